@@ -1,4 +1,34 @@
 #include "algo.hpp"
+#include <ua.hpp>
+#include <idp.hpp>
+#include <name.hpp>
+#include <xref.hpp>
+#include <algorithm>
+#include <fpro.h>
+
+//--------------------------------------------------------------------------
+/**
+* @brief Copy a view into a mutable graph and its nodes data
+*/
+static void view_to_mgraph(
+    gsview_t &view,
+    mutable_graph_t *mg,
+    gnodemap_t &node_map)
+{
+  int nodes_count = int(view.nodes.size());
+  mg->resize(nodes_count);
+  for (int nid=0; nid < nodes_count; nid++)
+  {
+    gnode_t *nc = node_map.add(nid);
+    nc->id = nid;
+    nc->text.swap(view.nodes[nid].text);
+    nc->hint.swap(view.nodes[nid].hint);
+
+    const intvec_t &succs = view.succs[nid];
+    for (size_t i=0; i < succs.size(); i++)
+      mg->add_edge(nid, succs[i], NULL);
+  }
+}
 
 //--------------------------------------------------------------------------
 bool func_to_mgraph(
@@ -6,7 +36,8 @@ bool func_to_mgraph(
     mutable_graph_t *mg,
     gnodemap_t &node_map,
     qflow_chart_t *fc,
-    bool append_node_id)
+    bool append_node_id,
+    const qstrvec_t *block_text)
 {
   // Build function's flowchart (if needed)
   qflow_chart_t _fc;
@@ -17,34 +48,41 @@ bool func_to_mgraph(
       return false;
   }
 
-  // Resize the graph
-  int nodes_count = fc->size();
-  mg->resize(nodes_count);
+  gsdb_fc_t gfc;
+  fc_to_gsdb_fc(fc, gfc);
 
-  // Build the node cache and edges
-  for (int nid=0; nid < nodes_count; nid++)
-  {
-    qbasic_block_t &block = fc->blocks[nid];
-    gnode_t *nc = node_map.add(nid);
+  gsview_t view;
+  gsview_build_single(get_ida_gsdb(), gfc, append_node_id, block_text, view);
+  view_to_mgraph(view, mg, node_map);
+  return true;
+}
 
-    // Append node ID to the output
-    if (append_node_id)
-      nc->text.sprnt("ID(%d)\n", nid);
+//--------------------------------------------------------------------------
+bool combined_mgraph(
+    ea_t func_ea,
+    groupman_t *gm,
+    gnodemap_t &node_map,
+    ng2nid_t &group2id,
+    mutable_graph_t *mg,
+    qflow_chart_t *fc,
+    const qstrvec_t *block_text)
+{
+  // Build function's flowchart (if needed)
+  qflow_chart_t _fc;
+  if (fc == NULL)
+  {
+    fc = &_fc;
+    if (!get_func_flowchart(func_ea, *fc))
+      return false;
+  }
 
-    // Generate disassembly text
-    get_disasm_text(
-        block.startEA, 
-        block.endEA, 
-        &nc->text);
+  gsdb_fc_t gfc;
+  fc_to_gsdb_fc(fc, gfc);
 
-    // Build edges
-    for (int nid_succ=0, succ_sz=fc->nsucc(nid); nid_succ < succ_sz; nid_succ++)
-    {
-      int nsucc = fc->succ(nid, nid_succ);
-      mg->add_edge(nid, nsucc, NULL);
-    }
-  }
-  return true;
+  gsview_t view;
+  bool ok = gsview_build_combined(get_ida_gsdb(), gfc, gm, block_text, group2id, view);
+  view_to_mgraph(view, mg, node_map);
+  return ok;
 }
 
 //--------------------------------------------------------------------------
@@ -149,9 +187,129 @@ void build_groupman_from_3dvec(
 }
 
 //--------------------------------------------------------------------------
-bool sanitize_groupman(
-  ea_t func_ea,
+psupergroup_t merge_2dvec_into_groupman(
+  int_2dvec_t &sg_vec,
   groupman_t *gm,
+  const char *sg_id)
+{
+  // Verify that no node was claimed already by another group
+  intset_t seen;
+  for (int_2dvec_t::iterator it_ng = sg_vec.begin();
+       it_ng != sg_vec.end();
+       ++it_ng)
+  {
+    for (intvec_t::iterator it_nd = it_ng->begin();
+         it_nd != it_ng->end();
+         ++it_nd)
+    {
+      nodeloc_t *loc = gm->find_nodeid_loc(*it_nd);
+      if (   loc == NULL
+          || loc->sg->gcount() != 1
+          || loc->ng->size() != 1
+          || !seen.insert(*it_nd).second)
+      {
+        return NULL;
+      }
+    }
+  }
+
+  psupergroup_t new_sg = new supergroup_t();
+  new_sg->id = sg_id;
+  new_sg->name = sg_id;
+
+  psupergroup_listp_t sgl = gm->get_path_sgl();
+  for (int_2dvec_t::iterator it_ng = sg_vec.begin();
+       it_ng != sg_vec.end();
+       ++it_ng)
+  {
+    pnodegroup_t ng = new_sg->add_nodegroup();
+    for (intvec_t::iterator it_nd = it_ng->begin();
+         it_nd != it_ng->end();
+         ++it_nd)
+    {
+      // Detach the ND from its own SG/NG then discard them
+      nodeloc_t *loc = gm->find_nodeid_loc(*it_nd);
+      pnodedef_t nd = loc->nd;
+      psupergroup_t old_sg = loc->sg;
+
+      loc->ng->remove(nd);
+      old_sg->remove_nodegroup(loc->ng, true);
+      sgl->remove_sg(old_sg, true);
+
+      ng->add_node(nd);
+    }
+  }
+
+  // Only the merged nodes moved: their old SGs are gone
+  gm->add_supergroup(sgl, new_sg);
+  gm->update_sg_lookups(new_sg);
+
+  return new_sg;
+}
+
+//--------------------------------------------------------------------------
+void get_range_features(
+  ea_t start,
+  ea_t end,
+  insn_featvec_t &insns)
+{
+  while (start < end)
+  {
+    int sz = decode_insn(start);
+    if (sz <= 0)
+      break;
+
+    insn_feat_t &f = insns.push_back();
+    f.ea = start;
+    f.itype = cmd.itype;
+    f.size = uchar(sz);
+    f.nops = 0;
+    for (int i=0; i < UA_MAXOP && i < BBF_MAXOP; i++)
+    {
+      op_t &op = cmd.Operands[i];
+      if (op.type == o_void)
+        break;
+
+      op_feat_t &of = f.ops[f.nops++];
+      of.type = op.type;
+      of.dtyp = op.dtyp;
+      of.reg = 0;
+      of.value = 0;
+      switch (op.type)
+      {
+        case o_reg:
+          of.reg = op.reg;
+          break;
+        case o_phrase:
+          of.reg = op.phrase;
+          break;
+        case o_displ:
+          of.reg = op.phrase;
+          of.value = op.addr;
+          break;
+        case o_imm:
+          of.value = op.value;
+          break;
+        case o_mem:
+        case o_near:
+        case o_far:
+          of.value = op.addr;
+          break;
+        default:
+          // Processor specific operands
+          of.reg = op.reg;
+          of.value = op.value;
+          break;
+      }
+    }
+    start += sz;
+  }
+}
+
+//--------------------------------------------------------------------------
+bool get_func_features(
+  ea_t func_ea,
+  func_features_t &ff,
   qflow_chart_t *fc)
 {
   // Build function's flowchart (if needed)
@@ -163,49 +321,188 @@ bool sanitize_groupman(
       return false;
   }
 
-  // Create a group for all potentially missing nodes
-  psupergroup_t missing_sg = new supergroup_t();
+  ff.clear();
+  ff.ea = func_ea;
+  for (int nid=0, nsize=fc->size(); nid < nsize; nid++)
+  {
+    qbasic_block_t &block = fc->blocks[nid];
 
-  int nodes_count = fc->size();
+    bbfeat_block_t &bb = ff.blocks.push_back();
+    bb.start = block.startEA;
+    bb.end = block.endEA;
+    bb.first_insn = int(ff.insns.size());
+    get_range_features(block.startEA, block.endEA, ff.insns);
+    bb.ninsns = int(ff.insns.size()) - bb.first_insn;
 
-  nid2ndef_t *nds = gm->get_nds();
+    bbfeat_hash_insns(
+      ff.insns.begin() + bb.first_insn, 
+      bb.ninsns, 
+      bb.hash);
 
-  // Verify that all nodes are present
-  for (int n=0; n < nodes_count; n++)
+    for (int i=0, n=fc->nsucc(nid); i < n; i++)
+      bb.succ.push_back(fc->succ(nid, i));
+
+    for (int i=0, n=fc->npred(nid); i < n; i++)
+      bb.pred.push_back(fc->pred(nid, i));
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------
+size_t get_db_features(func_featvec_t &funcs)
+{
+  funcs.qclear();
+  for (size_t i=0, n=get_func_qty(); i < n; i++)
   {
-    nid2ndef_t::iterator it = nds->find(n);
-    if (it != nds->end())
+    func_t *f = getn_func(i);
+    if (f == NULL)
       continue;
 
-    // Convert basic block to an ND
+    func_features_t &ff = funcs.push_back();
+    if (!get_func_features(f->startEA, ff))
+      funcs.pop_back();
+  }
+  return funcs.size();
+}
+
+//--------------------------------------------------------------------------
+size_t get_call_graph(
+  callgraph_t &cg,
+  qstrvec_t *names)
+{
+  // The functions are enumerated in address order
+  size_t nfuncs = get_func_qty();
+  eavec_t funcs;
+  funcs.reserve(nfuncs);
+  for (size_t i=0; i < nfuncs; i++)
+  {
+    func_t *f = getn_func(i);
+    if (f != NULL)
+      funcs.push_back(f->startEA);
+  }
+
+  // Walk the calls to each function: there are far fewer references
+  // to the function entries than instructions in the functions
+  intvec_t callers, callees;
+  for (size_t i=0; i < funcs.size(); i++)
+  {
+    xrefblk_t xb;
+    for (bool ok=xb.first_to(funcs[i], XREF_FAR); ok; ok=xb.next_to())
+    {
+      if (!xb.iscode || (xb.type != fl_CN && xb.type != fl_CF))
+        continue;
+
+      func_t *f = get_func(xb.from);
+      if (f == NULL)
+        continue;
+
+      const ea_t *p = std::lower_bound(funcs.begin(), funcs.end(), f->startEA);
+      if (p == funcs.end() || *p != f->startEA)
+        continue;
+
+      callers.push_back(int(p - funcs.begin()));
+      callees.push_back(int(i));
+    }
+  }
+  cg.build(funcs, callers, callees);
+
+  if (names != NULL)
+  {
+    names->resize(funcs.size());
+    char buf[MAXSTR];
+    for (size_t i=0; i < funcs.size(); i++)
+    {
+      if (get_func_name(funcs[i], buf, sizeof(buf)) == NULL)
+        (*names)[i].sprnt("sub_%a", funcs[i]);
+      else
+        (*names)[i] = buf;
+    }
+  }
+  return funcs.size();
+}
+
+//--------------------------------------------------------------------------
+uint64 get_fc_fingerprint(qflow_chart_t *fc)
+{
+  int nodes_count = fc->size();
+  fc_fingerprint_t fp(nodes_count);
+  for (int n=0; n < nodes_count; n++)
+  {
     qbasic_block_t &block = fc->blocks[n];
-    pnodedef_t nd = new nodedef_t();
-    nd->nid = n;
-    nd->start = block.startEA;
-    nd->end = block.endEA;
+    int nsucc = fc->nsucc(n);
+    fp.add_block(block.startEA, block.endEA, nsucc);
+    for (int i=0; i < nsucc; i++)
+      fp.add_succ(fc->succ(n, i));
+  }
+  return fp.value();
+}
 
-    // Add the node to its own group
-    pnodegroup_t ng = missing_sg->add_nodegroup();
-    ng->add_node(nd);
+//--------------------------------------------------------------------------
+/**
+* @brief Resolves the rules names with the processor module and the database
+*/
+class ida_rule_resolver_t: public rule_resolver_t
+{
+public:
+  virtual bool get_itypes(const char *mnem, intvec_t &itypes)
+  {
+    for (int itype=0; itype < ph.instruc_end; itype++)
+    {
+      const char *name = ph.instruc[itype].name;
+      if (name != NULL && stricmp(name, mnem) == 0)
+        itypes.push_back(itype);
+    }
+    return !itypes.empty();
   }
 
-  if (missing_sg->gcount() == 0)
+  virtual bool get_name_ea(const char *name, ea_t *ea)
   {
-    // No orphan nodes where found, get rid of the group
-    delete missing_sg;
+    *ea = ::get_name_ea(BADADDR, name);
+    return *ea != BADADDR;
   }
-  else
+};
+
+//--------------------------------------------------------------------------
+bool compile_rules_file(
+  const char *filename,
+  rulevec_t &rules,
+  qstring *errbuf)
+{
+  FILE *fp = qfopen(filename, "rb");
+  if (fp == NULL)
   {
-    // Found at least one orphan node, add it to the groupman
-    missing_sg->name = missing_sg->id = "orphan_nodes";
+    if (errbuf != NULL)
+      errbuf->sprnt("cannot open '%s'", filename);
+    return false;
+  }
+
+  qvector<char> text;
+  text.resize(size_t(qfsize(fp)) + 1, '\0');
+  qfread(fp, text.begin(), text.size() - 1);
+  qfclose(fp);
 
-    // This is a synthetic group
-    missing_sg->is_synthetic = true;
+  ida_rule_resolver_t resolver;
+  return rules_compile(text.begin(), resolver, rules, errbuf);
+}
 
-    gm->add_supergroup(
-          gm->get_path_sgl(),
-          missing_sg);
+//--------------------------------------------------------------------------
+bool sanitize_groupman(
+  ea_t func_ea,
+  groupman_t *gm,
+  qflow_chart_t *fc)
+{
+  // Build function's flowchart (if needed)
+  qflow_chart_t _fc;
+  if (fc == NULL)
+  {
+    fc = &_fc;
+    if (!get_func_flowchart(func_ea, *fc))
+      return false;
   }
 
+  gsdb_fc_t gfc;
+  fc_to_gsdb_fc(fc, gfc);
+  gsview_sanitize_groupman(gfc, gm);
+
   return true;
 }
\ No newline at end of file
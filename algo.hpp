@@ -24,6 +24,16 @@ History
 11/01/2013 - eliasb     - Now sanitize_groupman()' sanitized the path SGL only
                         - Added build_groupman_from_fc and build_groupman_from_3dvec functions
 04/10/2014 - eliasb     - fix: Auto increment SG number when building the info from BBMatch!Analyze()
+10/18/2026 - eliasb     - Added merge_2dvec_into_groupman() to add streamed analysis results
+                        - Added get_range_features() to decode instruction features
+                        - Added get_func_features() and get_db_features()
+                        - Added get_fc_fingerprint()
+                        - Added compile_rules_file()
+                        - Added get_call_graph()
+                        - The graph builders take the blocks text from the shared flowcharts cache
+                        - The graph builders and sanitize_groupman() run on the IDA independent views (see gsview.h)
+                        - Replaced the fc_to_combined_mg class by combined_mgraph()
+                        - fix: merge_2dvec_into_groupman() updates the lookups of the merged nodes only
 --------------------------------------------------------------------------*/
 
 
@@ -35,197 +45,39 @@ History
 #include <graph.hpp>
 #include "groupman.h"
 #include "util.h"
+#include "bbfeat.h"
+#include "rules.h"
+#include "callgraph.h"
+#include "gsview.h"
 
 //--------------------------------------------------------------------------
 /**
-* @brief Creates a mutable graph that have the combined nodes per the groupmanager
-*        A class was used to simulate nested functions needed by the combine algo
+* @brief Build the combined mutable graph of a function per the groupman
+*        (see gsview_build_combined())
+* @param block_text - optional: the disassembly text of each block
+* @return False if a block is not in the groupman
 */
-class fc_to_combined_mg
-{
-  // Create a mapping between single node ids and the nodedef list they belong to
-  ng2nid_t *group2id;
-
-  gnodemap_t *node_map;
-  groupman_t *gm;
-  qflow_chart_t *fc;
-  bool show_nids_only;
-
-  /**
-  * @brief Create and return a groupped node ID
-  */
-  int get_groupid(int n)
-  {
-    int group_id;
-
-    // Find how this single node is defined in the group manager
-    nodeloc_t *loc = gm->find_nodeid_loc(n);
-    if (loc == NULL)
-      return -1;
-
-    // Does this node have a group yet? (ndl)
-    ng2nid_t::iterator it = group2id->find(loc->ng);
-    if (it == group2id->end())
-    {
-      // Assign an auto-increment id
-      group_id = group2id->size();  
-      (*group2id)[loc->ng] = group_id;
-
-      // Initialize this group's node id
-      gnode_t gn;
-      gn.id = group_id;
-      size_t t = loc->ng->size();
-      for (nodegroup_t::iterator it=loc->ng->begin();
-           it != loc->ng->end();
-           ++it)
-      {
-        if (show_nids_only)
-        {
-          gn.text.cat_sprnt("%d", (*it)->nid);
-          if (--t > 0)
-            gn.text.append(", ");
-        }
-
-        qbasic_block_t &block = fc->blocks[(*it)->nid];
-        qstring s;
-        get_disasm_text(
-          block.startEA, 
-          block.endEA, 
-          &s);
-        gn.hint.append(s);
-      }
-
-      if (!show_nids_only)
-      {
-        // Are there any groupped nodes?
-        if (loc->ng->size() > 1)
-        {
-          //TODO: OPTION: enlarge groupped label
-          gn.text.append("\n\n\n");
-
-          // Display the group name or the group id
-          gn.text.append(loc->sg->get_display_name());
-
-          gn.text.append("\n\n\n");
-        }
-        else
-        {
-          gn.text = gn.hint;
-        }
-      }
-
-      // Cache the node data
-      (*node_map)[group_id] = gn;
-    }
-    else
-    {
-      // Grab the group id
-      group_id = it->second;
-    }
-
-    return group_id;
-  }
-
-  /**
-  * @brief Build the combined mutable graph from the groupman and a flowchart
-  */
-  bool build(
-    qflow_chart_t *fc,
+bool combined_mgraph(
+    ea_t func_ea,
     groupman_t *gm,
     gnodemap_t &node_map,
     ng2nid_t &group2id,
-    mutable_graph_t *mg)
-  {
-    // Take a reference to the local variables so they are used
-    // in the other helper functions
-    this->gm = gm;
-    this->node_map = &node_map;
-    this->fc = fc;
-  	this->group2id = &group2id;
-
-    // Compute the total size of nodes needed for the combined graph
-    // The size is the total count of node def lists in each group def
-    size_t node_count = 0;
-    for (supergroup_listp_t::iterator it=gm->get_path_sgl()->begin();
-         it != gm->get_path_sgl()->end();
-         ++it)
-    {
-      psupergroup_t sg = *it;
-      node_count += sg->gcount();
-    }
-
-    // Resize the graph
-    mg->resize(node_count);
-
-    // Build the combined graph
-    int snodes_count = fc->size();
-    for (int nid=0; nid < snodes_count; nid++)
-    {
-      // Figure out the combined node ID
-      int group_id = get_groupid(nid);
-      if (group_id == -1)
-        return false;
-
-      // Build the edges
-      for (int isucc=0, succ_sz=fc->nsucc(nid); 
-           isucc < succ_sz; 
-           isucc++)
-      {
-        // Get the successor node
-        int nid_succ = fc->succ(nid, isucc);
-
-        // This node belongs to the same group?
-        int succ_grid = get_groupid(nid_succ);
-        if (succ_grid == -1)
-          return false;
-
-        if (succ_grid == group_id)
-        {
-          // Do nothing, consider as one node
-          continue;
-        }
-        // Add an edge
-        mg->add_edge(group_id, succ_grid, NULL);
-      }
-    }
-    return true;
-  }
-
-public:
-  /**
-  * @brief Operator to call the class as a function
-  */
-  fc_to_combined_mg(
-      ea_t func_ea,
-      groupman_t *gm,
-      gnodemap_t &node_map,
-      ng2nid_t &group2id,
-      mutable_graph_t *mg,
-      qflow_chart_t *fc = NULL): show_nids_only(false)
-  {
-    // Build function's flowchart (if needed)
-    qflow_chart_t _fc;
-    if (fc == NULL)
-    {
-      fc = &_fc;
-      if (!get_func_flowchart(func_ea, *fc))
-        return;
-    }
-
-    build(fc, gm, node_map, group2id, mg);
-  }
-};
+    mutable_graph_t *mg,
+    qflow_chart_t *fc = NULL,
+    const qstrvec_t *block_text = NULL);
 
 //--------------------------------------------------------------------------
 /**
 * @brief Build a mutable graph from a function address
+* @param block_text - optional: the disassembly text of each block
 */
 bool func_to_mgraph(
     ea_t func_ea,
     mutable_graph_t *mg,
     gnodemap_t &node_map,
     qflow_chart_t *fc = NULL,
-    bool append_node_id = false);
+    bool append_node_id = false,
+    const qstrvec_t *block_text = NULL);
 
 //--------------------------------------------------------------------------
 /**
@@ -246,6 +98,69 @@ void build_groupman_from_3dvec(
   groupman_t *gm,
   bool sanitize);
 
+//--------------------------------------------------------------------------
+/**
+* @brief Merge one super group (defined as a 2d int vec) into a live groupman.
+*        All the nodes must still be in their own SG/NG, otherwise nothing is merged
+* @return The new super group or NULL
+*/
+psupergroup_t merge_2dvec_into_groupman(
+  int_2dvec_t &sg_vec,
+  groupman_t *gm,
+  const char *sg_id);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Decode the instructions in the given range and append their features
+*/
+void get_range_features(
+  ea_t start,
+  ea_t end,
+  insn_featvec_t &insns);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Extract the features (blocks, edges, instructions and hashes) of a function
+*/
+bool get_func_features(
+  ea_t func_ea,
+  func_features_t &ff,
+  qflow_chart_t *fc = NULL);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Extract the features of all the functions in the database
+* @return The count of functions
+*/
+size_t get_db_features(func_featvec_t &funcs);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Build the call graph of the database from the code cross references
+* @param names - optional: the function names
+* @return The count of functions
+*/
+size_t get_call_graph(
+  callgraph_t &cg,
+  qstrvec_t *names = NULL);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Compute the fingerprint of a flowchart (block ranges and edges)
+*        It is stored in the bbgroup file to skip sanitize_groupman() on load
+*/
+uint64 get_fc_fingerprint(qflow_chart_t *fc);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Load and compile a grouping rules file. The mnemonics are resolved
+*        with the processor module and the names with the database
+*/
+bool compile_rules_file(
+  const char *filename,
+  rulevec_t &rules,
+  qstring *errbuf);
+
 //--------------------------------------------------------------------------
 /**
 * @brief Sanitize the contents of the groupman path SGL versus the flowchart 
@@ -0,0 +1,384 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+--------------------------------------------------------------------------*/
+
+#include "bbalign.h"
+#include <algorithm>
+#ifdef BBALIGN_SSE2
+  #include <emmintrin.h>
+#endif
+
+//--------------------------------------------------------------------------
+// Token of the padding: it matches no instruction token
+static const uint16 PAD_TOKEN = 0xFFFF;
+
+// Padding around the sequences: the band reads up to BBALIGN_MAX_DIST
+// tokens before a sequence and 16 tokens past its end
+static const int PAD_LEN = 16;
+
+// Cells of the band that are out of the alignment matrix
+static const int INF_DIST = 0xFF;
+
+//--------------------------------------------------------------------------
+static inline uint64 mix_token(uint64 x)
+{
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+
+//--------------------------------------------------------------------------
+bbalign_seqs_t::bbalign_seqs_t(bbhash_level_e level): level(level)
+{
+  add_padding();
+}
+
+//--------------------------------------------------------------------------
+void bbalign_seqs_t::add_padding()
+{
+  for (int i=0; i < PAD_LEN; i++)
+    tokens.push_back(PAD_TOKEN);
+}
+
+//--------------------------------------------------------------------------
+int bbalign_seqs_t::add(const insn_feat_t *insns, size_t count)
+{
+  seq_t &s = seqs.push_back();
+  s.start = int(tokens.size());
+  s.len = int(count);
+  memset(s.sig, 0, sizeof(s.sig));
+
+  for (size_t i=0; i < count; i++)
+  {
+    uint64 key = bbfeat_insn_key(insns[i], level);
+    std::map<uint64, int>::iterator it = alphabet.find(key);
+    if (it == alphabet.end())
+      it = alphabet.insert(std::make_pair(key, int(alphabet.size()))).first;
+
+    // Large alphabets fold (the distance then becomes a lower bound)
+    uint16 t = uint16(it->second % PAD_TOKEN);
+    tokens.push_back(t);
+
+    uchar &c = s.sig[t & 15];
+    if (c != 0xFF)
+      ++c;
+  }
+  add_padding();
+  return size() - 1;
+}
+
+//--------------------------------------------------------------------------
+int bbalign_seqs_t::lower_bound(int s1, int s2) const
+{
+  // Each edit changes the count of at most one token of each side, so the
+  // histograms differences bound the distance. The saturated counts and
+  // the merged buckets only make the bound smaller
+  const seq_t &a = seqs[s1];
+  const seq_t &b = seqs[s2];
+#ifdef BBALIGN_SSE2
+  __m128i va = _mm_loadu_si128((const __m128i *)a.sig);
+  __m128i vb = _mm_loadu_si128((const __m128i *)b.sig);
+  __m128i zero = _mm_setzero_si128();
+  __m128i sab = _mm_sad_epu8(_mm_subs_epu8(va, vb), zero);
+  __m128i sba = _mm_sad_epu8(_mm_subs_epu8(vb, va), zero);
+  int ab = _mm_cvtsi128_si32(sab) + _mm_cvtsi128_si32(_mm_srli_si128(sab, 8));
+  int ba = _mm_cvtsi128_si32(sba) + _mm_cvtsi128_si32(_mm_srli_si128(sba, 8));
+#else
+  int ab = 0, ba = 0;
+  for (int i=0; i < 16; i++)
+  {
+    int d = int(a.sig[i]) - int(b.sig[i]);
+    if (d > 0)
+      ab += d;
+    else
+      ba -= d;
+  }
+#endif
+  return qmax(qmax(ab, ba), qabs(a.len - b.len));
+}
+
+//--------------------------------------------------------------------------
+int bbalign_seqs_t::distance(int s1, int s2, int max_dist) const
+{
+  return bbalign_banded_distance(
+      get_tokens(s1), length(s1),
+      get_tokens(s2), length(s2),
+      max_dist);
+}
+
+//--------------------------------------------------------------------------
+int bbalign_banded_distance(
+    const uint16 *a,
+    int n,
+    const uint16 *b,
+    int m,
+    int max_dist)
+{
+  int k = qmin(qmax(max_dist, 0), BBALIGN_MAX_DIST);
+  if (qabs(n - m) > k)
+    return k + 1;
+
+  if (n == 0 || m == 0)
+    return qmax(n, m);
+
+  // Row i of the band holds the cells (i, j = i + d - k), d in [0, 2k]
+  int w = 2 * k + 1;
+  int target = m - n + k;
+
+#ifdef BBALIGN_SSE2
+  uchar row0[16];
+  for (int d=0; d < 16; d++)
+    row0[d] = uchar(d < w && d >= k ? d - k : INF_DIST);
+
+  // The lanes past the band are kept out of the matrix
+  uchar hi[16];
+  for (int d=0; d < 16; d++)
+    hi[d] = uchar(d < w ? 0 : 0xFF);
+
+  __m128i prev = _mm_loadu_si128((const __m128i *)row0);
+  __m128i outside = _mm_loadu_si128((const __m128i *)hi);
+  __m128i one = _mm_set1_epi8(1);
+  __m128i kvec = _mm_set1_epi8(char(k));
+  __m128i zero = _mm_setzero_si128();
+
+  // Shifted lanes enter as out of the matrix
+  __m128i low1 = _mm_srli_si128(_mm_set1_epi8(-1), 15);
+  __m128i low2 = _mm_srli_si128(_mm_set1_epi8(-1), 14);
+  __m128i low4 = _mm_srli_si128(_mm_set1_epi8(-1), 12);
+  __m128i low8 = _mm_srli_si128(_mm_set1_epi8(-1), 8);
+
+  for (int i=1; i <= n; i++)
+  {
+    // Substitution: b[j - 1] for the 16 lanes
+    const uint16 *bp = b + (i - 1 - k);
+    __m128i tok = _mm_set1_epi16(short(a[i - 1]));
+    __m128i e0 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)bp), tok);
+    __m128i e1 = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(bp + 8)), tok);
+    __m128i mismatch = _mm_andnot_si128(_mm_packs_epi16(e0, e1), one);
+    __m128i cur = _mm_adds_epu8(prev, mismatch);
+
+    // Deletion: cell (i - 1, j) is the next lane of the previous row
+    cur = _mm_min_epu8(cur, _mm_adds_epu8(_mm_srli_si128(prev, 1), one));
+
+    // Insertion: cell (i, j - 1) is the previous lane of this row.
+    // The chain of insertions is resolved with a min-scan
+    cur = _mm_min_epu8(cur, _mm_adds_epu8(_mm_or_si128(_mm_slli_si128(cur, 1), low1), one));
+    cur = _mm_min_epu8(cur, _mm_adds_epu8(_mm_or_si128(_mm_slli_si128(cur, 2), low2), _mm_set1_epi8(2)));
+    cur = _mm_min_epu8(cur, _mm_adds_epu8(_mm_or_si128(_mm_slli_si128(cur, 4), low4), _mm_set1_epi8(4)));
+    cur = _mm_min_epu8(cur, _mm_adds_epu8(_mm_or_si128(_mm_slli_si128(cur, 8), low8), _mm_set1_epi8(8)));
+    cur = _mm_or_si128(cur, outside);
+
+    // The distance never decreases down the rows: stop when the whole band is past k
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(cur, kvec), zero)) == 0)
+      return k + 1;
+
+    prev = cur;
+  }
+
+  uchar last[16];
+  _mm_storeu_si128((__m128i *)last, prev);
+  return qmin(int(last[target]), k + 1);
+#else
+  int prev[2 * BBALIGN_MAX_DIST + 2], cur[2 * BBALIGN_MAX_DIST + 2];
+  for (int d=0; d <= w; d++)
+    prev[d] = d < w && d >= k ? d - k : INF_DIST;
+  cur[w] = INF_DIST;
+
+  for (int i=1; i <= n; i++)
+  {
+    int row_min = INF_DIST;
+    for (int d=0; d < w; d++)
+    {
+      int j = i + d - k;
+      int v = INF_DIST;
+      if (j >= 0)
+      {
+        v = prev[d + 1] + 1;
+        if (j > 0)
+          v = qmin(v, prev[d] + (a[i - 1] == b[j - 1] ? 0 : 1));
+        if (d > 0)
+          v = qmin(v, cur[d - 1] + 1);
+      }
+      cur[d] = qmin(v, INF_DIST);
+      row_min = qmin(row_min, cur[d]);
+    }
+
+    if (row_min > k)
+      return k + 1;
+
+    memcpy(prev, cur, sizeof(prev));
+  }
+  return qmin(prev[target], k + 1);
+#endif
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief A block in a min-hash bucket
+*/
+struct bucket_entry_t
+{
+  uint64 h;
+  int seq;
+
+  bool operator<(const bucket_entry_t &o) const
+  {
+    return h < o.h || (h == o.h && seq < o.seq);
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Union-find over the sequences
+*/
+static int find_root(intvec_t &parent, int x)
+{
+  while (parent[x] != x)
+  {
+    parent[x] = parent[parent[x]];
+    x = parent[x];
+  }
+  return x;
+}
+
+//--------------------------------------------------------------------------
+size_t find_near_duplicate_blocks(
+    const func_features_t *funcs,
+    size_t nfuncs,
+    const bbalign_params_t &params,
+    bbalign_groupvec_t &out,
+    bbalign_stats_t *stats)
+{
+  bbalign_stats_t _stats;
+  if (stats == NULL)
+    stats = &_stats;
+  *stats = bbalign_stats_t();
+
+  out.qclear();
+  int max_dist = qmin(qmax(params.max_dist, 0), BBALIGN_MAX_DIST);
+
+  // Encode the blocks
+  bbalign_seqs_t seqs(params.level);
+  qvector<bbalign_block_t> seq2block;
+  for (size_t f=0; f < nfuncs; f++)
+  {
+    const func_features_t &ff = funcs[f];
+    for (size_t b=0; b < ff.blocks.size(); b++)
+    {
+      const bbfeat_block_t &bb = ff.blocks[b];
+      if (bb.ninsns < params.min_insns)
+        continue;
+
+      seqs.add(ff.insns.begin() + bb.first_insn, bb.ninsns);
+      bbalign_block_t &sb = seq2block.push_back();
+      sb.func = int(f);
+      sb.block = int(b);
+    }
+  }
+  int nseqs = seqs.size();
+  stats->blocks = nseqs;
+
+  // Min-hash buckets of the token sets
+  qvector<bucket_entry_t> buckets;
+  for (int h=0; h < params.nhashes; h++)
+  {
+    uint64 seed = mix_token(uint64(h) + 1);
+    for (int s=0; s < nseqs; s++)
+    {
+      const uint16 *t = seqs.get_tokens(s);
+      uint64 best = ~uint64(0);
+      for (int i=0, len=seqs.length(s); i < len; i++)
+        best = qmin(best, mix_token(t[i] ^ seed));
+
+      bucket_entry_t &e = buckets.push_back();
+      e.h = best ^ (seed << 1);
+      e.seq = s;
+    }
+  }
+  std::sort(buckets.begin(), buckets.end());
+
+  // Distinct candidate pairs
+  uint64vec_t pairs;
+  for (size_t i=0; i < buckets.size(); )
+  {
+    size_t e = i + 1;
+    while (e < buckets.size() && buckets[e].h == buckets[i].h)
+      ++e;
+
+    size_t last = qmin(e, i + size_t(params.max_bucket));
+    for (size_t x=i; x < last; x++)
+    {
+      for (size_t y=x + 1; y < last; y++)
+        pairs.push_back((uint64(buckets[x].seq) << 32) | uint32(buckets[y].seq));
+    }
+    i = e;
+  }
+  std::sort(pairs.begin(), pairs.end());
+  pairs.resize(std::unique(pairs.begin(), pairs.end()) - pairs.begin());
+  stats->candidates = int(pairs.size());
+
+  // Confirm the pairs and join them
+  intvec_t parent, group_dist;
+  parent.resize(nseqs);
+  group_dist.resize(nseqs, 0);
+  for (int s=0; s < nseqs; s++)
+    parent[s] = s;
+
+  int min_dist = params.report_exact ? 0 : 1;
+  for (size_t i=0; i < pairs.size(); i++)
+  {
+    int s1 = int(pairs[i] >> 32), s2 = int(uint32(pairs[i]));
+    if (seqs.lower_bound(s1, s2) > max_dist)
+    {
+      ++stats->prefiltered;
+      continue;
+    }
+
+    ++stats->aligned;
+    int dist = seqs.distance(s1, s2, max_dist);
+    if (dist > max_dist || dist < min_dist)
+      continue;
+
+    ++stats->confirmed;
+    int r1 = find_root(parent, s1), r2 = find_root(parent, s2);
+    int gd = qmax(dist, qmax(group_dist[r1], group_dist[r2]));
+    if (r1 != r2)
+      parent[qmax(r1, r2)] = qmin(r1, r2);
+    group_dist[qmin(r1, r2)] = gd;
+  }
+
+  // The groups in the order of their first block
+  intvec_t root2group;
+  root2group.resize(nseqs, -1);
+  for (int s=0; s < nseqs; s++)
+  {
+    int &g = root2group[find_root(parent, s)];
+    if (g == -1)
+    {
+      g = int(out.size());
+      bbalign_group_t &grp = out.push_back();
+      grp.max_dist = group_dist[find_root(parent, s)];
+    }
+    out[g].blocks.push_back(seq2block[s]);
+  }
+
+  // Drop the blocks without a near-duplicate
+  size_t w = 0;
+  for (size_t g=0; g < out.size(); g++)
+  {
+    if (out[g].blocks.size() < 2)
+      continue;
+    if (w != g)
+      out[w] = out[g];
+    ++w;
+  }
+  out.resize(w);
+  return out.size();
+}
@@ -0,0 +1,205 @@
+#ifndef __BBALIGN__
+#define __BBALIGN__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Near-duplicate blocks module
+
+Blocks of inlined code often differ by one or two inserted or spilled
+instructions, so their hashes differ at every level. This module confirms
+such pairs with the edit distance of their normalized instruction keys,
+bounded by a small maximum distance.
+
+The keys are mapped to 16 bits tokens and the distance is computed on a
+diagonal band of the alignment matrix: one row of the band fits in one
+SSE2 register (8 bits saturated cells) and the in-row (insertion)
+dependency is resolved with a logarithmic min-scan. A cheaper prefilter
+runs first: the difference of the tokens histograms (16 buckets, one SSE2
+register) is a lower bound of the distance.
+
+The candidate pairs come from min-hash buckets of the blocks' token sets,
+so blocks that differ by a few instructions most likely share a bucket.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <map>
+#include "bbfeat.h"
+
+//--------------------------------------------------------------------------
+// The banded distance is vectorized with SSE2 unless BBALIGN_NO_SIMD is defined
+#if !defined(BBALIGN_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #define BBALIGN_SSE2
+#endif
+
+//--------------------------------------------------------------------------
+// Largest supported maximum distance: the band (2*d+1 cells) fits in 16 lanes
+#define BBALIGN_MAX_DIST 7
+
+//--------------------------------------------------------------------------
+/**
+* @brief Encoded instruction sequences, stored back to back with a
+*        padding of tokens that match nothing around each of them
+*/
+class bbalign_seqs_t
+{
+  typedef qvector<uint16> tokenvec_t;
+
+  struct seq_t
+  {
+    int start;
+    int len;
+    uchar sig[16];
+  };
+
+  bbhash_level_e level;
+  std::map<uint64, int> alphabet;
+  tokenvec_t tokens;
+  qvector<seq_t> seqs;
+
+  void add_padding();
+
+public:
+  bbalign_seqs_t(bbhash_level_e level = bbh_optype);
+
+  /**
+  * @brief Encode and add an instruction sequence
+  * @return The sequence index
+  */
+  int add(const insn_feat_t *insns, size_t count);
+
+  inline int size() const { return int(seqs.size()); }
+  inline int length(int s) const { return seqs[s].len; }
+  inline const uint16 *get_tokens(int s) const { return tokens.begin() + seqs[s].start; }
+
+  /**
+  * @brief Cheap lower bound of the distance of two sequences
+  */
+  int lower_bound(int s1, int s2) const;
+
+  /**
+  * @brief Edit distance of two sequences, capped to max_dist + 1
+  */
+  int distance(int s1, int s2, int max_dist) const;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Banded edit distance of two token sequences, capped to max_dist + 1.
+*        The tokens before and after 'b' must be readable (see bbalign_seqs_t)
+*/
+int bbalign_banded_distance(
+    const uint16 *a,
+    int n,
+    const uint16 *b,
+    int m,
+    int max_dist);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Near-duplicate blocks search parameters
+*/
+struct bbalign_params_t
+{
+  /**
+  * @brief Maximum edit distance (in instructions), at most BBALIGN_MAX_DIST
+  */
+  int max_dist;
+
+  /**
+  * @brief Blocks shorter than this (in instructions) are ignored
+  */
+  int min_insns;
+
+  /**
+  * @brief Instruction normalization level
+  */
+  bbhash_level_e level;
+
+  /**
+  * @brief Count of min-hash buckets per block
+  */
+  int nhashes;
+
+  /**
+  * @brief Maximum blocks paired per bucket
+  */
+  int max_bucket;
+
+  /**
+  * @brief Also report the blocks that are equal at the normalization level
+  *        (the block matcher already finds those)
+  */
+  bool report_exact;
+
+  bbalign_params_t(): max_dist(2), min_insns(4), level(bbh_optype),
+    nhashes(2), max_bucket(256), report_exact(false)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Statistics of a near-duplicate blocks search
+*/
+struct bbalign_stats_t
+{
+  // Blocks considered
+  int blocks;
+
+  // Distinct pairs that share a bucket
+  int candidates;
+
+  // Pairs rejected by the length and histogram prefilter
+  int prefiltered;
+
+  // Pairs that were aligned, and those within the maximum distance
+  int aligned;
+  int confirmed;
+
+  bbalign_stats_t(): blocks(0), candidates(0), prefiltered(0), aligned(0), confirmed(0)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief A block of one of the functions
+*/
+struct bbalign_block_t
+{
+  int func;
+  int block;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief A set of near-duplicate blocks (connected by confirmed pairs)
+*/
+struct bbalign_group_t
+{
+  /**
+  * @brief Largest distance of the confirmed pairs
+  */
+  int max_dist;
+  qvector<bbalign_block_t> blocks;
+};
+typedef qvector<bbalign_group_t> bbalign_groupvec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Find the near-duplicate blocks in a set of functions
+* @return The count of groups found
+*/
+size_t find_near_duplicate_blocks(
+    const func_features_t *funcs,
+    size_t nfuncs,
+    const bbalign_params_t &params,
+    bbalign_groupvec_t &out,
+    bbalign_stats_t *stats = NULL);
+
+#endif
@@ -0,0 +1,166 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version: instruction features and normalized block hashes
+                                - Added func_features_t
+--------------------------------------------------------------------------*/
+
+#include "bbfeat.h"
+#include <ua.hpp>
+
+//--------------------------------------------------------------------------
+// Seed of all the hash levels (FNV-1a offset basis)
+static const uint64 BBH_SEED = 0xCBF29CE484222325ULL;
+
+//--------------------------------------------------------------------------
+// Value used in place of masked immediates / displacements / addresses
+static const uint64 BBH_MASKED = 0x6D61736B6564ULL;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Mix a 64-bit value into a running hash
+*/
+static inline uint64 mix64(uint64 h, uint64 v)
+{
+  v ^= v >> 33;
+  v *= 0xFF51AFD7ED558CCDULL;
+  v ^= v >> 33;
+  return (h ^ v) * 0x100000001B3ULL;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Renames registers by their first use order within a block
+*/
+class regren_t
+{
+  uint16 regs[64];
+  int count;
+public:
+  regren_t(): count(0)
+  {
+  }
+
+  int rename(uint16 reg)
+  {
+    for (int i=0; i < count; i++)
+    {
+      if (regs[i] == reg)
+        return i + 1;
+    }
+    // Too many registers: do not rename
+    if (count == qnumber(regs))
+      return 0x10000 + reg;
+
+    regs[count++] = reg;
+    return count;
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Does the operand use a register?
+*/
+static inline bool op_has_reg(const op_feat_t &op)
+{
+  return op.type == o_reg || op.type == o_phrase || op.type == o_displ;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Is the operand value a code address? Those are always masked
+*/
+static inline bool op_is_code_addr(const op_feat_t &op)
+{
+  return op.type == o_near || op.type == o_far;
+}
+
+//--------------------------------------------------------------------------
+void bbfeat_hash_insns(
+    const insn_feat_t *insns,
+    size_t count,
+    bbhash_t &out)
+{
+  for (int i=0; i < bbh_count; i++)
+    out.h[i] = BBH_SEED;
+
+  regren_t ren;
+  for (size_t n=0; n < count; n++)
+  {
+    const insn_feat_t &insn = insns[n];
+    for (int i=0; i < bbh_count; i++)
+      out.h[i] = mix64(out.h[i], insn.itype);
+
+    for (int iop=0; iop < insn.nops; iop++)
+    {
+      const op_feat_t &op = insn.ops[iop];
+      uint64 optype = (uint64(op.type) << 8) | op.dtyp;
+      for (int i=bbh_optype; i < bbh_count; i++)
+        out.h[i] = mix64(out.h[i], optype);
+
+      // Registers
+      if (op_has_reg(op))
+      {
+        int r = ren.rename(op.reg);
+        out.h[bbh_regren] = mix64(out.h[bbh_regren], r);
+        out.h[bbh_regimm] = mix64(out.h[bbh_regimm], r);
+        out.h[bbh_exact]  = mix64(out.h[bbh_exact], op.reg);
+      }
+
+      // Values: immediates, displacements and addresses
+      if (op.type == o_reg)
+        continue;
+
+      uint64 v = op_is_code_addr(op) ? BBH_MASKED : op.value;
+      out.h[bbh_regren] = mix64(out.h[bbh_regren], BBH_MASKED);
+      out.h[bbh_regimm] = mix64(out.h[bbh_regimm], v);
+      out.h[bbh_exact]  = mix64(out.h[bbh_exact], v);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------
+uint64 bbfeat_insn_key(
+    const insn_feat_t &insn,
+    bbhash_level_e level)
+{
+  uint64 h = mix64(BBH_SEED, insn.itype);
+  if (level == bbh_itype)
+    return h;
+
+  for (int iop=0; iop < insn.nops; iop++)
+  {
+    const op_feat_t &op = insn.ops[iop];
+    h = mix64(h, (uint64(op.type) << 8) | op.dtyp);
+    if (level < bbh_exact)
+      continue;
+
+    if (op_has_reg(op))
+      h = mix64(h, op.reg);
+
+    if (op.type != o_reg)
+      h = mix64(h, op_is_code_addr(op) ? BBH_MASKED : op.value);
+  }
+  return h;
+}
+
+//--------------------------------------------------------------------------
+void func_features_t::clear()
+{
+  ea = BADADDR;
+  blocks.qclear();
+  insns.qclear();
+}
+
+//--------------------------------------------------------------------------
+int func_features_t::find_block(ea_t addr) const
+{
+  for (size_t i=0; i < blocks.size(); i++)
+  {
+    const bbfeat_block_t &b = blocks[i];
+    if (addr >= b.start && addr < b.end)
+      return int(i);
+  }
+  return -1;
+}
@@ -0,0 +1,160 @@
+#ifndef __BBFEAT__
+#define __BBFEAT__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Block features module
+
+This module defines the per-instruction features that are decoded once
+from the database and the normalized block hashes computed from them.
+It does not call the IDA kernel so it can be used in headless tools.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+
+//--------------------------------------------------------------------------
+// Maximum operands per instruction (same as UA_MAXOP)
+#define BBF_MAXOP 6
+
+//--------------------------------------------------------------------------
+/**
+* @brief Features of one operand
+*/
+struct op_feat_t
+{
+  /**
+  * @brief Operand type (o_reg, o_imm, ...) and data type
+  */
+  uchar type;
+  uchar dtyp;
+
+  /**
+  * @brief Register for o_reg or base register for o_phrase/o_displ
+  */
+  uint16 reg;
+
+  /**
+  * @brief Immediate value, displacement or address
+  */
+  uint64 value;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Features of one decoded instruction
+*/
+struct insn_feat_t
+{
+  ea_t ea;
+  uint16 itype;
+  uchar size;
+  uchar nops;
+  op_feat_t ops[BBF_MAXOP];
+};
+typedef qvector<insn_feat_t> insn_featvec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Normalization levels of the block hashes. From the loosest to the strictest
+*/
+enum bbhash_level_e
+{
+  // Instruction types only
+  bbh_itype  = 0,
+
+  // Instruction types, operand types and data types
+  bbh_optype = 1,
+
+  // Registers renamed by first use order. Immediates, displacements and addresses masked
+  bbh_regren = 2,
+
+  // Registers renamed by first use order. Immediates, displacements and data addresses kept
+  bbh_regimm = 3,
+
+  // Actual registers, immediates, displacements and data addresses
+  bbh_exact  = 4,
+
+  bbh_count
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief All the normalized hashes of a block
+*/
+struct bbhash_t
+{
+  uint64 h[bbh_count];
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Features of one basic block
+*/
+struct bbfeat_block_t
+{
+  ea_t start;
+  ea_t end;
+
+  /**
+  * @brief Index of the first instruction in the owning func_features_t::insns
+  */
+  int first_insn;
+  int ninsns;
+
+  /**
+  * @brief Successor and predecessor block indices
+  */
+  intvec_t succ;
+  intvec_t pred;
+
+  bbhash_t hash;
+};
+typedef qvector<bbfeat_block_t> bbfeat_blockvec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Features of a function: its blocks (in flowchart order) and
+*        the instructions of all the blocks
+*/
+struct func_features_t
+{
+  ea_t ea;
+  bbfeat_blockvec_t blocks;
+  insn_featvec_t insns;
+
+  func_features_t(): ea(BADADDR)
+  {
+  }
+
+  void clear();
+
+  /**
+  * @brief Return the index of the block containing the address or -1
+  */
+  int find_block(ea_t addr) const;
+};
+typedef qvector<func_features_t> func_featvec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Compute all the hash levels of an instruction sequence in one pass
+*/
+void bbfeat_hash_insns(
+    const insn_feat_t *insns,
+    size_t count,
+    bbhash_t &out);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Hash a single instruction at the given level.
+*        Registers are not renamed (there is no block context)
+*/
+uint64 bbfeat_insn_key(
+    const insn_feat_t &insn,
+    bbhash_level_e level);
+
+#endif
@@ -21,6 +21,9 @@ This module contains IDA specific basic block datatypes and helper functions
                       - Made Rekeying optional and off by default (since it will mess up relative comparison)
 					  - Enforce division by floats where needed
 					  - Avoid division by zero
+10/18/2026 - eliasb - Added hash_norm() backed by the native 'gsnative' module
+                    - Bumped the cache file name since the context has new members
+                    - Added block_distance() backed by the native 'gsnative' module
 
 TODO:
 ------
@@ -47,10 +50,23 @@ except:
 from   bb_types import *
 import bb_utils
 
+# Native helpers registered by the plugin (not available in standalone mode)
+try:
+    import gsnative
+except:
+    gsnative = None
+
+# Normalization levels returned by gsnative.block_hashes()
+NORM_ITYPE  = 0
+NORM_OPTYPE = 1
+NORM_REGREN = 2
+NORM_REGIMM = 3
+NORM_EXACT  = 4
+
 # ------------------------------------------------------------------------------
 def _get_cache_filename(addr):
     # Form the cache file name
-    return "%016X.cache" % addr
+    return "%016X.v2.cache" % addr
 
 
 # ------------------------------------------------------------------------------
@@ -128,6 +144,31 @@ def hash_itype2(start, end):
     return sh.hexdigest()
 
 
+# ------------------------------------------------------------------------------
+def hash_norm(start, end, level=NORM_REGREN):
+    """
+    Hash a block with registers renamed by first use order.
+    Immediates and displacements are masked at the NORM_REGREN level.
+    Falls back to hash_itype1() if the native module is not present
+    """
+    if gsnative is None:
+        return hash_itype1(start, end)
+
+    return "%016x" % gsnative.block_hashes(start, end)[level]
+
+
+# ------------------------------------------------------------------------------
+def block_distance(start1, end1, start2, end2, max_dist=2):
+    """
+    Edit distance (in instructions) of two blocks, capped to max_dist + 1.
+    Returns None if the native module is not present
+    """
+    if gsnative is None:
+        return None
+
+    return gsnative.block_distance(start1, end1, start2, end2, max_dist)
+
+
 # ------------------------------------------------------------------------------
 def get_block_frequency(start, end, rekey=False):
     """
@@ -248,6 +289,9 @@ class IdaBBContext(object):
         self.hash_itype2 = None
         """Hash on itype v2"""
 
+        self.hash_norm = None
+        """Register renaming invariant hash"""
+
         self.inst_count = 0
         """Instruction count"""
 
@@ -258,7 +302,8 @@ class IdaBBContext(object):
             bytes=True, 
             itype1=True, 
             itype2=False,
-            icount=True):
+            icount=True,
+            norm=True):
         """Compute the context of a basic block"""
         # Get the bytes
         if bytes:
@@ -276,6 +321,10 @@ class IdaBBContext(object):
         if itype2:
             self.hash_itype2 = hash_itype2(bb.start, bb.end)
 
+        # Get the normalized hash
+        if norm:
+            self.hash_norm = hash_norm(bb.start, bb.end)
+
 
 # ------------------------------------------------------------------------------
 class IDABBMan(BBMan):
@@ -287,7 +336,8 @@ class IDABBMan(BBMan):
             bb, 
             get_bytes, 
             get_hash_itype1,
-            get_hash_itype2):
+            get_hash_itype2,
+            get_hash_norm = False):
         """Add a basic block to the manager with its context computed"""
     
         # Create the context object
@@ -298,7 +348,8 @@ class IDABBMan(BBMan):
              bb, 
              get_bytes, 
              get_hash_itype1, 
-             get_hash_itype2)
+             get_hash_itype2,
+             norm = get_hash_norm)
 
         # Assign context to the basic block object
         bb.ctx = ctx
@@ -313,7 +364,8 @@ class IDABBMan(BBMan):
             use_cache = False, 
             get_bytes = False, 
             get_hash_itype1 = False,
-            get_hash_itype2 = False):
+            get_hash_itype2 = False,
+            get_hash_norm = False):
         """
         Build a BasicBlock manager object from a function address
         """
@@ -352,7 +404,8 @@ class IDABBMan(BBMan):
                         bb, 
                         get_bytes, 
                         get_hash_itype1,
-                        get_hash_itype2)
+                        get_hash_itype2,
+                        get_hash_norm)
 
             # Add all successors
             for succ_block in block.succs():
@@ -368,7 +421,8 @@ class IDABBMan(BBMan):
                             b0, 
                             get_bytes, 
                             get_hash_itype1, 
-                            get_hash_itype2)
+                            get_hash_itype2,
+                            get_hash_norm)
 
                 # Link successor
                 bb.add_succ(b0, link_pred = True)
@@ -386,7 +440,8 @@ class IDABBMan(BBMan):
                             b0, 
                             get_bytes, 
                             get_hash_itype1,
-                            get_hash_itype2)
+                            get_hash_itype2,
+                            get_hash_norm)
 
                 # Link predecessor
                 bb.add_pred(b0, link_succ = True)
@@ -418,6 +473,8 @@ def HashNode(bm, node_id, hash_id=1):
         r = hash_itype1(bb.start, bb.end)
     elif hash_id == 2:
         r = hash_itype2(bb.start, bb.end)
+    elif hash_id == 3:
+        r = hash_norm(bb.start, bb.end)
     else:
         r = "unknown hash_id %d" % hash_id
     print "->%s" % r
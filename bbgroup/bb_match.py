@@ -10,19 +10,84 @@ It is written by Ali Rahbar and Ali Pezeshk
 11/07/2013 - eliasb   - Renamed some functions to work with the C adapter
 11/08/2013 - alipezes - Fixed serialization issue
 08/27/2014 - alirah   - Cleaned up the script and readied it for public release
+10/18/2026 - eliasb   - Split Analyze() into Prepare() / AnalyzeStream() so the matching can run
+                        off the main thread and report each accepted group through a callback
+                      - Bucket head nodes by the normalized hash and try it first when matching successors
+                      - Thresholds now come from a matcher profile (see bb_tune.py) loaded with LoadProfile()
+                      - Fixed the minimum function head size check calling AddressIsInSubgraph() as a global
+                      - AnalyzeStream() polls an optional 'canceled' callable from its long loops
+                      - fix: the head nodes are bucketed by hash_itype2 again, with or without the native module
+                      - fix: the normalized hash takes the place of hash_itype1 when matching successors
+                      - fix: findMatchInSuccs() failed when the candidate parent has no successors
 """
 
-import idaapi
+try:
+	import idaapi
+except:
+	pass
 
 
 # ------------------------------------------------------------------------------
+import os
 import pickle
+import hashlib
 import cStringIO
 from   bb_ida import *
 import Queue
 from collections import defaultdict
 from ordered_set import OrderedSet
 
+# ------------------------------------------------------------------------------
+# Profile file name looked up next to this script when the module is loaded
+PROFILE_FILENAME = "matcher.profile"
+
+# ------------------------------------------------------------------------------
+def ParseProfile(fileName):
+	"""
+	Parse a profile file made of 'key=value' lines. Values are integers or comma separated integers.
+	Returns a dictionary or None on failure
+	"""
+	try:
+		f = open(fileName, 'r')
+	except:
+		return None
+
+	profile = {}
+	for line in f:
+		line = line.strip()
+		if line == '' or line.startswith('#') or '=' not in line:
+			continue
+		key, value = line.split('=', 1)
+		key, value = key.strip(), value.strip()
+		try:
+			if ',' in value:
+				profile[key] = [int(v) for v in value.split(',')]
+			else:
+				profile[key] = int(value)
+		except ValueError:
+			continue
+	f.close()
+	return profile
+
+# ------------------------------------------------------------------------------
+def WriteProfile(fileName, profile, comment = None):
+	"""Write a profile dictionary as 'key=value' lines"""
+	f = open(fileName, 'w')
+	if comment != None:
+		for line in comment.split('\n'):
+			f.write("# %s\n" % line)
+	for key in sorted(profile.keys()):
+		value = profile[key]
+		if isinstance(value, (list, tuple)):
+			value = ','.join([str(v) for v in value])
+		f.write("%s=%s\n" % (key, value))
+	f.close()
+
+# ------------------------------------------------------------------------------
+class AnalysisCanceled(Exception):
+	"""Raised by the long loops of the matcher when the caller canceled the analysis"""
+	pass
+
 # ------------------------------------------------------------------------------
 class bbMatcherClass:
 
@@ -32,6 +97,29 @@ class bbMatcherClass:
 	SizeDicMarker = "Size_Dic\n"
 	NodeHashesMarker = "Node_Hashes\n"
 	NodeHashMatchesMarker = "Node_Hash_Matches\n"
+
+	# Hash used to bucket the candidate head nodes. Not 'hash_norm': it would
+	# narrow the seed pairs and it falls back to 'hash_itype1' without the
+	# native module, so the results would depend on it being loaded
+	SeedHashType = 'hash_itype2'
+	# Match levels tried in findSubGraphs(), from the strictest to the fuzziest.
+	# 'hash_itype1' only stands in for 'hash_norm' without the native module:
+	# next to it, it would merge the blocks whose operands differ
+	MatchLadder = ['hash_norm' if gsnative is not None else 'hash_itype1', 'hash_itype2', 'freq']
+
+	# Matcher thresholds
+	DefaultProfile = {
+		# Minimum size (in blocks) of a reported subgraph
+		'min_function_size'      : 4,
+		# Minimum head size (in bytes) of a reported subgraph. 0 to disable
+		'min_function_head_size' : 0,
+		# Frequency mode: common instructions coverage needed for blocks of <=4, <=6, <=8 and more instructions
+		'freq_coverage'          : [50, 60, 75, 85],
+		# Frequency mode: needed match percentage of the common instructions
+		'freq_match'             : 95,
+	}
+	# Profile used by new matcher instances
+	Profile = dict(DefaultProfile)
 	
 	def __init__(self,func_addr=None):
 		self.M={}
@@ -45,7 +133,12 @@ class bbMatcherClass:
 		self.G=None
 		self.address=None
 		self.nodeHashes = defaultdict(dict)
+		# block frequency tables, precomputed by Prepare() so matching does not need IDA
+		self.freqCache = {}
+		self.profile = bbMatcherClass.Profile
 		self.bm=None
+		# optional callable polled by the long loops, see AnalyzeStream()
+		self.canceled = None
 		if func_addr!=None:
 			self.buildGRaphFromFunc(func_addr)
 	
@@ -58,27 +151,29 @@ class bbMatcherClass:
 			use_cache=True,
 			get_bytes=True,
 			get_hash_itype1 =True, 
-			get_hash_itype2 =True)
+			get_hash_itype2 =True,
+			get_hash_norm =True)
 		self.address = func_addr
 
 	def match(self,N1,N2, hashType):
 		"""Matches two nodes based on their type1(ordered instruction type hash) hash"""
 		if (hashType == 'freq'):
-			f1 = get_block_frequency(N1.start, N1.end)
-			f2 = get_block_frequency(N2.start, N2.end)
+			f1 = self.getBlockFrequency(N1)
+			f2 = self.getBlockFrequency(N2)
 			a, d1 = f1
 			b, d2 = f2
 
+			coverage = self.profile['freq_coverage']
 			if ( a <= 4 or b <= 4 ):
-				coveragePercentage = 50
+				coveragePercentage = coverage[0]
 			elif ( a <= 6 or b <= 6 ):
-				coveragePercentage = 60
+				coveragePercentage = coverage[1]
 			elif ( a <= 8 or b <= 8 ):
-				coveragePercentage = 75
+				coveragePercentage = coverage[2]
 			else:
-				coveragePercentage = 85
+				coveragePercentage = coverage[3]
 			
-			b1, b2 = match_block_frequencies(f1, f2, coveragePercentage, 95)
+			b1, b2 = match_block_frequencies(f1, f2, coveragePercentage, self.profile['freq_match'])
 			if (b1 and b2):
 				intersection = set.intersection(set(d1.keys()), set(d2.keys()))
 				freqHash = hashlib.sha1()
@@ -91,9 +186,23 @@ class bbMatcherClass:
 			return True
 		return False
 		
+	def getBlockFrequency(self, N):
+		"""Return the cached frequency table of a node or compute it"""
+		try:
+			return self.freqCache[N.id]
+		except KeyError:
+			f = get_block_frequency(N.start, N.end)
+			self.freqCache[N.id] = f
+			return f
+
+	def checkCanceled(self):
+		if self.canceled != None and self.canceled():
+			raise AnalysisCanceled()
+
 	def hashBBMatch(self, hashType):
 		"""Creates a dictionary of basic blocks with the hash as the key and matching block numbers as items of a list for that entry"""
 		for i in range(0,len(self.G.items())):
+			self.checkCanceled()
 			for j in range (i+1,len(self.G.items())):
 				if self.match(self.G[i],self.G[j],hashType):
 					x=self.G[i][hashType] 
@@ -131,6 +240,8 @@ class bbMatcherClass:
 		
 	def findMatchInSuccs(self, node1, Parent2, hashType, visitedNodes2, tmpVisitedNodes2, path2):
 		matchedbyHash = False
+		# Parent2 may have no successors
+		m = None
 		for m in self.G[Parent2].succs:
 			if (m not in visitedNodes2) and (m !=Parent2) and (m not in path2):
 				tmpVisitedNodes2.add(m)
@@ -151,6 +262,7 @@ class bbMatcherClass:
 		for i in self.M.keys():
 			for z in range(0,len(self.M[i])-1):
 				for j in self.M[i][z+1:]:							#pick one from the second node onward
+					self.checkCanceled()
 					visited1=set()
 					visited2=set()
 					q1=Queue.Queue()					#add the first and n node to tmp
@@ -164,7 +276,7 @@ class bbMatcherClass:
 					path2.add(j)
 					path1Str=''
 					path2Str=''
-					path1NodeHashes[self.M[i][z]]=self.G[(self.M[i][z])].ctx.hash_itype2
+					path1NodeHashes[self.M[i][z]]=self.G[(self.M[i][z])][bbMatcherClass.SeedHashType]
 					pathHash1= hashlib.sha1()
 					while not q1.empty():			                            # for each matching pair from tmp
 						x,y = q1.get(block = False)
@@ -174,18 +286,12 @@ class bbMatcherClass:
 							if (l not in visited1) and (l !=x) and (l not in path1):
 								visited1.add(l)
 								tmp_visited2Backup=tmp_visited2   
-								hashType = 'hash_itype1'
-								matchedbyHash, m, tmp_visited2 = self.findMatchInSuccs( l, y, hashType, visited2, tmp_visited2, path2)
-
-								if not matchedbyHash:
-									hashType = 'hash_itype2'
-									tmp_visited2= tmp_visited2Backup
-									matchedbyHash, m, tmp_visited2 = self.findMatchInSuccs( l, y, hashType, visited2, tmp_visited2, path2)
-								
-								if not matchedbyHash:
-									hashType = 'freq'
+								# From the strictest to the fuzziest match
+								for hashType in bbMatcherClass.MatchLadder:
 									tmp_visited2= tmp_visited2Backup
 									matchedbyHash, m, tmp_visited2 = self.findMatchInSuccs( l, y, hashType, visited2, tmp_visited2, path2)
+									if matchedbyHash:
+										break
 
 								if matchedbyHash:
 									path1NodeHashes[l] = self.G[l][hashType]
@@ -271,13 +377,18 @@ class bbMatcherClass:
 				return True
 		return False
 		
-	def GetMatchedWellFormedFunctions(self, minFunctionSizeInBlocks = 4, minFunctionHeadSize = 0):
+	def GetMatchedWellFormedFunctions(self, minFunctionSizeInBlocks = None, minFunctionHeadSize = None, callback = None):
+		if minFunctionSizeInBlocks == None:
+			minFunctionSizeInBlocks = self.profile['min_function_size']
+		if minFunctionHeadSize == None:
+			minFunctionHeadSize = self.profile['min_function_head_size']
 		MovedSubgraph = []
 		for i in reversed(sorted(self.size_dic.keys())):
 			if i < minFunctionSizeInBlocks :
 				break
 
 			for item in self.size_dic[i]:
+				self.checkCanceled()
 				x,y=item
 				if (not self.normalizedPathPerNodeHash.has_key(x)):
 					self.normalizedPathPerNodeHash[x] = {}
@@ -302,11 +413,15 @@ class bbMatcherClass:
 						subgraphStartAddress = self.G[ self.normalizedPathPerNodeHash[x][y][0][0] ].start
 						functionHeadBigEnough = True
 						for address in range ( subgraphStartAddress, subgraphStartAddress + 8, 2 ):
-							if not AddressIsInSubgraph( address, self.normalizedPathPerNodeHash[x][y][0] ):
+							if not self.AddressIsInSubgraph( address, self.normalizedPathPerNodeHash[x][y][0] ):
 								functionHeadBigEnough = False
 								break
 						if not functionHeadBigEnough:
 							self.normalizedPathPerNodeHash[x][y] = [] 
+
+					# Report the accepted group as soon as it is known
+					if callback != None and self.normalizedPathPerNodeHash[x][y] != []:
+						callback( self.normalizedPathPerNodeHash[x][y] )
 							
 				MovedSubgraph.extend( self.normalizedPathPerNodeHash[x][y] )
 
@@ -316,7 +431,10 @@ class bbMatcherClass:
 				return True
 		return False
 	
-	def FindSimilar(self, nodeList, hashType = 'hash_itype2' ):
+	def FindSimilar(self, nodeList, hashType = None ):
+		# The matches are bucketed by the seed hash
+		if hashType == None:
+			hashType = bbMatcherClass.SeedHashType
 		size = len(nodeList)
 		headNode = nodeList[0]
 		setNodeList = set( nodeList )
@@ -458,27 +576,79 @@ class bbMatcherClass:
 
 		f.close()
 		
-	def Analyze(self,func_addr=None):
-		result = []
-		if func_addr!=None:
-			self.buildGRaphFromFunc(func_addr)
-		if self.G !=None:
+	def LoadProfile(self,fileName):
+		"""Load the matcher thresholds from a profile file. Missing keys keep their default value"""
+		profile = ParseProfile(fileName)
+		if profile == None:
+			return False
+		newProfile = dict(bbMatcherClass.DefaultProfile)
+		newProfile.update(profile)
+		coverage = newProfile['freq_coverage']
+		if not isinstance(coverage, list) or len(coverage) != 4:
+			return False
+		bbMatcherClass.Profile = newProfile
+		self.profile = newProfile
+		return True
+
+	def Prepare(self,func_addr):
+		"""
+		Do all the work that needs the IDA API (must be called from the main thread).
+		After this call, AnalyzeStream() only works on Python data.
+		"""
+		self.__init__()
+		self.buildGRaphFromFunc(func_addr)
+		if self.G == None:
+			return False
 		# todo: refactor this to get the list from one place
-			for hashName in ['hash_itype1', 'hash_itype2']:
-				for i in self.G.items():
-					self.nodeHashes[i.id][hashName] = self.G[i.id][hashName]
-			self.hashBBMatch('hash_itype2')
+		for hashName in ['hash_itype1', 'hash_itype2', 'hash_norm']:
+			for i in self.G.items():
+				self.nodeHashes[i.id][hashName] = self.G[i.id][hashName]
+		for i in self.G.items():
+			self.getBlockFrequency(i)
+		return True
+
+	def AnalyzeStream(self,callback=None,canceled=None):
+		"""
+		Run the matcher on the prepared graph.
+		Each accepted group (list of node lists) is passed to the callback as soon as it is found.
+		The optional 'canceled' callable is polled by the long loops: the analysis stops
+		(and returns False) once it returns True
+		"""
+		if self.G == None:
+			return False
+		self.canceled = canceled
+		try:
+			self.hashBBMatch(bbMatcherClass.SeedHashType)
 			self.findSubGraphs()
 			self.sortByPathLen()
-			self.GetMatchedWellFormedFunctions()
-		 
+			self.GetMatchedWellFormedFunctions(callback = callback)
+		except AnalysisCanceled:
+			return False
+		finally:
+			self.canceled = None
+		return True
+
+	def GetResult(self):
+		"""Return the accepted groups of the last analysis"""
+		result = []
+		for x in self.normalizedPathPerNodeHash:
+			for y in self.normalizedPathPerNodeHash[x]:
+				if self.normalizedPathPerNodeHash[x][y] != []:
+					result.append( self.normalizedPathPerNodeHash[x][y] )
+		return result
 
-			for x in self.normalizedPathPerNodeHash:
-				for y in self.normalizedPathPerNodeHash[x]:
-					if self.normalizedPathPerNodeHash[x][y] != []:
-						result.append( self.normalizedPathPerNodeHash[x][y] )
+	def Analyze(self,func_addr=None):
+		result = []
+		if func_addr!=None:
+			self.Prepare(func_addr)
+		if self.G !=None:
+			self.AnalyzeStream()
+			result = self.GetResult()
 
 		return result
 
 # ------------------------------------------------------------------------------
 bbMatcher = bbMatcherClass()
+
+# Use the tuned profile if there is one
+bbMatcher.LoadProfile(os.path.join(os.path.dirname(os.path.abspath(__file__)), PROFILE_FILENAME))
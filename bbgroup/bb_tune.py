@@ -0,0 +1,297 @@
+"""
+Matcher thresholds auto-tuning
+
+The right matcher thresholds differ per compiler and target. This script
+runs the matcher over a sample of functions for a grid of parameters and
+writes the best scoring profile (see bb_match.LoadProfile()).
+
+Inside IDA (also headless: idaq -A -S"bb_tune.py" file.idb):
+  - Samples the functions of the database and prepares them (graph, hashes
+    and frequency tables; the block cache files are reused)
+  - Saves the prepared functions to a tuning set file
+  - Runs the sweep in an external Python process (GS_PYTHON environment
+    variable or 'python') and loads the resulting profile
+
+Standalone:
+  python bb_tune.py <tuning set file> <output profile> [jobs]
+
+The sweep runs the parameters combinations in parallel, one process per core.
+Each run is scored by its block coverage minus a penalty on the blocks
+reported in more than one instance and a penalty on the false matches: the
+blocks matched to a block of another instance with a different
+instructions and operands hash (hash_itype2). Without it the loosest
+parameters would always cover the most.
+
+
+10/18/2026 - eliasb - Initial version
+                    - fix: penalize the false matches, report the failing runs
+"""
+
+import os
+import sys
+import time
+import pickle
+
+try:
+    import idaapi
+    import idautils
+except:
+    pass
+
+import bb_ida
+from   bb_ida import *
+import bb_match
+from   bb_match import bbMatcherClass, WriteProfile, PROFILE_FILENAME
+
+# ------------------------------------------------------------------------------
+# Parameters grid
+GRID = {
+    'min_function_size'      : [2, 3, 4, 6, 8],
+    'min_function_head_size' : [0, 8],
+    'freq_coverage'          : [[40, 50, 65, 75], [50, 60, 75, 85], [60, 70, 80, 90]],
+    'freq_match'             : [90, 95, 98],
+}
+
+# Weight of the duplicate rate in the score
+DUPLICATE_PENALTY = 2.0
+
+# Weight of the false match rate in the score, and the hash that tells them
+FALSE_MATCH_PENALTY = 2.0
+FALSE_MATCH_HASH    = 'hash_itype2'
+
+# Sampling
+SAMPLE_SIZE       = 64
+SAMPLE_MIN_BLOCKS = 8
+
+TUNING_SET_FILENAME = "matcher.tuning"
+
+# ------------------------------------------------------------------------------
+def GridCombinations(grid):
+    """Return the list of all the parameters combinations (dictionaries) of a grid"""
+    combos = [{}]
+    for key in sorted(grid.keys()):
+        new_combos = []
+        for combo in combos:
+            for value in grid[key]:
+                c = dict(combo)
+                c[key] = value
+                new_combos.append(c)
+        combos = new_combos
+    return combos
+
+
+# ------------------------------------------------------------------------------
+def ScoreResult(result, block_count, hashes):
+    """
+    Score the result of one function
+    @param hashes: the hashes of each node (see bbMatcherClass.nodeHashes)
+    @return: (coverage, duplicate, false match) rates
+    """
+    seen  = {}
+    false = set()
+    for group in result:
+        for instance in group:
+            for node in instance:
+                seen[node] = seen.get(node, 0) + 1
+
+        # The instances are aligned on the first one: a node whose block
+        # differs from its counterpart (or has none) is a false match
+        ref = group[0]
+        for instance in group[1:]:
+            for i, node in enumerate(instance):
+                if i >= len(ref):
+                    false.add(node)
+                elif hashes[node][FALSE_MATCH_HASH] != hashes[ref[i]][FALSE_MATCH_HASH]:
+                    false.add(node)
+                    false.add(ref[i])
+
+    if block_count == 0:
+        return (0.0, 0.0, 0.0)
+
+    covered   = len(seen)
+    duplicate = len([n for n in seen if seen[n] > 1])
+    return (float(covered) / block_count, float(duplicate) / block_count, float(len(false)) / block_count)
+
+
+# ------------------------------------------------------------------------------
+def PrepareTuningSet(sample_size = SAMPLE_SIZE, min_blocks = SAMPLE_MIN_BLOCKS):
+    """
+    Sample and prepare the functions of the database (must run inside IDA)
+    @return: list of pickled prepared functions
+    """
+    candidates = []
+    for func_ea in idautils.Functions():
+        f = idaapi.get_func(func_ea)
+        if f is None:
+            continue
+        if idaapi.FlowChart(f).size >= min_blocks:
+            candidates.append(func_ea)
+
+    # Evenly spaced sample
+    if len(candidates) > sample_size:
+        step = float(len(candidates)) / sample_size
+        candidates = [candidates[int(i * step)] for i in xrange(sample_size)]
+
+    tuning_set = []
+    for func_ea in candidates:
+        m = bbMatcherClass()
+        if not m.Prepare(func_ea):
+            continue
+        entry = {
+            'addr'   : func_ea,
+            'blocks' : m.G.get_cache(),
+            'hashes' : dict(m.nodeHashes),
+            'freq'   : m.freqCache,
+        }
+        # Keep the entries pickled: each run needs a fresh copy (the matcher annotates the nodes)
+        tuning_set.append(pickle.dumps(entry, pickle.HIGHEST_PROTOCOL))
+
+    return tuning_set
+
+
+# ------------------------------------------------------------------------------
+def RunPrepared(entry_data, profile):
+    """Run the matcher on a prepared function with the given profile and return (result, block count, node hashes)"""
+    entry = pickle.loads(entry_data)
+
+    bm = IDABBMan()
+    for bb in entry['blocks'].values():
+        bm.add(bb)
+
+    m = bbMatcherClass()
+    m.G = bm
+    m.address = entry['addr']
+    m.nodeHashes.update(entry['hashes'])
+    m.freqCache = entry['freq']
+    m.profile = profile
+    m.AnalyzeStream()
+    return (m.GetResult(), len(entry['blocks']), entry['hashes'])
+
+
+# ------------------------------------------------------------------------------
+# Worker process state
+_worker_set = None
+
+def _WorkerInit(tuning_set_file):
+    global _worker_set
+    f = open(tuning_set_file, 'rb')
+    _worker_set = pickle.load(f)
+    f.close()
+
+
+def _WorkerEvaluate(profile):
+    """Evaluate one parameters combination over the whole tuning set"""
+    t0 = time.time()
+    sum_cov = sum_dup = sum_false = 0.0
+    failed = 0
+    for index, entry_data in enumerate(_worker_set):
+        try:
+            result, block_count, hashes = RunPrepared(entry_data, profile)
+            cov, dup, false = ScoreResult(result, block_count, hashes)
+        except (pickle.UnpicklingError, KeyError, IndexError, ValueError, TypeError, ZeroDivisionError), e:
+            # A failing run is as good as no result
+            sys.stderr.write("Function #%d failed with %r: %s: %s\n" % (index, profile, e.__class__.__name__, e))
+            failed += 1
+            continue
+        sum_cov   += cov
+        sum_dup   += dup
+        sum_false += false
+
+    n = max(len(_worker_set), 1)
+    cov, dup, false = sum_cov / n, sum_dup / n, sum_false / n
+    score = cov - DUPLICATE_PENALTY * dup - FALSE_MATCH_PENALTY * false
+    return (score, cov, dup, false, failed, time.time() - t0, profile)
+
+
+# ------------------------------------------------------------------------------
+def Sweep(tuning_set_file, profile_file, jobs = None, grid = GRID):
+    """Run the parameters sweep in parallel and write the best profile"""
+    import multiprocessing
+
+    combos = GridCombinations(grid)
+    if jobs is None:
+        jobs = multiprocessing.cpu_count()
+
+    print "Sweeping %d combinations with %d job(s)..." % (len(combos), jobs)
+    t0 = time.time()
+    if jobs > 1:
+        pool = multiprocessing.Pool(jobs, _WorkerInit, (tuning_set_file,))
+        scores = pool.map(_WorkerEvaluate, combos)
+        pool.close()
+        pool.join()
+    else:
+        _WorkerInit(tuning_set_file)
+        scores = map(_WorkerEvaluate, combos)
+
+    scores.sort(key = lambda s: s[0], reverse = True)
+    for score, cov, dup, false, failed, elapsed, profile in scores[:5]:
+        print "score=%.4f coverage=%.4f duplicate=%.4f false=%.4f failed=%d time=%.2fs %r" % (
+            score, cov, dup, false, failed, elapsed, profile)
+
+    failed = sum([s[4] for s in scores])
+    if failed > 0:
+        print "Warning: %d run(s) failed (see the errors above)" % failed
+
+    score, cov, dup, false, failed, elapsed, profile = scores[0]
+    best = dict(bbMatcherClass.DefaultProfile)
+    best.update(profile)
+    WriteProfile(
+        profile_file,
+        best,
+        "Generated by bb_tune.py: score=%.4f coverage=%.4f duplicate=%.4f false=%.4f" % (score, cov, dup, false))
+
+    print "Best profile written to '%s' in %.2fs" % (profile_file, time.time() - t0)
+    return True
+
+
+# ------------------------------------------------------------------------------
+def TuneDatabase(sample_size = SAMPLE_SIZE, jobs = None):
+    """Prepare a tuning set from the current database and sweep it in an external Python process"""
+    import subprocess
+
+    script_path  = os.path.dirname(os.path.abspath(__file__))
+    set_file     = os.path.join(script_path, TUNING_SET_FILENAME)
+    profile_file = os.path.join(script_path, PROFILE_FILENAME)
+
+    tuning_set = PrepareTuningSet(sample_size)
+    if len(tuning_set) == 0:
+        print "No function to tune with!"
+        return False
+
+    f = open(set_file, 'wb')
+    pickle.dump(tuning_set, f, pickle.HIGHEST_PROTOCOL)
+    f.close()
+    print "Saved %d prepared function(s) to '%s'" % (len(tuning_set), set_file)
+
+    # IDA's Python cannot fork worker processes: use an external interpreter
+    args = [os.environ.get('GS_PYTHON', 'python'), os.path.abspath(__file__), set_file, profile_file]
+    if jobs is not None:
+        args.append(str(jobs))
+
+    if subprocess.call(args, cwd = script_path) != 0:
+        print "The sweep failed!"
+        return False
+
+    return bb_match.bbMatcher.LoadProfile(profile_file)
+
+
+# ------------------------------------------------------------------------------
+def main():
+    if not bb_ida.stdalone:
+        idaapi.autoWait()
+        TuneDatabase()
+        if idaapi.cvar.batch:
+            idaapi.qexit(0)
+        return
+
+    if len(sys.argv) < 3:
+        print "Usage: %s <tuning set> <output profile> [jobs]" % sys.argv[0]
+        return
+
+    jobs = int(sys.argv[3]) if len(sys.argv) > 3 else None
+    Sweep(sys.argv[1], sys.argv[2], jobs)
+
+
+# ------------------------------------------------------------------------------
+if __name__ == '__main__':
+    main()
@@ -7,6 +7,8 @@ This module contains the basic types and data structures
 * 10/07/2013 - eliasb - Added the Caching class
                       - Added Cached prime generator
 * 10/15/2013 - eliasb - Added RekeyDictionary()
+* 10/18/2026 - eliasb - CachedPrimes() takes the primes from the native 'gsnative'
+                        table when available instead of the pickled cache file
 
 """
 
@@ -96,6 +98,16 @@ def GenPrimes():
 # ------------------------------------------------------------------------------
 class CachedPrimes(object):
     def __init__(self, count, fn_template = 'Primes%08d.cache'):
+        # Use the native table registered by the plugin if it is large enough
+        try:
+            import gsnative
+            self.__primes = gsnative.primes(count)
+        except:
+            self.__primes = None
+
+        if self.__primes is not None:
+            return
+
         # Format the file name
         fn = fn_template % count
 
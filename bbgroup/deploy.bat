@@ -2,6 +2,6 @@
 
 set DEST=p:\tools\idadev\plugins\GraphSlick
 
-FOR %%a in (bb_utils bb_ida bb_types bb_match bb_match_final) DO copy %%a.py %DEST%
+FOR %%a in (bb_utils bb_ida bb_types bb_match bb_match_final bb_tune) DO copy %%a.py %DEST%
 
 copy bb_match_final.py p:\tools\idadev\plugins\GraphSlick\bb_match.py
\ No newline at end of file
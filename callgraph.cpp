@@ -0,0 +1,334 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+--------------------------------------------------------------------------*/
+
+#include "callgraph.h"
+#include <map>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+void callgraph_t::build_csr(
+    int n,
+    const intvec_t &from,
+    const intvec_t &to,
+    intvec_t &start,
+    intvec_t &adj)
+{
+  // Counting sort of the edges by their source
+  start.resize(n + 1);
+  std::fill(start.begin(), start.end(), 0);
+  for (size_t i=0; i < from.size(); i++)
+    ++start[from[i] + 1];
+
+  for (int i=0; i < n; i++)
+    start[i + 1] += start[i];
+
+  adj.resize(from.size());
+  intvec_t pos;
+  pos.resize(n);
+  for (int i=0; i < n; i++)
+    pos[i] = start[i];
+
+  for (size_t i=0; i < from.size(); i++)
+    adj[pos[from[i]]++] = to[i];
+
+  // Drop the duplicates: the stamp of a target is the last node that had it
+  intvec_t stamp;
+  stamp.resize(n);
+  std::fill(stamp.begin(), stamp.end(), -1);
+
+  int w = 0, s = start[0];
+  for (int i=0; i < n; i++)
+  {
+    int e = start[i + 1];
+    start[i] = w;
+    for (int k=s; k < e; k++)
+    {
+      int t = adj[k];
+      if (stamp[t] == i)
+        continue;
+
+      stamp[t] = i;
+      adj[w++] = t;
+    }
+    s = e;
+  }
+  start[n] = w;
+  adj.resize(w);
+}
+
+//--------------------------------------------------------------------------
+void callgraph_t::build(
+    const eavec_t &funcs,
+    const intvec_t &callers,
+    const intvec_t &callees)
+{
+  this->funcs = funcs;
+  int n = size();
+  build_csr(n, callers, callees, succ_start, succ);
+  build_csr(n, callees, callers, pred_start, pred);
+}
+
+//--------------------------------------------------------------------------
+int callgraph_t::find_func(ea_t ea) const
+{
+  const ea_t *p = std::lower_bound(funcs.begin(), funcs.end(), ea);
+  if (p == funcs.end() || *p != ea)
+    return -1;
+  else
+    return int(p - funcs.begin());
+}
+
+//--------------------------------------------------------------------------
+int cg_quotient_t::get_hub(const callgraph_t &cg, int g) const
+{
+  int hub = -1, best = -1;
+  for (int k=member_start[g]; k < member_start[g + 1]; k++)
+  {
+    int f = members[k];
+    int deg = cg.nsucc(f) + cg.npred(f);
+    if (deg > best)
+    {
+      best = deg;
+      hub = f;
+    }
+  }
+  return hub;
+}
+
+//--------------------------------------------------------------------------
+void cg_build_quotient(
+    const callgraph_t &cg,
+    const intvec_t &group_of,
+    int ngroups,
+    cg_quotient_t &q)
+{
+  int n = cg.size();
+  q.group_of = group_of;
+
+  // Members: counting sort of the functions by group
+  q.member_start.resize(ngroups + 1);
+  std::fill(q.member_start.begin(), q.member_start.end(), 0);
+  for (int f=0; f < n; f++)
+  {
+    if (group_of[f] >= 0)
+      ++q.member_start[group_of[f] + 1];
+  }
+
+  for (int g=0; g < ngroups; g++)
+    q.member_start[g + 1] += q.member_start[g];
+
+  q.members.resize(q.member_start[ngroups]);
+  intvec_t pos;
+  pos.resize(ngroups);
+  for (int g=0; g < ngroups; g++)
+    pos[g] = q.member_start[g];
+
+  for (int f=0; f < n; f++)
+  {
+    if (group_of[f] >= 0)
+      q.members[pos[group_of[f]]++] = f;
+  }
+
+  // Edges: walk the calls of each group's members. The stamp of a group
+  // is the last group that added an edge to it
+  intvec_t stamp;
+  stamp.resize(ngroups);
+  std::fill(stamp.begin(), stamp.end(), -1);
+
+  q.succ.qclear();
+  q.succ_start.resize(ngroups + 1);
+  for (int g=0; g < ngroups; g++)
+  {
+    q.succ_start[g] = int(q.succ.size());
+    for (int k=q.member_start[g]; k < q.member_start[g + 1]; k++)
+    {
+      int f = q.members[k];
+      for (int e=cg.succ_start[f]; e < cg.succ_start[f + 1]; e++)
+      {
+        int h = group_of[cg.succ[e]];
+        if (h < 0 || h == g || stamp[h] == g)
+          continue;
+
+        stamp[h] = g;
+        q.succ.push_back(h);
+      }
+    }
+  }
+  q.succ_start[ngroups] = int(q.succ.size());
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Return the module prefix of a name
+*/
+static void get_name_prefix(const char *name, qstring *out)
+{
+  // C++ names: the scope
+  const char *scope = NULL;
+  for (const char *p=strstr(name, "::"); p != NULL; p=strstr(p + 2, "::"))
+    scope = p;
+
+  if (scope != NULL)
+  {
+    *out = qstring(name, scope - name);
+    return;
+  }
+
+  const char *s = name;
+  while (*s == '_' || *s == '@' || *s == '?' || *s == '.')
+    s++;
+
+  const char *e = s;
+  while (*e != '\0' && *e != '_' && *e != '@')
+    e++;
+
+  if (*e == '\0' || e == s)
+    out->qclear();
+  else
+    *out = qstring(s, e - s);
+}
+
+//--------------------------------------------------------------------------
+int cg_group_by_prefix(
+    const qstrvec_t &names,
+    intvec_t &group_of,
+    qstrvec_t &group_names)
+{
+  typedef std::map<qstring, int> str2int_t;
+  str2int_t groups;
+
+  group_names.qclear();
+  group_of.resize(names.size());
+
+  qstring prefix;
+  for (size_t i=0; i < names.size(); i++)
+  {
+    get_name_prefix(names[i].c_str(), &prefix);
+
+    std::pair<str2int_t::iterator, bool> ins = groups.insert(
+        std::make_pair(prefix, int(group_names.size())));
+
+    if (ins.second)
+      group_names.push_back(prefix);
+
+    group_of[i] = ins.first->second;
+  }
+  return int(group_names.size());
+}
+
+//--------------------------------------------------------------------------
+int cg_group_by_clusters(
+    const callgraph_t &cg,
+    intvec_t &group_of,
+    int max_iters)
+{
+  int n = cg.size();
+
+  intvec_t label;
+  label.resize(n);
+  for (int i=0; i < n; i++)
+    label[i] = i;
+
+  // Degrees in the undirected graph. The votes of a neighbor are weighted by
+  // the inverse of its degree so the hubs (e.g. memcpy) do not swallow everything
+  qvector<double> weight, votes;
+  weight.resize(n);
+  votes.resize(n);
+  std::fill(votes.begin(), votes.end(), 0.0);
+  for (int i=0; i < n; i++)
+  {
+    int deg = cg.nsucc(i) + cg.npred(i);
+    weight[i] = deg == 0 ? 0.0 : 1.0 / deg;
+  }
+
+  intvec_t touched;
+  for (int iter=0; iter < max_iters; iter++)
+  {
+    int changed = 0;
+    for (int i=0; i < n; i++)
+    {
+      touched.qclear();
+      for (int pass=0; pass < 2; pass++)
+      {
+        const intvec_t &start = pass == 0 ? cg.succ_start : cg.pred_start;
+        const intvec_t &adj   = pass == 0 ? cg.succ : cg.pred;
+        for (int e=start[i]; e < start[i + 1]; e++)
+        {
+          int nb = adj[e];
+          if (nb == i)
+            continue;
+
+          int l = label[nb];
+          if (votes[l] == 0.0)
+            touched.push_back(l);
+          votes[l] += weight[nb];
+        }
+      }
+
+      if (touched.empty())
+        continue;
+
+      // Best voted label. Ties go to the current label then to the smallest
+      int best = label[i];
+      double best_votes = votes[best];
+      for (size_t k=0; k < touched.size(); k++)
+      {
+        int l = touched[k];
+        if (votes[l] > best_votes || (votes[l] == best_votes && l < best && best != label[i]))
+        {
+          best = l;
+          best_votes = votes[l];
+        }
+      }
+
+      for (size_t k=0; k < touched.size(); k++)
+        votes[touched[k]] = 0.0;
+
+      if (best != label[i])
+      {
+        label[i] = best;
+        ++changed;
+      }
+    }
+
+    if (changed == 0)
+      break;
+  }
+
+  // Number the groups in the order of the functions
+  intvec_t ids;
+  ids.resize(n);
+  std::fill(ids.begin(), ids.end(), -1);
+
+  group_of.resize(n);
+  int ngroups = 0;
+  bool has_isolated = false;
+  for (int i=0; i < n; i++)
+  {
+    if (weight[i] == 0.0)
+    {
+      has_isolated = true;
+      continue;
+    }
+
+    int &id = ids[label[i]];
+    if (id == -1)
+      id = ngroups++;
+    group_of[i] = id;
+  }
+
+  if (has_isolated)
+  {
+    for (int i=0; i < n; i++)
+    {
+      if (weight[i] == 0.0)
+        group_of[i] = ngroups;
+    }
+    ++ngroups;
+  }
+  return ngroups;
+}
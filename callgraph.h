@@ -0,0 +1,144 @@
+#ifndef __CALLGRAPH__
+#define __CALLGRAPH__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Call graph module
+
+The program call graph and its quotient: the functions are grouped (by
+name prefix into modules or by call clusters) and the quotient has one
+node per group and the deduplicated calls between the groups. This is the
+call graph counterpart of what fc_to_combined_mg() does for the blocks
+of one function.
+
+The graphs are kept in compressed adjacency arrays (CSR) and every step is
+linear in the count of functions and calls, so a 100k functions database
+is grouped in a few milliseconds.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+
+//--------------------------------------------------------------------------
+/**
+* @brief Call graph in compressed adjacency arrays
+*/
+class callgraph_t
+{
+  /**
+  * @brief Fill a CSR from an edge list. The duplicate edges are dropped
+  */
+  static void build_csr(
+      int n,
+      const intvec_t &from,
+      const intvec_t &to,
+      intvec_t &start,
+      intvec_t &adj);
+
+public:
+  /**
+  * @brief Sorted function start addresses
+  */
+  eavec_t funcs;
+
+  /**
+  * @brief Callees of function i: succ[succ_start[i] .. succ_start[i+1])
+  */
+  intvec_t succ_start, succ;
+
+  /**
+  * @brief Callers of function i: pred[pred_start[i] .. pred_start[i+1])
+  */
+  intvec_t pred_start, pred;
+
+  inline int size() const { return int(funcs.size()); }
+
+  inline int nsucc(int n) const { return succ_start[n + 1] - succ_start[n]; }
+  inline int npred(int n) const { return pred_start[n + 1] - pred_start[n]; }
+
+  /**
+  * @brief Return the index of the function starting at 'ea' or -1
+  */
+  int find_func(ea_t ea) const;
+
+  /**
+  * @brief Set the functions (sorted) and the calls between them
+  * @param callers, callees - parallel arrays of function indices
+  */
+  void build(
+      const eavec_t &funcs,
+      const intvec_t &callers,
+      const intvec_t &callees);
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Quotient of a call graph by a grouping of its functions
+*/
+struct cg_quotient_t
+{
+  /**
+  * @brief The group of each function (-1 if not in the quotient)
+  */
+  intvec_t group_of;
+
+  /**
+  * @brief Functions of group g: members[member_start[g] .. member_start[g+1])
+  */
+  intvec_t member_start, members;
+
+  /**
+  * @brief Groups called by group g: succ[succ_start[g] .. succ_start[g+1])
+  */
+  intvec_t succ_start, succ;
+
+  inline int size() const { return int(member_start.size()) - 1; }
+
+  inline int nmembers(int g) const { return member_start[g + 1] - member_start[g]; }
+
+  /**
+  * @brief Return the most connected function of a group
+  */
+  int get_hub(const callgraph_t &cg, int g) const;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Build the quotient graph
+* @param group_of - the group of each function in [0, ngroups) or -1 to leave it out
+*/
+void cg_build_quotient(
+    const callgraph_t &cg,
+    const intvec_t &group_of,
+    int ngroups,
+    cg_quotient_t &q);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Group the functions by name prefix (module): the part before the
+*        last "::" or else before the first '_' or '@' (ignoring the leading ones).
+*        The names without a prefix go to one group named "" (empty)
+* @return The count of groups
+*/
+int cg_group_by_prefix(
+    const qstrvec_t &names,
+    intvec_t &group_of,
+    qstrvec_t &group_names);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Group the functions into call clusters (label propagation over the
+*        undirected call graph). The functions without calls go to one last group
+* @return The count of groups
+*/
+int cg_group_by_clusters(
+    const callgraph_t &cg,
+    intvec_t &group_of,
+    int max_iters = 16);
+
+#endif
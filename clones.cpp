@@ -0,0 +1,285 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version: rolling hash sub-block clone detection
+--------------------------------------------------------------------------*/
+
+#include "clones.h"
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+// Base of the polynomial rolling hash (odd, so it is invertible modulo 2^64)
+static const uint64 ROLL_BASE = 0x100000001B3ULL;
+
+//--------------------------------------------------------------------------
+/**
+* @brief A block in the flattened instruction stream
+*/
+struct flat_block_t
+{
+  int func;
+  int block;
+
+  // [start, end) positions in the flattened stream
+  int start;
+  int end;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief A hashed window: 'min_insns' keys starting at 'pos'
+*/
+struct window_t
+{
+  uint64 h;
+  int pos;
+
+  bool operator<(const window_t &o) const
+  {
+    return h < o.h || (h == o.h && pos < o.pos);
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Helper class holding the flattened instruction stream of all the functions
+*/
+class clone_finder_t
+{
+  const func_features_t *funcs;
+  const clone_params_t &params;
+
+  // Instruction keys of all the blocks of all the functions
+  uint64vec_t keys;
+
+  // Block index (in 'blocks') of each position
+  intvec_t pos2blk;
+  qvector<flat_block_t> blocks;
+
+  // Sorted windows and, for each position, its window index in 'windows'
+  // (-1 if the window hash is unique)
+  qvector<window_t> windows;
+  intvec_t pos2win;
+
+  // Positions that are already part of a reported clone
+  qvector<bool> covered;
+
+  void flatten(size_t nfuncs)
+  {
+    for (size_t f=0; f < nfuncs; f++)
+    {
+      const func_features_t &ff = funcs[f];
+      for (size_t b=0; b < ff.blocks.size(); b++)
+      {
+        const bbfeat_block_t &bb = ff.blocks[b];
+        flat_block_t &fb = blocks.push_back();
+        fb.func = int(f);
+        fb.block = int(b);
+        fb.start = int(keys.size());
+        for (int i=0; i < bb.ninsns; i++)
+        {
+          keys.push_back(bbfeat_insn_key(ff.insns[bb.first_insn + i], params.level));
+          pos2blk.push_back(int(blocks.size() - 1));
+        }
+        fb.end = int(keys.size());
+      }
+    }
+  }
+
+  void hash_windows()
+  {
+    const int w = params.min_insns;
+    uint64 pow_w = 1;
+    for (int i=0; i < w; i++)
+      pow_w *= ROLL_BASE;
+
+    for (size_t b=0; b < blocks.size(); b++)
+    {
+      const flat_block_t &fb = blocks[b];
+      if (fb.end - fb.start < w)
+        continue;
+
+      uint64 h = 0;
+      for (int i=0; i < w; i++)
+        h = h * ROLL_BASE + keys[fb.start + i];
+
+      for (int pos=fb.start; ; )
+      {
+        window_t &win = windows.push_back();
+        win.h = h;
+        win.pos = pos;
+
+        if (pos + w >= fb.end)
+          break;
+
+        // Roll: drop the first key, append the next one
+        h = h * ROLL_BASE + keys[pos + w] - keys[pos] * pow_w;
+        ++pos;
+      }
+    }
+
+    std::sort(windows.begin(), windows.end());
+
+    pos2win.resize(keys.size(), -1);
+    for (size_t i=0; i < windows.size(); )
+    {
+      size_t j = i + 1;
+      while (j < windows.size() && windows[j].h == windows[i].h)
+        ++j;
+
+      // Only buckets with more than one window are interesting
+      if (j - i > 1)
+      {
+        for (size_t k=i; k < j; k++)
+          pos2win[windows[k].pos] = int(k);
+      }
+      i = j;
+    }
+  }
+
+  inline bool same_keys(int p1, int p2, int len)
+  {
+    for (int i=0; i < len; i++)
+    {
+      if (keys[p1 + i] != keys[p2 + i])
+        return false;
+    }
+    return true;
+  }
+
+  /**
+  * @brief Extend the common length of the occurrences as far as possible
+  */
+  int extend(const intvec_t &members, int len)
+  {
+    int p = members[0];
+    for (;;)
+    {
+      for (size_t i=0; i < members.size(); i++)
+      {
+        int m = members[i];
+        if (    m + len >= blocks[pos2blk[m]].end
+             || keys[m + len] != keys[p + len]
+             || covered[m + len]
+             || (i + 1 < members.size() && m + len >= members[i + 1]))
+        {
+          return len;
+        }
+      }
+      ++len;
+    }
+  }
+
+  void report(const intvec_t &members, int len, clone_groupvec_t &out)
+  {
+    if (params.skip_whole_blocks)
+    {
+      bool all_whole = true;
+      for (size_t i=0; i < members.size() && all_whole; i++)
+      {
+        const flat_block_t &fb = blocks[pos2blk[members[i]]];
+        all_whole = members[i] == fb.start && members[i] + len == fb.end;
+      }
+      if (all_whole)
+        return;
+    }
+
+    clone_group_t &cg = out.push_back();
+    cg.ninsns = len;
+    for (size_t i=0; i < members.size(); i++)
+    {
+      int m = members[i];
+      const flat_block_t &fb = blocks[pos2blk[m]];
+      const func_features_t &ff = funcs[fb.func];
+      const bbfeat_block_t &bb = ff.blocks[fb.block];
+
+      clone_range_t &r = cg.ranges.push_back();
+      r.func = fb.func;
+      r.block = fb.block;
+      r.first_insn = bb.first_insn + (m - fb.start);
+      r.ninsns = len;
+
+      const insn_feat_t &last = ff.insns[r.first_insn + len - 1];
+      r.start = ff.insns[r.first_insn].ea;
+      r.end = last.ea + last.size;
+    }
+  }
+
+public:
+  clone_finder_t(
+    const func_features_t *funcs,
+    const clone_params_t &params): funcs(funcs), params(params)
+  {
+  }
+
+  size_t find(size_t nfuncs, clone_groupvec_t &out)
+  {
+    if (params.min_insns <= 0)
+      return 0;
+
+    flatten(nfuncs);
+    hash_windows();
+    covered.resize(keys.size(), false);
+
+    const int w = params.min_insns;
+    size_t count = out.size();
+
+    // Walk the positions in order so clones are seeded at their leftmost window
+    intvec_t members;
+    for (int p=0, n=int(keys.size()); p < n; p++)
+    {
+      int iwin = pos2win[p];
+      if (iwin == -1 || covered[p])
+        continue;
+
+      // Collect the non overlapping, not yet covered and verified occurrences.
+      // The bucket is sorted by position so the following windows are after 'p'
+      members.qclear();
+      uint64 h = windows[iwin].h;
+      int considered = 0;
+      for (size_t k=iwin;
+           k < windows.size() && windows[k].h == h && considered < params.max_bucket;
+           k++, considered++)
+      {
+        int q = windows[k].pos;
+        if (covered[q] || (q != p && !same_keys(p, q, w)))
+          continue;
+
+        if (!members.empty() && q < members.back() + w)
+          continue;
+
+        // Part of the window may be covered by a previous clone
+        bool free_window = true;
+        for (int i=0; i < w && free_window; i++)
+          free_window = !covered[q + i];
+
+        if (free_window)
+          members.push_back(q);
+      }
+
+      if (members.size() < 2)
+        continue;
+
+      int len = extend(members, w);
+      for (size_t i=0; i < members.size(); i++)
+      {
+        for (int k=0; k < len; k++)
+          covered[members[i] + k] = true;
+      }
+      report(members, len, out);
+    }
+    return out.size() - count;
+  }
+};
+
+//--------------------------------------------------------------------------
+size_t find_subblock_clones(
+    const func_features_t *funcs,
+    size_t nfuncs,
+    const clone_params_t &params,
+    clone_groupvec_t &out)
+{
+  clone_finder_t finder(funcs, params);
+  return finder.find(nfuncs, out);
+}
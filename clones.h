@@ -0,0 +1,107 @@
+#ifndef __CLONES__
+#define __CLONES__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Sub-block clone detection module
+
+This module finds repeated instruction sequences that do not necessarily
+start or end on a basic block boundary (for example inlined code that the
+compiler merged with neighbouring blocks).
+
+It slides a rolling hash of a fixed window over the normalized instruction
+keys of each block, buckets the windows by hash and then extends each
+verified seed to its maximal common length. The clones are reported as
+address ranges contained in a single block so they map to nodedef_t.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include "bbfeat.h"
+
+//--------------------------------------------------------------------------
+/**
+* @brief One occurrence of a clone
+*/
+struct clone_range_t
+{
+  /**
+  * @brief Function index (in the features array) and block index
+  */
+  int func;
+  int block;
+
+  /**
+  * @brief Instruction range in the function's instructions
+  */
+  int first_insn;
+  int ninsns;
+
+  /**
+  * @brief Address range [start, end)
+  */
+  ea_t start;
+  ea_t end;
+};
+typedef qvector<clone_range_t> clone_rangevec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief A set of equivalent instruction sequences
+*/
+struct clone_group_t
+{
+  int ninsns;
+  clone_rangevec_t ranges;
+};
+typedef qvector<clone_group_t> clone_groupvec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Clone detection parameters
+*/
+struct clone_params_t
+{
+  /**
+  * @brief Minimum clone length in instructions (the rolling window length)
+  */
+  int min_insns;
+
+  /**
+  * @brief Instruction normalization level
+  */
+  bbhash_level_e level;
+
+  /**
+  * @brief Do not report clones that only cover whole blocks
+  *        (the block matcher already finds those)
+  */
+  bool skip_whole_blocks;
+
+  /**
+  * @brief Maximum occurrences considered per window hash.
+  *        Bounds the work on degenerate input (long runs of the same instruction)
+  */
+  int max_bucket;
+
+  clone_params_t(): min_insns(6), level(bbh_optype), skip_whole_blocks(true), max_bucket(256)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Find the sub-block clones in a set of functions
+* @return The count of clone groups found
+*/
+size_t find_subblock_clones(
+    const func_features_t *funcs,
+    size_t nfuncs,
+    const clone_params_t &params,
+    clone_groupvec_t &out);
+
+#endif
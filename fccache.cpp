@@ -0,0 +1,177 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - Charge the flowcharts to the memory budget (see gsmem.h) and keep
+                                  the released ones cached while their fingerprint does not change
+                                - fix: the release comment (the released flowchart is not evicted right away)
+--------------------------------------------------------------------------*/
+
+#include "fccache.h"
+#include "util.h"
+#include "algo.hpp"
+#include "gsmem.h"
+#include <map>
+
+//--------------------------------------------------------------------------
+// The referenced and the cached (released) flowcharts
+typedef std::map<ea_t, shared_fc_t *> ea2sfc_t;
+static ea2sfc_t shared_fcs;
+
+//--------------------------------------------------------------------------
+/**
+* @brief The flowcharts memory cache. The key is the function address
+*/
+class fc_memcache_t: public gsmem_cache_t
+{
+public:
+  fc_memcache_t(): gsmem_cache_t("Flowcharts")
+  {
+  }
+
+  virtual void evict(uint64 key)
+  {
+    // Only the released flowcharts are unpinned
+    ea2sfc_t::iterator it = shared_fcs.find(ea_t(key));
+    if (it == shared_fcs.end() || it->second->refs > 0)
+      return;
+
+    delete it->second;
+    shared_fcs.erase(it);
+  }
+};
+static fc_memcache_t fc_memcache;
+
+//--------------------------------------------------------------------------
+void shared_fc_t::charge()
+{
+  // Rough footprint of the flowchart and of the derived data
+  int n = size();
+  size_t bytes = sizeof(*this) + n * sizeof(qbasic_block_t);
+  for (int nid=0; nid < n; nid++)
+    bytes += (nsucc(nid) + npred(nid)) * sizeof(int);
+
+  // The rebuild cost is counted in decoded instructions
+  double cost = n;
+  if (has_text)
+  {
+    for (int nid=0; nid < n; nid++)
+      bytes += block_text[nid].size();
+    cost += n;
+  }
+
+  if (features != NULL)
+  {
+    bytes += sizeof(*features)
+           + features->blocks.size() * sizeof(bbfeat_block_t)
+           + features->insns.size() * sizeof(insn_feat_t);
+    for (size_t i=0; i < features->blocks.size(); i++)
+    {
+      const bbfeat_block_t &block = features->blocks[i];
+      bytes += (block.succ.size() + block.pred.size()) * sizeof(int);
+    }
+    cost += features->insns.size();
+  }
+
+  // The disassembly text is about as costly as the features
+  if (has_text && features != NULL)
+    cost += features->insns.size();
+
+  fc_memcache.charge(func_ea, bytes, cost);
+}
+
+//--------------------------------------------------------------------------
+const qstrvec_t &shared_fc_t::get_block_text()
+{
+  if (!has_text)
+  {
+    int n = size();
+    block_text.resize(n);
+    for (int nid=0; nid < n; nid++)
+    {
+      qbasic_block_t &block = blocks[nid];
+      get_disasm_text(
+          block.startEA,
+          block.endEA,
+          &block_text[nid]);
+    }
+    has_text = true;
+    charge();
+  }
+  return block_text;
+}
+
+//--------------------------------------------------------------------------
+const func_features_t *shared_fc_t::get_features()
+{
+  if (features == NULL)
+  {
+    features = new func_features_t();
+    if (!get_func_features(func_ea, *features, this))
+    {
+      delete features;
+      features = NULL;
+    }
+    charge();
+  }
+  return features;
+}
+
+//--------------------------------------------------------------------------
+shared_fc_t *acquire_shared_fc(ea_t ea)
+{
+  func_t *f = get_func(ea);
+  if (f == NULL)
+    return NULL;
+
+  shared_fc_t *cached = NULL;
+  ea2sfc_t::iterator it = shared_fcs.find(f->startEA);
+  if (it != shared_fcs.end())
+  {
+    if (it->second->refs > 0)
+      return it->second->addref();
+
+    cached = it->second;
+  }
+
+  shared_fc_t *fc = new shared_fc_t(f->startEA);
+  if (!get_func_flowchart(f->startEA, *fc))
+  {
+    delete fc;
+    return NULL;
+  }
+  fc->fingerprint = get_fc_fingerprint(fc);
+
+  if (cached != NULL)
+  {
+    // Reuse the cached flowchart and its derived data if the function did not change
+    if (cached->fingerprint == fc->fingerprint)
+    {
+      delete fc;
+      cached->refs = 1;
+      fc_memcache.pin(cached->func_ea, true);
+      fc_memcache.touch(cached->func_ea);
+      return cached;
+    }
+
+    fc_memcache.uncharge(cached->func_ea);
+    delete cached;
+  }
+
+  shared_fcs[f->startEA] = fc;
+  fc->charge();
+  fc_memcache.pin(fc->func_ea, true);
+  return fc;
+}
+
+//--------------------------------------------------------------------------
+void release_shared_fc(shared_fc_t *fc)
+{
+  if (fc == NULL || --fc->refs > 0)
+    return;
+
+  // Keep it cached: unpinning evicts the other entries over the budget
+  // first, this one goes on a later trim
+  fc_memcache.pin(fc->func_ea, false);
+}
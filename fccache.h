@@ -0,0 +1,104 @@
+#ifndef __FCCACHE__
+#define __FCCACHE__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Shared flowcharts module
+
+The choosers and graph views of the functions being looked at share one
+flowchart per function, with the data derived from it (the blocks
+disassembly text and the function features) computed on first use. The
+flowcharts are reference counted and charged to the memory budget (see
+gsmem.h): a referenced flowchart is pinned, the last view that releases
+one leaves it in the cache until the budget evicts it. A cached flowchart
+is reused only if the function's flowchart fingerprint did not change.
+
+Checking the fingerprint means building the function's flowchart again:
+IDA keeps no cheaper change stamp per function, and the bounds alone miss
+the edits inside a function. So a cache hit still costs one flowchart
+build; it saves the derived data (the blocks text and the features),
+which cost far more.
+
+Must be used from the main thread (the derived data calls the IDA kernel).
+Once built, a shared flowchart may be read from any thread.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+#include <gdl.hpp>
+#include "bbfeat.h"
+
+//--------------------------------------------------------------------------
+/**
+* @brief A function flowchart shared by the views
+*/
+class shared_fc_t: public qflow_chart_t
+{
+  friend shared_fc_t *acquire_shared_fc(ea_t);
+  friend void release_shared_fc(shared_fc_t *);
+  friend class fc_memcache_t;
+
+  int refs;
+  ea_t func_ea;
+  uint64 fingerprint;
+  bool has_text;
+  qstrvec_t block_text;
+  func_features_t *features;
+
+  shared_fc_t(ea_t func_ea): refs(1), func_ea(func_ea), fingerprint(0),
+    has_text(false), features(NULL)
+  {
+  }
+
+  /**
+  * @brief Update the size and rebuild cost charged to the memory budget
+  */
+  void charge();
+
+  ~shared_fc_t()
+  {
+    delete features;
+  }
+
+public:
+  inline ea_t get_func_ea() const { return func_ea; }
+
+  /**
+  * @brief Add a reference
+  */
+  inline shared_fc_t *addref()
+  {
+    ++refs;
+    return this;
+  }
+
+  /**
+  * @brief The disassembly text of each block
+  */
+  const qstrvec_t &get_block_text();
+
+  /**
+  * @brief The features of the function or NULL on failure
+  */
+  const func_features_t *get_features();
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Return the shared flowchart of the function containing 'ea'
+*        (built if needed) with a new reference or NULL on failure.
+*        A released (cached) flowchart is checked by building the
+*        flowchart again, see above
+*/
+shared_fc_t *acquire_shared_fc(ea_t ea);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Drop a reference. NULL is allowed
+*/
+void release_shared_fc(shared_fc_t *fc);
+
+#endif
@@ -0,0 +1,906 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+--------------------------------------------------------------------------*/
+
+#include "fsgminer.h"
+#include <map>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+// Edge labels: the CFG edge directions seen from the edge's 'from' vertex
+#define FSG_E_OUT  1
+#define FSG_E_IN   2
+
+//--------------------------------------------------------------------------
+/**
+* @brief An adjacency entry of the undirected graph
+*/
+struct fsg_edge_t
+{
+  int from;
+  int to;
+  int elabel;
+  int id;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Labeled undirected graph (the function CFG or a pattern)
+*/
+struct fsg_graph_t
+{
+  intvec_t vlabel;
+  qvector< qvector<fsg_edge_t> > adj;
+  int nedges;
+
+  fsg_graph_t(): nedges(0)
+  {
+  }
+
+  void resize(int n)
+  {
+    vlabel.resize(n);
+    adj.resize(n);
+  }
+
+  static inline int reverse_elabel(int elabel)
+  {
+    return ((elabel & FSG_E_OUT) != 0 ? FSG_E_IN : 0) | ((elabel & FSG_E_IN) != 0 ? FSG_E_OUT : 0);
+  }
+
+  /**
+  * @brief Add an undirected edge. 'elabel' is seen from 'from'
+  */
+  void add_edge(int from, int to, int elabel)
+  {
+    fsg_edge_t &e1 = adj[from].push_back();
+    e1.from = from;
+    e1.to = to;
+    e1.elabel = elabel;
+    e1.id = nedges;
+
+    fsg_edge_t &e2 = adj[to].push_back();
+    e2.from = to;
+    e2.to = from;
+    e2.elabel = reverse_elabel(elabel);
+    e2.id = nedges;
+
+    ++nedges;
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief One DFS code edge. The labels that are implied are -1
+*/
+struct fsg_dfs_t
+{
+  int from, to;
+  int fromlabel, elabel, tolabel;
+
+  bool operator==(const fsg_dfs_t &o) const
+  {
+    return    from == o.from && to == o.to && fromlabel == o.fromlabel
+           && elabel == o.elabel && tolabel == o.tolabel;
+  }
+  bool operator!=(const fsg_dfs_t &o) const { return !(*this == o); }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief DFS code of a pattern
+*/
+class fsg_code_t: public qvector<fsg_dfs_t>
+{
+public:
+  void push(int from, int to, int fromlabel, int elabel, int tolabel)
+  {
+    fsg_dfs_t &d = push_back();
+    d.from = from;
+    d.to = to;
+    d.fromlabel = fromlabel;
+    d.elabel = elabel;
+    d.tolabel = tolabel;
+  }
+
+  /**
+  * @brief The code edges on the rightmost path, from the rightmost vertex up
+  */
+  void build_rmpath(intvec_t &rmpath) const
+  {
+    rmpath.qclear();
+    int old_from = -1;
+    for (int i=int(size()) - 1; i >= 0; i--)
+    {
+      const fsg_dfs_t &d = (*this)[i];
+      if (d.from < d.to && (rmpath.empty() || old_from == d.to))
+      {
+        rmpath.push_back(i);
+        old_from = d.from;
+      }
+    }
+  }
+
+  int nvertices() const
+  {
+    int n = 0;
+    for (size_t i=0; i < size(); i++)
+      n = qmax(n, qmax((*this)[i].from, (*this)[i].to) + 1);
+    return n;
+  }
+
+  void to_graph(fsg_graph_t &g) const
+  {
+    g.resize(nvertices());
+    for (size_t i=0; i < size(); i++)
+    {
+      const fsg_dfs_t &d = (*this)[i];
+      if (d.fromlabel != -1)
+        g.vlabel[d.from] = d.fromlabel;
+      if (d.tolabel != -1)
+        g.vlabel[d.to] = d.tolabel;
+      g.add_edge(d.from, d.to, d.elabel);
+    }
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief One edge of an embedding, chained to the previous edges
+*/
+struct fsg_pdfs_t
+{
+  const fsg_edge_t *edge;
+  const fsg_pdfs_t *prev;
+};
+typedef qvector<fsg_pdfs_t> fsg_projected_t;
+
+// Extensions keyed by (from|to, elabel, tolabel)
+typedef std::map<int, fsg_projected_t> fsg_projmap1_t;
+typedef std::map<int, fsg_projmap1_t> fsg_projmap2_t;
+typedef std::map<int, fsg_projmap2_t> fsg_projmap3_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief The edges and vertices of an embedding. The membership tests
+*        use stamps so building a history does not clear anything
+*/
+class fsg_history_t
+{
+  intvec_t vstamp, estamp;
+  int stamp;
+
+public:
+  qvector<const fsg_edge_t *> edges;
+
+  fsg_history_t(const fsg_graph_t &g): stamp(0)
+  {
+    vstamp.resize(g.vlabel.size(), 0);
+    estamp.resize(g.nedges, 0);
+  }
+
+  void build(const fsg_pdfs_t *p)
+  {
+    ++stamp;
+    edges.qclear();
+    for (; p != NULL; p=p->prev)
+    {
+      edges.push_back(p->edge);
+      estamp[p->edge->id] = stamp;
+      vstamp[p->edge->from] = stamp;
+      vstamp[p->edge->to] = stamp;
+    }
+    std::reverse(edges.begin(), edges.end());
+  }
+
+  inline bool has_edge(int id) const { return estamp[id] == stamp; }
+  inline bool has_vertex(int v) const { return vstamp[v] == stamp; }
+  inline const fsg_edge_t *operator[](int i) const { return edges[i]; }
+};
+
+//--------------------------------------------------------------------------
+// The gSpan extension rules
+static const fsg_edge_t *get_backward(
+    const fsg_graph_t &g,
+    const fsg_edge_t *e1,
+    const fsg_edge_t *e2,
+    const fsg_history_t &h)
+{
+  if (e1 == e2)
+    return NULL;
+
+  const qvector<fsg_edge_t> &adj = g.adj[e2->to];
+  for (size_t i=0; i < adj.size(); i++)
+  {
+    const fsg_edge_t *e = &adj[i];
+    if (h.has_edge(e->id))
+      continue;
+
+    if (    e->to == e1->from
+         && (   e1->elabel < e->elabel
+             || (e1->elabel == e->elabel && g.vlabel[e1->to] <= g.vlabel[e2->to])))
+    {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+static bool get_forward_rmpath(
+    const fsg_graph_t &g,
+    const fsg_edge_t *e,
+    int minlabel,
+    const fsg_history_t &h,
+    qvector<const fsg_edge_t *> &out)
+{
+  out.qclear();
+  int tolabel = g.vlabel[e->to];
+  const qvector<fsg_edge_t> &adj = g.adj[e->from];
+  for (size_t i=0; i < adj.size(); i++)
+  {
+    const fsg_edge_t *it = &adj[i];
+    int tolabel2 = g.vlabel[it->to];
+    if (e->to == it->to || minlabel > tolabel2 || h.has_vertex(it->to))
+      continue;
+
+    if (e->elabel < it->elabel || (e->elabel == it->elabel && tolabel <= tolabel2))
+      out.push_back(it);
+  }
+  return !out.empty();
+}
+
+static bool get_forward_pure(
+    const fsg_graph_t &g,
+    const fsg_edge_t *e,
+    int minlabel,
+    const fsg_history_t &h,
+    qvector<const fsg_edge_t *> &out)
+{
+  out.qclear();
+  const qvector<fsg_edge_t> &adj = g.adj[e->to];
+  for (size_t i=0; i < adj.size(); i++)
+  {
+    const fsg_edge_t *it = &adj[i];
+    if (minlabel > g.vlabel[it->to] || h.has_vertex(it->to))
+      continue;
+    out.push_back(it);
+  }
+  return !out.empty();
+}
+
+static void get_forward_root(
+    const fsg_graph_t &g,
+    fsg_projmap3_t &root)
+{
+  for (size_t v=0; v < g.adj.size(); v++)
+  {
+    const qvector<fsg_edge_t> &adj = g.adj[v];
+    for (size_t i=0; i < adj.size(); i++)
+    {
+      const fsg_edge_t *e = &adj[i];
+      if (g.vlabel[v] > g.vlabel[e->to])
+        continue;
+
+      fsg_pdfs_t &p = root[g.vlabel[v]][e->elabel][g.vlabel[e->to]].push_back();
+      p.edge = e;
+      p.prev = NULL;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief A frequent pattern and its occurrences
+*/
+struct fsg_candidate_t
+{
+  int nblocks;
+  int nedges;
+
+  // Discovery order (seed then order within the seed) to break the ties
+  int seed;
+  int order;
+
+  // The blocks of each occurrence, in pattern vertex order
+  qvector<intvec_t> occs;
+
+  // Prefer the candidates covering the most blocks then the most connected
+  bool operator<(const fsg_candidate_t &o) const
+  {
+    int s1 = nblocks * int(occs.size()), s2 = o.nblocks * int(o.occs.size());
+    if (s1 != s2)
+      return s1 > s2;
+    if (nedges != o.nedges)
+      return nedges > o.nedges;
+    if (seed != o.seed)
+      return seed < o.seed;
+    return order < o.order;
+  }
+};
+typedef qvector<fsg_candidate_t> fsg_candvec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Mines the subtrees of the seeds it is given (one per worker thread)
+*/
+class fsg_worker_t
+{
+  const fsg_graph_t &g;
+  const fsg_params_t &params;
+  fsg_history_t h;
+  fsg_code_t code;
+  int seed;
+
+public:
+  fsg_stats_t stats;
+  fsg_candvec_t cands;
+
+private:
+  /**
+  * @brief The image of each pattern vertex in an embedding
+  */
+  void get_image(const fsg_history_t &hist, intvec_t &img)
+  {
+    img.resize(code.nvertices());
+    for (size_t i=0; i < code.size(); i++)
+    {
+      img[code[i].from] = hist[int(i)]->from;
+      img[code[i].to] = hist[int(i)]->to;
+    }
+  }
+
+  /**
+  * @brief Minimum image based support
+  */
+  int get_support(const fsg_projected_t &proj)
+  {
+    int nv = code.nvertices();
+    qvector<uint64> pairs;
+    intvec_t img;
+    for (size_t i=0; i < proj.size(); i++)
+    {
+      h.build(&proj[i]);
+      get_image(h, img);
+      for (int k=0; k < nv; k++)
+        pairs.push_back((uint64(k) << 32) | uint32(img[k]));
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    intvec_t count;
+    count.resize(nv, 0);
+    for (size_t i=0; i < pairs.size(); i++)
+    {
+      if (i == 0 || pairs[i] != pairs[i - 1])
+        ++count[int(pairs[i] >> 32)];
+    }
+    return *std::min_element(count.begin(), count.end());
+  }
+
+  /**
+  * @brief Record a frequent pattern: its distinct occurrences (as block sets)
+  */
+  void report(const fsg_projected_t &proj)
+  {
+    typedef std::map<intvec_t, intvec_t> set2img_t;
+    set2img_t occs;
+    intvec_t img, key;
+    for (size_t i=0; i < proj.size(); i++)
+    {
+      h.build(&proj[i]);
+      get_image(h, img);
+      key = img;
+      std::sort(key.begin(), key.end());
+      occs.insert(std::make_pair(key, img));
+    }
+
+    if (occs.size() < size_t(params.min_support))
+      return;
+
+    fsg_candidate_t &c = cands.push_back();
+    c.nblocks = code.nvertices();
+    c.nedges = int(code.size());
+    c.seed = seed;
+    c.order = stats.candidates++;
+    for (set2img_t::iterator it=occs.begin(); it != occs.end(); ++it)
+      c.occs.push_back(it->second);
+  }
+
+  /**
+  * @brief Is the current code the minimal DFS code of its pattern?
+  */
+  bool is_min()
+  {
+    if (code.size() == 1)
+      return true;
+
+    fsg_graph_t pg;
+    code.to_graph(pg);
+    fsg_history_t ph(pg);
+
+    fsg_projmap3_t root;
+    get_forward_root(pg, root);
+
+    fsg_projmap3_t::iterator fromlabel = root.begin();
+    fsg_projmap2_t::iterator elabel = fromlabel->second.begin();
+    fsg_projmap1_t::iterator tolabel = elabel->second.begin();
+
+    fsg_code_t min_code;
+    min_code.push(0, 1, fromlabel->first, elabel->first, tolabel->first);
+    if (min_code[0] != code[0])
+      return false;
+
+    return project_is_min(pg, ph, min_code, tolabel->second);
+  }
+
+  bool project_is_min(
+      const fsg_graph_t &pg,
+      fsg_history_t &ph,
+      fsg_code_t &min_code,
+      const fsg_projected_t &proj)
+  {
+    intvec_t rmpath;
+    min_code.build_rmpath(rmpath);
+    int minlabel = min_code[0].fromlabel;
+    int maxtoc = min_code[rmpath[0]].to;
+
+    // Backward
+    {
+      bool found = false;
+      int newto = 0;
+      std::map<int, fsg_projected_t> root;
+      for (int i=int(rmpath.size()) - 1; !found && i >= 1; i--)
+      {
+        for (size_t k=0; k < proj.size(); k++)
+        {
+          ph.build(&proj[k]);
+          const fsg_edge_t *e = get_backward(pg, ph[rmpath[i]], ph[rmpath[0]], ph);
+          if (e == NULL)
+            continue;
+
+          fsg_pdfs_t &p = root[e->elabel].push_back();
+          p.edge = e;
+          p.prev = &proj[k];
+          newto = min_code[rmpath[i]].from;
+          found = true;
+        }
+      }
+
+      if (found)
+      {
+        std::map<int, fsg_projected_t>::iterator elabel = root.begin();
+        min_code.push(maxtoc, newto, -1, elabel->first, -1);
+        size_t n = min_code.size() - 1;
+        if (code[n] != min_code[n])
+          return false;
+        return project_is_min(pg, ph, min_code, elabel->second);
+      }
+    }
+
+    // Forward
+    {
+      bool found = false;
+      int newfrom = 0;
+      fsg_projmap2_t root;
+      qvector<const fsg_edge_t *> edges;
+      for (size_t k=0; k < proj.size(); k++)
+      {
+        ph.build(&proj[k]);
+        if (!get_forward_pure(pg, ph[rmpath[0]], minlabel, ph, edges))
+          continue;
+
+        found = true;
+        newfrom = maxtoc;
+        for (size_t j=0; j < edges.size(); j++)
+        {
+          fsg_pdfs_t &p = root[edges[j]->elabel][pg.vlabel[edges[j]->to]].push_back();
+          p.edge = edges[j];
+          p.prev = &proj[k];
+        }
+      }
+
+      for (size_t i=0; !found && i < rmpath.size(); i++)
+      {
+        for (size_t k=0; k < proj.size(); k++)
+        {
+          ph.build(&proj[k]);
+          if (!get_forward_rmpath(pg, ph[rmpath[i]], minlabel, ph, edges))
+            continue;
+
+          found = true;
+          newfrom = min_code[rmpath[i]].from;
+          for (size_t j=0; j < edges.size(); j++)
+          {
+            fsg_pdfs_t &p = root[edges[j]->elabel][pg.vlabel[edges[j]->to]].push_back();
+            p.edge = edges[j];
+            p.prev = &proj[k];
+          }
+        }
+      }
+
+      if (found)
+      {
+        fsg_projmap2_t::iterator elabel = root.begin();
+        fsg_projmap1_t::iterator tolabel = elabel->second.begin();
+        min_code.push(newfrom, maxtoc + 1, -1, elabel->first, tolabel->first);
+        size_t n = min_code.size() - 1;
+        if (code[n] != min_code[n])
+          return false;
+        return project_is_min(pg, ph, min_code, tolabel->second);
+      }
+    }
+    return true;
+  }
+
+  /**
+  * @brief Visit a pattern and its extensions
+  */
+  void project(const fsg_projected_t &proj)
+  {
+    if (get_support(proj) < params.min_support)
+      return;
+
+    if (!is_min())
+    {
+      ++stats.non_canonical;
+      return;
+    }
+    ++stats.patterns;
+
+    int nv = code.nvertices();
+    if (nv >= params.min_blocks)
+      report(proj);
+
+    if (int(proj.size()) > params.max_embeddings)
+    {
+      ++stats.truncated;
+      return;
+    }
+
+    intvec_t rmpath;
+    code.build_rmpath(rmpath);
+    int minlabel = code[0].fromlabel;
+    int maxtoc = code[rmpath[0]].to;
+
+    fsg_projmap3_t new_fwd_root;
+    fsg_projmap2_t new_bck_root;
+    qvector<const fsg_edge_t *> edges;
+    bool can_grow = nv < params.max_blocks;
+
+    for (size_t k=0; k < proj.size(); k++)
+    {
+      const fsg_pdfs_t *cur = &proj[k];
+      h.build(cur);
+
+      // Backward: close a cycle from the rightmost vertex
+      for (int i=int(rmpath.size()) - 1; i >= 1; i--)
+      {
+        const fsg_edge_t *e = get_backward(g, h[rmpath[i]], h[rmpath[0]], h);
+        if (e == NULL)
+          continue;
+
+        fsg_pdfs_t &p = new_bck_root[code[rmpath[i]].from][e->elabel].push_back();
+        p.edge = e;
+        p.prev = cur;
+      }
+
+      if (!can_grow)
+        continue;
+
+      // Pure forward: from the rightmost vertex
+      if (get_forward_pure(g, h[rmpath[0]], minlabel, h, edges))
+      {
+        for (size_t j=0; j < edges.size(); j++)
+        {
+          fsg_pdfs_t &p = new_fwd_root[maxtoc][edges[j]->elabel][g.vlabel[edges[j]->to]].push_back();
+          p.edge = edges[j];
+          p.prev = cur;
+        }
+      }
+
+      // Backtracked forward: from the rightmost path
+      for (size_t i=0; i < rmpath.size(); i++)
+      {
+        if (!get_forward_rmpath(g, h[rmpath[i]], minlabel, h, edges))
+          continue;
+
+        for (size_t j=0; j < edges.size(); j++)
+        {
+          fsg_pdfs_t &p = new_fwd_root[code[rmpath[i]].from][edges[j]->elabel][g.vlabel[edges[j]->to]].push_back();
+          p.edge = edges[j];
+          p.prev = cur;
+        }
+      }
+    }
+
+    // Recurse in the DFS code order
+    for (fsg_projmap2_t::iterator to=new_bck_root.begin(); to != new_bck_root.end(); ++to)
+    {
+      for (fsg_projmap1_t::iterator el=to->second.begin(); el != to->second.end(); ++el)
+      {
+        code.push(maxtoc, to->first, -1, el->first, -1);
+        project(el->second);
+        code.pop_back();
+      }
+    }
+
+    for (fsg_projmap3_t::reverse_iterator from=new_fwd_root.rbegin(); from != new_fwd_root.rend(); ++from)
+    {
+      for (fsg_projmap2_t::iterator el=from->second.begin(); el != from->second.end(); ++el)
+      {
+        for (fsg_projmap1_t::iterator tl=el->second.begin(); tl != el->second.end(); ++tl)
+        {
+          code.push(from->first, maxtoc + 1, -1, el->first, tl->first);
+          project(tl->second);
+          code.pop_back();
+        }
+      }
+    }
+  }
+
+public:
+  fsg_worker_t(
+    const fsg_graph_t &g,
+    const fsg_params_t &params): g(g), params(params), h(g), seed(0)
+  {
+  }
+
+  /**
+  * @brief Mine the patterns whose first code edge is the seed
+  */
+  void mine(int seed, const fsg_dfs_t &first, const fsg_projected_t &proj)
+  {
+    this->seed = seed;
+    code.qclear();
+    code.push_back(first);
+    project(proj);
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief State shared by the mining threads
+*/
+struct fsg_job_t
+{
+  const fsg_graph_t *g;
+  const fsg_params_t *params;
+  qvector<fsg_dfs_t> seed_codes;
+  qvector<const fsg_projected_t *> seed_projs;
+  std::atomic<int> next_seed;
+  qvector<fsg_worker_t *> workers;
+  std::atomic<int> next_worker;
+};
+
+static int idaapi fsg_thread(void *ud)
+{
+  fsg_job_t &job = *(fsg_job_t *)ud;
+  fsg_worker_t *w = job.workers[job.next_worker++];
+
+  int nseeds = int(job.seed_codes.size());
+  for (int s; (s = job.next_seed++) < nseeds; )
+    w->mine(s, job.seed_codes[s], *job.seed_projs[s]);
+
+  return 0;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Build the labeled undirected graph of the CFG. A self loop is
+*        folded into its block label
+*/
+static void build_cfg_graph(
+    const func_features_t &ff,
+    bbhash_level_e level,
+    fsg_graph_t &g)
+{
+  int n = int(ff.blocks.size());
+  g.resize(n);
+
+  std::map<uint64, int> alphabet;
+  std::map<uint64, int> pairs;
+  for (int b=0; b < n; b++)
+  {
+    const bbfeat_block_t &bb = ff.blocks[b];
+    std::map<uint64, int>::iterator it = alphabet.find(bb.hash.h[level]);
+    if (it == alphabet.end())
+      it = alphabet.insert(std::make_pair(bb.hash.h[level], int(alphabet.size()))).first;
+
+    bool self_loop = bb.succ.has(b);
+    g.vlabel[b] = it->second * 2 + (self_loop ? 1 : 0);
+
+    // Direction bits seen from the lower block id
+    for (size_t i=0; i < bb.succ.size(); i++)
+    {
+      int s = bb.succ[i];
+      if (s == b)
+        continue;
+
+      int lo = qmin(b, s), hi = qmax(b, s);
+      pairs[(uint64(lo) << 32) | uint32(hi)] |= b == lo ? FSG_E_OUT : FSG_E_IN;
+    }
+  }
+
+  for (std::map<uint64, int>::iterator it=pairs.begin(); it != pairs.end(); ++it)
+    g.add_edge(int(it->first >> 32), int(uint32(it->first)), it->second);
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Is the set of blocks single-entry? At most one block (the function's
+*        entry block counts) is entered from outside of the set
+*/
+static bool is_single_entry(
+    const func_features_t &ff,
+    const intvec_t &blocks,
+    qvector<bool> &in_set)
+{
+  for (size_t i=0; i < blocks.size(); i++)
+    in_set[blocks[i]] = true;
+
+  int nentries = 0;
+  for (size_t i=0; i < blocks.size() && nentries <= 1; i++)
+  {
+    int b = blocks[i];
+    bool entered = b == 0;
+    const intvec_t &pred = ff.blocks[b].pred;
+    for (size_t k=0; k < pred.size() && !entered; k++)
+      entered = !in_set[pred[k]];
+
+    if (entered)
+      ++nentries;
+  }
+
+  for (size_t i=0; i < blocks.size(); i++)
+    in_set[blocks[i]] = false;
+
+  return nentries <= 1;
+}
+
+//--------------------------------------------------------------------------
+size_t mine_frequent_subgraphs(
+    const func_features_t &ff,
+    const fsg_params_t &params,
+    int_3dvec_t &result,
+    fsg_stats_t *stats)
+{
+  fsg_stats_t _stats;
+  if (stats == NULL)
+    stats = &_stats;
+  *stats = fsg_stats_t();
+
+  result.qclear();
+  int nblocks = int(ff.blocks.size());
+  if (nblocks == 0)
+    return 0;
+
+  fsg_graph_t g;
+  build_cfg_graph(ff, params.level, g);
+
+  // The single edge patterns are the seeds. Only the frequent ones are
+  // mined: the support does not grow with the extensions
+  fsg_projmap3_t root;
+  get_forward_root(g, root);
+
+  fsg_job_t job;
+  job.g = &g;
+  job.params = &params;
+  for (fsg_projmap3_t::iterator fl=root.begin(); fl != root.end(); ++fl)
+  {
+    for (fsg_projmap2_t::iterator el=fl->second.begin(); el != fl->second.end(); ++el)
+    {
+      for (fsg_projmap1_t::iterator tl=el->second.begin(); tl != el->second.end(); ++tl)
+      {
+        if (tl->second.size() < size_t(params.min_support))
+          continue;
+
+        fsg_dfs_t &d = job.seed_codes.push_back();
+        d.from = 0;
+        d.to = 1;
+        d.fromlabel = fl->first;
+        d.elabel = el->first;
+        d.tolabel = tl->first;
+        job.seed_projs.push_back(&tl->second);
+      }
+    }
+  }
+  stats->seeds = int(job.seed_codes.size());
+
+  int nthreads = params.nthreads;
+  if (nthreads <= 0)
+    nthreads = qmax(int(std::thread::hardware_concurrency()), 1);
+  nthreads = qmax(qmin(nthreads, stats->seeds), 1);
+
+  for (int i=0; i < nthreads; i++)
+    job.workers.push_back(new fsg_worker_t(g, params));
+  job.next_seed = 0;
+  job.next_worker = 0;
+
+  // The calling thread is one of the workers
+  qvector<qthread_t> threads;
+  for (int i=1; i < nthreads; i++)
+  {
+    qthread_t t = qthread_create(fsg_thread, &job);
+    if (t != NULL)
+      threads.push_back(t);
+  }
+  fsg_thread(&job);
+
+  for (size_t i=0; i < threads.size(); i++)
+  {
+    qthread_join(threads[i]);
+    qthread_free(threads[i]);
+  }
+
+  // Gather the candidates and the statistics
+  fsg_candvec_t cands;
+  for (size_t i=0; i < job.workers.size(); i++)
+  {
+    fsg_worker_t *w = job.workers[i];
+    stats->patterns += w->stats.patterns;
+    stats->non_canonical += w->stats.non_canonical;
+    stats->truncated += w->stats.truncated;
+    for (size_t k=0; k < w->cands.size(); k++)
+    {
+      fsg_candidate_t &c = cands.push_back();
+      c = w->cands[k];
+    }
+    delete w;
+  }
+  stats->candidates = int(cands.size());
+  std::sort(cands.begin(), cands.end());
+
+  // Select greedily the unused single-entry occurrences
+  qvector<bool> used, in_set;
+  used.resize(nblocks, false);
+  in_set.resize(nblocks, false);
+  for (size_t ic=0; ic < cands.size(); ic++)
+  {
+    fsg_candidate_t &c = cands[ic];
+
+    qvector<const intvec_t *> picked;
+    for (size_t i=0; i < c.occs.size(); i++)
+    {
+      const intvec_t &occ = c.occs[i];
+
+      // Not used by a previous SG nor by a previous occurrence of this one
+      bool free_occ = true;
+      for (size_t k=0; k < occ.size() && free_occ; k++)
+        free_occ = !used[occ[k]];
+
+      if (!free_occ)
+        continue;
+
+      if (!is_single_entry(ff, occ, in_set))
+      {
+        ++stats->rejected_entry;
+        continue;
+      }
+
+      for (size_t k=0; k < occ.size(); k++)
+        used[occ[k]] = true;
+      picked.push_back(&occ);
+    }
+
+    if (picked.size() >= size_t(params.min_support))
+    {
+      int_2dvec_t &sg = result.push_back();
+      for (size_t i=0; i < picked.size(); i++)
+        sg.push_back(*picked[i]);
+      continue;
+    }
+
+    // Not enough occurrences: release the blocks
+    for (size_t i=0; i < picked.size(); i++)
+    {
+      const intvec_t &occ = *picked[i];
+      for (size_t k=0; k < occ.size(); k++)
+        used[occ[k]] = false;
+    }
+  }
+  return result.size();
+}
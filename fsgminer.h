@@ -0,0 +1,116 @@
+#ifndef __FSGMINER__
+#define __FSGMINER__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Frequent subgraphs miner module
+
+A native alternative grouping engine to findSubGraphs() and to the
+repeated paths engine: it finds the connected subgraphs of a function's
+CFG that occur at least k times, whatever their shape.
+
+The mining is gSpan-style over the CFG seen as an undirected graph: the
+vertices are labeled with the block hashes and the edges with their
+direction(s). Patterns are grown by rightmost extension of their DFS code
+and a pattern is only expanded from its minimal (canonical) DFS code, so
+each pattern is visited once. The support is the minimum image based
+support (the smallest count of distinct blocks a pattern vertex maps to)
+which never grows when a pattern is extended. The subtrees of the frequent
+single edge patterns are mined in parallel.
+
+The frequent patterns are then selected greedily (most covered blocks
+first): their occurrences that are single-entry and do not reuse a block
+become the node groups of a super group.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include "bbfeat.h"
+#include "types.hpp"
+
+//--------------------------------------------------------------------------
+/**
+* @brief Frequent subgraphs miner parameters
+*/
+struct fsg_params_t
+{
+  /**
+  * @brief Minimum count of occurrences of a pattern (k)
+  */
+  int min_support;
+
+  /**
+  * @brief Pattern size bounds, in blocks
+  */
+  int min_blocks;
+  int max_blocks;
+
+  /**
+  * @brief Patterns with more occurrences than this are not extended
+  */
+  int max_embeddings;
+
+  /**
+  * @brief Block hash level used as the vertex labels
+  */
+  bbhash_level_e level;
+
+  /**
+  * @brief Count of worker threads; zero to use one per core
+  */
+  int nthreads;
+
+  fsg_params_t(): min_support(2), min_blocks(2), max_blocks(8),
+    max_embeddings(5000), level(bbh_regren), nthreads(0)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Statistics of a mining run
+*/
+struct fsg_stats_t
+{
+  // Frequent single edge patterns (the parallel work items)
+  int seeds;
+
+  // Patterns visited, frequent and canonical
+  int patterns;
+
+  // Patterns pruned because their DFS code is not the canonical one
+  int non_canonical;
+
+  // Patterns not extended because they have too many occurrences
+  int truncated;
+
+  // Frequent patterns within the size bounds
+  int candidates;
+
+  // Occurrences rejected because they have more than one entry
+  int rejected_entry;
+
+  fsg_stats_t(): seeds(0), patterns(0), non_canonical(0), truncated(0),
+    candidates(0), rejected_entry(0)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Find the frequent single-entry subgraphs of a function.
+*        The result has the same layout as find_repeated_paths(). The nodes
+*        of the NGs of one SG are listed in corresponding order
+* @return The count of super groups found
+*/
+size_t mine_frequent_subgraphs(
+    const func_features_t &ff,
+    const fsg_params_t &params,
+    int_3dvec_t &result,
+    fsg_stats_t *stats = NULL);
+
+#endif
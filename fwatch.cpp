@@ -0,0 +1,193 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - fix: a created file is only seen once written (no IN_CREATE)
+--------------------------------------------------------------------------*/
+
+#include "fwatch.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef FWATCH_INOTIFY
+  #include <sys/inotify.h>
+  #include <unistd.h>
+  #include <fcntl.h>
+  #include <string.h>
+#endif
+
+//--------------------------------------------------------------------------
+file_watch_t::file_watch_t(): size(-1), reported_size(-1), mtime(-1), reported_mtime(-1)
+{
+#ifdef FWATCH_INOTIFY
+  fd = -1;
+  wd = -1;
+#endif
+}
+
+//--------------------------------------------------------------------------
+file_watch_t::~file_watch_t()
+{
+  stop();
+}
+
+//--------------------------------------------------------------------------
+bool file_watch_t::stat_file(int64 *out_size, int64 *out_mtime)
+{
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return false;
+
+  *out_size = int64(st.st_size);
+  *out_mtime = int64(st.st_mtime);
+  return true;
+}
+
+//--------------------------------------------------------------------------
+bool file_watch_t::start(const char *path)
+{
+  stop();
+  this->path = path;
+  if (!stat_file(&size, &mtime))
+  {
+    this->path.qclear();
+    return false;
+  }
+  reported_size = size;
+  reported_mtime = mtime;
+
+#ifdef FWATCH_INOTIFY
+  // Watch the directory: the file may be replaced rather than rewritten
+  qstring dir = path;
+  const char *slash = strrchr(path, '/');
+  if (slash == NULL)
+  {
+    dir = ".";
+    file_name = path;
+  }
+  else
+  {
+    dir.resize(slash - path);
+    if (dir.empty())
+      dir = "/";
+    file_name = slash + 1;
+  }
+
+  fd = inotify_init();
+  if (fd != -1)
+  {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    // Not IN_CREATE: a new file is reloaded once it is written and closed
+    wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd == -1)
+    {
+      // Fall back to polling
+      close(fd);
+      fd = -1;
+    }
+  }
+#endif
+  return true;
+}
+
+//--------------------------------------------------------------------------
+void file_watch_t::stop()
+{
+#ifdef FWATCH_INOTIFY
+  if (fd != -1)
+  {
+    close(fd);
+    fd = -1;
+    wd = -1;
+  }
+#endif
+  path.qclear();
+}
+
+#ifdef FWATCH_INOTIFY
+//--------------------------------------------------------------------------
+/**
+* @brief Drain the pending events. Returns true if one is about the file
+*/
+bool file_watch_t::read_events()
+{
+  bool changed = false;
+  char buf[4096];
+  for ( ;; )
+  {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0)
+      break;
+
+    for (ssize_t off=0; off < n; )
+    {
+      const struct inotify_event *ev = (const struct inotify_event *)(buf + off);
+      if (ev->len > 0 && file_name == ev->name)
+        changed = true;
+      off += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+  return changed;
+}
+#endif
+
+//--------------------------------------------------------------------------
+bool file_watch_t::poll()
+{
+  if (!is_watching())
+    return false;
+
+#ifdef FWATCH_INOTIFY
+  if (fd != -1)
+  {
+    if (!read_events())
+      return false;
+
+    // Reported when the writer closes the file: no need to wait for it
+    stat_file(&reported_size, &reported_mtime);
+    size = reported_size;
+    mtime = reported_mtime;
+    return true;
+  }
+#endif
+
+  int64 cur_size, cur_mtime;
+  if (!stat_file(&cur_size, &cur_mtime))
+    return false;
+
+  // Still being written?
+  if (cur_size != size || cur_mtime != mtime)
+  {
+    size = cur_size;
+    mtime = cur_mtime;
+    return false;
+  }
+
+  if (size == reported_size && mtime == reported_mtime)
+    return false;
+
+  reported_size = size;
+  reported_mtime = mtime;
+  return true;
+}
+
+//--------------------------------------------------------------------------
+void file_watch_t::rearm()
+{
+  if (!is_watching())
+    return;
+
+#ifdef FWATCH_INOTIFY
+  if (fd != -1)
+    read_events();
+#endif
+
+  if (stat_file(&size, &mtime))
+  {
+    reported_size = size;
+    reported_mtime = mtime;
+  }
+}
@@ -0,0 +1,77 @@
+#ifndef __FWATCH__
+#define __FWATCH__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+File watcher module
+
+Tells when a file was rewritten. On Linux the file's directory is watched
+with inotify (so the files replaced by a rename are seen too). Elsewhere
+the file size and modification time are polled and a change is reported
+once they are stable across two polls (not while the file is written).
+
+poll() does not block: it is meant to be called from a UI timer.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+
+#if defined(__LINUX__) || defined(__linux__)
+  #define FWATCH_INOTIFY
+#endif
+
+//--------------------------------------------------------------------------
+/**
+* @brief Watches one file
+*/
+class file_watch_t
+{
+  qstring path;
+
+  // Last seen and last reported file size and modification time
+  int64 size, reported_size;
+  int64 mtime, reported_mtime;
+
+#ifdef FWATCH_INOTIFY
+  int fd;
+  int wd;
+  qstring file_name;
+
+  bool read_events();
+#endif
+
+  bool stat_file(int64 *out_size, int64 *out_mtime);
+
+public:
+  file_watch_t();
+  ~file_watch_t();
+
+  /**
+  * @brief Start watching a file (stops watching the previous one)
+  */
+  bool start(const char *path);
+
+  /**
+  * @brief Stop watching
+  */
+  void stop();
+
+  inline bool is_watching() const { return !path.empty(); }
+
+  inline const char *get_path() const { return path.c_str(); }
+
+  /**
+  * @brief Did the file change since the last poll() or rearm()?
+  */
+  bool poll();
+
+  /**
+  * @brief Forget the pending changes (the file was written by us)
+  */
+  void rearm();
+};
+
+#endif
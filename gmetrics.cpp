@@ -0,0 +1,182 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+--------------------------------------------------------------------------*/
+
+#include "gmetrics.h"
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+/**
+* @brief Count the instructions of a block within a node definition's range
+*/
+static int count_nd_insns(
+    const func_features_t &ff,
+    const bbfeat_block_t &bb,
+    pnodedef_t nd)
+{
+  // Whole block (the common case)
+  if (nd->start <= bb.start && nd->end >= bb.end)
+    return bb.ninsns;
+
+  int n = 0;
+  for (int i=bb.first_insn, e=bb.first_insn + bb.ninsns; i < e; i++)
+  {
+    ea_t ea = ff.insns[i].ea;
+    if (ea >= nd->start && ea < nd->end)
+      ++n;
+  }
+  return n;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Count the edges between the groups of the blocks
+* @param blk_grp - the group index of each block (-1 if none)
+*/
+static void count_group_edges(
+    const func_features_t &ff,
+    const intvec_t &blk_grp,
+    int ngroups,
+    intvec_t &in_degree,
+    intvec_t &out_degree,
+    intvec_t &internal_edges)
+{
+  in_degree.resize(ngroups);
+  out_degree.resize(ngroups);
+  internal_edges.resize(ngroups);
+  std::fill(in_degree.begin(), in_degree.end(), 0);
+  std::fill(out_degree.begin(), out_degree.end(), 0);
+  std::fill(internal_edges.begin(), internal_edges.end(), 0);
+
+  // Blocks ordered by group so the stamps count each pair of groups once
+  intvec_t order, start;
+  start.resize(ngroups + 1);
+  std::fill(start.begin(), start.end(), 0);
+  for (size_t b=0; b < blk_grp.size(); b++)
+  {
+    if (blk_grp[b] >= 0)
+      ++start[blk_grp[b] + 1];
+  }
+  for (int g=0; g < ngroups; g++)
+    start[g + 1] += start[g];
+
+  order.resize(start[ngroups]);
+  intvec_t pos = start;
+  for (size_t b=0; b < blk_grp.size(); b++)
+  {
+    if (blk_grp[b] >= 0)
+      order[pos[blk_grp[b]]++] = int(b);
+  }
+
+  // The stamp of a group is the last group that had an edge to it
+  intvec_t stamp;
+  stamp.resize(ngroups);
+  std::fill(stamp.begin(), stamp.end(), -1);
+  for (int g=0; g < ngroups; g++)
+  {
+    for (int k=start[g]; k < start[g + 1]; k++)
+    {
+      const intvec_t &succ = ff.blocks[order[k]].succ;
+      for (size_t i=0; i < succ.size(); i++)
+      {
+        int h = blk_grp[succ[i]];
+        if (h == g)
+        {
+          ++internal_edges[g];
+        }
+        else if (h >= 0 && stamp[h] != g)
+        {
+          stamp[h] = g;
+          ++out_degree[g];
+          ++in_degree[h];
+        }
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------
+void gm_compute_metrics(
+    groupman_t *gm,
+    const func_features_t &ff)
+{
+  gm_metrics_t &m = gm->metrics;
+  m.clear();
+
+  int nblocks = int(ff.blocks.size());
+
+  // Index the groups and map the blocks to them
+  qvector<pnodegroup_t> ngs;
+  qvector<psupergroup_t> sgs;
+  intvec_t ng_sg, blk_ng, blk_sg, ng_blocks;
+  blk_ng.resize(nblocks);
+  blk_sg.resize(nblocks);
+  std::fill(blk_ng.begin(), blk_ng.end(), -1);
+  std::fill(blk_sg.begin(), blk_sg.end(), -1);
+
+  psupergroup_listp_t sgl = gm->get_path_sgl();
+  for (supergroup_listp_t::iterator it_sg=sgl->begin(); it_sg != sgl->end(); ++it_sg)
+  {
+    psupergroup_t sg = *it_sg;
+    int isg = int(sgs.size());
+    sgs.push_back(sg);
+
+    group_metrics_t &sgm = m.sgs[sg];
+    sgm.occurrences = int(sg->gcount());
+
+    for (nodegroup_list_t::iterator it_ng=sg->groups.begin(); it_ng != sg->groups.end(); ++it_ng)
+    {
+      pnodegroup_t ng = *it_ng;
+      int ing = int(ngs.size());
+      ngs.push_back(ng);
+      ng_sg.push_back(isg);
+      ng_blocks.push_back(0);
+
+      group_metrics_t &ngm = m.ngs[ng];
+      ngm.occurrences = sgm.occurrences;
+      for (nodegroup_t::iterator it=ng->begin(); it != ng->end(); ++it)
+      {
+        pnodedef_t nd = *it;
+        ngm.nbytes += int(nd->end - nd->start);
+        if (nd->nid < 0 || nd->nid >= nblocks)
+          continue;
+
+        ngm.ninsns += count_nd_insns(ff, ff.blocks[nd->nid], nd);
+        blk_ng[nd->nid] = ing;
+        blk_sg[nd->nid] = isg;
+        ++ng_blocks[ing];
+      }
+      sgm.ninsns += ngm.ninsns;
+      sgm.nbytes += ngm.nbytes;
+    }
+  }
+
+  // Degrees and internal edges
+  intvec_t in_degree, out_degree, internal_edges;
+  count_group_edges(ff, blk_ng, int(ngs.size()), in_degree, out_degree, internal_edges);
+  for (size_t i=0; i < ngs.size(); i++)
+  {
+    group_metrics_t &ngm = m.ngs[ngs[i]];
+    ngm.in_degree = in_degree[i];
+    ngm.out_degree = out_degree[i];
+
+    // M = E - N + 2 for one connected component
+    ngm.cyclomatic = qmax(internal_edges[i] - ng_blocks[i] + 2, 1);
+
+    group_metrics_t &sgm = m.sgs[sgs[ng_sg[i]]];
+    sgm.cyclomatic = qmax(sgm.cyclomatic, ngm.cyclomatic);
+  }
+
+  count_group_edges(ff, blk_sg, int(sgs.size()), in_degree, out_degree, internal_edges);
+  for (size_t i=0; i < sgs.size(); i++)
+  {
+    group_metrics_t &sgm = m.sgs[sgs[i]];
+    sgm.in_degree = in_degree[i];
+    sgm.out_degree = out_degree[i];
+  }
+
+  m.valid = true;
+}
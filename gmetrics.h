@@ -0,0 +1,32 @@
+#ifndef __GMETRICS__
+#define __GMETRICS__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Group metrics module
+
+Computes, in one pass over the blocks and the edges of a function, the
+metrics of each NG and SG of the path SGL: instruction count, byte size,
+in/out degree to the other groups, internal cyclomatic complexity and
+occurrence count. The results are cached in the groupman (see gm_metrics_t)
+and shown by the chooser.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include "groupman.h"
+#include "bbfeat.h"
+
+//--------------------------------------------------------------------------
+/**
+* @brief Compute the metrics of the groups into gm->metrics
+*/
+void gm_compute_metrics(
+    groupman_t *gm,
+    const func_features_t &ff);
+
+#endif
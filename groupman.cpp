@@ -28,6 +28,14 @@ History
 11/06/2013 - eliasb             - added 'remove_sg', 'move_nodes_to_ng'
                                 - added 'reset_groupping'
                                 - added added nodegroup_list_t.add_nodegroup()
+10/18/2026 - eliasb             - added get_similar_sgl()
+                                - emit/parse the flowchart fingerprint section
+                                - added clone()
+                                - added the append-only save (emit_append) and the journal replay in parse()
+                                - added the groups metrics cache
+                                - added patch_from()
+                                - added update_sg_lookups()
+                                - does not include util.h (the headless analyzer builds without the IDA kernel)
 --------------------------------------------------------------------------*/
 
 #define USE_STANDARD_FILE_FUNCTIONS
@@ -37,7 +45,14 @@ History
 #include <string>
 #include <fstream>
 #include <iostream>
-#include "util.h"
+
+//--------------------------------------------------------------------------
+// Not util.h's: it needs the IDA kernel and the headless analyzer builds
+// this module with libpro only
+static char *skip_spaces(char *p)
+{
+  return skipSpaces(p);
+}
 
 //--------------------------------------------------------------------------
 static const char STR_ID[]          = "ID";
@@ -49,6 +64,23 @@ static const char STR_NODESET[]     = "NODESET";
 static const char STR_GROUP_NAME[]  = "GROUPNAME";
 static const char STR_PATHINFO[]    = "PATHINFO";
 static const char STR_SIMILARINFO[] = "SIMILARINFO";
+static const char STR_FINGERPRINT[] = "FINGERPRINT";
+static const char STR_JOURNAL[]     = "JOURNAL";
+
+//--------------------------------------------------------------------------
+/**
+* @brief Hash of an emitted SG line (64-bit FNV-1a)
+*/
+static uint64 hash_sg_line(const qstring &line)
+{
+  uint64 h = 0xCBF29CE484222325ULL;
+  for (const char *p = line.c_str(); *p != '\0'; p++)
+  {
+    h ^= uchar(*p);
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
 
 //--------------------------------------------------------------------------
 //--  NODEGROUP_LIST CLASS  ------------------------------------------------
@@ -245,6 +277,47 @@ void supergroup_t::copy_attr_from(psupergroup_t sg)
   ++ncopy;
 }
 
+//--------------------------------------------------------------------------
+//--  GROUP METRICS  -------------------------------------------------------
+//--------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------
+int group_metrics_t::get(int key) const
+{
+  switch (key)
+  {
+    case gmk_insns: return ninsns;
+    case gmk_bytes: return nbytes;
+    case gmk_in:    return in_degree;
+    case gmk_out:   return out_degree;
+    case gmk_cc:    return cyclomatic;
+    case gmk_count: return occurrences;
+    default:        return 0;
+  }
+}
+
+//--------------------------------------------------------------------------
+void gm_metrics_t::clear()
+{
+  ngs.clear();
+  sgs.clear();
+  valid = false;
+}
+
+//--------------------------------------------------------------------------
+const group_metrics_t *gm_metrics_t::get(pnodegroup_t ng) const
+{
+  std::map<pnodegroup_t, group_metrics_t>::const_iterator it = ngs.find(ng);
+  return it == ngs.end() ? NULL : &it->second;
+}
+
+//--------------------------------------------------------------------------
+const group_metrics_t *gm_metrics_t::get(psupergroup_t sg) const
+{
+  std::map<psupergroup_t, group_metrics_t>::const_iterator it = sgs.find(sg);
+  return it == sgs.end() ? NULL : &it->second;
+}
+
 //--------------------------------------------------------------------------
 //--  GROUP MANAGER CLASS  -------------------------------------------------
 //--------------------------------------------------------------------------
@@ -261,6 +334,178 @@ void groupman_t::clear()
   clear_sgl(&path_sgl);
   clear_sgl(&similar_sgl);
   all_nodes.clear();
+  metrics.clear();
+  fingerprint = 0;
+}
+
+//--------------------------------------------------------------------------
+void groupman_t::copy_sgl_from(
+    psupergroup_listp_t src_sgl,
+    psupergroup_listp_t dst_sgl)
+{
+  for (supergroup_listp_t::iterator it_sg=src_sgl->begin();
+       it_sg != src_sgl->end();
+       ++it_sg)
+  {
+    add_supergroup(dst_sgl, copy_sg(*it_sg));
+  }
+}
+
+//--------------------------------------------------------------------------
+psupergroup_t groupman_t::copy_sg(psupergroup_t src_sg)
+{
+  psupergroup_t sg = new supergroup_t();
+  sg->id = src_sg->id;
+  sg->name = src_sg->name;
+  sg->is_synthetic = src_sg->is_synthetic;
+
+  for (nodegroup_list_t::iterator it_ng=src_sg->groups.begin();
+       it_ng != src_sg->groups.end();
+       ++it_ng)
+  {
+    pnodegroup_t src_ng = *it_ng;
+    pnodegroup_t ng = sg->add_nodegroup();
+    for (nodegroup_t::iterator it_nd=src_ng->begin();
+         it_nd != src_ng->end();
+         ++it_nd)
+    {
+      pnodedef_t nd = ng->add_node();
+      *nd = **it_nd;
+      map_nodedef(nd->nid, nd);
+    }
+  }
+  return sg;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Key of an SG when patching: its id and its rank among the SGs with
+*        that id (the ids are not required to be unique)
+*/
+static void get_sg_patch_key(
+    psupergroup_t sg,
+    std::map<qstring, int> &id_counts,
+    qstring *out)
+{
+  int rank = id_counts[sg->id]++;
+  out->sprnt("%s#%d", sg->id.c_str(), rank);
+}
+
+//--------------------------------------------------------------------------
+int groupman_t::patch_sgl(
+    psupergroup_listp_t sgl,
+    psupergroup_listp_t src_sgl,
+    qstrvec_t *changed_ids)
+{
+  // Index the new SGs
+  typedef std::map<qstring, psupergroup_t> key2sg_t;
+  key2sg_t src_sgs;
+  std::map<qstring, int> id_counts;
+  qstring key;
+  for (supergroup_listp_t::iterator it=src_sgl->begin();
+       it != src_sgl->end();
+       ++it)
+  {
+    get_sg_patch_key(*it, id_counts, &key);
+    src_sgs[key] = *it;
+  }
+
+  // Replace or remove the SGs in place
+  int count = 0;
+  qstring line, src_line;
+  id_counts.clear();
+  for (supergroup_listp_t::iterator it=sgl->begin(); it != sgl->end(); )
+  {
+    psupergroup_t sg = *it;
+    get_sg_patch_key(sg, id_counts, &key);
+    key2sg_t::iterator it_src = src_sgs.find(key);
+    if (it_src != src_sgs.end())
+    {
+      psupergroup_t src_sg = it_src->second;
+      src_sgs.erase(it_src);
+
+      format_sg(sg, &line);
+      format_sg(src_sg, &src_line);
+      if (line == src_line && sg->is_synthetic == src_sg->is_synthetic)
+      {
+        ++it;
+        continue;
+      }
+
+      sgl->insert(it, copy_sg(src_sg));
+      if (changed_ids != NULL)
+        changed_ids->push_back(src_sg->id);
+    }
+
+    it = sgl->erase(it);
+    sg->clear();
+    delete sg;
+    ++count;
+  }
+
+  // Append the new SGs in the file order
+  std::set<psupergroup_t> new_sgs;
+  for (key2sg_t::iterator it=src_sgs.begin(); it != src_sgs.end(); ++it)
+    new_sgs.insert(it->second);
+
+  for (supergroup_listp_t::iterator it=src_sgl->begin();
+       it != src_sgl->end();
+       ++it)
+  {
+    psupergroup_t src_sg = *it;
+    if (new_sgs.find(src_sg) == new_sgs.end())
+      continue;
+
+    add_supergroup(sgl, copy_sg(src_sg));
+    if (changed_ids != NULL)
+      changed_ids->push_back(src_sg->id);
+    ++count;
+  }
+  return count;
+}
+
+//--------------------------------------------------------------------------
+int groupman_t::patch_from(
+    groupman_t *src,
+    qstrvec_t *changed_ids)
+{
+  int count = patch_sgl(&path_sgl, &src->path_sgl, changed_ids)
+            + patch_sgl(&similar_sgl, &src->similar_sgl, NULL);
+
+  fingerprint = src->fingerprint;
+  if (count > 0)
+  {
+    metrics.clear();
+    rebuild_nds();
+    initialize_lookups();
+  }
+  return count;
+}
+
+//--------------------------------------------------------------------------
+groupman_t *groupman_t::clone()
+{
+  groupman_t *gm = new groupman_t();
+  gm->copy_sgl_from(&path_sgl, &gm->path_sgl);
+  gm->copy_sgl_from(&similar_sgl, &gm->similar_sgl);
+  gm->src_filename = src_filename;
+  gm->fingerprint = fingerprint;
+  gm->filestate = filestate;
+  gm->journal_limit = journal_limit;
+  gm->initialize_lookups();
+  return gm;
+}
+
+//--------------------------------------------------------------------------
+bool groupman_t::matches_flowchart(uint64 fp, int nblocks)
+{
+  if (fingerprint == 0 || fingerprint != fp)
+    return false;
+
+  // Every node id in [0, nblocks) must be defined. The map keys are unique
+  // so checking the count and the bounds is enough
+  return    int(all_nodes.size()) == nblocks
+         && (nblocks == 0 || (all_nodes.begin()->first == 0 && all_nodes.rbegin()->first == nblocks - 1));
 }
 
 //--------------------------------------------------------------------------
@@ -411,6 +656,24 @@ void groupman_t::initialize_lookups()
   }
 }
 
+//--------------------------------------------------------------------------
+void groupman_t::update_sg_lookups(psupergroup_t sg)
+{
+  for (nodegroup_list_t::iterator it=sg->groups.begin();
+       it != sg->groups.end();
+       ++it)
+  {
+    pnodegroup_t ng = *it;
+    for (nodegroup_t::iterator it=ng->begin();
+         it != ng->end();
+         ++it)
+    {
+      nodedef_t *nd = *it;
+      nid2loc[nd->nid] = nodeloc_t(sg, ng, nd);
+    }
+  }
+}
+
 //--------------------------------------------------------------------------
 psupergroup_t groupman_t::add_supergroup(
     psupergroup_listp_t sgl,
@@ -541,56 +804,98 @@ pnodegroup_t groupman_t::move_nodes_to_ng(pnodegroup_t ng)
 }
 
 //--------------------------------------------------------------------------
-void groupman_t::emit_sgl(
-    FILE *fp,
-    psupergroup_listp_t sgl)
+void groupman_t::format_sg(
+    psupergroup_t sg,
+    qstring *out)
 {
-  for (supergroup_listp_t::iterator it=sgl->begin();
-       it != sgl->end();
-       ++it)
-  {
-    psupergroup_t sg = *it;
+  out->qclear();
 
-    // Write ID
-    if (!sg->id.empty())
-      qfprintf(fp, "%s:%s;", STR_ID, sg->id.c_str());
+  // Write ID
+  if (!sg->id.empty())
+    out->cat_sprnt("%s:%s;", STR_ID, sg->id.c_str());
 
-    // Write Name
-    if (!sg->name.empty())
-      qfprintf(fp, "%s:%s;", STR_GROUP_NAME, sg->name.c_str());
+  // Write Name
+  if (!sg->name.empty())
+    out->cat_sprnt("%s:%s;", STR_GROUP_NAME, sg->name.c_str());
 
-    size_t group_count = sg->groups.size();
-    if (group_count > 0)
+  size_t group_count = sg->groups.size();
+  if (group_count > 0)
+  {
+    out->cat_sprnt("%s:", STR_NODESET);
+    nodegroup_list_t &ngl = sg->groups;
+    for (nodegroup_list_t::iterator it = ngl.begin(); 
+         it != ngl.end(); 
+         ++it)
     {
-      qfprintf(fp, "%s:", STR_NODESET);
-      nodegroup_list_t &ngl = sg->groups;
-      for (nodegroup_list_t::iterator it = ngl.begin(); 
-           it != ngl.end(); 
-           ++it)
-      {
-        pnodegroup_t ng = *it;
+      pnodegroup_t ng = *it;
 
-        qfprintf(fp, "(");
+      out->append("(");
 
-        size_t c = ng->size();
-        for (nodegroup_t::iterator it = ng->begin();
-             it != ng->end();
-             ++it)
-        {
-          nodedef_t *nd = *it;
-          qfprintf(fp, "%d : %a : %a", nd->nid, nd->start, nd->end);
-          if (--c != 0)
-            qfprintf(fp, ", ");
-        }
-        qfprintf(fp, ")");
-        if (--group_count != 0)
-          qfprintf(fp, ", ");
+      size_t c = ng->size();
+      for (nodegroup_t::iterator it = ng->begin();
+           it != ng->end();
+           ++it)
+      {
+        nodedef_t *nd = *it;
+        out->cat_sprnt("%d : %a : %a", nd->nid, nd->start, nd->end);
+        if (--c != 0)
+          out->append(", ");
       }
+      out->append(")");
+      if (--group_count != 0)
+        out->append(", ");
     }
-    qfprintf(fp, "\n");
   }
 }
 
+//--------------------------------------------------------------------------
+void groupman_t::emit_sgl(
+    FILE *fp,
+    psupergroup_listp_t sgl,
+    sghash_count_map_t *hashes)
+{
+  qstring line;
+  for (supergroup_listp_t::iterator it=sgl->begin();
+       it != sgl->end();
+       ++it)
+  {
+    format_sg(*it, &line);
+    qfprintf(fp, "%s\n", line.c_str());
+
+    if (hashes != NULL)
+      ++(*hashes)[hash_sg_line(line)];
+  }
+}
+
+//--------------------------------------------------------------------------
+void groupman_t::hash_sgl(
+    psupergroup_listp_t sgl,
+    sghash_count_map_t &out)
+{
+  out.clear();
+  qstring line;
+  for (supergroup_listp_t::iterator it=sgl->begin();
+       it != sgl->end();
+       ++it)
+  {
+    format_sg(*it, &line);
+    ++out[hash_sg_line(line)];
+  }
+}
+
+//--------------------------------------------------------------------------
+void groupman_t::set_filestate(
+    const char *filename,
+    int64 size)
+{
+  filestate.filename = filename;
+  filestate.size = size;
+  filestate.fingerprint = fingerprint;
+  filestate.journal_records = 0;
+  hash_sgl(&path_sgl, filestate.path_sgs);
+  hash_sgl(&similar_sgl, filestate.similar_sgs);
+}
+
 //--------------------------------------------------------------------------
 bool groupman_t::emit(
         const char *filename, 
@@ -600,21 +905,153 @@ bool groupman_t::emit(
   if (fp == NULL)
     return false;
 
+  gm_filestate_t fs;
+
   qfprintf(fp, "--%s\n", STR_PATHINFO);
-  emit_sgl(fp, &path_sgl);
+  emit_sgl(fp, &path_sgl, &fs.path_sgs);
 
   qfprintf(fp, "--%s\n", STR_SIMILARINFO);
-  emit_sgl(fp, &similar_sgl);
+  emit_sgl(fp, &similar_sgl, &fs.similar_sgs);
+
+  if (fingerprint != 0)
+    qfprintf(fp, "--%s\n%016" FMT_64 "X\n", STR_FINGERPRINT, fingerprint);
 
   // Emit additional sections
   if (additional_sections != NULL)
     qfprintf(fp, "%s\n", additional_sections);
 
+  // Remember what the file holds for the next append-only save
+  fs.filename = filename;
+  fs.size = qftell(fp);
+  fs.fingerprint = fingerprint;
+  filestate = fs;
+
   qfclose(fp);
 
   return true;
 }
 
+//--------------------------------------------------------------------------
+int groupman_t::diff_sgl(
+    char kind,
+    psupergroup_listp_t sgl,
+    const sghash_count_map_t &old_sgs,
+    sghash_count_map_t &new_sgs,
+    qstring &records)
+{
+  // Hash the current SGs and keep one line per hash for the additions
+  std::map<uint64, qstring> lines;
+  qstring line;
+  new_sgs.clear();
+  for (supergroup_listp_t::iterator it=sgl->begin();
+       it != sgl->end();
+       ++it)
+  {
+    format_sg(*it, &line);
+    uint64 h = hash_sg_line(line);
+    if (++new_sgs[h] == 1)
+      lines[h] = line;
+  }
+
+  int nrecords = 0;
+
+  // Removed SGs are referred to by their hash
+  for (sghash_count_map_t::const_iterator it=old_sgs.begin();
+       it != old_sgs.end();
+       ++it)
+  {
+    sghash_count_map_t::const_iterator it_new = new_sgs.find(it->first);
+    for (int n = it->second - (it_new == new_sgs.end() ? 0 : it_new->second); n > 0; n--, nrecords++)
+      records.cat_sprnt("-%c:%016" FMT_64 "X\n", kind, it->first);
+  }
+
+  // Added SGs are written in full
+  for (sghash_count_map_t::const_iterator it=new_sgs.begin();
+       it != new_sgs.end();
+       ++it)
+  {
+    sghash_count_map_t::const_iterator it_old = old_sgs.find(it->first);
+    for (int n = it->second - (it_old == old_sgs.end() ? 0 : it_old->second); n > 0; n--, nrecords++)
+    {
+      records.cat_sprnt("+%c:", kind);
+      records.append(lines[it->first]);
+      records.append("\n");
+    }
+  }
+  return nrecords;
+}
+
+//--------------------------------------------------------------------------
+bool groupman_t::emit_append(
+    const char *filename,
+    bool *compacted)
+{
+  if (compacted != NULL)
+    *compacted = false;
+
+  // Append only to the file we know of and while the journal is small enough
+  FILE *fp = NULL;
+  if (   filestate.journal_records < journal_limit
+      && qstrcmp(filestate.filename.c_str(), filename) == 0)
+  {
+    fp = qfopen(filename, "a");
+    if (fp != NULL)
+    {
+      qfseek(fp, 0, SEEK_END);
+      if (qftell(fp) != filestate.size)
+      {
+        qfclose(fp);
+        fp = NULL;
+      }
+    }
+  }
+
+  // Rewrite (compact) the file
+  if (fp == NULL)
+  {
+    if (compacted != NULL)
+      *compacted = true;
+    return emit(filename);
+  }
+
+  qstring records;
+  gm_filestate_t fs = filestate;
+  int nrecords = diff_sgl('P', &path_sgl, filestate.path_sgs, fs.path_sgs, records)
+               + diff_sgl('S', &similar_sgl, filestate.similar_sgs, fs.similar_sgs, records);
+
+  if (fingerprint != filestate.fingerprint)
+  {
+    records.cat_sprnt("F:%016" FMT_64 "X\n", fingerprint);
+    fs.fingerprint = fingerprint;
+    ++nrecords;
+  }
+
+  bool ok = true;
+  if (nrecords > 0)
+  {
+    // Open the journal section once
+    if (filestate.journal_records == 0)
+      qfprintf(fp, "--%s\n", STR_JOURNAL);
+
+    ok = qfwrite(fp, records.c_str(), records.length()) == ssize_t(records.length());
+  }
+
+  if (ok)
+  {
+    fs.size = qftell(fp);
+    fs.journal_records += nrecords;
+    filestate = fs;
+  }
+  else
+  {
+    // Unknown file contents: force a rewrite next time
+    filestate.size = -1;
+  }
+  qfclose(fp);
+
+  return ok;
+}
+
 //--------------------------------------------------------------------------
 bool groupman_t::parse_line(
     psupergroup_t sg,
@@ -652,6 +1089,94 @@ bool groupman_t::parse_line(
   return true;
 }
 
+//--------------------------------------------------------------------------
+void groupman_t::replay_journal_record(
+    char *rec,
+    std::multimap<uint64, psupergroup_t> &path_idx,
+    std::multimap<uint64, psupergroup_t> &similar_idx)
+{
+  // Fingerprint update
+  if (rec[0] == 'F' && rec[1] == ':')
+  {
+    uint64 v;
+    if (qsscanf(rec + 2, "%" FMT_64 "X", &v) == 1)
+      fingerprint = v;
+    return;
+  }
+
+  if ((rec[0] != '-' && rec[0] != '+') || rec[1] == '\0' || rec[2] != ':')
+    return;
+
+  psupergroup_listp_t sgl;
+  std::multimap<uint64, psupergroup_t> *idx;
+  if (rec[1] == 'P')
+  {
+    sgl = &path_sgl;
+    idx = &path_idx;
+  }
+  else if (rec[1] == 'S')
+  {
+    sgl = &similar_sgl;
+    idx = &similar_idx;
+  }
+  else
+  {
+    return;
+  }
+
+  if (rec[0] == '-')
+  {
+    // Remove one SG with that hash
+    uint64 h;
+    if (qsscanf(rec + 3, "%" FMT_64 "X", &h) != 1)
+      return;
+
+    std::multimap<uint64, psupergroup_t>::iterator it = idx->find(h);
+    if (it == idx->end())
+      return;
+
+    sgl->remove_sg(it->second, true);
+    idx->erase(it);
+  }
+  else
+  {
+    // Add a new SG
+    psupergroup_t sg = add_supergroup(sgl);
+    parse_line(sg, rec + 3);
+
+    qstring line;
+    format_sg(sg, &line);
+    idx->insert(std::make_pair(hash_sg_line(line), sg));
+  }
+}
+
+//--------------------------------------------------------------------------
+void groupman_t::rebuild_nds()
+{
+  all_nodes.clear();
+  psupergroup_listp_t sgls[] = { &path_sgl, &similar_sgl };
+  for (size_t i=0; i < qnumber(sgls); i++)
+  {
+    for (supergroup_listp_t::iterator it_sg=sgls[i]->begin();
+         it_sg != sgls[i]->end();
+         ++it_sg)
+    {
+      nodegroup_list_t &ngl = (*it_sg)->groups;
+      for (nodegroup_list_t::iterator it_ng=ngl.begin();
+           it_ng != ngl.end();
+           ++it_ng)
+      {
+        for (nodegroup_t::iterator it_nd=(*it_ng)->begin();
+             it_nd != (*it_ng)->end();
+             ++it_nd)
+        {
+          map_nodedef((*it_nd)->nid, *it_nd);
+        }
+      }
+    }
+  }
+}
+
 //--------------------------------------------------------------------------
 bool groupman_t::parse(
     const char *filename, 
@@ -664,6 +1189,10 @@ bool groupman_t::parse(
   // Remember the opened file name
   this->src_filename = filename;
 
+  in_file.seekg(0, std::ios::end);
+  int64 file_size = int64(in_file.tellg());
+  in_file.seekg(0, std::ios::beg);
+
   // Clear previous items
   clear();
 
@@ -671,6 +1200,12 @@ bool groupman_t::parse(
 
   //TODO: generate dummy group names ; int group_dummy_name;
   psupergroup_listp_t cur_sgl = &path_sgl;
+  bool in_fingerprint = false;
+
+  // Journal replay state: the SGs indexed by the hash of their line
+  bool in_journal = false, has_journal = false;
+  int journal_records = 0;
+  std::multimap<uint64, psupergroup_t> path_idx, similar_idx;
 
   while (in_file.good())
   {
@@ -686,6 +1221,25 @@ bool groupman_t::parse(
     if (s[0] == '-' && s[1] == '-' && s[2] != '\0')
     {
       s += 2;
+      in_fingerprint = qstrcmp(s, STR_FINGERPRINT) == 0;
+      in_journal = qstrcmp(s, STR_JOURNAL) == 0;
+
+      // Index the SGs once, when the first journal section starts
+      if (in_journal && !has_journal)
+      {
+        has_journal = true;
+        qstring sg_line;
+        for (supergroup_listp_t::iterator it=path_sgl.begin(); it != path_sgl.end(); ++it)
+        {
+          format_sg(*it, &sg_line);
+          path_idx.insert(std::make_pair(hash_sg_line(sg_line), *it));
+        }
+        for (supergroup_listp_t::iterator it=similar_sgl.begin(); it != similar_sgl.end(); ++it)
+        {
+          format_sg(*it, &sg_line);
+          similar_idx.insert(std::make_pair(hash_sg_line(sg_line), *it));
+        }
+      }
       if (qstrcmp(s, STR_PATHINFO) == 0)
         cur_sgl = &path_sgl;
       else if (qstrcmp(s, STR_SIMILARINFO) == 0)
@@ -697,6 +1251,23 @@ bool groupman_t::parse(
       continue;
     }
 
+    if (in_fingerprint)
+    {
+      uint64 v;
+      if (qsscanf(s, "%" FMT_64 "X", &v) == 1)
+        fingerprint = v;
+      continue;
+    }
+
+    if (in_journal)
+    {
+      s = qstrdup(s);
+      replay_journal_record(s, path_idx, similar_idx);
+      qfree(s);
+      ++journal_records;
+      continue;
+    }
+
     // Skip lines when no known SGL section is being parsed
     if (cur_sgl == NULL)
       continue;
@@ -714,6 +1285,14 @@ bool groupman_t::parse(
   }
   in_file.close();
 
+  // The replayed removals freed some node definitions
+  if (has_journal)
+    rebuild_nds();
+
+  // Remember what the file holds for the next append-only save
+  set_filestate(filename, file_size);
+  filestate.journal_records = journal_records;
+
   // Initialize cache
   if (init_cache)
     initialize_lookups();
@@ -216,6 +216,159 @@ struct nodeloc_t
   }
 };
 
+//--------------------------------------------------------------------------
+/**
+* @brief Incremental flowchart fingerprint (64-bit FNV-1a) over the block
+*        ranges and the edges. Feed the blocks in node id order.
+*/
+class fc_fingerprint_t
+{
+  uint64 h;
+
+  inline void add(uint64 v)
+  {
+    for (int i=0; i < 8; i++, v >>= 8)
+    {
+      h ^= (v & 0xFF);
+      h *= 0x100000001B3ULL;
+    }
+  }
+
+public:
+  fc_fingerprint_t(int nblocks): h(0xCBF29CE484222325ULL)
+  {
+    add(nblocks);
+  }
+
+  inline void add_block(ea_t start, ea_t end, int nsucc)
+  {
+    add(start);
+    add(end);
+    add(nsucc);
+  }
+
+  inline void add_succ(int nid)
+  {
+    add(nid);
+  }
+
+  /**
+  * @brief Return the fingerprint. Zero is reserved for "no fingerprint"
+  */
+  inline uint64 value() const
+  {
+    return h == 0 ? 1 : h;
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Maps the hash of an SG's emitted line to the count of such SGs
+*/
+typedef std::map<uint64, int> sghash_count_map_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief What was last written to (or read from) the bbgroup file
+*        The append-only save diffs the groups against it
+*/
+struct gm_filestate_t
+{
+  qstring filename;
+
+  // File size at that time. Any other size means the file changed behind our back
+  int64 size;
+
+  uint64 fingerprint;
+
+  sghash_count_map_t path_sgs;
+  sghash_count_map_t similar_sgs;
+
+  // Count of records appended since the file was last rewritten
+  int journal_records;
+
+  gm_filestate_t(): size(-1), fingerprint(0), journal_records(0)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Group metrics keys
+*/
+enum gmetric_key_e
+{
+  gmk_insns    = 0,
+  gmk_bytes    = 1,
+  gmk_in       = 2,
+  gmk_out      = 3,
+  gmk_cc       = 4,
+  gmk_count    = 5,
+  gmk_nkeys
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Metrics of an NG or of an SG (see gm_compute_metrics())
+*/
+struct group_metrics_t
+{
+  /**
+  * @brief Instruction count and byte size. Totals of the NGs for an SG
+  */
+  int ninsns;
+  int nbytes;
+
+  /**
+  * @brief Count of the other groups (NGs or SGs) with edges into or out of the group
+  */
+  int in_degree;
+  int out_degree;
+
+  /**
+  * @brief Cyclomatic complexity of the internal edges. The largest NG one for an SG
+  */
+  int cyclomatic;
+
+  /**
+  * @brief Occurrences of the group: the NG count of the (containing) SG
+  */
+  int occurrences;
+
+  group_metrics_t(): ninsns(0), nbytes(0), in_degree(0), out_degree(0),
+    cyclomatic(0), occurrences(0)
+  {
+  }
+
+  /**
+  * @brief Return a metric by key
+  */
+  int get(int key) const;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Cached metrics of the path SGL groups
+*/
+struct gm_metrics_t
+{
+  bool valid;
+  std::map<pnodegroup_t, group_metrics_t> ngs;
+  std::map<psupergroup_t, group_metrics_t> sgs;
+
+  gm_metrics_t(): valid(false)
+  {
+  }
+
+  void clear();
+
+  /**
+  * @brief Return the metrics of a group or NULL
+  */
+  const group_metrics_t *get(pnodegroup_t ng) const;
+  const group_metrics_t *get(psupergroup_t sg) const;
+};
+
 //--------------------------------------------------------------------------
 /**
 * @brief Group management class
@@ -268,6 +421,66 @@ private:
   */
   void clear_sgl(psupergroup_listp_t sgl);
 
+  /**
+  * @brief Rebuild the node definitions lookup from both SGLs
+  */
+  void rebuild_nds();
+
+  /**
+  * @brief Format an SG the way it is emitted (without the new line)
+  */
+  void format_sg(psupergroup_t sg, qstring *out);
+
+  /**
+  * @brief Hash the emitted lines of an SGL
+  */
+  void hash_sgl(psupergroup_listp_t sgl, sghash_count_map_t &out);
+
+  /**
+  * @brief Replay one journal record
+  */
+  void replay_journal_record(
+      char *rec,
+      std::multimap<uint64, psupergroup_t> &path_idx,
+      std::multimap<uint64, psupergroup_t> &similar_idx);
+
+  /**
+  * @brief Diff an SGL against the SGs hashes of the file and format the
+  *        journal records that bring the file up to date
+  * @return The count of records
+  */
+  int diff_sgl(
+      char kind,
+      psupergroup_listp_t sgl,
+      const sghash_count_map_t &old_sgs,
+      sghash_count_map_t &new_sgs,
+      qstring &records);
+
+  /**
+  * @brief Remember the file state after a parse or an emit
+  */
+  void set_filestate(const char *filename, int64 size);
+
+  /**
+  * @brief Return a deep copy of a super group (not added to a list)
+  */
+  psupergroup_t copy_sg(psupergroup_t src_sg);
+
+  /**
+  * @brief Append deep copies of the super groups of another list
+  */
+  void copy_sgl_from(
+      psupergroup_listp_t src_sgl,
+      psupergroup_listp_t dst_sgl);
+
+  /**
+  * @brief Patch an SGL with the SGs of another one (see patch_from())
+  */
+  int patch_sgl(
+      psupergroup_listp_t sgl,
+      psupergroup_listp_t src_sgl,
+      qstrvec_t *changed_ids);
+
 public:
 
   /**
@@ -275,16 +488,54 @@ public:
   */
   qstring src_filename;
 
+  /**
+  * @brief Fingerprint of the flowchart the groups were built for (see fc_fingerprint_t)
+  *        Zero when unknown. It is emitted and parsed with the groups
+  */
+  uint64 fingerprint;
+
+  /**
+  * @brief State of the file last loaded or saved (see emit_append())
+  */
+  gm_filestate_t filestate;
+
+  /**
+  * @brief Rewrite the file in emit_append() once that many journal records were appended
+  */
+  int journal_limit;
+
+  /**
+  * @brief Metrics of the groups, computed by gm_compute_metrics()
+  */
+  gm_metrics_t metrics;
+
+  /**
+  * @brief Is this groupman complete for a flowchart of 'nblocks' nodes
+  *        with the given fingerprint? If so, it does not need sanitization
+  */
+  bool matches_flowchart(uint64 fp, int nblocks);
+
   /**
   * @brief Method to initialize lookups
   */
   void initialize_lookups();
 
+  /**
+  * @brief Update the lookups of the nodes of one super group only (after
+  *        its nodes were moved into it)
+  */
+  void update_sg_lookups(psupergroup_t sg);
+
   /**
   * @brief Return the path super groups
   */
   inline psupergroup_listp_t get_path_sgl() { return &path_sgl; }
 
+  /**
+  * @brief Return the similar nodes super groups
+  */
+  inline psupergroup_listp_t get_similar_sgl() { return &similar_sgl; }
+
   /**
   * @brief All the node defs
   */
@@ -296,7 +547,7 @@ public:
   /**
   * @ctor Default constructor
   */
-  groupman_t() { }
+  groupman_t(): fingerprint(0), journal_limit(256) { }
 
   /**
   * @dtor Destructor
@@ -308,6 +559,12 @@ public:
   */
   void clear();
 
+  /**
+  * @brief Return a deep copy of this groupman. The copy can be used from
+  *        another thread (to save it for example) while this one is edited
+  */
+  groupman_t *clone();
+
   /**
   * @brief Remember the node definition
   */
@@ -338,6 +595,29 @@ public:
     const char *filename, 
     const char *additional_sections = NULL);
 
+  /**
+  * @brief Append-only save: append to the file the SGs that changed since
+  *        it was last loaded or saved, as journal records. Falls back to
+  *        emit() (and thus compacts the file) when the file is not the one
+  *        we know or when the journal grew past 'journal_limit'
+  * @param compacted - optional: set to true if the file was rewritten
+  */
+  bool emit_append(
+    const char *filename,
+    bool *compacted = NULL);
+
+  /**
+  * @brief Patch the super groups that differ from the ones of another groupman.
+  *        The SGs are matched by id: the changed SGs are replaced in place, the
+  *        new ones are appended and the missing ones are removed. The other SGs
+  *        are left untouched
+  * @param changed_ids - optional: receives the ids of the replaced and added SGs
+  * @return The count of SGs replaced, added or removed
+  */
+  int patch_from(
+    groupman_t *src,
+    qstrvec_t *changed_ids = NULL);
+
   /**
   * @brief Parse groups definition file
   */
@@ -384,6 +664,7 @@ public:
 
   void emit_sgl(
     FILE *fp,
-    supergroup_listp_t* path_sgl);
+    supergroup_listp_t* path_sgl,
+    sghash_count_map_t *hashes = NULL);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,628 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - fix: document the batch-then-query cost of the numbering
+--------------------------------------------------------------------------*/
+
+#include "grouptree.h"
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+/**
+* @brief Whether a node of the given kind may be a child of the parent kind
+*/
+static bool can_hold(gtnode_kind_e parent, gtnode_kind_e child)
+{
+  switch (parent)
+  {
+    case gtk_root:
+      return child == gtk_group;
+    case gtk_group:
+      return child == gtk_group || child == gtk_ng;
+    case gtk_ng:
+      return child == gtk_block;
+    default:
+      return false;
+  }
+}
+
+//--------------------------------------------------------------------------
+group_tree_t::group_tree_t()
+{
+  clear();
+}
+
+//--------------------------------------------------------------------------
+void group_tree_t::clear()
+{
+  nodes.qclear();
+  free_nodes.qclear();
+  nid2node.clear();
+
+  gtnode_t &r = nodes.push_back();
+  r.kind = gtk_root;
+  dirty = true;
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::alloc_node(gtnode_kind_e kind, int parent)
+{
+  if (!is_valid(parent) || !can_hold(nodes[parent].kind, kind))
+    return -1;
+
+  int n;
+  if (free_nodes.empty())
+  {
+    n = int(nodes.size());
+    nodes.push_back();
+  }
+  else
+  {
+    n = free_nodes.back();
+    free_nodes.pop_back();
+    nodes[n] = gtnode_t();
+  }
+  nodes[n].kind = kind;
+  link(n, parent);
+  return n;
+}
+
+//--------------------------------------------------------------------------
+void group_tree_t::free_node(int n)
+{
+  unlink(n);
+  nodes[n] = gtnode_t();
+  free_nodes.push_back(n);
+}
+
+//--------------------------------------------------------------------------
+void group_tree_t::link(int n, int parent)
+{
+  nodes[n].parent = parent;
+  nodes[parent].children.push_back(n);
+  dirty = true;
+}
+
+//--------------------------------------------------------------------------
+void group_tree_t::unlink(int n)
+{
+  int parent = nodes[n].parent;
+  if (parent == -1)
+    return;
+
+  intvec_t &ch = nodes[parent].children;
+  ch.erase(std::find(ch.begin(), ch.end(), n));
+  nodes[n].parent = -1;
+  dirty = true;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Number the nodes in preorder and count the blocks of each subtree
+*/
+void group_tree_t::renumber()
+{
+  // Iterative walk: (node, next child)
+  qvector<std::pair<int, size_t> > stack;
+  int counter = 0;
+
+  nodes[0].tin = counter++;
+  nodes[0].nblocks = 0;
+  stack.push_back(std::make_pair(0, size_t(0)));
+  while (!stack.empty())
+  {
+    std::pair<int, size_t> &top = stack.back();
+    gtnode_t &nd = nodes[top.first];
+    if (top.second < nd.children.size())
+    {
+      int c = nd.children[top.second++];
+      gtnode_t &cn = nodes[c];
+      cn.tin = counter++;
+      cn.nblocks = cn.kind == gtk_block ? 1 : 0;
+      stack.push_back(std::make_pair(c, size_t(0)));
+      continue;
+    }
+
+    // Subtree done
+    nd.tout = counter - 1;
+    if (nd.parent != -1)
+      nodes[nd.parent].nblocks += nd.nblocks;
+    stack.pop_back();
+  }
+  dirty = false;
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::get_block_count(int n)
+{
+  refresh();
+  return nodes[n].nblocks;
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::get_level(int n) const
+{
+  int level = 0;
+  for (; n != -1; n = nodes[n].parent)
+  {
+    if (nodes[n].kind == gtk_group)
+      ++level;
+  }
+  return level;
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::add_group(int parent, const char *id, const char *name)
+{
+  int n = alloc_node(gtk_group, parent);
+  if (n != -1)
+  {
+    nodes[n].id = id;
+    if (name != NULL)
+      nodes[n].name = name;
+  }
+  return n;
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::add_ng(int parent)
+{
+  return alloc_node(gtk_ng, parent);
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::add_block(int parent, int nid, ea_t start, ea_t end)
+{
+  if (find_block(nid) != -1)
+    return -1;
+
+  int n = alloc_node(gtk_block, parent);
+  if (n != -1)
+  {
+    gtnode_t &nd = nodes[n];
+    nd.nid = nid;
+    nd.start = start;
+    nd.end = end;
+    nid2node[nid] = n;
+  }
+  return n;
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::find_block(int nid) const
+{
+  std::map<int, int>::const_iterator it = nid2node.find(nid);
+  return it == nid2node.end() ? -1 : it->second;
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::find_sg(psupergroup_t sg) const
+{
+  for (size_t n=0; n < nodes.size(); n++)
+  {
+    if (nodes[n].kind == gtk_group && nodes[n].sg == sg)
+      return int(n);
+  }
+  return -1;
+}
+
+//--------------------------------------------------------------------------
+bool group_tree_t::is_ancestor(int a, int b)
+{
+  refresh();
+  return nodes[a].tin <= nodes[b].tin && nodes[b].tin <= nodes[a].tout;
+}
+
+//--------------------------------------------------------------------------
+bool group_tree_t::contains(int n, int nid)
+{
+  int b = find_block(nid);
+  return b != -1 && is_ancestor(n, b);
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::lca(int a, int b)
+{
+  while (a != -1 && !is_ancestor(a, b))
+    a = nodes[a].parent;
+  return a;
+}
+
+//--------------------------------------------------------------------------
+bool group_tree_t::move(int n, int new_parent)
+{
+  if (   !is_valid(n)
+      || !is_valid(new_parent)
+      || !can_hold(nodes[new_parent].kind, nodes[n].kind))
+  {
+    return false;
+  }
+
+  if (nodes[n].parent == new_parent)
+    return true;
+
+  // The new parent must not be in the subtree. Walk up rather than use the
+  // numbering: it may be stale during a batch of moves
+  for (int p = new_parent; p != -1; p = nodes[p].parent)
+  {
+    if (p == n)
+      return false;
+  }
+
+  unlink(n);
+  link(n, new_parent);
+  return true;
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::nest(
+    const intvec_t &group_nodes,
+    const char *id,
+    const char *name)
+{
+  for (size_t i=0; i < group_nodes.size(); i++)
+  {
+    int n = group_nodes[i];
+    if (!is_valid(n) || !can_hold(gtk_group, nodes[n].kind))
+      return -1;
+  }
+
+  // Keep the topmost nodes only
+  intvec_t top;
+  for (size_t i=0; i < group_nodes.size(); i++)
+  {
+    int n = group_nodes[i];
+    bool inner = false;
+    for (size_t j=0; j < group_nodes.size() && !inner; j++)
+    {
+      int m = group_nodes[j];
+      inner = m != n && is_ancestor(m, n);
+    }
+    if (!inner && !top.has(n))
+      top.push_back(n);
+  }
+
+  if (top.empty())
+    return -1;
+
+  // The container is the lowest common group that is not one of the nodes
+  int p = top[0];
+  for (size_t i=1; i < top.size(); i++)
+    p = lca(p, top[i]);
+  while (nodes[p].kind != gtk_root && (nodes[p].kind != gtk_group || top.has(p)))
+    p = nodes[p].parent;
+
+  int g = add_group(p, id, name);
+  if (g == -1)
+    return -1;
+
+  for (size_t i=0; i < top.size(); i++)
+    move(top[i], g);
+
+  return g;
+}
+
+//--------------------------------------------------------------------------
+bool group_tree_t::ungroup(int n)
+{
+  if (!is_valid(n) || nodes[n].kind != gtk_group)
+    return false;
+
+  int parent = nodes[n].parent;
+  intvec_t ch = nodes[n].children;
+  for (size_t i=0; i < ch.size(); i++)
+  {
+    if (!can_hold(nodes[parent].kind, nodes[ch[i]].kind))
+      return false;
+  }
+
+  for (size_t i=0; i < ch.size(); i++)
+    move(ch[i], parent);
+
+  free_node(n);
+  return true;
+}
+
+//--------------------------------------------------------------------------
+void group_tree_t::get_path(int n, qstring *out) const
+{
+  out->qclear();
+  for (; n != -1 && nodes[n].kind == gtk_group; n = nodes[n].parent)
+  {
+    if (out->empty())
+    {
+      *out = nodes[n].id;
+    }
+    else
+    {
+      qstring s = nodes[n].id;
+      s.append(GROUPTREE_SEP);
+      s.append(*out);
+      out->swap(s);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------
+void group_tree_t::get_level_cut(int level, intvec_t &out)
+{
+  refresh();
+  out.qclear();
+
+  // (node, level)
+  qvector<std::pair<int, int> > stack;
+  stack.push_back(std::make_pair(0, 0));
+  while (!stack.empty())
+  {
+    int n = stack.back().first;
+    int lvl = stack.back().second;
+    stack.pop_back();
+
+    const gtnode_t &nd = nodes[n];
+    if (nd.nblocks == 0)
+      continue;
+
+    if (nd.kind == gtk_group)
+      ++lvl;
+
+    if (nd.kind == gtk_ng || nd.kind == gtk_block || lvl >= level)
+    {
+      out.push_back(n);
+      continue;
+    }
+
+    // Push in reverse to emit in preorder
+    for (size_t i=nd.children.size(); i > 0; i--)
+      stack.push_back(std::make_pair(nd.children[i-1], lvl));
+  }
+}
+
+//--------------------------------------------------------------------------
+void group_tree_t::get_collapsed_cut(
+    const std::set<int> &collapsed,
+    intvec_t &out)
+{
+  refresh();
+  out.qclear();
+
+  intvec_t stack;
+  stack.push_back(0);
+  while (!stack.empty())
+  {
+    int n = stack.back();
+    stack.pop_back();
+
+    const gtnode_t &nd = nodes[n];
+    if (nd.nblocks == 0)
+      continue;
+
+    if (nd.kind == gtk_block || collapsed.find(n) != collapsed.end())
+    {
+      out.push_back(n);
+      continue;
+    }
+
+    for (size_t i=nd.children.size(); i > 0; i--)
+      stack.push_back(nd.children[i-1]);
+  }
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Order the nodes by preorder index
+*/
+struct gt_tin_less_t
+{
+  const qvector<gtnode_t> &nodes;
+  gt_tin_less_t(const qvector<gtnode_t> &nodes): nodes(nodes) { }
+  bool operator()(int a, int b) const { return nodes[a].tin < nodes[b].tin; }
+};
+
+//--------------------------------------------------------------------------
+bool group_tree_t::is_cut(const intvec_t &cut)
+{
+  refresh();
+
+  intvec_t sorted = cut;
+  std::sort(sorted.begin(), sorted.end(), gt_tin_less_t(nodes));
+
+  // The subtrees must be disjoint and hold all the blocks
+  int total = 0;
+  int last_tout = -1;
+  for (size_t i=0; i < sorted.size(); i++)
+  {
+    int n = sorted[i];
+    if (!is_valid(n) || nodes[n].tin <= last_tout)
+      return false;
+
+    last_tout = nodes[n].tout;
+    total += nodes[n].nblocks;
+  }
+  return total == nodes[0].nblocks;
+}
+
+//--------------------------------------------------------------------------
+bool group_tree_t::build_quotient(
+    const intvec_t &cut,
+    const qvector<intvec_t> &succs,
+    gt_quotient_t &out)
+{
+  if (!is_cut(cut))
+    return false;
+
+  out.nodes = cut;
+  std::sort(out.nodes.begin(), out.nodes.end(), gt_tin_less_t(nodes));
+
+  intvec_t tins;
+  tins.resize(out.nodes.size());
+  for (size_t i=0; i < out.nodes.size(); i++)
+    tins[i] = nodes[out.nodes[i]].tin;
+
+  // Map each block to the cut node whose interval holds its preorder index
+  size_t nids = succs.size();
+  if (!nid2node.empty() && size_t(nid2node.rbegin()->first) >= nids)
+    nids = nid2node.rbegin()->first + 1;
+
+  out.node_of_nid.qclear();
+  out.node_of_nid.resize(nids, -1);
+  for (std::map<int, int>::const_iterator it=nid2node.begin();
+       it != nid2node.end();
+       ++it)
+  {
+    if (it->first < 0)
+      continue;
+
+    int tin = nodes[it->second].tin;
+    out.node_of_nid[it->first] = int(std::upper_bound(tins.begin(), tins.end(), tin) - tins.begin()) - 1;
+  }
+
+  // Quotient edges
+  out.edges.qclear();
+  for (size_t nid=0; nid < succs.size(); nid++)
+  {
+    int u = out.node_of_nid[nid];
+    if (u == -1)
+      continue;
+
+    const intvec_t &s = succs[nid];
+    for (size_t i=0; i < s.size(); i++)
+    {
+      if (s[i] < 0 || size_t(s[i]) >= nids)
+        continue;
+
+      int v = out.node_of_nid[s[i]];
+      if (v != -1 && v != u)
+        out.edges.push_back(std::make_pair(u, v));
+    }
+  }
+  std::sort(out.edges.begin(), out.edges.end());
+  out.edges.resize(std::unique(out.edges.begin(), out.edges.end()) - out.edges.begin());
+  return true;
+}
+
+//--------------------------------------------------------------------------
+void group_tree_t::build_from(groupman_t *gm)
+{
+  clear();
+
+  // The first group of each path. The implicit groups have no SG yet
+  std::map<qstring, int> path2group;
+
+  psupergroup_listp_t sgl = gm->get_path_sgl();
+  for (supergroup_listp_t::iterator it_sg=sgl->begin();
+       it_sg != sgl->end();
+       ++it_sg)
+  {
+    psupergroup_t sg = *it_sg;
+
+    // Find or create the parent groups
+    int parent = root();
+    qstring path;
+    const char *id = sg->id.c_str();
+    for (const char *sep; (sep = strchr(id, GROUPTREE_SEP)) != NULL; id = sep + 1)
+    {
+      qstring comp(id, sep - id);
+      if (!path.empty())
+        path.append(GROUPTREE_SEP);
+      path.append(comp);
+
+      std::map<qstring, int>::iterator it = path2group.find(path);
+      if (it == path2group.end())
+      {
+        parent = add_group(parent, comp.c_str());
+        path2group[path] = parent;
+      }
+      else
+      {
+        parent = it->second;
+      }
+    }
+
+    // The group itself: complete the implicit group of that path if any
+    int g = -1;
+    std::map<qstring, int>::iterator it = path2group.find(sg->id);
+    if (it != path2group.end() && nodes[it->second].sg == NULL)
+      g = it->second;
+    else
+      g = add_group(parent, id);
+
+    if (it == path2group.end() && !sg->id.empty())
+      path2group[sg->id] = g;
+
+    nodes[g].name = sg->name;
+    nodes[g].sg = sg;
+
+    for (nodegroup_list_t::iterator it_ng=sg->groups.begin();
+         it_ng != sg->groups.end();
+         ++it_ng)
+    {
+      int ngn = add_ng(g);
+      for (nodegroup_t::iterator it_nd=(*it_ng)->begin();
+           it_nd != (*it_ng)->end();
+           ++it_nd)
+      {
+        pnodedef_t nd = *it_nd;
+        add_block(ngn, nd->nid, nd->start, nd->end);
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------
+int group_tree_t::export_to(groupman_t *gm)
+{
+  // Build the new path SGs in a copy and patch the changed ones in place,
+  // so the unchanged SGs keep their identity
+  groupman_t *tmp = gm->clone();
+  psupergroup_listp_t sgl = tmp->get_path_sgl();
+  while (!sgl->empty())
+    sgl->remove_sg(sgl->front(), true);
+
+  intvec_t stack;
+  stack.push_back(root());
+  while (!stack.empty())
+  {
+    int n = stack.back();
+    stack.pop_back();
+
+    const gtnode_t &g = nodes[n];
+    psupergroup_t sg = NULL;
+    for (size_t i=0; i < g.children.size(); i++)
+    {
+      const gtnode_t &c = nodes[g.children[i]];
+      if (c.kind != gtk_ng || c.children.empty())
+        continue;
+
+      if (sg == NULL)
+      {
+        sg = tmp->add_supergroup(sgl);
+        get_path(n, &sg->id);
+        sg->name = g.name;
+        if (g.sg != NULL)
+          sg->is_synthetic = g.sg->is_synthetic;
+      }
+
+      pnodegroup_t ng = sg->add_nodegroup();
+      for (size_t j=0; j < c.children.size(); j++)
+      {
+        const gtnode_t &b = nodes[c.children[j]];
+        pnodedef_t nd = ng->add_node();
+        nd->nid = b.nid;
+        nd->start = b.start;
+        nd->end = b.end;
+      }
+    }
+
+    for (size_t i=g.children.size(); i > 0; i--)
+    {
+      if (nodes[g.children[i-1]].kind == gtk_group)
+        stack.push_back(g.children[i-1]);
+    }
+  }
+
+  int count = gm->patch_from(tmp);
+  delete tmp;
+  return count;
+}
@@ -0,0 +1,270 @@
+#ifndef __GROUPTREE__
+#define __GROUPTREE__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Hierarchical groups module
+
+The groups of the groups manager are two levels deep: super groups hold
+node groups that hold node definitions. This module models the groups as a
+tree of arbitrary depth, so a group may nest other groups (an inlined
+helper inside an inlined loop body inside a handler):
+
+   root -> group -> ... -> group -> node group -> block
+
+The tree is numbered with an Euler tour: each node gets its preorder index
+(tin) and the last preorder index of its subtree (tout), so the ancestor
+and containment tests are two comparisons. Regrouping (moving a subtree,
+removing a group level) walks the parents only, O(depth), and marks the
+numbering stale; it is rebuilt once, on the next query.
+
+The numbering is not maintained incrementally: rebuilding it is O(n). So
+batch the regrouping, then query. The queries (is_ancestor(), contains(),
+lca(), get_block_count(), the cuts and the quotient graph) are O(1) or
+O(depth) plus that O(n) rebuild when a regrouping came before them. A loop
+that alternates a move and a query costs O(n) per iteration. move() and
+nest() themselves do not use the numbering of their own moves.
+
+A cut of the tree is a set of nodes that covers every block exactly once
+(for example the groups at a given nesting level). The quotient graph of a
+cut has one node per cut node and an edge for each pair of cut nodes
+linked by a flowchart edge. The blocks are mapped to the cut nodes with a
+binary search on the preorder indexes.
+
+The nesting is persisted in the super groups ids: a super group with the
+id "a/b" is nested in the super group "a" (the missing intermediate groups
+are created as empty groups). The existing two-level view of the groups
+manager is thus unchanged: build the tree from it, regroup, and export the
+tree back.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <set>
+#include "groupman.h"
+
+//--------------------------------------------------------------------------
+// Separator of the nested super groups ids
+#define GROUPTREE_SEP '/'
+
+//--------------------------------------------------------------------------
+enum gtnode_kind_e
+{
+  gtk_free,
+  gtk_root,
+  gtk_group,
+  gtk_ng,
+  gtk_block,
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief A node of the groups tree
+*/
+struct gtnode_t
+{
+  gtnode_kind_e kind;
+  int parent;
+  intvec_t children;
+
+  // Euler tour numbering: preorder index and last preorder index of the subtree
+  int tin;
+  int tout;
+
+  // Count of blocks in the subtree
+  int nblocks;
+
+  // Groups: the id relative to the parent group and the name
+  qstring id;
+  qstring name;
+
+  // Groups: the super group it came from, if any
+  psupergroup_t sg;
+
+  // Blocks: the node definition
+  int nid;
+  ea_t start;
+  ea_t end;
+
+  gtnode_t(): kind(gtk_free), parent(-1), tin(0), tout(-1), nblocks(0),
+    sg(NULL), nid(-1), start(0), end(0)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief The quotient graph of a cut
+*/
+struct gt_quotient_t
+{
+  // The cut nodes, by preorder
+  intvec_t nodes;
+
+  // Index in 'nodes' of each node id (-1 if the block is not in the tree)
+  intvec_t node_of_nid;
+
+  // Edges between the indexes of 'nodes', without duplicates and self loops
+  qvector<std::pair<int, int> > edges;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Groups tree
+*/
+class group_tree_t
+{
+  qvector<gtnode_t> nodes;
+  intvec_t free_nodes;
+  std::map<int, int> nid2node;
+  bool dirty;
+
+  int alloc_node(gtnode_kind_e kind, int parent);
+  void free_node(int n);
+  void link(int n, int parent);
+  void unlink(int n);
+  void renumber();
+
+  inline void refresh()
+  {
+    if (dirty)
+      renumber();
+  }
+
+public:
+  group_tree_t();
+
+  /**
+  * @brief Remove all the nodes but the root
+  */
+  void clear();
+
+  inline int root() const { return 0; }
+  inline int size() const { return int(nodes.size()); }
+  inline bool is_valid(int n) const { return n >= 0 && n < int(nodes.size()) && nodes[n].kind != gtk_free; }
+  inline const gtnode_t &get_node(int n) const { return nodes[n]; }
+  inline int get_parent(int n) const { return nodes[n].parent; }
+  inline const intvec_t &get_children(int n) const { return nodes[n].children; }
+
+  /**
+  * @brief Count of blocks under a node
+  */
+  int get_block_count(int n);
+
+  /**
+  * @brief Nesting level of a node: the count of groups from the top down to
+  *        it (the root is at level 0), O(depth)
+  */
+  int get_level(int n) const;
+
+  /**
+  * @brief Add a group under the root or another group
+  * @return The new node or -1 if the parent is not a group
+  */
+  int add_group(int parent, const char *id, const char *name = NULL);
+
+  /**
+  * @brief Add a node group under a group
+  */
+  int add_ng(int parent);
+
+  /**
+  * @brief Add a block under a node group
+  */
+  int add_block(int parent, int nid, ea_t start, ea_t end);
+
+  /**
+  * @brief Return the block node of a node id or -1
+  */
+  int find_block(int nid) const;
+
+  /**
+  * @brief Return the group node of a super group or -1
+  */
+  int find_sg(psupergroup_t sg) const;
+
+  /**
+  * @brief Whether 'a' is 'b' or one of its ancestors. O(1) when the
+  *        numbering is current, O(n) after a regrouping (see above)
+  */
+  bool is_ancestor(int a, int b);
+
+  /**
+  * @brief Whether a node contains the block of a node id
+  */
+  bool contains(int n, int nid);
+
+  /**
+  * @brief Lowest common ancestor of two nodes, O(depth) when the numbering
+  *        is current, plus O(n) after a regrouping (see above)
+  */
+  int lca(int a, int b);
+
+  /**
+  * @brief Move a node and its subtree under another parent, O(depth).
+  *        Fails if the parent is in the subtree or cannot hold the node.
+  *        The numbering goes stale until the next query
+  */
+  bool move(int n, int new_parent);
+
+  /**
+  * @brief Group nodes under a new group created under their lowest common
+  *        group. The nodes inside another of the nodes move along with it
+  * @return The new group or -1
+  */
+  int nest(const intvec_t &group_nodes, const char *id, const char *name = NULL);
+
+  /**
+  * @brief Remove a group level: its children move to its parent
+  */
+  bool ungroup(int n);
+
+  /**
+  * @brief The id path of a group, from the top group
+  */
+  void get_path(int n, qstring *out) const;
+
+  /**
+  * @brief The groups at the given nesting level and the node groups of the
+  *        groups above it. Subtrees without blocks are skipped
+  */
+  void get_level_cut(int level, intvec_t &out);
+
+  /**
+  * @brief The topmost nodes that are collapsed or are blocks
+  */
+  void get_collapsed_cut(const std::set<int> &collapsed, intvec_t &out);
+
+  /**
+  * @brief Whether a set of nodes covers every block exactly once
+  */
+  bool is_cut(const intvec_t &cut);
+
+  /**
+  * @brief Build the quotient graph of a cut
+  * @param succs - the successors of each node id
+  */
+  bool build_quotient(
+      const intvec_t &cut,
+      const qvector<intvec_t> &succs,
+      gt_quotient_t &out);
+
+  /**
+  * @brief Build the tree from the path super groups. The super groups ids
+  *        carry the nesting
+  */
+  void build_from(groupman_t *gm);
+
+  /**
+  * @brief Write the tree back to the path super groups: each group with node
+  *        groups is a super group with its path as id
+  * @return The count of super groups changed
+  */
+  int export_to(groupman_t *gm);
+};
+
+#endif
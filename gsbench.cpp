@@ -0,0 +1,356 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - fix: the counters also count the threads started after they open
+                                - fix: tell why the counters are unavailable
+--------------------------------------------------------------------------*/
+
+#include "gsbench.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef GSBENCH_PERF
+  #include <linux/perf_event.h>
+  #include <sys/syscall.h>
+  #include <sys/ioctl.h>
+  #include <unistd.h>
+  #include <fcntl.h>
+  #include <errno.h>
+#elif defined(__NT__) || defined(_WIN32)
+  #include <windows.h>
+  #include <psapi.h>
+  #pragma comment(lib, "psapi.lib")
+#else
+  #include <sys/resource.h>
+#endif
+
+//--------------------------------------------------------------------------
+// What the counters measure (see gsbench.h)
+#define COUNTERS_SCOPE "opening_thread_and_later_threads"
+
+//--------------------------------------------------------------------------
+static const char *const counter_names[gsbc_count] =
+{
+  "cycles",
+  "instructions",
+  "cache_misses",
+  "branch_misses",
+};
+
+#ifdef GSBENCH_PERF
+//--------------------------------------------------------------------------
+static int open_counter(uint64 config)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  // The workers started later are counted too (their counts are added on exit)
+  attr.inherit = 1;
+
+  // This thread and its children, any CPU
+  return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Read a counter scaled to the time it was enabled
+*/
+static uint64 read_counter(int fd)
+{
+  uint64 v[3];
+  if (read(fd, v, sizeof(v)) != sizeof(v) || v[2] == 0)
+    return 0;
+
+  if (v[2] == v[1])
+    return v[0];
+
+  return uint64(double(v[0]) * double(v[1]) / double(v[2]));
+}
+#endif
+
+//--------------------------------------------------------------------------
+gsbench_t::gsbench_t(): rss_reset(false), counters_errno(0)
+{
+  for (int i=0; i < gsbc_count; i++)
+    fds[i] = -1;
+
+#ifdef GSBENCH_PERF
+  static const uint64 configs[gsbc_count] =
+  {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+  };
+  for (int i=0; i < gsbc_count; i++)
+  {
+    fds[i] = open_counter(configs[i]);
+    if (fds[i] == -1 && counters_errno == 0)
+      counters_errno = errno;
+  }
+
+  // Resetting the peak RSS needs Linux 4.0
+  rss_reset = true;
+  reset_peak_rss();
+#endif
+}
+
+//--------------------------------------------------------------------------
+gsbench_t::~gsbench_t()
+{
+#ifdef GSBENCH_PERF
+  for (int i=0; i < gsbc_count; i++)
+  {
+    if (fds[i] != -1)
+      close(fds[i]);
+  }
+#endif
+}
+
+//--------------------------------------------------------------------------
+bool gsbench_t::has_counters() const
+{
+  for (int i=0; i < gsbc_count; i++)
+  {
+    if (fds[i] != -1)
+      return true;
+  }
+  return false;
+}
+
+//--------------------------------------------------------------------------
+const char *gsbench_t::counters_error() const
+{
+  if (has_counters())
+    return NULL;
+
+#ifdef GSBENCH_PERF
+  switch (counters_errno)
+  {
+    case EACCES:
+    case EPERM:
+      return "refused by the kernel (see /proc/sys/kernel/perf_event_paranoid)";
+    case ENOENT:
+    case EOPNOTSUPP:
+      return "no hardware PMU (virtual machine?)";
+    case ENOSYS:
+      return "perf_event_open is not supported by the kernel";
+    default:
+      return "perf_event_open failed";
+  }
+#else
+  return "not supported on this platform";
+#endif
+}
+
+//--------------------------------------------------------------------------
+void gsbench_t::read_counters(uint64 *out)
+{
+  for (int i=0; i < gsbc_count; i++)
+  {
+#ifdef GSBENCH_PERF
+    out[i] = fds[i] == -1 ? 0 : read_counter(fds[i]);
+#else
+    out[i] = 0;
+#endif
+  }
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Peak resident set size in KB
+*/
+uint64 gsbench_t::read_peak_rss()
+{
+#ifdef GSBENCH_PERF
+  FILE *fp = fopen("/proc/self/status", "r");
+  if (fp == NULL)
+    return 0;
+
+  uint64 kb = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), fp) != NULL)
+  {
+    unsigned long long v;
+    if (sscanf(line, "VmHWM: %llu", &v) == 1)
+    {
+      kb = v;
+      break;
+    }
+  }
+  fclose(fp);
+  return kb;
+#elif defined(__NT__) || defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return 0;
+  return uint64(pmc.PeakWorkingSetSize) >> 10;
+#else
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) != 0)
+    return 0;
+  #ifdef __APPLE__
+    return uint64(ru.ru_maxrss) >> 10;
+  #else
+    return uint64(ru.ru_maxrss);
+  #endif
+#endif
+}
+
+//--------------------------------------------------------------------------
+void gsbench_t::reset_peak_rss()
+{
+  if (!rss_reset)
+    return;
+
+#ifdef GSBENCH_PERF
+  // Writing 5 resets the peak RSS to the current RSS
+  int fd = open("/proc/self/clear_refs", O_WRONLY);
+  if (fd == -1 || write(fd, "5", 1) != 1)
+    rss_reset = false;
+  if (fd != -1)
+    close(fd);
+#else
+  rss_reset = false;
+#endif
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Fold the current peak into the entered stages
+*/
+void gsbench_t::update_peaks()
+{
+  uint64 kb = read_peak_rss();
+  for (size_t i=0; i < stages.size(); i++)
+  {
+    stage_t &st = stages[i];
+    if (st.active && kb > st.peak_rss_kb)
+      st.peak_rss_kb = kb;
+  }
+}
+
+//--------------------------------------------------------------------------
+int gsbench_t::get_stage(const char *name)
+{
+  for (size_t i=0; i < stages.size(); i++)
+  {
+    if (strcmp(stages[i].name, name) == 0)
+      return int(i);
+  }
+
+  stage_t &st = stages.push_back();
+  memset(&st, 0, sizeof(st));
+  st.name = name;
+  return int(stages.size() - 1);
+}
+
+//--------------------------------------------------------------------------
+void gsbench_t::begin(int stage)
+{
+  stage_t &st = stages[stage];
+  if (st.active)
+    return;
+
+  // The enclosing stages keep the peak reached so far
+  update_peaks();
+  reset_peak_rss();
+
+  st.active = true;
+  ++st.calls;
+  update_peaks();
+
+  read_counters(st.start_counters);
+  st.start_ns = get_nsec_stamp();
+}
+
+//--------------------------------------------------------------------------
+void gsbench_t::end(int stage)
+{
+  stage_t &st = stages[stage];
+  if (!st.active)
+    return;
+
+  uint64 now = get_nsec_stamp();
+  uint64 counters[gsbc_count];
+  read_counters(counters);
+
+  st.wall_ns += now - st.start_ns;
+  for (int i=0; i < gsbc_count; i++)
+    st.counters[i] += counters[i] - st.start_counters[i];
+
+  update_peaks();
+  st.active = false;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Write a JSON string
+*/
+static void write_json_str(FILE *fp, const char *s)
+{
+  qfputc('"', fp);
+  for (; *s != '\0'; s++)
+  {
+    uchar c = uchar(*s);
+    if (c == '"' || c == '\\')
+      qfprintf(fp, "\\%c", c);
+    else if (c < 0x20)
+      qfprintf(fp, "\\u%04x", c);
+    else
+      qfputc(c, fp);
+  }
+  qfputc('"', fp);
+}
+
+//--------------------------------------------------------------------------
+bool gsbench_t::write_json(const char *filename, const char *title)
+{
+  FILE *fp = qfopen(filename, "w");
+  if (fp == NULL)
+    return false;
+
+  qfprintf(fp, "{\n  \"title\": ");
+  write_json_str(fp, title);
+  qfprintf(fp, ",\n  \"counters\": %s,\n  \"counters_scope\": \"%s\",\n  \"peak_rss_per_stage\": %s,\n  \"stages\": [\n",
+    has_counters() ? "true" : "false",
+    COUNTERS_SCOPE,
+    rss_reset ? "true" : "false");
+
+  for (size_t i=0; i < stages.size(); i++)
+  {
+    const stage_t &st = stages[i];
+    qfprintf(fp, "    { \"name\": ");
+    write_json_str(fp, st.name);
+    qfprintf(fp, ", \"calls\": %d, \"wall_ms\": %.3f", st.calls, double(st.wall_ns) / 1e6);
+
+    for (int c=0; c < gsbc_count; c++)
+    {
+      if (fds[c] == -1)
+        qfprintf(fp, ", \"%s\": null", counter_names[c]);
+      else
+        qfprintf(fp, ", \"%s\": %" FMT_64 "u", counter_names[c], st.counters[c]);
+    }
+
+    if (fds[gsbc_cycles] == -1 || fds[gsbc_instructions] == -1 || st.counters[gsbc_cycles] == 0)
+      qfprintf(fp, ", \"ipc\": null");
+    else
+      qfprintf(fp, ", \"ipc\": %.3f", double(st.counters[gsbc_instructions]) / double(st.counters[gsbc_cycles]));
+
+    qfprintf(fp, ", \"peak_rss_kb\": %" FMT_64 "u }%s\n",
+      st.peak_rss_kb,
+      i + 1 < stages.size() ? "," : "");
+  }
+
+  qfprintf(fp, "  ]\n}\n");
+  qfclose(fp);
+  return true;
+}
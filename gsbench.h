@@ -0,0 +1,161 @@
+#ifndef __GSBENCH__
+#define __GSBENCH__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Benchmark stages module
+
+Measures named stages of the headless runs: the wall time, the hardware
+counters (cycles, instructions, cache misses, branch misses) and the peak
+resident set size. A stage may be entered many times (once per function
+for example): its measures are summed, its peak is the largest.
+
+The counters come from perf_event_open on Linux (user space only, scaled
+when the kernel multiplexes them); they are reported as unavailable
+elsewhere or when the kernel refuses them (see perf_event_paranoid).
+They count the thread that created the gsbench_t and the threads it (or
+they) start afterwards; a finished thread's counts are added when it
+exits. The threads that were already running (workers started before)
+are not counted: "counters_scope" says so in the results.
+
+On Linux the peak RSS is reset when a stage is entered (through
+/proc/self/clear_refs), so each stage gets its own peak. Elsewhere, or if
+the reset fails, it is the process peak at the end of the stage.
+
+The results are written as JSON:
+
+  {
+    "title": "...",
+    "counters": true,
+    "counters_scope": "opening_thread_and_later_threads",
+    "peak_rss_per_stage": true,
+    "stages": [
+      { "name": "parse", "calls": 120, "wall_ms": 10.5, "cycles": ...,
+        "instructions": ..., "cache_misses": ..., "branch_misses": ...,
+        "ipc": 1.9, "peak_rss_kb": 5120 },
+      ...
+    ]
+  }
+
+The unavailable counters are null.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+
+#if defined(__LINUX__) || defined(__linux__)
+  #define GSBENCH_PERF
+#endif
+
+//--------------------------------------------------------------------------
+enum gsbench_counter_e
+{
+  gsbc_cycles,
+  gsbc_instructions,
+  gsbc_cache_misses,
+  gsbc_branch_misses,
+  gsbc_count
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Collects the measures of the benchmark stages
+*/
+class gsbench_t
+{
+  struct stage_t
+  {
+    const char *name;
+    int calls;
+    uint64 wall_ns;
+    uint64 counters[gsbc_count];
+    uint64 peak_rss_kb;
+
+    // Values when the stage was entered
+    uint64 start_ns;
+    uint64 start_counters[gsbc_count];
+    bool active;
+  };
+  qvector<stage_t> stages;
+
+  // Counters file descriptors (-1 if unavailable)
+  int fds[gsbc_count];
+  bool rss_reset;
+
+  // errno of the first counter that failed to open (0 if none)
+  int counters_errno;
+
+  void read_counters(uint64 *out);
+  uint64 read_peak_rss();
+  void reset_peak_rss();
+  void update_peaks();
+
+  gsbench_t(const gsbench_t &) { }
+
+public:
+  gsbench_t();
+  ~gsbench_t();
+
+  /**
+  * @brief Whether at least one hardware counter is available
+  */
+  bool has_counters() const;
+
+  /**
+  * @brief Why the hardware counters are unavailable, NULL if they are not
+  */
+  const char *counters_error() const;
+
+  /**
+  * @brief Return the index of a stage, added on first use. The name must
+  *        be a static string
+  */
+  int get_stage(const char *name);
+
+  /**
+  * @brief Enter a stage. The stages may nest
+  */
+  void begin(int stage);
+
+  /**
+  * @brief Leave a stage
+  */
+  void end(int stage);
+
+  /**
+  * @brief Write the results
+  */
+  bool write_json(const char *filename, const char *title);
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Measures a stage for the lifetime of the object. Does nothing if
+*        the benchmark is NULL
+*/
+class gsbench_scope_t
+{
+  gsbench_t *bench;
+  int stage;
+
+public:
+  gsbench_scope_t(gsbench_t *bench, const char *name): bench(bench), stage(-1)
+  {
+    if (bench != NULL)
+    {
+      stage = bench->get_stage(name);
+      bench->begin(stage);
+    }
+  }
+
+  ~gsbench_scope_t()
+  {
+    if (bench != NULL)
+      bench->end(stage);
+  }
+};
+
+#endif
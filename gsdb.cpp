@@ -0,0 +1,263 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - fix: reject the truncated recordings and the counts larger than the file
+                                - fix: reject the addresses that do not fit ea_t (64-bit recording, 32-bit build)
+--------------------------------------------------------------------------*/
+
+#include "gsdb.h"
+#include "groupman.h"
+#include "snapio.hpp"
+
+//--------------------------------------------------------------------------
+static const char REC_MAGIC[] = "GSDBREC";
+static const uchar REC_VERSION = 1;
+
+//--------------------------------------------------------------------------
+void gsdb_fc_t::clear()
+{
+  func_ea = BADADDR;
+  blocks.qclear();
+}
+
+//--------------------------------------------------------------------------
+void gsdb_fc_t::build_preds()
+{
+  for (size_t i=0; i < blocks.size(); i++)
+    blocks[i].pred.qclear();
+
+  for (int n=0, nblocks=size(); n < nblocks; n++)
+  {
+    const intvec_t &succ = blocks[n].succ;
+    for (size_t i=0; i < succ.size(); i++)
+      blocks[succ[i]].pred.push_back(n);
+  }
+}
+
+//--------------------------------------------------------------------------
+uint64 gsdb_fc_t::fingerprint() const
+{
+  int nodes_count = size();
+  fc_fingerprint_t fp(nodes_count);
+  for (int n=0; n < nodes_count; n++)
+  {
+    const gsdb_block_t &block = blocks[n];
+    int nsucc = int(block.succ.size());
+    fp.add_block(block.start, block.end, nsucc);
+    for (int i=0; i < nsucc; i++)
+      fp.add_succ(block.succ[i]);
+  }
+  return fp.value();
+}
+
+//--------------------------------------------------------------------------
+int gsdb_record(gsdb_t *db, const char *filename)
+{
+  snap_writer_t w;
+  w.put_bytes(REC_MAGIC, sizeof(REC_MAGIC) - 1);
+  w.put_u8(REC_VERSION);
+
+  qstring db_name;
+  db->get_db_name(&db_name);
+  w.put_str(db_name.c_str(), db_name.length());
+
+  // The functions without a flowchart are skipped: count them first
+  qvector<gsdb_fc_t> fcs;
+  eavec_t ends;
+  for (size_t i=0, n=db->get_func_qty(); i < n; i++)
+  {
+    ea_t start, end;
+    ea_t ea = db->getn_func(i);
+    if (ea == BADADDR || !db->get_func_bounds(ea, &start, &end))
+      continue;
+
+    gsdb_fc_t &fc = fcs.push_back();
+    if (!db->get_flowchart(start, fc))
+    {
+      fcs.pop_back();
+      continue;
+    }
+    fc.func_ea = start;
+    ends.push_back(end);
+  }
+
+  w.put_uleb(fcs.size());
+  qstring text;
+  for (size_t ifunc=0; ifunc < fcs.size(); ifunc++)
+  {
+    const gsdb_fc_t &fc = fcs[ifunc];
+    w.put_uleb(fc.func_ea);
+    w.put_uleb(ends[ifunc] - fc.func_ea);
+    w.put_uleb(fc.blocks.size());
+    for (size_t iblock=0; iblock < fc.blocks.size(); iblock++)
+    {
+      const gsdb_block_t &bb = fc.blocks[iblock];
+      w.put_sleb(int64(bb.start - fc.func_ea));
+      w.put_uleb(bb.end - bb.start);
+
+      w.put_uleb(bb.succ.size());
+      for (size_t i=0; i < bb.succ.size(); i++)
+        w.put_uleb(bb.succ[i]);
+
+      text.qclear();
+      db->get_disasm_text(bb.start, bb.end, &text);
+      w.put_str(text.c_str(), text.length());
+    }
+  }
+
+  if (!w.save_file(filename))
+    return -1;
+
+  return int(fcs.size());
+}
+
+//--------------------------------------------------------------------------
+void gsdb_rec_t::clear()
+{
+  db_name.qclear();
+  funcs.clear();
+  func_eas.qclear();
+  blocks.clear();
+}
+
+//--------------------------------------------------------------------------
+bool gsdb_rec_t::load(const char *filename)
+{
+  clear();
+
+  qvector<uchar> buf;
+  if (!snap_reader_t::load_file(filename, buf))
+    return false;
+
+  snap_reader_t r(buf.begin(), buf.size());
+
+  char magic[sizeof(REC_MAGIC) - 1];
+  if (   !r.get_bytes(magic, sizeof(magic))
+      || memcmp(magic, REC_MAGIC, sizeof(magic)) != 0
+      || r.get_u8() != REC_VERSION
+      || !r.get_str(&db_name))
+  {
+    return false;
+  }
+
+  size_t nfuncs = r.get_count();
+  for (size_t ifunc=0; ifunc < nfuncs && r.ok; ifunc++)
+  {
+    uint64 start64 = r.get_uleb();
+    uint64 end64 = start64 + r.get_uleb();
+
+    // Recorded from a 64-bit database: the eas would be truncated
+    if (uint64(ea_t(end64)) != end64 || end64 < start64)
+      return false;
+
+    ea_t start = ea_t(start64);
+    if (funcs.find(start) != funcs.end())
+      return false;
+
+    rec_func_t &f = funcs[start];
+    f.end = ea_t(end64);
+    f.fc.func_ea = start;
+    func_eas.push_back(start);
+
+    int nblocks = int(r.get_count());
+    for (int iblock=0; iblock < nblocks && r.ok; iblock++)
+    {
+      gsdb_block_t &bb = f.fc.blocks.push_back();
+      bb.start = ea_t(start + r.get_sleb());
+      bb.end = ea_t(bb.start + r.get_uleb());
+
+      int nsucc = int(r.get_count());
+      for (int i=0; i < nsucc && r.ok; i++)
+      {
+        uint64 succ = r.get_uleb();
+        if (succ >= uint64(nblocks))
+          return false;
+        bb.succ.push_back(int(succ));
+      }
+
+      rec_block_t &rb = blocks[bb.start];
+      rb.end = bb.end;
+      r.get_str(&rb.text);
+    }
+
+    // Truncated: some blocks are missing
+    if (!r.ok)
+      return false;
+
+    f.fc.build_preds();
+  }
+  return r.ok;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Return the function containing an address
+*/
+const gsdb_rec_t::rec_func_t *gsdb_rec_t::find_func(ea_t ea)
+{
+  // The last function starting at or before the address
+  ea2func_t::iterator it = funcs.upper_bound(ea);
+  if (it == funcs.begin())
+    return NULL;
+
+  --it;
+  if (ea >= it->second.end)
+    return NULL;
+
+  return &it->second;
+}
+
+//--------------------------------------------------------------------------
+void gsdb_rec_t::get_db_name(qstring *out)
+{
+  *out = db_name;
+}
+
+//--------------------------------------------------------------------------
+size_t gsdb_rec_t::get_func_qty()
+{
+  return func_eas.size();
+}
+
+//--------------------------------------------------------------------------
+ea_t gsdb_rec_t::getn_func(size_t n)
+{
+  return n < func_eas.size() ? func_eas[n] : BADADDR;
+}
+
+//--------------------------------------------------------------------------
+bool gsdb_rec_t::get_func_bounds(ea_t ea, ea_t *start, ea_t *end)
+{
+  const rec_func_t *f = find_func(ea);
+  if (f == NULL)
+    return false;
+
+  *start = f->fc.func_ea;
+  *end = f->end;
+  return true;
+}
+
+//--------------------------------------------------------------------------
+bool gsdb_rec_t::get_flowchart(ea_t ea, gsdb_fc_t &fc)
+{
+  const rec_func_t *f = find_func(ea);
+  if (f == NULL)
+    return false;
+
+  fc = f->fc;
+  return true;
+}
+
+//--------------------------------------------------------------------------
+void gsdb_rec_t::get_disasm_text(ea_t start, ea_t end, qstring *out)
+{
+  // Only the recorded blocks are known: a range covers whole blocks
+  for (ea2block_t::iterator it=blocks.lower_bound(start);
+       it != blocks.end() && it->first < end;
+       ++it)
+  {
+    out->append(it->second.text);
+  }
+}
@@ -0,0 +1,179 @@
+#ifndef __GSDB__
+#define __GSDB__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Database access module
+
+The database queries the function views are built from (function bounds,
+flowcharts and blocks disassembly) behind one interface:
+
+  - the IDA database (see get_ida_gsdb() in util.h), used by the plugin
+  - a recording of it (gsdb_rec_t), used by the headless runs
+
+The plugin records a database with "Record database for headless runs".
+The recorded stand-in answers the same queries without IDA, so the view
+logic (see gsview.h) runs and can be measured on any platform.
+
+Recording layout (all integers are LEB128 varints):
+
+  "GSDBREC" version(u8) db_name(len, chars) nfuncs
+  per function:
+    start (end - start) nblocks
+    per block:
+      zigzag(start - func start) (end - start) nsucc succ... text(len, chars)
+
+The predecessors are rebuilt from the successors.
+
+The varints make the recording independent of the byte order and of the
+ea_t size: the Windows plugin records it, the Linux headless build (see
+headless.mak) replays it. A build without __EA64__ refuses the recordings
+whose addresses do not fit 32 bits.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+#include <map>
+
+//--------------------------------------------------------------------------
+#define GSDB_REC_EXT "gsdbrec"
+
+//--------------------------------------------------------------------------
+/**
+* @brief A basic block of a flowchart
+*/
+struct gsdb_block_t
+{
+  ea_t start;
+  ea_t end;
+  intvec_t succ;
+  intvec_t pred;
+};
+typedef qvector<gsdb_block_t> gsdb_blockvec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief A function flowchart (same block numbering as qflow_chart_t)
+*/
+struct gsdb_fc_t
+{
+  ea_t func_ea;
+  gsdb_blockvec_t blocks;
+
+  gsdb_fc_t(): func_ea(BADADDR) { }
+
+  inline int size() const { return int(blocks.size()); }
+  inline int nsucc(int n) const { return int(blocks[n].succ.size()); }
+  inline int succ(int n, int i) const { return blocks[n].succ[i]; }
+
+  void clear();
+
+  /**
+  * @brief Fill the predecessors from the successors
+  */
+  void build_preds();
+
+  /**
+  * @brief Same value as get_fc_fingerprint()
+  */
+  uint64 fingerprint() const;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief The database queries of the function views
+*/
+class gsdb_t
+{
+public:
+  virtual ~gsdb_t() { }
+
+  /**
+  * @brief The database path without its extension
+  */
+  virtual void get_db_name(qstring *out) = 0;
+
+  /**
+  * @brief Count of functions
+  */
+  virtual size_t get_func_qty() = 0;
+
+  /**
+  * @brief Start address of the n-th function or BADADDR
+  */
+  virtual ea_t getn_func(size_t n) = 0;
+
+  /**
+  * @brief Bounds of the function containing an address
+  */
+  virtual bool get_func_bounds(ea_t ea, ea_t *start, ea_t *end) = 0;
+
+  /**
+  * @brief Flowchart of the function containing an address
+  */
+  virtual bool get_flowchart(ea_t ea, gsdb_fc_t &fc) = 0;
+
+  /**
+  * @brief Append the disassembly lines of a range, one per line
+  */
+  virtual void get_disasm_text(ea_t start, ea_t end, qstring *out) = 0;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Recorded database
+*/
+class gsdb_rec_t: public gsdb_t
+{
+  struct rec_block_t
+  {
+    ea_t end;
+    qstring text;
+  };
+  typedef std::map<ea_t, rec_block_t> ea2block_t;
+
+  struct rec_func_t
+  {
+    ea_t end;
+    gsdb_fc_t fc;
+  };
+  typedef std::map<ea_t, rec_func_t> ea2func_t;
+
+  qstring db_name;
+  ea2func_t funcs;
+  eavec_t func_eas;
+
+  // The blocks text by start address, of all the functions
+  ea2block_t blocks;
+
+  const rec_func_t *find_func(ea_t ea);
+
+public:
+  /**
+  * @brief Load a recording
+  */
+  bool load(const char *filename);
+
+  void clear();
+
+  virtual void get_db_name(qstring *out);
+  virtual size_t get_func_qty();
+  virtual ea_t getn_func(size_t n);
+  virtual bool get_func_bounds(ea_t ea, ea_t *start, ea_t *end);
+  virtual bool get_flowchart(ea_t ea, gsdb_fc_t &fc);
+  virtual void get_disasm_text(ea_t start, ea_t end, qstring *out);
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Record the functions of a database (the plugin passes the IDA one)
+* @return The count of recorded functions or -1 on failure
+*/
+int gsdb_record(gsdb_t *db, const char *filename);
+
+#endif
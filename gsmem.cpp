@@ -0,0 +1,277 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+--------------------------------------------------------------------------*/
+
+#include "gsmem.h"
+#include <map>
+
+//--------------------------------------------------------------------------
+struct gsmem_entry_t;
+typedef std::multimap<double, gsmem_entry_t *> gsmem_queue_t;
+
+//--------------------------------------------------------------------------
+struct gsmem_entry_t
+{
+  gsmem_cache_t *cache;
+  uint64 key;
+  size_t bytes;
+  double cost;
+  bool pinned;
+
+  // Position in the eviction queue (unpinned entries only)
+  gsmem_queue_t::iterator qpos;
+};
+
+typedef std::pair<gsmem_cache_t *, uint64> gsmem_entry_key_t;
+typedef std::map<gsmem_entry_key_t, gsmem_entry_t> gsmem_entrymap_t;
+
+//--------------------------------------------------------------------------
+struct gsmem_cache_stats_t
+{
+  uint64 bytes;
+  uint64 pinned_bytes;
+  int entries;
+  int evictions;
+
+  gsmem_cache_stats_t(): bytes(0), pinned_bytes(0), entries(0), evictions(0)
+  {
+  }
+};
+
+typedef std::map<gsmem_cache_t *, gsmem_cache_stats_t> gsmem_cachemap_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief The manager state. Built on first use: the caches may be static
+*        objects of other modules
+*/
+struct gsmem_state_t
+{
+  gsmem_entrymap_t entries;
+  gsmem_queue_t queue;
+  gsmem_cachemap_t caches;
+
+  uint64 budget;
+  uint64 used;
+
+  // GreedyDual-Size clock: the priority of the last evicted entry
+  double clock;
+
+  gsmem_state_t(): budget(GSMEM_DEFAULT_BUDGET), used(0), clock(0)
+  {
+  }
+};
+
+static gsmem_state_t &get_state()
+{
+  static gsmem_state_t state;
+  return state;
+}
+
+//--------------------------------------------------------------------------
+static double get_priority(const gsmem_entry_t &e)
+{
+  return get_state().clock + e.cost / double(e.bytes == 0 ? 1 : e.bytes);
+}
+
+//--------------------------------------------------------------------------
+static void enqueue(gsmem_entry_t &e)
+{
+  if (!e.pinned)
+    e.qpos = get_state().queue.insert(std::make_pair(get_priority(e), &e));
+}
+
+//--------------------------------------------------------------------------
+static void dequeue(gsmem_entry_t &e)
+{
+  if (!e.pinned)
+    get_state().queue.erase(e.qpos);
+}
+
+//--------------------------------------------------------------------------
+static void account(const gsmem_entry_t &e, int sign)
+{
+  gsmem_state_t &gs = get_state();
+  gsmem_cache_stats_t &st = gs.caches[e.cache];
+  if (sign > 0)
+  {
+    gs.used += e.bytes;
+    st.bytes += e.bytes;
+    if (e.pinned)
+      st.pinned_bytes += e.bytes;
+  }
+  else
+  {
+    gs.used -= e.bytes;
+    st.bytes -= e.bytes;
+    if (e.pinned)
+      st.pinned_bytes -= e.bytes;
+  }
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Evict the lowest priority entries until the usage fits the budget.
+*        The 'keep' entry is not evicted
+*/
+static void trim(const gsmem_entry_t *keep = NULL)
+{
+  gsmem_state_t &gs = get_state();
+  gsmem_queue_t::iterator it = gs.queue.begin();
+  while (gs.used > gs.budget && it != gs.queue.end())
+  {
+    gsmem_entry_t *e = it->second;
+    if (e == keep)
+    {
+      ++it;
+      continue;
+    }
+
+    gs.clock = it->first;
+    gs.queue.erase(it);
+
+    // Forget the entry before calling the cache: it may charge other entries
+    gsmem_cache_t *cache = e->cache;
+    uint64 key = e->key;
+    account(*e, -1);
+    gsmem_cache_stats_t &st = gs.caches[cache];
+    --st.entries;
+    ++st.evictions;
+    gs.entries.erase(gsmem_entry_key_t(cache, key));
+
+    cache->evict(key);
+
+    // The queue may have changed
+    it = gs.queue.begin();
+  }
+}
+
+//--------------------------------------------------------------------------
+gsmem_cache_t::gsmem_cache_t(const char *name): name(name)
+{
+  get_state().caches[this] = gsmem_cache_stats_t();
+}
+
+//--------------------------------------------------------------------------
+gsmem_cache_t::~gsmem_cache_t()
+{
+  gsmem_state_t &gs = get_state();
+  gsmem_entrymap_t::iterator it = gs.entries.lower_bound(gsmem_entry_key_t(this, 0));
+  while (it != gs.entries.end() && it->first.first == this)
+  {
+    dequeue(it->second);
+    account(it->second, -1);
+    gs.entries.erase(it++);
+  }
+  gs.caches.erase(this);
+}
+
+//--------------------------------------------------------------------------
+void gsmem_cache_t::charge(uint64 key, size_t bytes, double cost)
+{
+  gsmem_state_t &gs = get_state();
+  gsmem_entry_key_t ek(this, key);
+  gsmem_entrymap_t::iterator it = gs.entries.find(ek);
+  gsmem_entry_t *e;
+  if (it == gs.entries.end())
+  {
+    e = &gs.entries[ek];
+    e->cache = this;
+    e->key = key;
+    e->pinned = false;
+    ++gs.caches[this].entries;
+  }
+  else
+  {
+    e = &it->second;
+    dequeue(*e);
+    account(*e, -1);
+  }
+
+  e->bytes = bytes;
+  e->cost = cost;
+  account(*e, 1);
+  enqueue(*e);
+
+  trim(e);
+}
+
+//--------------------------------------------------------------------------
+void gsmem_cache_t::touch(uint64 key)
+{
+  gsmem_state_t &gs = get_state();
+  gsmem_entrymap_t::iterator it = gs.entries.find(gsmem_entry_key_t(this, key));
+  if (it == gs.entries.end())
+    return;
+
+  dequeue(it->second);
+  enqueue(it->second);
+}
+
+//--------------------------------------------------------------------------
+void gsmem_cache_t::uncharge(uint64 key)
+{
+  gsmem_state_t &gs = get_state();
+  gsmem_entrymap_t::iterator it = gs.entries.find(gsmem_entry_key_t(this, key));
+  if (it == gs.entries.end())
+    return;
+
+  dequeue(it->second);
+  account(it->second, -1);
+  --gs.caches[this].entries;
+  gs.entries.erase(it);
+}
+
+//--------------------------------------------------------------------------
+void gsmem_cache_t::pin(uint64 key, bool pinned)
+{
+  gsmem_state_t &gs = get_state();
+  gsmem_entrymap_t::iterator it = gs.entries.find(gsmem_entry_key_t(this, key));
+  if (it == gs.entries.end() || it->second.pinned == pinned)
+    return;
+
+  gsmem_entry_t &e = it->second;
+  dequeue(e);
+  account(e, -1);
+  e.pinned = pinned;
+  account(e, 1);
+  enqueue(e);
+
+  if (!pinned)
+    trim(&e);
+}
+
+//--------------------------------------------------------------------------
+void gsmem_set_budget(uint64 bytes)
+{
+  get_state().budget = bytes;
+  trim();
+}
+
+//--------------------------------------------------------------------------
+uint64 gsmem_get_budget(uint64 *out_used)
+{
+  gsmem_state_t &gs = get_state();
+  if (out_used != NULL)
+    *out_used = gs.used;
+  return gs.budget;
+}
+
+//--------------------------------------------------------------------------
+void gsmem_get_usage(gsmem_usagevec_t &out)
+{
+  gsmem_state_t &gs = get_state();
+  out.qclear();
+  for (gsmem_cachemap_t::iterator it=gs.caches.begin(); it != gs.caches.end(); ++it)
+  {
+    gsmem_usage_t &u = out.push_back();
+    u.name = it->first->get_name();
+    u.bytes = it->second.bytes;
+    u.pinned_bytes = it->second.pinned_bytes;
+    u.entries = it->second.entries;
+    u.evictions = it->second.evictions;
+  }
+}
@@ -0,0 +1,118 @@
+#ifndef __GSMEM__
+#define __GSMEM__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Memory budget module
+
+The caches of GraphSlick (the shared flowcharts with their block text and
+features, the groups query indexes, ...) register with one budget manager.
+Each cache entry is charged with its size and the cost of rebuilding it.
+When the total goes over the budget, the manager evicts the unpinned
+entries with the lowest priority, GreedyDual-Size style:
+
+   priority = clock + cost / size
+
+The clock is raised to the priority of each evicted entry, so the entries
+that were not used for a while age out, and the cheap and large entries go
+first. An entry is pinned while its data is in use (for example a
+flowchart that a view references): it is counted but never evicted.
+
+Must be used from the main thread.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+
+//--------------------------------------------------------------------------
+// Default total budget, in bytes
+#define GSMEM_DEFAULT_BUDGET (uint64(256) << 20)
+
+//--------------------------------------------------------------------------
+/**
+* @brief A cache that registers with the budget manager. Its entries are
+*        identified by a key of its choice
+*/
+class gsmem_cache_t
+{
+  const char *name;
+
+public:
+  /**
+  * @brief Register the cache. The name must be a static string
+  */
+  gsmem_cache_t(const char *name);
+
+  /**
+  * @brief Unregister the cache and forget its entries (they are not evicted)
+  */
+  virtual ~gsmem_cache_t();
+
+  inline const char *get_name() const { return name; }
+
+  /**
+  * @brief Drop an entry. Called by the manager for unpinned entries only;
+  *        the entry is already forgotten by the manager
+  */
+  virtual void evict(uint64 key) = 0;
+
+  /**
+  * @brief Add or resize an entry and mark it as used. Other entries may be
+  *        evicted to stay within the budget
+  * @param bytes - the entry size
+  * @param cost - the work to rebuild the entry (any unit, the same for all the caches)
+  */
+  void charge(uint64 key, size_t bytes, double cost);
+
+  /**
+  * @brief Mark an entry as used
+  */
+  void touch(uint64 key);
+
+  /**
+  * @brief Forget an entry the cache dropped by itself
+  */
+  void uncharge(uint64 key);
+
+  /**
+  * @brief Pin or unpin an entry. Unpinning may evict entries
+  */
+  void pin(uint64 key, bool pinned);
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Usage of one cache
+*/
+struct gsmem_usage_t
+{
+  const char *name;
+  uint64 bytes;
+  uint64 pinned_bytes;
+  int entries;
+  int evictions;
+};
+typedef qvector<gsmem_usage_t> gsmem_usagevec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Set the total budget (in bytes) and evict the entries over it
+*/
+void gsmem_set_budget(uint64 bytes);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Return the total budget and optionally the charged bytes
+*/
+uint64 gsmem_get_budget(uint64 *used = NULL);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Return the usage of each registered cache
+*/
+void gsmem_get_usage(gsmem_usagevec_t &out);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __GSPRIMES__
+#define __GSPRIMES__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Prime numbers table
+
+The Python matcher hashes the instructions with products of primes (one
+prime per instruction type and per operand type). The primes used to be
+generated and pickled to 'Primes%08d.cache' on the first run; they are now
+a native table exposed by the 'gsnative' module (see pygsnative.cpp).
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+
+//--------------------------------------------------------------------------
+// Count of primes in the table (the count the matcher uses)
+#define GS_PRIMES_COUNT 8117
+
+//--------------------------------------------------------------------------
+/**
+* @brief The first GS_PRIMES_COUNT primes: 2, 3, 5, ...
+*/
+extern const uint32 gs_primes[GS_PRIMES_COUNT];
+
+#endif
@@ -0,0 +1,419 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - fix: stop() runs the pending tasks and completions instead of deleting them
+--------------------------------------------------------------------------*/
+
+#include "gssched.h"
+#include <thread>
+#include <limits.h>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+enum gstask_state_e
+{
+  gts_queued,
+  gts_running,
+  gts_finished,
+};
+
+//--------------------------------------------------------------------------
+struct gstask_t
+{
+  gssched_prio_e prio;
+
+  // The priority it was started with (worker tasks)
+  gssched_prio_e run_prio;
+
+  gstask_cb_t run;
+  gstask_cb_t done;
+  void *ud;
+  bool on_main;
+  gstask_state_e state;
+  bool canceled;
+};
+
+//--------------------------------------------------------------------------
+gssched_t::gssched_t(): interactive_depth(0), stopping(false)
+{
+  running[gsp_interactive] = running[gsp_background] = 0;
+}
+
+//--------------------------------------------------------------------------
+gssched_t::~gssched_t()
+{
+  stop();
+}
+
+//--------------------------------------------------------------------------
+int idaapi gssched_t::s_worker(void *ud)
+{
+  ((gssched_t *)ud)->worker();
+  return 0;
+}
+
+//--------------------------------------------------------------------------
+bool gssched_t::start(int nworkers)
+{
+  if (!workers.empty())
+    return true;
+
+  if (nworkers <= 0)
+    nworkers = qmin(int(std::thread::hardware_concurrency()), 4);
+
+  // One worker is reserved for the interactive tasks
+  nworkers = qmax(nworkers, 2);
+
+  stopping = false;
+  for (int i=0; i < nworkers; i++)
+  {
+    qthread_t t = qthread_create(s_worker, this);
+    if (t == NULL)
+      break;
+    workers.push_back(t);
+  }
+
+  if (workers.size() >= 2)
+    return true;
+
+  stop();
+  return false;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Run the queued tasks and all the completions until no task is left
+*        (main thread). Their owners get their completions, as usual
+*/
+void gssched_t::drain()
+{
+  for ( ;; )
+  {
+    pump(INT_MAX);
+
+    std::unique_lock<std::mutex> lk(lock);
+    for ( ;; )
+    {
+      bool main_pending = !main_q[gsp_interactive].empty() || !main_q[gsp_background].empty();
+      if (main_pending)
+        break;
+
+      bool worker_pending =    !worker_q[gsp_interactive].empty()
+                            || !worker_q[gsp_background].empty()
+                            || running[gsp_interactive] > 0
+                            || running[gsp_background] > 0;
+      if (!worker_pending)
+        return;
+
+      state_cv.wait(lk);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------
+void gssched_t::stop()
+{
+  if (workers.empty())
+    return;
+
+  // The owners hold the task handles and a queued save must not be lost:
+  // finish everything before the workers go away
+  drain();
+
+  {
+    std::unique_lock<std::mutex> lk(lock);
+    stopping = true;
+    work_cv.notify_all();
+    state_cv.notify_all();
+  }
+
+  for (size_t i=0; i < workers.size(); i++)
+  {
+    qthread_join(workers[i]);
+    qthread_free(workers[i]);
+  }
+  workers.qclear();
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Next task for a worker: the interactive ones first, the background
+*        ones only if a worker is left for the interactive ones
+*/
+gstask_t *gssched_t::pick_task()
+{
+  taskq_t *q = NULL;
+  if (!worker_q[gsp_interactive].empty())
+    q = &worker_q[gsp_interactive];
+  else if (   !worker_q[gsp_background].empty()
+           && running[gsp_background] < int(workers.size()) - 1)
+    q = &worker_q[gsp_background];
+
+  if (q == NULL)
+    return NULL;
+
+  gstask_t *task = q->front();
+  q->pop_front();
+  return task;
+}
+
+//--------------------------------------------------------------------------
+void gssched_t::worker()
+{
+  std::unique_lock<std::mutex> lk(lock);
+  while (!stopping)
+  {
+    gstask_t *task = pick_task();
+    if (task == NULL)
+    {
+      work_cv.wait(lk);
+      continue;
+    }
+
+    task->state = gts_running;
+    task->run_prio = task->prio;
+    ++running[task->run_prio];
+
+    lk.unlock();
+    task->run(task, task->ud);
+    lk.lock();
+
+    --running[task->run_prio];
+    task->state = gts_finished;
+
+    // The completion runs on the main thread
+    main_q[task->prio].push_back(task);
+
+    state_cv.notify_all();
+
+    // A background slot may be free
+    work_cv.notify_all();
+  }
+}
+
+//--------------------------------------------------------------------------
+bool gssched_t::is_interactive_pending_locked()
+{
+  return    interactive_depth > 0
+         || running[gsp_interactive] > 0
+         || !worker_q[gsp_interactive].empty()
+         || !main_q[gsp_interactive].empty();
+}
+
+//--------------------------------------------------------------------------
+bool gssched_t::is_interactive_pending()
+{
+  std::unique_lock<std::mutex> lk(lock);
+  return is_interactive_pending_locked();
+}
+
+//--------------------------------------------------------------------------
+bool gssched_t::remove_from(taskq_t &q, gstask_t *task)
+{
+  taskq_t::iterator it = std::find(q.begin(), q.end(), task);
+  if (it == q.end())
+    return false;
+
+  q.erase(it);
+  return true;
+}
+
+//--------------------------------------------------------------------------
+gstask_t *gssched_t::new_task(
+    gssched_prio_e prio,
+    gstask_cb_t run,
+    gstask_cb_t done,
+    void *ud,
+    bool on_main)
+{
+  gstask_t *task = new gstask_t();
+  task->prio = task->run_prio = prio;
+  task->run = run;
+  task->done = done;
+  task->ud = ud;
+  task->on_main = on_main;
+  task->state = gts_queued;
+  task->canceled = false;
+  return task;
+}
+
+//--------------------------------------------------------------------------
+gstask_t *gssched_t::post(
+    gssched_prio_e prio,
+    gstask_cb_t run,
+    gstask_cb_t done,
+    void *ud)
+{
+  if (!start())
+    return NULL;
+
+  gstask_t *task = new_task(prio, run, done, ud, false);
+
+  std::unique_lock<std::mutex> lk(lock);
+  worker_q[prio].push_back(task);
+  work_cv.notify_all();
+  return task;
+}
+
+//--------------------------------------------------------------------------
+gstask_t *gssched_t::post_main(
+    gssched_prio_e prio,
+    gstask_cb_t run,
+    void *ud)
+{
+  gstask_t *task = new_task(prio, run, NULL, ud, true);
+
+  std::unique_lock<std::mutex> lk(lock);
+  main_q[prio].push_back(task);
+  return task;
+}
+
+//--------------------------------------------------------------------------
+bool gssched_t::yield(gstask_t *task)
+{
+  std::unique_lock<std::mutex> lk(lock);
+  while (   task->prio == gsp_background
+         && !task->canceled
+         && !stopping
+         && is_interactive_pending_locked())
+  {
+    state_cv.wait(lk);
+  }
+  return !task->canceled && !stopping;
+}
+
+//--------------------------------------------------------------------------
+bool gssched_t::is_canceled(gstask_t *task)
+{
+  std::unique_lock<std::mutex> lk(lock);
+  return task->canceled || stopping;
+}
+
+//--------------------------------------------------------------------------
+void gssched_t::cancel(gstask_t *task)
+{
+  std::unique_lock<std::mutex> lk(lock);
+  task->canceled = true;
+  state_cv.notify_all();
+
+  if (task->state == gts_queued)
+  {
+    taskq_t *qs = task->on_main ? main_q : worker_q;
+    remove_from(qs[task->prio], task);
+  }
+  else
+  {
+    while (task->state != gts_finished)
+      state_cv.wait(lk);
+    remove_from(main_q[task->prio], task);
+  }
+  delete task;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Move a task to the interactive class. Called with the lock held
+*/
+void gssched_t::promote(gstask_t *task)
+{
+  if (task->prio == gsp_interactive)
+    return;
+
+  if (task->state != gts_running)
+  {
+    taskq_t *qs = task->on_main || task->state == gts_finished ? main_q : worker_q;
+    if (remove_from(qs[gsp_background], task))
+      qs[gsp_interactive].push_front(task);
+  }
+  task->prio = gsp_interactive;
+
+  // A yielding task may resume
+  state_cv.notify_all();
+  work_cv.notify_all();
+}
+
+//--------------------------------------------------------------------------
+void gssched_t::wait(gstask_t *task)
+{
+  std::unique_lock<std::mutex> lk(lock);
+  promote(task);
+
+  if (task->on_main)
+  {
+    remove_from(main_q[task->prio], task);
+  }
+  else
+  {
+    while (task->state != gts_finished)
+      state_cv.wait(lk);
+    remove_from(main_q[task->prio], task);
+  }
+  lk.unlock();
+
+  if (task->on_main)
+    task->run(task, task->ud);
+  else if (task->done != NULL)
+    task->done(task, task->ud);
+
+  delete task;
+}
+
+//--------------------------------------------------------------------------
+void gssched_t::enter_interactive()
+{
+  std::unique_lock<std::mutex> lk(lock);
+  ++interactive_depth;
+}
+
+//--------------------------------------------------------------------------
+void gssched_t::leave_interactive()
+{
+  std::unique_lock<std::mutex> lk(lock);
+  if (--interactive_depth == 0)
+    state_cv.notify_all();
+}
+
+//--------------------------------------------------------------------------
+bool gssched_t::pump(int slice_ms)
+{
+  uint64 deadline = get_nsec_stamp() + uint64(slice_ms) * 1000000;
+  for ( ;; )
+  {
+    gstask_t *task;
+    {
+      std::unique_lock<std::mutex> lk(lock);
+      if (!main_q[gsp_interactive].empty())
+      {
+        task = main_q[gsp_interactive].front();
+        main_q[gsp_interactive].pop_front();
+      }
+      else if (   !main_q[gsp_background].empty()
+               && !is_interactive_pending_locked()
+               && get_nsec_stamp() < deadline)
+      {
+        task = main_q[gsp_background].front();
+        main_q[gsp_background].pop_front();
+      }
+      else
+      {
+        // Anything left?
+        for (int p=0; p < 2; p++)
+        {
+          if (!worker_q[p].empty() || !main_q[p].empty() || running[p] > 0)
+            return true;
+        }
+        return false;
+      }
+    }
+
+    // Main thread task or completion of a worker task
+    if (task->on_main)
+      task->run(task, task->ud);
+    else if (task->done != NULL)
+      task->done(task, task->ud);
+
+    delete task;
+  }
+}
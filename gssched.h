@@ -0,0 +1,194 @@
+#ifndef __GSSCHED__
+#define __GSSCHED__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Task scheduler module
+
+Runs the plugin's work in two priority classes:
+
+  - interactive: what a user action waits for (loading the file the user
+    picked, ...)
+  - background: the rest (saving, reloading, analyzing, ...)
+
+The tasks run on a small worker pool. One worker is reserved for the
+interactive tasks, so an interactive task starts right away even when all
+the other workers are busy with background tasks. The background tasks
+call yield() at their preemption points: it blocks them while interactive
+work is pending (queued, running, or a user action handled on the main
+thread, see gssched_scope_t).
+
+The completions of the worker tasks and the main thread tasks run from
+pump(), which the plugin calls from an IDA timer: the interactive ones
+all, the background ones within a time slice and only when no interactive
+work is pending.
+
+The tasks never call the IDA kernel from the workers.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+//--------------------------------------------------------------------------
+enum gssched_prio_e
+{
+  gsp_interactive,
+  gsp_background,
+};
+
+struct gstask_t;
+typedef void (idaapi *gstask_cb_t)(gstask_t *task, void *ud);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Task scheduler
+*/
+class gssched_t
+{
+  typedef std::deque<gstask_t *> taskq_t;
+
+  std::mutex lock;
+
+  // Signaled when a worker may pick a task
+  std::condition_variable work_cv;
+
+  // Signaled when a task finishes or the interactive work drops
+  std::condition_variable state_cv;
+
+  // Worker tasks waiting to run, by priority
+  taskq_t worker_q[2];
+
+  // Main thread tasks and completions waiting for pump(), by priority
+  taskq_t main_q[2];
+
+  // Running worker tasks, by the priority they were started with
+  int running[2];
+
+  // Nesting of the user actions handled on the main thread
+  int interactive_depth;
+
+  qvector<qthread_t> workers;
+  bool stopping;
+
+  static int idaapi s_worker(void *ud);
+  void worker();
+  gstask_t *pick_task();
+  bool is_interactive_pending_locked();
+  bool remove_from(taskq_t &q, gstask_t *task);
+  gstask_t *new_task(gssched_prio_e prio, gstask_cb_t run, gstask_cb_t done, void *ud, bool on_main);
+  void promote(gstask_t *task);
+  void drain();
+
+  gssched_t(const gssched_t &);
+  gssched_t &operator=(const gssched_t &);
+
+public:
+  gssched_t();
+  ~gssched_t();
+
+  /**
+  * @brief Start the workers (at least two). Called on the first post()
+  * @param nworkers - 0 for the count of processors
+  */
+  bool start(int nworkers = 0);
+
+  /**
+  * @brief Run the pending tasks and their completions, then stop the
+  *        workers (main thread). No handle is released behind its owner's
+  *        back: the owners of the tasks that do not end by themselves (the
+  *        streamed analysis) must cancel them first
+  */
+  void stop();
+
+  /**
+  * @brief Post a task to run on a worker. 'done' (optional) runs on the main
+  *        thread from pump() once 'run' returns, unless the task was canceled.
+  *        The task handle is valid until 'done' is called or the task is
+  *        canceled
+  * @return The task or NULL if the workers could not start
+  */
+  gstask_t *post(
+      gssched_prio_e prio,
+      gstask_cb_t run,
+      gstask_cb_t done,
+      void *ud);
+
+  /**
+  * @brief Post a task to run on the main thread from pump()
+  */
+  gstask_t *post_main(
+      gssched_prio_e prio,
+      gstask_cb_t run,
+      void *ud);
+
+  /**
+  * @brief Preemption point of the running tasks: the background tasks wait
+  *        here while interactive work is pending
+  * @return False if the task was canceled: it should return
+  */
+  bool yield(gstask_t *task);
+
+  /**
+  * @brief Whether the task was canceled (from the task)
+  */
+  bool is_canceled(gstask_t *task);
+
+  /**
+  * @brief Cancel a task (main thread). A queued task is dropped, a running
+  *        one is waited for. 'done' is not called and the handle is released
+  */
+  void cancel(gstask_t *task);
+
+  /**
+  * @brief Wait for a task and call its 'done' (main thread). The task is
+  *        promoted to the interactive class: the user is waiting for it.
+  *        The handle is released
+  */
+  void wait(gstask_t *task);
+
+  /**
+  * @brief Mark a user action handled on the main thread (main thread)
+  */
+  void enter_interactive();
+  void leave_interactive();
+
+  /**
+  * @brief Whether interactive work is queued or running
+  */
+  bool is_interactive_pending();
+
+  /**
+  * @brief Run the completions and the main thread tasks (main thread)
+  * @param slice_ms - the time given to the background ones
+  * @return False if no task is left
+  */
+  bool pump(int slice_ms);
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Marks a user action for the lifetime of the object
+*/
+class gssched_scope_t
+{
+  gssched_t *sched;
+
+public:
+  gssched_scope_t(gssched_t *sched): sched(sched)
+  {
+    sched->enter_interactive();
+  }
+
+  ~gssched_scope_t()
+  {
+    sched->leave_interactive();
+  }
+};
+
+#endif
@@ -0,0 +1,239 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version, it comes from the graph
+                                  builders of the algorithms module
+--------------------------------------------------------------------------*/
+
+#include "gsview.h"
+
+//--------------------------------------------------------------------------
+/**
+* @brief Append the disassembly text of a block
+*/
+static void append_block_text(
+    gsdb_t *db,
+    const gsdb_fc_t &fc,
+    const qstrvec_t *block_text,
+    int nid,
+    qstring *out)
+{
+  if (block_text != NULL)
+  {
+    out->append((*block_text)[nid]);
+  }
+  else
+  {
+    const gsdb_block_t &block = fc.blocks[nid];
+    db->get_disasm_text(block.start, block.end, out);
+  }
+}
+
+//--------------------------------------------------------------------------
+void gsview_build_single(
+    gsdb_t *db,
+    const gsdb_fc_t &fc,
+    bool append_node_id,
+    const qstrvec_t *block_text,
+    gsview_t &view)
+{
+  int nodes_count = fc.size();
+  view.clear();
+  view.nodes.resize(nodes_count);
+  view.succs.resize(nodes_count);
+
+  for (int nid=0; nid < nodes_count; nid++)
+  {
+    gnode_t &nc = view.nodes[nid];
+    nc.id = nid;
+
+    // Append node ID to the output
+    if (append_node_id)
+      nc.text.sprnt("ID(%d)\n", nid);
+
+    append_block_text(db, fc, block_text, nid, &nc.text);
+
+    view.succs[nid] = fc.blocks[nid].succ;
+  }
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Builds the combined view. A class is used to simulate the nested
+*        functions needed by the combine algo
+*/
+class combined_view_builder_t
+{
+  gsdb_t *db;
+  const gsdb_fc_t &fc;
+  groupman_t *gm;
+  const qstrvec_t *block_text;
+  ng2nid_t &group2id;
+  gsview_t &view;
+
+  /**
+  * @brief Create and return a groupped node ID
+  */
+  int get_groupid(int n)
+  {
+    // Find how this single node is defined in the group manager
+    nodeloc_t *loc = gm->find_nodeid_loc(n);
+    if (loc == NULL)
+      return -1;
+
+    // Does this node have a group yet? (ndl)
+    ng2nid_t::iterator it = group2id.find(loc->ng);
+    if (it != group2id.end())
+      return it->second;
+
+    // Assign an auto-increment id
+    int group_id = int(group2id.size());
+    group2id[loc->ng] = group_id;
+
+    if (group_id >= int(view.nodes.size()))
+    {
+      view.nodes.resize(group_id + 1);
+      view.succs.resize(group_id + 1);
+    }
+
+    // Initialize this group's node
+    gnode_t &gn = view.nodes[group_id];
+    gn.id = group_id;
+    for (nodegroup_t::iterator it=loc->ng->begin();
+         it != loc->ng->end();
+         ++it)
+    {
+      append_block_text(db, fc, block_text, (*it)->nid, &gn.hint);
+    }
+
+    // Are there any groupped nodes?
+    if (loc->ng->size() > 1)
+    {
+      //TODO: OPTION: enlarge groupped label
+      gn.text.append("\n\n\n");
+
+      // Display the group name or the group id
+      gn.text.append(loc->sg->get_display_name());
+
+      gn.text.append("\n\n\n");
+    }
+    else
+    {
+      gn.text = gn.hint;
+    }
+    return group_id;
+  }
+
+public:
+  combined_view_builder_t(
+      gsdb_t *db,
+      const gsdb_fc_t &fc,
+      groupman_t *gm,
+      const qstrvec_t *block_text,
+      ng2nid_t &group2id,
+      gsview_t &view)
+    : db(db), fc(fc), gm(gm), block_text(block_text), group2id(group2id), view(view)
+  {
+  }
+
+  bool build()
+  {
+    // The node count of the combined view is the count of node groups
+    size_t node_count = 0;
+    for (supergroup_listp_t::iterator it=gm->get_path_sgl()->begin();
+         it != gm->get_path_sgl()->end();
+         ++it)
+    {
+      psupergroup_t sg = *it;
+      node_count += sg->gcount();
+    }
+
+    view.clear();
+    view.nodes.resize(node_count);
+    view.succs.resize(node_count);
+
+    for (int nid=0, snodes_count=fc.size(); nid < snodes_count; nid++)
+    {
+      // Figure out the combined node ID
+      int group_id = get_groupid(nid);
+      if (group_id == -1)
+        return false;
+
+      // Build the edges
+      for (int isucc=0, succ_sz=fc.nsucc(nid); isucc < succ_sz; isucc++)
+      {
+        // This node belongs to the same group?
+        int succ_grid = get_groupid(fc.succ(nid, isucc));
+        if (succ_grid == -1)
+          return false;
+
+        // Consider as one node
+        if (succ_grid == group_id)
+          continue;
+
+        view.succs[group_id].push_back(succ_grid);
+      }
+    }
+    return true;
+  }
+};
+
+//--------------------------------------------------------------------------
+bool gsview_build_combined(
+    gsdb_t *db,
+    const gsdb_fc_t &fc,
+    groupman_t *gm,
+    const qstrvec_t *block_text,
+    ng2nid_t &group2id,
+    gsview_t &view)
+{
+  combined_view_builder_t builder(db, fc, gm, block_text, group2id, view);
+  return builder.build();
+}
+
+//--------------------------------------------------------------------------
+void gsview_sanitize_groupman(
+    const gsdb_fc_t &fc,
+    groupman_t *gm)
+{
+  // Create a group for all potentially missing nodes
+  psupergroup_t missing_sg = new supergroup_t();
+
+  nid2ndef_t *nds = gm->get_nds();
+
+  // Verify that all nodes are present
+  for (int n=0, nodes_count=fc.size(); n < nodes_count; n++)
+  {
+    if (nds->find(n) != nds->end())
+      continue;
+
+    // Convert basic block to an ND
+    const gsdb_block_t &block = fc.blocks[n];
+    pnodedef_t nd = new nodedef_t();
+    nd->nid = n;
+    nd->start = block.start;
+    nd->end = block.end;
+
+    // Add the node to its own group
+    pnodegroup_t ng = missing_sg->add_nodegroup();
+    ng->add_node(nd);
+  }
+
+  if (missing_sg->gcount() == 0)
+  {
+    // No orphan nodes where found, get rid of the group
+    delete missing_sg;
+    return;
+  }
+
+  // Found at least one orphan node, add it to the groupman
+  missing_sg->name = missing_sg->id = "orphan_nodes";
+
+  // This is a synthetic group
+  missing_sg->is_synthetic = true;
+
+  gm->add_supergroup(
+        gm->get_path_sgl(),
+        missing_sg);
+}
@@ -0,0 +1,78 @@
+#ifndef __GSVIEW__
+#define __GSVIEW__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Function view module
+
+The IDA independent part of the graph views: the nodes (text and hint)
+and the edges of the single and combined views of a function, built from
+its flowchart and groupman through the database queries (see gsdb.h).
+The plugin copies a view into the graph viewer's mutable graph (see
+func_to_mgraph() and fc_to_combined_mg in algo.hpp); the headless runs
+use it as is.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include "gsdb.h"
+#include "groupman.h"
+#include "types.hpp"
+
+//--------------------------------------------------------------------------
+/**
+* @brief The nodes and edges of a view. The node ids are the indexes
+*/
+struct gsview_t
+{
+  qvector<gnode_t> nodes;
+  qvector<intvec_t> succs;
+
+  void clear()
+  {
+    nodes.qclear();
+    succs.qclear();
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Build the single view: one node per block
+* @param block_text - optional: the disassembly text of each block
+*/
+void gsview_build_single(
+    gsdb_t *db,
+    const gsdb_fc_t &fc,
+    bool append_node_id,
+    const qstrvec_t *block_text,
+    gsview_t &view);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Build the combined view: one node per node group
+* @param group2id - the node id of each node group
+* @param block_text - optional: the disassembly text of each block
+* @return False if a block is not in the groupman
+*/
+bool gsview_build_combined(
+    gsdb_t *db,
+    const gsdb_fc_t &fc,
+    groupman_t *gm,
+    const qstrvec_t *block_text,
+    ng2nid_t &group2id,
+    gsview_t &view);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Add the blocks missing from the groupman to the synthetic orphan
+*        nodes super group
+*/
+void gsview_sanitize_groupman(
+    const gsdb_fc_t &fc,
+    groupman_t *gm);
+
+#endif
@@ -0,0 +1,450 @@
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Headless analyzer
+
+Runs the native grouping pipeline (repeated paths engine or frequent
+subgraphs miner) on a database
+snapshot exported by the plugin ("Export database snapshot") without IDA,
+and writes one bbgroup file per function that has groups. The file names
+follow the plugin's convention (<idb root>-<function ea>.bbgroup) so the
+plugin picks them up when the function is opened.
+
+Usage: headless <snapshot file> [output directory] [min blocks] [paths|mine] [bench file]
+       headless --flows <recording> <bbgroup directory> [output directory] [bench file]
+
+The timings of the engines on a whole database can be compared by running
+it once per engine.
+
+It is built with headless.vcxproj on Windows and headless.mak on Linux;
+both modes, --flows included, need no IDA kernel on either.
+
+With a bench file, each written file is also parsed back and its groups
+quotient graph is built, and the stages (load, analyze, build, emit,
+parse, initialize_lookups, quotient) are measured with the hardware
+counters and the peak RSS (see gsbench.h). The results are written to the
+bench file as JSON.
+
+With --flows, the plugin's user flows are replayed on a database recording
+("Record database for headless runs", see gsdb.h) instead of IDA, for each
+function that has a bbgroup file in the given directory: load the file
+and sanitize it against the flowchart, switch to the single and combined
+views, combine the two groups of the first edge between groups, and save.
+The stages (flow_load, flow_switch_view, flow_combine, flow_save) are
+measured like the analysis ones.
+
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - Emit the flowchart fingerprint
+                                - Added the frequent subgraphs miner engine
+                                - Added the benchmark stages
+                                - Added the --flows mode replaying the plugin's user flows on a database recording
+                                - fix: tell why the hardware counters are unavailable
+                                - fix: both modes build on Linux (headless.mak)
+--------------------------------------------------------------------------*/
+
+#include <time.h>
+#include "groupman.h"
+#include "snapshot.h"
+#include "repaths.h"
+#include "fsgminer.h"
+#include "grouptree.h"
+#include "gsbench.h"
+#include "gsdb.h"
+#include "gsview.h"
+
+//--------------------------------------------------------------------------
+#define BBGROUP_EXT "bbgroup"
+
+//--------------------------------------------------------------------------
+/**
+* @brief Build the groupman from the repeated paths result and the function
+*        features. Same layout as build_groupman_from_3dvec() followed by sanitize_groupman()
+*/
+static void build_groupman_from_features(
+  const func_features_t &ff,
+  int_3dvec_t &path,
+  groupman_t *gm)
+{
+  gm->clear();
+
+  int sg_id = 0;
+  for (int_3dvec_t::iterator it_sg=path.begin();
+       it_sg != path.end();
+       ++it_sg, ++sg_id)
+  {
+    psupergroup_t sg = gm->add_supergroup();
+    sg->id.sprnt("ID_%d", sg_id);
+    sg->name.sprnt("SG_%d", sg_id);
+    sg->is_synthetic = false;
+
+    int_2dvec_t &ng_vec = *it_sg;
+    for (int_2dvec_t::iterator it_ng=ng_vec.begin();
+         it_ng != ng_vec.end();
+         ++it_ng)
+    {
+      pnodegroup_t ng = sg->add_nodegroup();
+      intvec_t &nodes_vec = *it_ng;
+      for (intvec_t::iterator it_nd=nodes_vec.begin();
+           it_nd != nodes_vec.end();
+           ++it_nd)
+      {
+        int nid = *it_nd;
+        pnodedef_t nd = ng->add_node();
+        nd->nid = nid;
+        nd->start = ff.blocks[nid].start;
+        nd->end = ff.blocks[nid].end;
+        gm->map_nodedef(nid, nd);
+      }
+    }
+  }
+
+  // The nodes that are not in a path go to the synthetic orphan nodes SG
+  psupergroup_t missing_sg = NULL;
+  nid2ndef_t *nds = gm->get_nds();
+  for (int nid=0, nsize=int(ff.blocks.size()); nid < nsize; nid++)
+  {
+    if (nds->find(nid) != nds->end())
+      continue;
+
+    if (missing_sg == NULL)
+    {
+      missing_sg = gm->add_supergroup();
+      missing_sg->name = missing_sg->id = "orphan_nodes";
+      missing_sg->is_synthetic = true;
+    }
+
+    pnodedef_t nd = missing_sg->add_nodegroup()->add_node();
+    nd->nid = nid;
+    nd->start = ff.blocks[nid].start;
+    nd->end = ff.blocks[nid].end;
+  }
+  gm->initialize_lookups();
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Same fingerprint as get_fc_fingerprint() but from the function features
+*/
+static uint64 get_features_fingerprint(const func_features_t &ff)
+{
+  fc_fingerprint_t fp(int(ff.blocks.size()));
+  for (size_t i=0; i < ff.blocks.size(); i++)
+  {
+    const bbfeat_block_t &bb = ff.blocks[i];
+    fp.add_block(bb.start, bb.end, int(bb.succ.size()));
+    for (size_t k=0; k < bb.succ.size(); k++)
+      fp.add_succ(bb.succ[k]);
+  }
+  return fp.value();
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Return the file name part of a path coming from any platform
+*/
+static const char *get_file_part(const char *path)
+{
+  const char *p = path;
+  for (const char *s=path; *s != '\0'; s++)
+  {
+    if (*s == '/' || *s == '\\')
+      p = s + 1;
+  }
+  return p;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Measure the plugin side stages on a written file: parse it back,
+*        build its lookups and the quotient graph of its top level groups
+*/
+static void bench_file_stages(
+  gsbench_t *bench,
+  const func_features_t &ff,
+  const char *filename)
+{
+  groupman_t gm;
+  {
+    gsbench_scope_t scope(bench, "parse");
+    if (!gm.parse(filename, false))
+      return;
+  }
+
+  {
+    gsbench_scope_t scope(bench, "initialize_lookups");
+    gm.initialize_lookups();
+  }
+
+  gsbench_scope_t scope(bench, "quotient");
+  qvector<intvec_t> succs;
+  succs.resize(ff.blocks.size());
+  for (size_t i=0; i < ff.blocks.size(); i++)
+    succs[i] = ff.blocks[i].succ;
+
+  group_tree_t tree;
+  tree.build_from(&gm);
+
+  intvec_t cut;
+  tree.get_level_cut(1, cut);
+
+  gt_quotient_t q;
+  tree.build_quotient(cut, succs, q);
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Replay the user flows of the plugin on a function
+* @return False if the function has no bbgroup file
+*/
+static bool replay_func_flows(
+  gsbench_t *bench,
+  gsdb_t *db,
+  ea_t func_ea,
+  const char *bbgroup_dir,
+  const char *out_dir)
+{
+  qstring db_name;
+  db->get_db_name(&db_name);
+  const char *db_root = get_file_part(db_name.c_str());
+
+  qstring fn;
+  fn.sprnt("%s/%s-%08a.%s", bbgroup_dir, db_root, func_ea, BBGROUP_EXT);
+  if (!qfileexist(fn.c_str()))
+    return false;
+
+  // Load: same steps as the plugin's asynchronous load
+  gsdb_fc_t fc;
+  groupman_t gm;
+  {
+    gsbench_scope_t scope(bench, "flow_load");
+    if (!db->get_flowchart(func_ea, fc) || !gm.parse(fn.c_str(), false))
+      return false;
+
+    if (!gm.matches_flowchart(fc.fingerprint(), fc.size()))
+      gsview_sanitize_groupman(fc, &gm);
+    gm.initialize_lookups();
+  }
+
+  // Show the single view then switch to the combined view
+  gsview_t view;
+  ng2nid_t ng2id;
+  {
+    gsbench_scope_t scope(bench, "flow_switch_view");
+    gsview_build_single(db, fc, false, NULL, view);
+    gsview_build_combined(db, fc, &gm, NULL, ng2id, view);
+  }
+
+  // Combine the two groups of the first edge crossing groups, in the
+  // combined view (the view is rebuilt like the plugin does)
+  {
+    gsbench_scope_t scope(bench, "flow_combine");
+    nodegroup_list_t ngl;
+    for (int nid=0, n=fc.size(); nid < n && ngl.empty(); nid++)
+    {
+      nodeloc_t *loc = gm.find_nodeid_loc(nid);
+      for (int i=0, nsucc=fc.nsucc(nid); loc != NULL && i < nsucc; i++)
+      {
+        nodeloc_t *succ_loc = gm.find_nodeid_loc(fc.succ(nid, i));
+        if (succ_loc != NULL && succ_loc->ng != loc->ng)
+        {
+          ngl.push_back(loc->ng);
+          ngl.push_back(succ_loc->ng);
+          break;
+        }
+      }
+    }
+
+    if (!ngl.empty() && gm.combine_ngl(&ngl) != NULL)
+    {
+      ng2id.clear();
+      gsview_build_combined(db, fc, &gm, NULL, ng2id, view);
+    }
+  }
+
+  // Save next to the other output files
+  {
+    gsbench_scope_t scope(bench, "flow_save");
+    fn.sprnt("%s/%s-%08a.%s", out_dir, db_root, func_ea, BBGROUP_EXT);
+    if (!gm.emit_append(fn.c_str()))
+      printf("Failed to write '%s'\n", fn.c_str());
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief The --flows mode
+*/
+static int replay_flows(int argc, char *argv[])
+{
+  if (argc < 4)
+  {
+    printf("Usage: %s --flows <recording> <bbgroup directory> [output directory] [bench file]\n", argv[0]);
+    return -1;
+  }
+
+  const char *rec_file = argv[2];
+  const char *bbgroup_dir = argv[3];
+  const char *out_dir = argc > 4 ? argv[4] : ".";
+  const char *bench_file = argc > 5 ? argv[5] : NULL;
+  gsbench_t *bench = bench_file != NULL ? new gsbench_t() : NULL;
+  if (bench != NULL && !bench->has_counters())
+    printf("Hardware counters are not available (%s), measuring the time and memory only\n", bench->counters_error());
+
+  clock_t t0 = clock();
+
+  gsdb_rec_t db;
+  bool loaded;
+  {
+    gsbench_scope_t scope(bench, "load");
+    loaded = db.load(rec_file);
+  }
+  if (!loaded)
+  {
+    printf("Failed to load recording '%s'\n", rec_file);
+    delete bench;
+    return -1;
+  }
+
+  clock_t t1 = clock();
+
+  int nreplayed = 0;
+  for (size_t i=0, n=db.get_func_qty(); i < n; i++)
+  {
+    if (replay_func_flows(bench, &db, db.getn_func(i), bbgroup_dir, out_dir))
+      ++nreplayed;
+  }
+
+  clock_t t2 = clock();
+  printf("%d function(s) loaded in %.3fs, flows replayed on %d function(s) in %.3fs\n",
+    int(db.get_func_qty()),
+    double(t1 - t0) / CLOCKS_PER_SEC,
+    nreplayed,
+    double(t2 - t1) / CLOCKS_PER_SEC);
+
+  if (bench != NULL)
+  {
+    qstring title;
+    title.sprnt("%s (flows)", rec_file);
+    if (bench->write_json(bench_file, title.c_str()))
+      printf("Benchmark results written to '%s'\n", bench_file);
+    else
+      printf("Failed to write '%s'\n", bench_file);
+    delete bench;
+  }
+
+  return 0;
+}
+
+//--------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  if (argc > 1 && strcmp(argv[1], "--flows") == 0)
+    return replay_flows(argc, argv);
+
+  if (argc < 2)
+  {
+    printf("Usage: %s <snapshot file> [output directory] [min blocks] [paths|mine] [bench file]\n", argv[0]);
+    printf("       %s --flows <recording> <bbgroup directory> [output directory] [bench file]\n", argv[0]);
+    return -1;
+  }
+
+  const char *out_dir = argc > 2 ? argv[2] : ".";
+  repath_params_t params;
+  fsg_params_t mine_params;
+  if (argc > 3)
+    params.min_blocks = mine_params.min_blocks = atoi(argv[3]);
+
+  bool mine = argc > 4 && strcmp(argv[4], "mine") == 0;
+
+  const char *bench_file = argc > 5 ? argv[5] : NULL;
+  gsbench_t *bench = bench_file != NULL ? new gsbench_t() : NULL;
+  if (bench != NULL && !bench->has_counters())
+    printf("Hardware counters are not available (%s), measuring the time and memory only\n", bench->counters_error());
+
+  clock_t t0 = clock();
+
+  qstring db_name;
+  func_featvec_t funcs;
+  bool loaded;
+  {
+    gsbench_scope_t scope(bench, "load");
+    loaded = snapshot_load(argv[1], &db_name, funcs);
+  }
+  if (!loaded)
+  {
+    printf("Failed to load snapshot '%s'\n", argv[1]);
+    delete bench;
+    return -1;
+  }
+
+  clock_t t1 = clock();
+
+  int nfiles = 0, ngroups = 0;
+  for (size_t i=0; i < funcs.size(); i++)
+  {
+    func_features_t &ff = funcs[i];
+
+    int_3dvec_t result;
+    size_t nsg;
+    {
+      gsbench_scope_t scope(bench, "analyze");
+      nsg = mine ? mine_frequent_subgraphs(ff, mine_params, result)
+                 : find_repeated_paths(ff, params, result);
+    }
+    if (nsg == 0)
+      continue;
+
+    groupman_t gm;
+    {
+      gsbench_scope_t scope(bench, "build");
+      build_groupman_from_features(ff, result, &gm);
+      gm.fingerprint = get_features_fingerprint(ff);
+    }
+
+    qstring fn;
+    fn.sprnt("%s/%s-%08a.%s", out_dir, get_file_part(db_name.c_str()), ff.ea, BBGROUP_EXT);
+    bool emitted;
+    {
+      gsbench_scope_t scope(bench, "emit");
+      emitted = gm.emit(fn.c_str());
+    }
+    if (!emitted)
+    {
+      printf("Failed to write '%s'\n", fn.c_str());
+      continue;
+    }
+
+    ++nfiles;
+    ngroups += int(result.size());
+
+    if (bench != NULL)
+      bench_file_stages(bench, ff, fn.c_str());
+  }
+
+  clock_t t2 = clock();
+  printf("%d function(s) loaded in %.3fs, %s: %d group(s) in %d file(s) written in %.3fs\n",
+    int(funcs.size()),
+    double(t1 - t0) / CLOCKS_PER_SEC,
+    mine ? "miner" : "paths",
+    ngroups,
+    nfiles,
+    double(t2 - t1) / CLOCKS_PER_SEC);
+
+  if (bench != NULL)
+  {
+    qstring title;
+    title.sprnt("%s (%s)", argv[1], mine ? "miner" : "paths");
+    if (bench->write_json(bench_file, title.c_str()))
+      printf("Benchmark results written to '%s'\n", bench_file);
+    else
+      printf("Failed to write '%s'\n", bench_file);
+    delete bench;
+  }
+
+  return 0;
+}
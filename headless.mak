@@ -0,0 +1,80 @@
+#--------------------------------------------------------------------------
+# GraphSlick (c) Elias Bachaalany
+#
+# Headless analyzer: Linux build
+#
+# Builds the headless analyzer (see headless.cpp) and its IDA independent
+# modules. Only the SDK's libpro is linked: no IDA kernel is needed, so it
+# runs on a Linux batch box. The hardware counters (see gsbench.h) come from
+# perf_event_open there.
+#
+#   make -f headless.mak IDASDK=<sdk directory> [EA64=1] [DEBUG=1]
+#
+# The plugin lives in <sdk>/plugins/GraphSlick by default (like the Windows
+# projects). The SDK's Linux libraries are 32-bit: ARCH_FLAGS defaults to -m32.
+#
+# History
+# --------
+#
+# 10/18/2026 - eliasb             - First version
+#--------------------------------------------------------------------------
+
+IDASDK     ?= ../..
+ARCH_FLAGS ?= -m32
+
+ifdef EA64
+  LIBDIR  = $(IDASDK)/lib/x86_linux_gcc_64
+  DEFINES = -D__LINUX__ -D__EA64__
+  SUFFIX  = 64
+else
+  LIBDIR  = $(IDASDK)/lib/x86_linux_gcc_32
+  DEFINES = -D__LINUX__
+  SUFFIX  =
+endif
+
+ifdef DEBUG
+  OPTFLAGS = -g -O0 -D_DEBUG
+else
+  OPTFLAGS = -O2 -DNDEBUG
+endif
+
+CXX      ?= g++
+CXXFLAGS += $(ARCH_FLAGS) $(OPTFLAGS) $(DEFINES) -I$(IDASDK)/include -Wall -Wextra
+LDFLAGS  += $(ARCH_FLAGS)
+LDLIBS   += $(LIBDIR)/pro.a -lpthread -ldl
+
+OBJDIR = obj/linux$(SUFFIX)
+BINDIR = bin/linux$(SUFFIX)
+TARGET = $(BINDIR)/headless
+
+SOURCES = headless.cpp \
+          bbfeat.cpp \
+          repaths.cpp \
+          fsgminer.cpp \
+          snapshot.cpp \
+          groupman.cpp \
+          grouptree.cpp \
+          gsbench.cpp \
+          gsdb.cpp \
+          gsview.cpp
+
+OBJECTS = $(SOURCES:%.cpp=$(OBJDIR)/%.o)
+
+#--------------------------------------------------------------------------
+all: $(TARGET)
+
+$(TARGET): $(OBJECTS) | $(BINDIR)
+	$(CXX) $(LDFLAGS) -o $@ $(OBJECTS) $(LDLIBS)
+
+$(OBJDIR)/%.o: %.cpp | $(OBJDIR)
+	$(CXX) $(CXXFLAGS) -MMD -MP -c -o $@ $<
+
+$(OBJDIR) $(BINDIR):
+	mkdir -p $@
+
+clean:
+	rm -rf $(OBJDIR) $(TARGET)
+
+.PHONY: all clean
+
+-include $(OBJECTS:.o=.d)
@@ -77,6 +77,50 @@ History
                                 - Added PUBLIC define to compile-out a few experimental features
 04/16/2014 - eliasb             - Added NO_PYTHON compile define
 09/24/2014 - eliasb             - Integrated changes from Hex-Rays, thanks to Arnaud Diederen
+10/18/2026 - eliasb             - Analyze() now streams the matcher results into the live groupman
+                                - Added "Find sub-block clones" chooser menus
+                                - Added the native repeated paths engine and its comparison with the Python matcher
+                                - Added "Load matcher profile" chooser menu
+                                - Added "Export database snapshot" chooser menu (see headless.cpp)
+                                - Store the flowchart fingerprint in the bbgroup files and skip the sanitization on load when it matches
+                                - Load and save the bbgroup files asynchronously
+                                - Saving appends the changes to the bbgroup file (the file is compacted past a threshold)
+                                - Added the "Apply grouping rules" chooser menus
+                                - Added the "Query groups" graph menu (see sgquery.h)
+                                - Added the "Show call graph groups" chooser menu (see callgraph.h)
+                                - Removed the chooser singleton: one chooser and graph per function. The flowcharts
+                                  (see fccache.h) and the Python matcher are shared between them
+                                - Added the frequent subgraphs miner engine (see fsgminer.h) and its comparison with the other engines
+                                - Added the "Find near-duplicate blocks" chooser menu (see bbalign.h)
+                                - The groups are also IDA's collapsible groups in the ungroupped view: switching the
+                                  views collapses or expands them in place. Added "Toggle group" graph menu
+                                - fix: the collapsed groups are selected by their blocks, so the ungroupped view
+                                  actions (combine, promote, find similar) work on them
+                                - fix: the groups created by the user in the graph viewer are refused
+                                - fix: a reloaded file adds the changed groups to the highlighting, and the
+                                  ungroupped view is repainted instead of rebuilt
+                                - The chooser shows the groups metrics columns (see gmetrics.h) and can sort by them
+                                - The flowcharts and the query indexes are charged to a memory budget (see gsmem.h).
+                                  Added "Show memory usage" chooser menu
+                                - The Python matcher is initialized on first use (or warmed up once the chooser is shown)
+                                  instead of when the chooser opens
+                                - The loaded bbgroup file is watched (see fwatch.h): when it is rewritten, only the
+                                  changed super groups are patched into the groupman
+                                - Added "Load trace heatmap" and "Clear trace heatmap" chooser menus (see traceheat.h)
+                                - The background work and the file loads/saves run on the tasks scheduler (see gssched.h):
+                                  the background tasks pause while the user actions are handled
+                                - Added "Record database for headless runs" chooser menu (see gsdb.h)
+                                - The groups can nest (see grouptree.h). Added "Nest groups", "Unnest group" and
+                                  "Highlight nesting level" graph menus
+                                - fix: save_file() is queue_save_file(): it returns before the file is written
+                                - fix: find similar analyzes the function again in an interactive task (not on the
+                                  UI thread) when another chooser analyzed since
+                                - fix: the streamed groups are merged and shown at most once per second and keep
+                                  the highlighting
+                                - fix: the soft refresh (groups collapsed or expanded, highlighting) does not lay out
+                                  the graph again
+                                - fix: the choosers are found by the function they were shown for, not by their
+                                  flowchart (not loaded yet, or another function after Analyze)
 
 TODO
 -----------
@@ -102,12 +146,29 @@ TODO
 #include <kernwin.hpp>
 #include <diskio.hpp>
 #include <prodir.h>
+#include <algorithm>
+#include <math.h>
 
 #include "groupman.h"
 #include "util.h"
 #include "algo.hpp"
 #include "colorgen.h"
 #include "pybbmatcher.h"
+#include "spscq.hpp"
+#include "clones.h"
+#include "repaths.h"
+#include "fsgminer.h"
+#include "bbalign.h"
+#include "gmetrics.h"
+#include "gsmem.h"
+#include "fwatch.h"
+#include "traceheat.h"
+#include "grouptree.h"
+#include "gssched.h"
+#include "snapshot.h"
+#include "gsdb.h"
+#include "sgquery.h"
+#include "fccache.h"
 
 //--------------------------------------------------------------------------
 // Some defines
@@ -121,16 +182,39 @@ TODO
 
 #define BBGROUP_EXT "bbgroup"
 
+// Interval (ms) at which the streamed analysis results are drained
+#define STREAM_TIMER_INTERVAL 200
+
+// Minimal interval (ms) between two graph rebuilds while the analysis streams
+#define STREAM_LAYOUT_INTERVAL 1000
+
+// Interval (ms) at which the scheduler runs the main thread work while tasks are pending
+#define SCHED_TIMER_INTERVAL 50
+
+// Time (ms) given to the background main thread work per scheduler tick
+#define SCHED_BG_SLICE 10
+
+// Delay (ms) after the chooser is shown before the Python matcher is warmed up
+#define PY_WARM_DELAY 1000
+
+// Interval (ms) at which the loaded bbgroup file is checked for changes
+#define WATCH_TIMER_INTERVAL 500
+
 //--------------------------------------------------------------------------
 static const char STR_CANNOT_BUILD_F_FC[] = "Cannot build function flowchart!";
 static const char STR_PLGNAME[]           = "GraphSlick";
 static const char TITLE_GS_PANEL[]        = "Graph Slick - Panel";
 static const char STR_GS_VIEW[]           = "Graph Slick - View";
+static const char STR_GS_CG_VIEW[]        = "Graph Slick - Call graph";
 static const char STR_OUTWIN_TITLE[]      = "Output window";
 static const char STR_IDAVIEWA_TITLE[]    = "IDA View-A";
 static const char STR_SEARCH_PROMPT[]     = "Please enter search string";
+static const char STR_QUERY_PROMPT[]      = "Please enter the groups query";
 static const char STR_DUMMY_SG_NAME[]     = "No name";
 static const char STR_GS_PY_PLGFILE[]     = "GraphSlick" SDIRCHAR "init.py";
+static const char STR_SUBCLONE_ID_PREFIX[] = "SUBCLONE_";
+static const char STR_RULE_ID_PREFIX[]     = "RULE_";
+static const char STR_NEARDUP_ID_PREFIX[]  = "NEARDUP_";
 
 //--------------------------------------------------------------------------
 typedef std::map<int, bgcolor_t> ncolormap_t;
@@ -193,6 +277,62 @@ struct gsoptions_t
   */
   bool debug;
 
+  /**
+  * @brief Run the matcher in the background and show the groups as they are found
+  */
+  bool stream_analyze;
+
+  /**
+  * @brief Minimum length (in instructions) of the reported sub-block clones
+  */
+  int clone_min_insns;
+
+  /**
+  * @brief Minimum length (in blocks) of the paths found by the native paths engine
+  */
+  int path_min_blocks;
+
+  /**
+  * @brief Minimum count of occurrences of the subgraphs found by the miner
+  */
+  int mine_min_support;
+
+  /**
+  * @brief Maximum size (in blocks) of the subgraphs found by the miner
+  */
+  int mine_max_blocks;
+
+  /**
+  * @brief Maximum edit distance (in instructions) of the near-duplicate blocks
+  */
+  int neardup_max_dist;
+
+  /**
+  * @brief Create the groups as collapsible groups of the graph viewer in the
+  *        ungroupped view. Switching the views then collapses or expands them
+  *        instead of rebuilding the graph: the groupped view stays an ungroupped
+  *        view whose groups are collapsed, and selecting a group node selects
+  *        its blocks
+  */
+  bool native_groups;
+
+  /**
+  * @brief Memory budget (in MB) of the caches: flowcharts, disassembly text,
+  *        features and query indexes
+  */
+  int mem_budget_mb;
+
+  /**
+  * @brief Initialize the Python matcher shortly after the chooser is shown
+  *        rather than on its first use
+  */
+  bool warm_python;
+
+  /**
+  * @brief Watch the loaded bbgroup file and patch the groups it changes
+  */
+  bool hot_reload;
+
   /**
   * @brief Graph layout
   */
@@ -216,6 +356,16 @@ struct gsoptions_t
     start_view_mode = gvrfm_combined_mode; // gvrfm_single_mode;
     debug = true;
     graph_layout = layout_digraph;
+    stream_analyze = true;
+    native_groups = true;
+    clone_min_insns = 6;
+    path_min_blocks = 2;
+    mine_min_support = 2;
+    mine_max_blocks = 8;
+    neardup_max_dist = 2;
+    mem_budget_mb = 256;
+    warm_python = true;
+    hot_reload = true;
     //;!
     no_initial_path_info = false;
   }
@@ -245,6 +395,48 @@ struct gsoptions_t
   }
 };
 
+//--------------------------------------------------------------------------
+/**
+* @brief The graph views query indexes memory cache. The key is the graph view
+*/
+class query_index_memcache_t: public gsmem_cache_t
+{
+public:
+  query_index_memcache_t(): gsmem_cache_t("Query indexes")
+  {
+  }
+
+  virtual void evict(uint64 key);
+};
+static query_index_memcache_t query_index_memcache;
+
+//--------------------------------------------------------------------------
+/**
+* @brief The tasks scheduler (see gssched.h) and the timer that pumps it
+*/
+static gssched_t gs_sched;
+static qtimer_t gs_sched_timer = NULL;
+
+static int idaapi s_sched_timer(void * /*ud*/)
+{
+  if (gs_sched.pump(SCHED_BG_SLICE))
+    return SCHED_TIMER_INTERVAL;
+
+  // Idle: the next task registers the timer again
+  gs_sched_timer = NULL;
+  return -1;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Make sure the scheduler gets pumped. Called after posting a task
+*/
+static void pump_sched_later()
+{
+  if (gs_sched_timer == NULL)
+    gs_sched_timer = register_timer(SCHED_TIMER_INTERVAL, s_sched_timer, NULL);
+}
+
 //--------------------------------------------------------------------------
 /**
 * @brief GSGraph actions. It allows parents to get notified on GSGV actions
@@ -263,9 +455,11 @@ public:
   virtual void notify_refresh(bool hard_refresh = false) = 0;
 
   /**
-  * @brief Find nodes similar to the highlighted ones
+  * @brief Find nodes similar to the highlighted ones and highlight them
+  *        (see gsgraphview_t::highlight_similar_ngl()). It may finish later,
+  *        once the matcher state of the function is restored
   */
-  virtual pnodegroup_list_t find_similar(intvec_t &sel_nodes) = 0;
+  virtual void find_similar(intvec_t &sel_nodes) = 0;
 };
 
 //--------------------------------------------------------------------------
@@ -316,7 +510,7 @@ private:
 
   gnodemap_t node_map;
   ng2nid_t ng2id;
-  qflow_chart_t *func_fc;
+  shared_fc_t *func_fc;
   gvrefresh_modes_e refresh_mode, cur_view_mode;
 
   gsgv_actions_t *actions;
@@ -339,12 +533,51 @@ private:
   int idm_reset_groupping;
 
   int idm_test;
-  int idm_highlight_similar, idm_find_highlight;
+  int idm_highlight_similar, idm_find_highlight, idm_query_highlight;
 
   int idm_combine_ngs;
+  int idm_toggle_group;
+  int idm_nest_sgs, idm_unnest_sg, idm_nesting_level;
 
   int idm_show_options;
 
+  /**
+  * @brief A collapsible group of the graph viewer. It holds an NG with more than
+  *        one node or the NGs of an SG (ng == NULL)
+  */
+  struct native_group_t
+  {
+    psupergroup_t sg;
+    pnodegroup_t ng;
+
+    // First block of the group: the group node takes its color
+    int first_nid;
+
+    bool collapsed;
+  };
+  typedef std::map<int, native_group_t> native_groupmap_t;
+
+  /**
+  * @brief Native groups by group node id
+  */
+  native_groupmap_t native_groups;
+
+  /**
+  * @brief Collapse the native groups when they are created
+  */
+  bool collapse_native_groups;
+
+  /**
+  * @brief Set while the plugin creates a native group: the other group
+  *        creations come from the user
+  */
+  bool creating_native_group;
+
+  /**
+  * @brief The graph of the viewer (set on the refresh)
+  */
+  mutable_graph_t *cur_mg;
+
   bool in_sel_mode;
 
   ncolormap_t     highlighted_nodes;
@@ -352,6 +585,16 @@ private:
 
   ncolormap_t::iterator it_selected_node, it_highlighted_node;
 
+  /**
+  * @brief Query index of the groups. Built on the first query
+  */
+  sgquery_index_t *query_index;
+
+  /**
+  * @brief Trace hit counts shown as a heatmap in both view modes
+  */
+  trace_heat_t heat;
+
   /**
   * @brief Static menu item dispatcher
   */
@@ -362,6 +605,8 @@ private:
     if (it == menu_ids.end())
       return false;
 
+    // The background tasks pause while the user action is handled
+    gssched_scope_t scope(&gs_sched);
     it->second.gsgv->on_menu(id);
 
     return true;
@@ -431,14 +676,29 @@ private:
     //
     else if (menu_id == idm_single_view_mode)
     {
-      redo_layout(gvrfm_single_mode);
+      // The native groups expand in place
+      if (cur_view_mode == gvrfm_single_mode && !native_groups.empty())
+        set_native_groups_visibility(true);
+      else
+        redo_layout(gvrfm_single_mode);
     }
     //
     // Switch to combined view mode
     //
     else if (menu_id == idm_combined_view_mode)
     {
-      redo_layout(gvrfm_combined_mode);
+      // The native groups collapse in place
+      if (cur_view_mode == gvrfm_single_mode && !native_groups.empty())
+        set_native_groups_visibility(false);
+      else
+        redo_layout(gvrfm_combined_mode);
+    }
+    //
+    // Collapse or expand the group of the current node
+    //
+    else if (menu_id == idm_toggle_group)
+    {
+      toggle_native_group(cur_node);
     }
     //
     // Show the options dialog
@@ -462,6 +722,13 @@ private:
       find_and_highlight_nodes(options->manual_refresh_mode);
     }
     //
+    // Query and highlight supergroups
+    //
+    else if (menu_id == idm_query_highlight)
+    {
+      query_and_highlight_nodes(options->manual_refresh_mode);
+    }
+    //
     // Change the current graph layout
     //
     else if (menu_id == idm_change_graph_layout)
@@ -491,20 +758,23 @@ private:
     //
     else if (menu_id == idm_edit_sg_desc)
     {
-      // Check the view mode and selection
-      if (   cur_view_mode != gvrfm_combined_mode
-          || cur_node == -1)
+      // A group node of the ungroupped view or a node of the groupped view
+      native_group_t *grp = find_native_group(cur_node);
+      if (   grp == NULL
+          && (cur_view_mode != gvrfm_combined_mode || cur_node == -1))
       {
         msg(STR_GS_MSG "Incorrect view mode or no nodes are selected\n");
         return;
       }
 
-      psupergroup_t sg = get_sg_from_ngid(cur_node);
+      psupergroup_t sg = grp != NULL ? grp->sg : get_sg_from_ngid(cur_node);
       if (sg == NULL)
         return;
 
       if (edit_sg_description(sg))
       {
+        invalidate_query_index();
+
         // Notify that a refresh is taking place
         actions->notify_refresh();
       }
@@ -557,6 +827,29 @@ private:
       promote_node_groups_to_sgs();
     }
     //
+    // Nest the selected groups
+    //
+    else if (menu_id == idm_nest_sgs)
+    {
+      nest_selected_sgs();
+    }
+    //
+    // Move a group one nesting level up
+    //
+    else if (menu_id == idm_unnest_sg)
+    {
+      unnest_current_sg();
+    }
+    //
+    // Highlight the groups of a nesting level
+    //
+    else if (menu_id == idm_nesting_level)
+    {
+      static sval_t last_level = 1;
+      if (asklong(&last_level, "Nesting level"))
+        highlight_nesting_level(int(last_level));
+    }
+    //
     // Reset groupping
     //
     else if (menu_id == idm_reset_groupping)
@@ -584,12 +877,7 @@ private:
         sel_nodes.push_back(nid);
       }
 
-      pnodegroup_list_t ngl = actions->find_similar(sel_nodes);
-
-      DECL_CG;
-      highlight_nodes(ngl, cg, options->manual_refresh_mode);
-      ngl->free_nodegroup(false);
-      delete ngl;
+      actions->find_similar(sel_nodes);
     }
   }
 
@@ -632,9 +920,20 @@ private:
         va_arg(va, graph_item_t *);
         if (in_sel_mode && item1 != NULL && item1->is_node)
         {
-          toggle_select_node(
-            item1->node,
-            options->manual_refresh_mode);
+          // A group node selects its blocks: the ungroupped view paths work on blocks
+          native_group_t *grp = find_native_group(item1->node);
+          if (grp != NULL)
+          {
+            toggle_select_native_group(
+              *grp,
+              options->manual_refresh_mode);
+          }
+          else
+          {
+            toggle_select_node(
+              item1->node,
+              options->manual_refresh_mode);
+          }
         }
 
         // don't ignore the click
@@ -660,19 +959,33 @@ private:
       //
       case grcode_creating_group:
       {
-        //mutable_graph_t *mg = va_arg(va, mutable_graph_t *);
-        //intset_t *nodes = va_arg(va, intset_t *);
-
-        //msg("grcode_creating_group(%p):", mg);
-        //for (intset_t::iterator it=nodes->begin();
-        //     it != nodes->end();
-        //     ++it)
-        //{
-        //  msg("%d,", *it);
-        //}
-        //msg("\n");
-        //result = 1;
+        // in:  mutable_graph_t *g
+        //      intset_t *nodes
         // out: 0-ok, 1-forbid group creation
+        if (creating_native_group)
+          break;
+
+        // The groupman does not know the user groups: its groups are combined
+        msg(STR_GS_MSG "Use \"Combine nodes\" to group the selected nodes\n");
+        result = 1;
+        break;
+      }
+
+      //
+      // A group is being collapsed or expanded
+      //
+      case grcode_group_visibility:
+      {
+        // in:  mutable_graph_t *g
+        //      int group
+        //      bool expand
+        va_arg(va, mutable_graph_t *);
+        int group = va_argi(va, int);
+        bool expand = va_argi(va, bool);
+
+        native_group_t *grp = find_native_group(group);
+        if (grp != NULL)
+          grp->collapsed = !expand;
         break;
       }
 
@@ -684,6 +997,12 @@ private:
         // in:  mutable_graph_t *g
         //      int old_group
         // out: 0-ok, 1-forbid group deletion
+        va_arg(va, mutable_graph_t *);
+        int old_group = va_argi(va, int);
+
+        // The user ungrouped it
+        native_groups.erase(old_group);
+        node_map.erase(old_group);
         break;
       }
 
@@ -705,6 +1024,7 @@ private:
       case grcode_user_refresh:
       {
         mutable_graph_t *mg = va_arg(va, mutable_graph_t *);
+        cur_mg = mg;
         if (node_map.empty() || refresh_mode != gvrfm_soft)
         {
           // Clear previous graph node data
@@ -722,13 +1042,23 @@ private:
 
           // Switch to the desired mode
           if (refresh_mode == gvrfm_single_mode)
+          {
             switch_to_single_view_mode(mg);
+            create_native_groups(mg);
+          }
           else if (refresh_mode == gvrfm_combined_mode)
             switch_to_combined_view_mode(mg);
           else
             msg_unk_mode();
+
+          // The heatmap follows the view mode
+          if (!heat.empty())
+            highlight_heat(true);
+
+          mg->redo_layout();
         }
-        mg->redo_layout();
+        // The soft refresh only repaints: the nodes did not change and
+        // change_group_visibility() already laid out the groups it toggled
         result = 1;
         break;
       }
@@ -756,6 +1086,14 @@ private:
         // Caller requested a bgcolor?
         if (bgcolor != NULL) do
         {
+          // A group node shows its own highlight (heatmap) or the color of its first block
+          native_group_t *grp = find_native_group(node);
+          if (   grp != NULL
+              && highlighted_nodes.find(node) == highlighted_nodes.end())
+          {
+            node = grp->first_nid;
+          }
+
           // Selection has priority over highlight
           ncolormap_t::iterator psel = selected_nodes.find(node);
           if (psel == selected_nodes.end())
@@ -811,6 +1149,8 @@ private:
 
         actions->notify_close();
 
+        invalidate_query_index();
+        release_shared_fc(func_fc);
         delete this;
         break;
       }
@@ -826,6 +1166,7 @@ private:
     // Clear node information
     node_map.clear();
     ng2id.clear();
+    native_groups.clear();
 
     // Clear highlight / selected
     highlighted_nodes.clear();
@@ -889,7 +1230,7 @@ public:
   {
     // The current node is a node group id
     // Convert ngid to a node id
-    pnodegroup_t ng = get_ng_from_ngid(cur_node);
+    pnodegroup_t ng = get_ng_from_ngid(ngid);
     if (ng == NULL)
       return NULL;
     else
@@ -1066,6 +1407,92 @@ public:
     return true;
   }
 
+  /**
+  * @brief Heat color of a hit count: pale yellow to red, on a log scale
+  */
+  static bgcolor_t get_heat_color(uint64 hits, uint64 max_hits)
+  {
+    double t = max_hits <= 1 ? 1.0 : log(double(hits) + 1) / log(double(max_hits) + 1);
+
+    // bgcolor_t is 0xBBGGRR
+    int g = int(240 - 180 * t);
+    int b = int(160 - 120 * t);
+    return bgcolor_t((b << 16) | (g << 8) | 0xFF);
+  }
+
+  /**
+  * @brief Set the trace heatmap and highlight it
+  */
+  void set_heat(const trace_heat_t &new_heat)
+  {
+    heat = new_heat;
+    highlight_heat(false);
+  }
+
+  /**
+  * @brief Remove the trace heatmap
+  */
+  void clear_heat()
+  {
+    if (heat.empty())
+      return;
+
+    heat.clear();
+    clear_highlighting(false);
+  }
+
+  /**
+  * @brief Highlight the trace heatmap: each block in the single view mode
+  *        and each node group in the combined view mode and when collapsed
+  */
+  void highlight_heat(bool delay_refresh)
+  {
+    highlighted_nodes.clear();
+    it_highlighted_node = highlighted_nodes.end();
+
+    psupergroup_listp_t sgl = gm->get_path_sgl();
+    for (supergroup_listp_t::iterator it_sg=sgl->begin();
+         it_sg != sgl->end();
+         ++it_sg)
+    {
+      nodegroup_list_t &ngl = (*it_sg)->groups;
+      for (nodegroup_list_t::iterator it_ng=ngl.begin();
+           it_ng != ngl.end();
+           ++it_ng)
+      {
+        pnodegroup_t ng = *it_ng;
+        if (cur_view_mode == gvrfm_combined_mode)
+        {
+          std::map<pnodegroup_t, uint64>::const_iterator p = heat.ngs.find(ng);
+          int gr_nid = get_ngid_from_ng(ng);
+          if (p != heat.ngs.end() && gr_nid != -1)
+            highlighted_nodes[gr_nid] = get_heat_color(p->second, heat.max_ng);
+          continue;
+        }
+
+        for (nodegroup_t::iterator it_nd=ng->begin(); it_nd != ng->end(); ++it_nd)
+        {
+          std::map<pnodedef_t, uint64>::const_iterator p = heat.nds.find(*it_nd);
+          if (p != heat.nds.end())
+            highlighted_nodes[(*it_nd)->nid] = get_heat_color(p->second, heat.max_nd);
+        }
+      }
+    }
+
+    // The collapsed native groups show their node group total
+    for (native_groupmap_t::iterator it=native_groups.begin();
+         it != native_groups.end();
+         ++it)
+    {
+      std::map<pnodegroup_t, uint64>::const_iterator p = heat.ngs.find(it->second.ng);
+      if (p != heat.ngs.end())
+        highlighted_nodes[it->first] = get_heat_color(p->second, heat.max_ng);
+    }
+
+    if (!delay_refresh)
+      refresh_view();
+  }
+
   /**
   * @brief Highlight a nodegroup list
   */
@@ -1169,7 +1596,16 @@ public:
       sel_nodes.push_back(it->first);
     }
 
-    pnodegroup_list_t ngl = actions->find_similar(sel_nodes);
+    actions->find_similar(sel_nodes);
+  }
+
+  /**
+  * @brief Highlight the node groups found by find_similar() and free them
+  */
+  void highlight_similar_ngl(pnodegroup_list_t ngl)
+  {
+    if (ngl == NULL)
+      return;
 
     DECL_CG;
     highlight_nodes(ngl, cg, options->manual_refresh_mode);
@@ -1216,6 +1652,35 @@ public:
     }
   }
 
+  /**
+  * @brief Toggle the selection of the blocks of a native group. The group
+  *        is selected unless all its blocks already are
+  */
+  void toggle_select_native_group(
+          const native_group_t &grp,
+          bool delay_refresh)
+  {
+    intvec_t nids;
+    get_native_group_nids(grp, nids);
+
+    bool all_selected = true;
+    for (size_t i=0; i < nids.size() && all_selected; i++)
+      all_selected = selected_nodes.find(nids[i]) != selected_nodes.end();
+
+    for (size_t i=0; i < nids.size(); i++)
+    {
+      if (all_selected)
+        selected_nodes.erase(nids[i]);
+      else
+        selected_nodes[nids[i]] = NODE_SEL_COLOR;
+    }
+
+    if (delay_refresh)
+      msg(STR_GS_MSG "Selected %d nodes of '%s'\n", int(nids.size()), grp.sg->get_display_name(""));
+    else
+      refresh_view();
+  }
+
   /**
   * @brief Find and highlights nodes
   */
@@ -1278,52 +1743,148 @@ public:
   }
 
   /**
-  * @brief Merge the highlighted nodes with the selection. End result is more selection coming from highlight
+  * @brief Drop the query index so the next query rebuilds it
   */
-  void merge_highlight_with_selection()
+  void invalidate_query_index()
   {
-    for (ncolormap_t::iterator it=highlighted_nodes.begin();
-         it != highlighted_nodes.end();
-         ++it)
-    {
-      if (selected_nodes.find(it->first) != selected_nodes.end())
-        continue;
-      else
-      {
-        selected_nodes[it->first] = NODE_SEL_COLOR;
-      }
-    }
+    if (query_index == NULL)
+      return;
+
+    query_index_memcache.uncharge(uint64(size_t(this)));
+    delete query_index;
+    query_index = NULL;
   }
 
   /**
-  * @brief Jumps to next item in the container
+  * @brief Query and highlight the matching super groups
   */
-  void jump_to_next_node(ncolormap_t::iterator &it, ncolormap_t &cont)
+  void query_and_highlight_nodes(bool delay_refresh)
   {
-    if (cont.empty())
+    static char last_query[MAXSTR] = {0};
+
+    const char *query = askstr(HIST_SRCH, last_query, STR_QUERY_PROMPT);
+    if (query == NULL)
       return;
 
-    // End? Rewind
-    if (it == cont.end())
-      it = cont.begin();
+    // Remember last query
+    qstrncpy(
+        last_query,
+        query,
+        sizeof(last_query));
 
-    jump_to_node(gv, it->first);
+    if (query_index == NULL)
+    {
+      // The features are only needed to count the instructions
+      query_index = new sgquery_index_t();
+      query_index->build(gm, func_fc->get_features());
+
+      // Rebuilding it costs about one visit of each group
+      query_index_memcache.charge(
+        uint64(size_t(this)),
+        query_index->memory_size(),
+        double(query_index->size()));
+    }
+    else
+    {
+      query_index_memcache.touch(uint64(size_t(this)));
+    }
 
-    // Advance to next match
-    ++it;
-  }
+    intvec_t result;
+    qstring errbuf;
+    if (!query_index->query(query, result, &errbuf))
+    {
+      msg(STR_GS_MSG "Query failed: %s\n", errbuf.c_str());
+      return;
+    }
 
-  /**
-  * @brief Combine node groups
-  */
-  void combine_node_groups()
-  {
-    pnodegroup_t new_ng = NULL;
-    if (cur_view_mode == gvrfm_combined_mode)
+    msg(STR_GS_MSG "Query matched %d group(s)\n", int(result.size()));
+
+    DECL_CG;
+
+    clear_highlighting(true);
+
+    colorvargen_t cv;
+    pnodegroup_t first_ng = NULL;
+    for (intvec_t::iterator it=result.begin();
+         it != result.end();
+         ++it)
+    {
+      psupergroup_t sg = query_index->get_sg(*it);
+      if (first_ng == NULL)
+        first_ng = sg->groups.get_first_ng();
+
+      // Assign a new color variant for each group
+      cg.get_colorvar(cv);
+      for (nodegroup_list_t::iterator it_ng=sg->groups.begin();
+           it_ng != sg->groups.end();
+           ++it_ng)
+      {
+        highlight_nodes(
+            *it_ng,
+            cg.get_color_anyway(cv),
+            true);
+      }
+    }
+
+    if (!delay_refresh)
+      refresh_view();
+
+    int nid = first_ng == NULL ? -1 : get_ngid_from_ng(first_ng);
+    if (nid != -1)
+    {
+      jump_to_node(
+        gv,
+        nid);
+    }
+  }
+
+  /**
+  * @brief Merge the highlighted nodes with the selection. End result is more selection coming from highlight
+  */
+  void merge_highlight_with_selection()
+  {
+    for (ncolormap_t::iterator it=highlighted_nodes.begin();
+         it != highlighted_nodes.end();
+         ++it)
+    {
+      if (selected_nodes.find(it->first) != selected_nodes.end())
+        continue;
+      else
+      {
+        selected_nodes[it->first] = NODE_SEL_COLOR;
+      }
+    }
+  }
+
+  /**
+  * @brief Jumps to next item in the container
+  */
+  void jump_to_next_node(ncolormap_t::iterator &it, ncolormap_t &cont)
+  {
+    if (cont.empty())
+      return;
+
+    // End? Rewind
+    if (it == cont.end())
+      it = cont.begin();
+
+    jump_to_node(gv, it->first);
+
+    // Advance to next match
+    ++it;
+  }
+
+  /**
+  * @brief Combine node groups
+  */
+  void combine_node_groups()
+  {
+    pnodegroup_t new_ng = NULL;
+    if (cur_view_mode == gvrfm_combined_mode)
     {
       //
-      // Make a nodegroup list from the selection
-      //
+      // Make a nodegroup list from the selection
+      //
       nodegroup_list_t ngl;
       for (ncolormap_t::iterator it = selected_nodes.begin();
            it != selected_nodes.end();
@@ -1450,6 +2011,209 @@ public:
     redo_current_layout();
   }
 
+  /**
+  * @brief Collect the super groups of the selected nodes (or of the current
+  *        node if none is selected)
+  */
+  void get_selected_sgs(std::set<psupergroup_t> &sgs)
+  {
+    intvec_t nodes;
+    for (ncolormap_t::iterator it=selected_nodes.begin();
+         it != selected_nodes.end();
+         ++it)
+    {
+      nodes.push_back(it->first);
+    }
+    if (nodes.empty() && cur_node != -1)
+      nodes.push_back(cur_node);
+
+    for (size_t i=0; i < nodes.size(); i++)
+    {
+      psupergroup_t sg = NULL;
+      native_group_t *grp = find_native_group(nodes[i]);
+      if (grp != NULL)
+      {
+        sg = grp->sg;
+      }
+      else if (cur_view_mode == gvrfm_combined_mode)
+      {
+        sg = get_sg_from_ngid(nodes[i]);
+      }
+      else
+      {
+        nodeloc_t *loc = gm->find_nodeid_loc(nodes[i]);
+        if (loc != NULL)
+          sg = loc->sg;
+      }
+
+      if (sg != NULL)
+        sgs.insert(sg);
+    }
+  }
+
+  /**
+  * @brief Write a regrouped tree back to the groupman and refresh
+  */
+  void apply_group_tree(group_tree_t &tree)
+  {
+    if (tree.export_to(gm) == 0)
+      return;
+
+    invalidate_query_index();
+
+    // Refresh the chooser
+    actions->notify_refresh(true);
+
+    // Re-layout
+    redo_current_layout();
+  }
+
+  /**
+  * @brief Nest the super groups of the selection in a new group
+  */
+  void nest_selected_sgs()
+  {
+    std::set<psupergroup_t> sgs;
+    get_selected_sgs(sgs);
+    if (sgs.empty())
+    {
+      msg(STR_GS_MSG "No groups are selected\n");
+      return;
+    }
+
+    group_tree_t tree;
+    tree.build_from(gm);
+
+    intvec_t group_nodes;
+    for (std::set<psupergroup_t>::iterator it=sgs.begin(); it != sgs.end(); ++it)
+    {
+      int n = tree.find_sg(*it);
+      if (n != -1)
+        group_nodes.push_back(n);
+    }
+
+    static char last_id[MAXSTR] = "group";
+    const char *id;
+    while (true)
+    {
+      id = askstr(HIST_IDENT, last_id, "Please enter the id of the new group");
+      if (id == NULL)
+        return;
+
+      if (   id[0] == '\0'
+          || strchr(id, GROUPTREE_SEP) != NULL
+          || strchr(id, ':') != NULL
+          || strchr(id, ';') != NULL)
+      {
+        warning("The id cannot be empty or contain the following characters: '/:;'");
+        continue;
+      }
+      break;
+    }
+    qstrncpy(last_id, id, sizeof(last_id));
+
+    if (tree.nest(group_nodes, last_id) == -1)
+    {
+      msg(STR_GS_MSG "Failed to nest the selected groups\n");
+      return;
+    }
+    apply_group_tree(tree);
+  }
+
+  /**
+  * @brief Move the super group of the current node one nesting level up
+  */
+  void unnest_current_sg()
+  {
+    std::set<psupergroup_t> sgs;
+    get_selected_sgs(sgs);
+    if (sgs.size() != 1)
+    {
+      msg(STR_GS_MSG "Select the nodes of one group\n");
+      return;
+    }
+
+    group_tree_t tree;
+    tree.build_from(gm);
+
+    int n = tree.find_sg(*sgs.begin());
+    int parent = n == -1 ? -1 : tree.get_parent(n);
+    if (parent == -1 || parent == tree.root())
+    {
+      msg(STR_GS_MSG "The group is not nested\n");
+      return;
+    }
+
+    // The parent level goes away if nothing else is left in it
+    tree.move(n, tree.get_parent(parent));
+    if (tree.get_children(parent).empty())
+      tree.ungroup(parent);
+
+    apply_group_tree(tree);
+  }
+
+  /**
+  * @brief Highlight the groups at a nesting level, one color per group, and
+  *        report their quotient graph
+  */
+  void highlight_nesting_level(int level)
+  {
+    group_tree_t tree;
+    tree.build_from(gm);
+
+    intvec_t cut;
+    tree.get_level_cut(level, cut);
+
+    qvector<intvec_t> succs;
+    const func_features_t *ff = func_fc->get_features();
+    if (ff != NULL)
+    {
+      for (size_t i=0; i < ff->blocks.size(); i++)
+        succs.push_back(ff->blocks[i].succ);
+    }
+
+    gt_quotient_t q;
+    if (!tree.build_quotient(cut, succs, q))
+    {
+      msg(STR_GS_MSG "Failed to compute the nesting level\n");
+      return;
+    }
+
+    clear_highlighting(true);
+
+    DECL_CG;
+    colorvargen_t cv;
+    cg.get_colorvar(cv);
+    qvector<bgcolor_t> colors;
+    for (size_t i=0; i < q.nodes.size(); i++)
+      colors.push_back(cg.get_color_anyway(cv));
+
+    for (size_t nid=0; nid < q.node_of_nid.size(); nid++)
+    {
+      int idx = q.node_of_nid[nid];
+      if (idx == -1)
+        continue;
+
+      // In the combined view the cut never splits a node group
+      int gr_nid = int(nid);
+      if (cur_view_mode == gvrfm_combined_mode)
+      {
+        nodeloc_t *loc = gm->find_nodeid_loc(gr_nid);
+        gr_nid = loc == NULL ? -1 : get_ngid_from_ng(loc->ng);
+        if (gr_nid == -1)
+          continue;
+      }
+      highlighted_nodes[gr_nid] = colors[idx];
+    }
+    it_highlighted_node = highlighted_nodes.end();
+    refresh_view();
+
+    msg(STR_GS_MSG "Nesting level %d: %d group(s) and %d edge(s) between them\n",
+        level,
+        int(q.nodes.size()),
+        int(q.edges.size()));
+  }
+
   /**
   * @brief Move all nodes in selected node groups and put each ND into its own NG
   *        The SG of the node will remain the same
@@ -1571,6 +2335,28 @@ public:
     // Adjust the name
     sg->name = desc;
 
+    // Update the native group nodes
+    for (native_groupmap_t::iterator it=native_groups.begin();
+         it != native_groups.end();
+         ++it)
+    {
+      if (it->second.sg != sg)
+        continue;
+
+      gnode_t *gnode = get_node(it->first);
+      if (gnode != NULL)
+        get_native_group_text(it->second, &gnode->text);
+    }
+
+    // In the ungroupped view the node ids are the blocks: only the group nodes show the name
+    if (cur_view_mode != gvrfm_combined_mode)
+    {
+      if (!options->manual_refresh_mode)
+        refresh_view();
+
+      return true;
+    }
+
     // From the super group, get all individual node groups
     for (nodegroup_list_t::iterator it=sg->groups.begin();
          it != sg->groups.end();
@@ -1599,94 +2385,311 @@ public:
   }
 
   /**
-  * @brief Switch to combined view mode
+  * @brief Return the native group of a group node id or NULL
   */
-  void switch_to_single_view_mode(mutable_graph_t *mg)
+  native_group_t *find_native_group(int gnid)
   {
-    msg(STR_GS_MSG "Switching to single mode view...");
-    func_to_mgraph(
-      BADADDR,
-      mg,
-      node_map,
-      func_fc,
-      options->append_node_id);
-    msg("done\n");
+    native_groupmap_t::iterator it = native_groups.find(gnid);
+    return it == native_groups.end() ? NULL : &it->second;
   }
 
   /**
-  * @brief Switch to combined view mode
+  * @brief The blocks of a native group: its NG or all the NGs of its SG
   */
-  void switch_to_combined_view_mode(mutable_graph_t *mg)
+  void get_native_group_nids(const native_group_t &grp, intvec_t &nids)
   {
-    msg(STR_GS_MSG "Switching to combined mode view...");
-    fc_to_combined_mg(
-      BADADDR,
-      gm,
-      node_map,
-      ng2id,
-      mg,
-      func_fc);
+    nids.qclear();
+    if (grp.ng != NULL)
+    {
+      for (nodegroup_t::iterator it=grp.ng->begin(); it != grp.ng->end(); ++it)
+        nids.push_back((*it)->nid);
+      return;
+    }
 
-    msg("done\n");
+    for (nodegroup_list_t::iterator it_ng=grp.sg->groups.begin();
+         it_ng != grp.sg->groups.end();
+         ++it_ng)
+    {
+      pnodegroup_t ng = *it_ng;
+      for (nodegroup_t::iterator it=ng->begin(); it != ng->end(); ++it)
+        nids.push_back((*it)->nid);
+    }
   }
 
   /**
-  * @brief Add a context menu to the graphview
+  * @brief Text of a group node
   */
-  int add_menu(
-    const char *name,
-    const char *hotkey = NULL)
+  void get_native_group_text(const native_group_t &grp, qstring *text)
   {
-    // Static ID for all menu item IDs
-    static int id = 0;
-
-    // Is this a separator menu item?
-    bool is_sep = name[0] == '-' && name[1] == '\0';
-
-    // Only remember this item if it was not a separator
-    if (!is_sep)
-    {
-      ++id;
-
-      // Create a menu context
-      menucbctx_t ctx;
-      ctx.gsgv = this;
-      ctx.name = name;
+    *text = grp.sg->get_display_name();
+    if (grp.ng != NULL)
+      text->cat_sprnt("\n(%d nodes)", int(grp.ng->size()));
+    else
+      text->cat_sprnt("\n(%d groups)", int(grp.sg->gcount()));
+  }
 
-      menu_ids[id] = ctx;
-    }
+  /**
+  * @brief Create a native group and its node data
+  * @return The group node id or -1
+  */
+  int add_native_group(
+    mutable_graph_t *mg,
+    const intset_t &nodes,
+    psupergroup_t sg,
+    pnodegroup_t ng,
+    int first_nid)
+  {
+    creating_native_group = true;
+    int gnid = mg->create_group(nodes);
+    creating_native_group = false;
+    if (gnid < 0)
+      return -1;
 
-    bool ok = viewer_add_menu_item(
-      gv,
-      name,
-      is_sep ? NULL : s_menu_item_callback,
-      (void *)id,
-      hotkey,
-      0);
+    native_group_t &grp = native_groups[gnid];
+    grp.sg = sg;
+    grp.ng = ng;
+    grp.first_nid = first_nid;
+    grp.collapsed = false;
 
-    // Ignore return value for separator
-    if (is_sep)
-      return -1;
+    gnode_t *gn = node_map.add(gnid);
+    gn->id = gnid;
+    get_native_group_text(grp, &gn->text);
 
-    if (!ok)
-      menu_ids.erase(id);
+    if (collapse_native_groups && mg->change_group_visibility(gnid, false))
+      grp.collapsed = true;
 
-    return ok ? id : -1;
+    return gnid;
   }
 
   /**
-  * @brief Delete a context menu item
+  * @brief Map the groups onto the graph viewer groups: one group per NG
+  *        with more than one node, nested in one group per SG with more than one NG
   */
-  void del_menu(int menu_id)
+  void create_native_groups(mutable_graph_t *mg)
   {
-    if (menu_id == -1)
+    native_groups.clear();
+    if (!options->native_groups)
       return;
 
-    idmenucbtx_t::iterator it = menu_ids.find(menu_id);
-    if (it == menu_ids.end())
-      return;
+    intset_t nodes, members;
+    psupergroup_listp_t sgl = gm->get_path_sgl();
+    for (supergroup_listp_t::iterator it_sg=sgl->begin();
+         it_sg != sgl->end();
+         ++it_sg)
+    {
+      psupergroup_t sg = *it_sg;
+      if (sg->is_synthetic)
+        continue;
 
-    viewer_del_menu_item(
+      int first_nid = -1;
+      members.clear();
+      for (nodegroup_list_t::iterator it_ng=sg->groups.begin();
+           it_ng != sg->groups.end();
+           ++it_ng)
+      {
+        pnodegroup_t ng = *it_ng;
+        pnodedef_t nd = ng->get_first_node();
+        if (nd == NULL)
+          continue;
+
+        if (first_nid == -1)
+          first_nid = nd->nid;
+
+        if (ng->size() == 1)
+        {
+          members.insert(nd->nid);
+          continue;
+        }
+
+        nodes.clear();
+        for (nodegroup_t::iterator it=ng->begin(); it != ng->end(); ++it)
+          nodes.insert((*it)->nid);
+
+        int gnid = add_native_group(mg, nodes, sg, ng, nd->nid);
+        if (gnid == -1)
+          members.insert(nodes.begin(), nodes.end());
+        else
+          members.insert(gnid);
+      }
+
+      if (sg->gcount() > 1 && members.size() > 1)
+        add_native_group(mg, members, sg, NULL, first_nid);
+    }
+  }
+
+  /**
+  * @brief Collapse or expand all the native groups without rebuilding the graph
+  */
+  void set_native_groups_visibility(bool expand)
+  {
+    if (cur_mg == NULL)
+      return;
+
+    // The NG groups are created before their SG group: collapse the inner
+    // groups first and expand the outer groups first
+    if (expand)
+    {
+      for (native_groupmap_t::reverse_iterator it=native_groups.rbegin(); it != native_groups.rend(); ++it)
+      {
+        if (it->second.collapsed && cur_mg->change_group_visibility(it->first, true))
+          it->second.collapsed = false;
+      }
+    }
+    else
+    {
+      for (native_groupmap_t::iterator it=native_groups.begin(); it != native_groups.end(); ++it)
+      {
+        if (!it->second.collapsed && cur_mg->change_group_visibility(it->first, false))
+          it->second.collapsed = true;
+      }
+    }
+
+    // Keep the state when the graph is rebuilt
+    collapse_native_groups = !expand;
+
+    refresh_mode = gvrfm_soft;
+    refresh_viewer(gv);
+  }
+
+  /**
+  * @brief Collapse or expand a group node, or collapse the innermost group of a block
+  */
+  void toggle_native_group(int nid)
+  {
+    if (cur_mg == NULL || nid == -1)
+      return;
+
+    native_group_t *grp = find_native_group(nid);
+    if (grp != NULL)
+    {
+      if (cur_mg->change_group_visibility(nid, grp->collapsed))
+        grp->collapsed = !grp->collapsed;
+    }
+    else
+    {
+      nodeloc_t *loc = cur_view_mode == gvrfm_single_mode ? gm->find_nodeid_loc(nid) : NULL;
+      if (loc == NULL)
+        return;
+
+      // The NG group if any, else the SG group
+      int gnid = -1;
+      for (native_groupmap_t::iterator it=native_groups.begin(); it != native_groups.end(); ++it)
+      {
+        if (it->second.ng == loc->ng)
+        {
+          gnid = it->first;
+          break;
+        }
+        if (it->second.ng == NULL && it->second.sg == loc->sg)
+          gnid = it->first;
+      }
+
+      grp = find_native_group(gnid);
+      if (grp == NULL)
+      {
+        msg(STR_GS_MSG "The node is not in a group\n");
+        return;
+      }
+
+      if (!grp->collapsed && cur_mg->change_group_visibility(gnid, false))
+        grp->collapsed = true;
+    }
+
+    refresh_mode = gvrfm_soft;
+    refresh_viewer(gv);
+  }
+
+  /**
+  * @brief Switch to combined view mode
+  */
+  void switch_to_single_view_mode(mutable_graph_t *mg)
+  {
+    msg(STR_GS_MSG "Switching to single mode view...");
+    func_to_mgraph(
+      BADADDR,
+      mg,
+      node_map,
+      func_fc,
+      options->append_node_id,
+      &func_fc->get_block_text());
+    msg("done\n");
+  }
+
+  /**
+  * @brief Switch to combined view mode
+  */
+  void switch_to_combined_view_mode(mutable_graph_t *mg)
+  {
+    msg(STR_GS_MSG "Switching to combined mode view...");
+    combined_mgraph(
+      BADADDR,
+      gm,
+      node_map,
+      ng2id,
+      mg,
+      func_fc,
+      &func_fc->get_block_text());
+
+    msg("done\n");
+  }
+
+  /**
+  * @brief Add a context menu to the graphview
+  */
+  int add_menu(
+    const char *name,
+    const char *hotkey = NULL)
+  {
+    // Static ID for all menu item IDs
+    static int id = 0;
+
+    // Is this a separator menu item?
+    bool is_sep = name[0] == '-' && name[1] == '\0';
+
+    // Only remember this item if it was not a separator
+    if (!is_sep)
+    {
+      ++id;
+
+      // Create a menu context
+      menucbctx_t ctx;
+      ctx.gsgv = this;
+      ctx.name = name;
+
+      menu_ids[id] = ctx;
+    }
+
+    bool ok = viewer_add_menu_item(
+      gv,
+      name,
+      is_sep ? NULL : s_menu_item_callback,
+      (void *)id,
+      hotkey,
+      0);
+
+    // Ignore return value for separator
+    if (is_sep)
+      return -1;
+
+    if (!ok)
+      menu_ids.erase(id);
+
+    return ok ? id : -1;
+  }
+
+  /**
+  * @brief Delete a context menu item
+  */
+  void del_menu(int menu_id)
+  {
+    if (menu_id == -1)
+      return;
+
+    idmenucbtx_t::iterator it = menu_ids.find(menu_id);
+    if (it == menu_ids.end())
+      return;
+
+    viewer_del_menu_item(
       it->second.gsgv->gv,
       it->second.name.c_str());
 
@@ -1707,6 +2710,9 @@ public:
   */
   void redo_layout(gvrefresh_modes_e rm)
   {
+    // The groups may have changed
+    invalidate_query_index();
+
     refresh_mode = rm;
     refresh_viewer(gv);
     if (focus_node != -1)
@@ -1727,6 +2733,64 @@ public:
     redo_layout(cur_view_mode);
   }
 
+  /**
+  * @brief Show the groups after they changed and keep the highlighting.
+  *        The ungroupped view without native groups keeps its nodes: it is
+  *        only repainted. Otherwise the graph is rebuilt and the highlighting
+  *        is carried over by blocks
+  */
+  void redo_layout_keep_highlighting()
+  {
+    if (cur_view_mode == gvrfm_single_mode && !options->native_groups)
+    {
+      invalidate_query_index();
+      refresh_mode = gvrfm_soft;
+      refresh_viewer(gv);
+      return;
+    }
+
+    // The node ids change with the groups: remember the colors by blocks
+    ncolormap_t block_colors;
+    for (ncolormap_t::iterator it=highlighted_nodes.begin();
+         it != highlighted_nodes.end();
+         ++it)
+    {
+      if (cur_view_mode == gvrfm_combined_mode)
+      {
+        pnodegroup_t ng = get_ng_from_ngid(it->first);
+        if (ng == NULL)
+          continue;
+
+        for (nodegroup_t::iterator it_nd=ng->begin(); it_nd != ng->end(); ++it_nd)
+          block_colors[(*it_nd)->nid] = it->second;
+      }
+      // The native group nodes are recreated
+      else if (find_native_group(it->first) == NULL)
+      {
+        block_colors[it->first] = it->second;
+      }
+    }
+
+    redo_current_layout();
+
+    for (ncolormap_t::iterator it=block_colors.begin();
+         it != block_colors.end();
+         ++it)
+    {
+      int gvnid = get_gvnid_from_nid(it->first);
+      if (gvnid != -1)
+        highlighted_nodes[gvnid] = it->second;
+    }
+  }
+
+  /**
+  * @brief Return the current view mode
+  */
+  inline gvrefresh_modes_e get_view_mode()
+  {
+    return cur_view_mode;
+  }
+
   /**
   * @brief Set the actions variable
   */
@@ -1736,10 +2800,11 @@ public:
   }
 
   /**
-  * @brief Creates and shows the graph
+  * @brief Creates and shows the graph. The graph holds a reference to the flowchart
   */
   static gsgraphview_t *show_graph(
-    qflow_chart_t *func_fc,
+    const char *form_title,
+    shared_fc_t *func_fc,
     groupman_t *gm,
     gsoptions_t *options)
   {
@@ -1749,7 +2814,7 @@ public:
     for (int init=0; init<2; init++)
     {
       HWND hwnd = NULL;
-      TForm *form = create_tform(STR_GS_VIEW, &hwnd);
+      TForm *form = create_tform(form_title, &hwnd);
       if (hwnd != NULL)
       {
         // get a unique graph id
@@ -1759,7 +2824,7 @@ public:
         id.create(title.c_str());
 
         // Create a graph object
-        gsgraphview_t *gsgv = new gsgraphview_t(func_fc, options);
+        gsgraphview_t *gsgv = new gsgraphview_t(func_fc->addref(), options);
 
         // Assign the groupmanager instance
         gsgv->gm = gm;
@@ -1830,10 +2895,15 @@ public:
     add_menu("-");
     idm_highlight_similar             = add_menu("Highlight similar nodes",         "M");
     idm_find_highlight                = add_menu("Find group",                      "F");
+    idm_query_highlight               = add_menu("Query groups",                    "Y");
 
     //
     // Groupping actions
     idm_combine_ngs                   = add_menu("Combine nodes",                   "C");
+    idm_toggle_group                  = add_menu("Toggle group",                    "W");
+    idm_nest_sgs                      = add_menu("Nest groups",                     "N");
+    idm_unnest_sg                     = add_menu("Unnest group",                    "X");
+    idm_nesting_level                 = add_menu("Highlight nesting level",         "L");
 #ifndef PUBLIC
     idm_remove_nodes_from_group       = add_menu("Move node(s) to their own group", "R");
     idm_promote_node_groups           = add_menu("Promote node group",              "P");
@@ -1854,7 +2924,7 @@ public:
   /**
   * @brief Constructor
   */
-  gsgraphview_t(qflow_chart_t *func_fc, gsoptions_t *options)
+  gsgraphview_t(shared_fc_t *func_fc, gsoptions_t *options)
     : func_fc(func_fc),
       options(options),
       idm_single_view_mode(-1),
@@ -1874,12 +2944,24 @@ public:
       idm_test(-1),
       idm_highlight_similar(-1),
       idm_find_highlight(-1),
+      idm_query_highlight(-1),
       idm_combine_ngs(-1),
+      idm_toggle_group(-1),
+      idm_nest_sgs(-1),
+      idm_unnest_sg(-1),
+      idm_nesting_level(-1),
       idm_show_options(-1)
   {
     gv = NULL;
     form = NULL;
+    cur_mg = NULL;
     refresh_mode = options->start_view_mode;
+
+    // With the native groups the groupped view is the ungroupped view collapsed
+    collapse_native_groups = options->native_groups && refresh_mode == gvrfm_combined_mode;
+    creating_native_group = false;
+    if (collapse_native_groups)
+      refresh_mode = gvrfm_single_mode;
     set_callback(NULL);
 
     focus_node = -1;
@@ -1887,92 +2969,500 @@ public:
     cur_node = -1;
     idm_set_sel_mode = -1;
     idm_edit_sg_desc = -1;
+    query_index = NULL;
   }
 
 };
 gsgraphview_t::idmenucbtx_t gsgraphview_t::menu_ids;
 
 //--------------------------------------------------------------------------
-/**
-* @brief Types of lines in the chooser
-*/
-enum gsch_line_type_t
+void query_index_memcache_t::evict(uint64 key)
 {
-  chlt_gm  = 0,
-  chlt_sg  = 1,
-  chlt_ng  = 3,
-};
+  // The next query rebuilds it
+  ((gsgraphview_t *)size_t(key))->invalidate_query_index();
+}
 
 //--------------------------------------------------------------------------
 /**
-* @brief Chooser line structure
+* @brief Call graph quotient view: one node per group of functions.
+*        Double clicking a group shows its functions and double clicking
+*        a function jumps to it
 */
-class gschooser_line_t
+class cgview_t
 {
-public:
-  gsch_line_type_t type;
-  groupman_t *gm;
-  psupergroup_t sg;
-  pnodegroup_t ng;
-  pnodegroup_list_t ngl;
+  callgraph_t cg;
+  qstrvec_t names;
+  qstrvec_t group_names;
 
   /**
-  * @brief Constructor
+  * @brief The groups of functions and the drill down into one group
   */
-  gschooser_line_t()
-  {
-    gm = NULL;
-    sg = NULL;
-    ng = NULL;
-    ngl = NULL;
-  }
-};
-typedef qvector<gschooser_line_t> chooser_lines_vec_t;
-
-//--------------------------------------------------------------------------
-/**
-* @brief GraphSlick chooser class
-*/
-class gschooser_t: public gsgv_actions_t
-{
-private:
-  static gschooser_t *singleton;
-  chooser_lines_vec_t ch_nodes;
-
-  chooser_info_t chi;
-  gsgraphview_t *gsgv;
-  groupman_t *gm;
-  qstring last_loaded_file;
-
-  qflow_chart_t func_fc;
-  gsoptions_t options;
+  cg_quotient_t groups, members;
 
-  PyBBMatcher *py_matcher;
+  /**
+  * @brief The group being shown or -1 when showing the groups
+  */
+  int cur_group;
 
-  static uint32 idaapi s_sizer(void *obj)
-  {
-    return ((gschooser_t *)obj)->on_get_size();
-  }
+  gnodemap_t node_map;
+  graph_viewer_t *gv;
+  TForm *form;
+  gsoptions_t *options;
 
-  static void idaapi s_getl(void *obj, uint32 n, char *const *arrptr)
+  static bool idaapi s_menu_back(void *ud)
   {
-    ((gschooser_t *)obj)->on_get_line(n, arrptr);
+    ((cgview_t *)ud)->show_group(-1);
+    return true;
   }
 
-  static uint32 idaapi s_del(void *obj, uint32 n)
+  static int idaapi _gr_callback(
+      void *ud,
+      int code, va_list va)
   {
-    return ((gschooser_t *)obj)->on_delete(n);
+    return ((cgview_t *)ud)->gr_callback(code, va);
   }
 
-  static void idaapi s_ins(void *obj)
+  /**
+  * @brief Return the display name of a group
+  */
+  void get_group_name(int g, qstring *out)
   {
-    ((gschooser_t *)obj)->on_insert();
+    if (!group_names.empty())
+      *out = group_names[g].empty() ? "(no module)" : group_names[g].c_str();
+    else
+      out->sprnt("cluster of %s", names[groups.get_hub(cg, g)].c_str());
   }
 
-  static void idaapi s_enter(void *obj, uint32 n)
+  /**
+  * @brief Build the graph of the current level from its quotient
+  */
+  void build_graph(mutable_graph_t *mg)
   {
-    ((gschooser_t *)obj)->on_enter(n);
-  }
+    cg_quotient_t &q = cur_group == -1 ? groups : members;
+
+    node_map.clear();
+    mg->resize(q.size());
+    for (int g=0; g < q.size(); g++)
+    {
+      gnode_t *gn = node_map.add(g);
+      gn->id = g;
+      if (cur_group == -1)
+      {
+        get_group_name(g, &gn->text);
+        gn->text.cat_sprnt("\n%d function(s)", q.nmembers(g));
+
+        // List a few functions in the hint
+        int nhint = qmin(q.nmembers(g), 32);
+        for (int k=0; k < nhint; k++)
+          gn->hint.cat_sprnt("%s\n", names[q.members[q.member_start[g] + k]].c_str());
+
+        if (nhint < q.nmembers(g))
+          gn->hint.append("...\n");
+      }
+      else
+      {
+        // One function per group at this level
+        gn->text = names[q.members[q.member_start[g]]];
+      }
+
+      for (int e=q.succ_start[g]; e < q.succ_start[g + 1]; e++)
+        mg->add_edge(g, q.succ[e], NULL);
+    }
+  }
+
+  /**
+  * @brief Show the functions of a group or the groups (-1)
+  */
+  void show_group(int g)
+  {
+    cur_group = g;
+    if (g != -1)
+    {
+      // Number the group's functions
+      intvec_t group_of;
+      group_of.resize(cg.size());
+      std::fill(group_of.begin(), group_of.end(), -1);
+      for (int k=groups.member_start[g], i=0; k < groups.member_start[g + 1]; k++, i++)
+        group_of[groups.members[k]] = i;
+
+      cg_build_quotient(cg, group_of, groups.nmembers(g), members);
+    }
+    refresh_viewer(gv);
+  }
+
+  int gr_callback(int code, va_list va)
+  {
+    int result = 0;
+    switch (code)
+    {
+      case grcode_user_refresh:
+      {
+        mutable_graph_t *mg = va_arg(va, mutable_graph_t *);
+        mg->clear();
+        mg->current_layout = options->graph_layout;
+        build_graph(mg);
+        mg->redo_layout();
+        result = 1;
+        break;
+      }
+
+      case grcode_user_text:
+      {
+        va_arg(va, mutable_graph_t *);
+        int node           = va_arg(va, int);
+        const char **text  = va_arg(va, const char **);
+        va_arg(va, bgcolor_t *);
+
+        gnode_t *gnode = node_map.get(node);
+        if (gnode != NULL)
+        {
+          *text = gnode->text.c_str();
+          result = 1;
+        }
+        break;
+      }
+
+      case grcode_user_hint:
+      {
+        va_arg(va, mutable_graph_t *);
+        int mousenode = va_arg(va, int);
+        va_arg(va, int); // mouseedge_src
+        va_arg(va, int); // mouseedge_dst
+        char **hint = va_arg(va, char **);
+
+        gnode_t *gnode;
+        if (    mousenode != -1
+             && (gnode = node_map.get(mousenode)) != NULL
+             && !gnode->hint.empty())
+        {
+          *hint = qstrdup(gnode->hint.c_str());
+          result = 1;
+        }
+        break;
+      }
+
+      case grcode_dblclicked:
+      {
+        va_arg(va, graph_viewer_t *);
+        selection_item_t *item = va_arg(va, selection_item_t *);
+        if (item == NULL || !item->is_node)
+          break;
+
+        // Drill down into the group or jump to the function
+        if (cur_group == -1)
+          show_group(item->node);
+        else
+          jumpto(cg.funcs[members.members[members.member_start[item->node]]]);
+
+        result = 1;
+        break;
+      }
+
+      case grcode_destroyed:
+      {
+        delete this;
+        break;
+      }
+    }
+    return result;
+  }
+
+  cgview_t(gsoptions_t *options): cur_group(-1), gv(NULL), form(NULL), options(options)
+  {
+  }
+
+public:
+  /**
+  * @brief Build the call graph, group the functions and show the quotient
+  * @param by_modules - group by name prefix, otherwise by call clusters
+  */
+  static cgview_t *show(gsoptions_t *options, bool by_modules)
+  {
+    cgview_t *cgv = new cgview_t(options);
+
+    show_wait_box("Building the call graph...");
+    uint64 t0 = get_nsec_stamp();
+    get_call_graph(cgv->cg, &cgv->names);
+    uint64 t1 = get_nsec_stamp();
+
+    intvec_t group_of;
+    int ngroups;
+    if (by_modules)
+      ngroups = cg_group_by_prefix(cgv->names, group_of, cgv->group_names);
+    else
+      ngroups = cg_group_by_clusters(cgv->cg, group_of);
+    cg_build_quotient(cgv->cg, group_of, ngroups, cgv->groups);
+    uint64 t2 = get_nsec_stamp();
+    hide_wait_box();
+
+    msg(STR_GS_MSG "Call graph: %d function(s) in %.3fs, %d group(s) with %d call edge(s) in %.3fs\n",
+      cgv->cg.size(),
+      (t1 - t0) / 1000000000.0,
+      ngroups,
+      int(cgv->groups.succ.size()),
+      (t2 - t1) / 1000000000.0);
+
+    // Recreate the form if it was there
+    for (int init=0; init < 2; init++)
+    {
+      HWND hwnd = NULL;
+      TForm *form = create_tform(STR_GS_CG_VIEW, &hwnd);
+      if (hwnd == NULL)
+      {
+        close_tform(form, 0);
+        continue;
+      }
+
+      netnode id;
+      id.create("$ GS call graph");
+
+      cgv->form = form;
+      cgv->gv = create_graph_viewer(
+          form,
+          id,
+          _gr_callback,
+          cgv,
+          0);
+
+      open_tform(form, FORM_TAB|FORM_MENU|FORM_QWIDGET);
+      if (cgv->gv == NULL)
+        break;
+
+      viewer_fit_window(cgv->gv);
+      viewer_add_menu_item(
+          cgv->gv,
+          "Back to groups",
+          s_menu_back,
+          cgv,
+          "B",
+          0);
+
+      return cgv;
+    }
+    delete cgv;
+    return NULL;
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Types of lines in the chooser
+*/
+enum gsch_line_type_t
+{
+  chlt_gm  = 0,
+  chlt_sg  = 1,
+  chlt_ng  = 3,
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Chooser columns. The columns from CHCOL_METRICS on show the
+*        group metrics, in the gmetric_key_e order
+*/
+static const char *const chcol_names[] =
+{
+  "Node",
+  "Address",
+  "Insns",
+  "Bytes",
+  "In",
+  "Out",
+  "CC",
+  "Count"
+};
+#define CHCOL_METRICS 3
+
+//--------------------------------------------------------------------------
+/**
+* @brief Chooser line structure
+*/
+class gschooser_line_t
+{
+public:
+  gsch_line_type_t type;
+  groupman_t *gm;
+  psupergroup_t sg;
+  pnodegroup_t ng;
+  pnodegroup_list_t ngl;
+
+  /**
+  * @brief Constructor
+  */
+  gschooser_line_t()
+  {
+    gm = NULL;
+    sg = NULL;
+    ng = NULL;
+    ngl = NULL;
+  }
+};
+typedef qvector<gschooser_line_t> chooser_lines_vec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Orders the groups by one of their metrics. The groups without metrics
+*        and the ties keep their order
+*/
+template <class T>
+struct group_metric_less_t
+{
+  const gm_metrics_t *metrics;
+  int key;
+  bool descending;
+
+  group_metric_less_t(const gm_metrics_t *metrics, int key, bool descending)
+    : metrics(metrics), key(key), descending(descending)
+  {
+  }
+
+  bool operator()(T a, T b) const
+  {
+    const group_metrics_t *ma = metrics->get(a);
+    const group_metrics_t *mb = metrics->get(b);
+    if (ma == NULL || mb == NULL)
+      return false;
+
+    int va = ma->get(key), vb = mb->get(key);
+    return descending ? va > vb : va < vb;
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief GraphSlick chooser class
+*/
+class gschooser_t: public gsgv_actions_t
+{
+private:
+  /**
+  * @brief The open choosers. Each one has its function, groups and graph view
+  */
+  static qvector<gschooser_t *> instances;
+
+  /**
+  * @brief The Python matcher is shared by the choosers. Its analysis state
+  *        (used by FindSimilar) belongs to the last chooser that analyzed
+  */
+  static PyBBMatcher *shared_matcher;
+  static int matcher_refs;
+  static gschooser_t *matcher_owner;
+
+  chooser_lines_vec_t ch_nodes;
+
+  chooser_info_t chi;
+  qstring title, view_title;
+  gsgraphview_t *gsgv;
+  groupman_t *gm;
+  qstring last_loaded_file;
+
+  shared_fc_t *func_fc;
+  gsoptions_t options;
+
+  // The function the chooser was shown for (see show()). Unlike func_fc, it
+  // is set before the flowchart loads and it does not follow Analyze
+  ea_t instance_ea;
+
+  /**
+  * @brief Groups order in the chooser: a metric key (gmk_xxx) or -1 for the file order
+  */
+  int sort_key;
+  bool sort_descending;
+
+  PyBBMatcher *py_matcher;
+
+  /**
+  * @brief Pending Python matcher warm up
+  */
+  qtimer_t warm_timer;
+
+  /**
+  * @brief Streamed analysis: the matcher background task produces, the UI
+  *        timer consumes
+  */
+  typedef spsc_queue_t<int_2dvec_t *, 256> sg_queue_t;
+  sg_queue_t stream_queue;
+  gstask_t *stream_task;
+  qtimer_t stream_timer;
+  std::atomic<bool> stream_done;
+  int stream_sg_count;
+  qstrvec_t streamed_sg_ids;
+  uint64 stream_layout_ms;
+
+  /**
+  * @brief Find similar while another chooser owns the matcher: an interactive
+  *        task analyzes this function again and the completion finds the
+  *        nodes similar to the selection
+  */
+  gstask_t *similar_task;
+  intvec_t similar_sel;
+  bool similar_ok;
+
+  /**
+  * @brief Asynchronous bbgroup file load or save. A scheduler task does the
+  *        file I/O, parsing, formatting and sanitizing. The IDA API steps run
+  *        on the main thread between the task stages. Loading a file the
+  *        user picked is interactive, saving and reloading are background
+  */
+  struct io_job_t
+  {
+    bool is_load;
+    qstring filename;
+
+    // Load: the groupman being built; Save: a copy of the groupman to write
+    groupman_t *gm;
+
+    // Load: flowchart of the file's function, acquired on the main thread
+    shared_fc_t *fc;
+
+    // Load: 0 = parse, 1 = sanitize
+    int stage;
+
+    // Load: analyze the screen function if the file could not be loaded
+    bool analyze_on_failure;
+
+    // Load: the watched file changed, patch the current groupman with it
+    bool is_reload;
+
+    // Save: the file was rewritten instead of appended to
+    bool compacted;
+
+    bool ok;
+  };
+  io_job_t *io_job;
+  gstask_t *io_task;
+
+  /**
+  * @brief The watched bbgroup file (last loaded or saved)
+  */
+  file_watch_t file_watch;
+  qtimer_t watch_timer;
+
+  static uint32 idaapi s_sizer(void *obj)
+  {
+    return ((gschooser_t *)obj)->on_get_size();
+  }
+
+  static void idaapi s_getl(void *obj, uint32 n, char *const *arrptr)
+  {
+    ((gschooser_t *)obj)->on_get_line(n, arrptr);
+  }
+
+  static uint32 idaapi s_del(void *obj, uint32 n)
+  {
+    return ((gschooser_t *)obj)->on_delete(n);
+  }
+
+  static void idaapi s_ins(void *obj)
+  {
+    ((gschooser_t *)obj)->on_insert();
+  }
+
+  static void idaapi s_enter(void *obj, uint32 n)
+  {
+    gssched_scope_t scope(&gs_sched);
+    ((gschooser_t *)obj)->on_enter(n);
+  }
 
   static void idaapi s_refresh(void *obj)
   {
@@ -1999,94 +3489,1524 @@ private:
     ((gschooser_t *)obj)->on_select(sel);
   }
 
-  static uint32 idaapi s_onmenu_save_bbfile(void *obj, uint32 n)
-  {
-    ((gschooser_t *)obj)->onmenu_save_bbfile();
-    return n;
+  static uint32 idaapi s_onmenu_save_bbfile(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_save_bbfile();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_show_graph(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_show_graph();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_analyze(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_analyze();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_auto_find_path(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_analyze();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_find_clones(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_find_clones();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_find_db_clones(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_find_db_clones();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_find_near_duplicates(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_find_near_duplicates();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_analyze_native(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_analyze_native();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_analyze_mined(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_analyze_mined();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_compare_engines(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_compare_engines();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_load_profile(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_load_profile();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_apply_rules(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_apply_rules();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_apply_db_rules(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_apply_db_rules();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_sort_groups(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_sort_groups();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_load_trace(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_load_trace();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_clear_trace(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_clear_trace();
+    return n;
+  }
+
+  static bool s_trace_cancel(void * /*ud*/)
+  {
+    return wasBreak();
+  }
+
+  static uint32 idaapi s_onmenu_show_memory_usage(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_show_memory_usage();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_show_call_graph(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_show_call_graph();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_export_snapshot(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_export_snapshot();
+    return n;
+  }
+
+  static uint32 idaapi s_onmenu_record_db(void *obj, uint32 n)
+  {
+    ((gschooser_t *)obj)->onmenu_record_db();
+    return n;
+  }
+
+  /**
+  * @brief The matcher task and its chooser, passed to the stream callback
+  */
+  struct stream_ctx_t
+  {
+    gschooser_t *ch;
+    gstask_t *task;
+  };
+
+  static void idaapi s_stream_task(gstask_t *task, void *ud)
+  {
+    stream_ctx_t ctx;
+    ctx.ch = (gschooser_t *)ud;
+    ctx.task = task;
+    ctx.ch->py_matcher->AnalyzeStream(s_stream_push, &ctx, s_stream_canceled);
+    ctx.ch->stream_done = true;
+  }
+
+  static void idaapi s_stream_task_done(gstask_t * /*task*/, void *ud)
+  {
+    ((gschooser_t *)ud)->stream_task = NULL;
+  }
+
+  static void idaapi s_similar_task(gstask_t *task, void *ud)
+  {
+    stream_ctx_t ctx;
+    ctx.ch = (gschooser_t *)ud;
+    ctx.task = task;
+    ctx.ch->similar_ok = ctx.ch->py_matcher->AnalyzeStream(s_similar_push, &ctx, s_stream_canceled);
+  }
+
+  static void idaapi s_similar_task_done(gstask_t * /*task*/, void *ud)
+  {
+    ((gschooser_t *)ud)->on_similar_task_done();
+  }
+
+  static bool idaapi s_similar_push(int_2dvec_t & /*sg*/, void * /*ud*/)
+  {
+    // Only the matcher state is needed
+    return true;
+  }
+
+  static void idaapi s_io_task(gstask_t * /*task*/, void *ud)
+  {
+    ((gschooser_t *)ud)->run_io_stage();
+  }
+
+  static void idaapi s_io_task_done(gstask_t * /*task*/, void *ud)
+  {
+    ((gschooser_t *)ud)->on_io_stage_done();
+  }
+
+  static int idaapi s_warm_timer(void *ud)
+  {
+    return ((gschooser_t *)ud)->on_warm_timer();
+  }
+
+  static int idaapi s_watch_timer(void *ud)
+  {
+    return ((gschooser_t *)ud)->on_watch_timer();
+  }
+
+  static bool idaapi s_stream_push(int_2dvec_t &sg, void *ud)
+  {
+    stream_ctx_t *ctx = (stream_ctx_t *)ud;
+    return ctx->ch->on_stream_push(ctx->task, sg);
+  }
+
+  /**
+  * @brief Polled by the matcher loops: stopping the stream does not wait
+  *        for the next accepted group
+  */
+  static bool idaapi s_stream_canceled(void *ud)
+  {
+    return gs_sched.is_canceled(((stream_ctx_t *)ud)->task);
+  }
+
+  static int idaapi s_stream_timer(void *ud)
+  {
+    return ((gschooser_t *)ud)->on_stream_timer();
+  }
+
+  /**
+  * @brief Called from the matcher task for each accepted group. It is the
+  *        task's preemption point
+  */
+  bool on_stream_push(gstask_t *task, int_2dvec_t &sg)
+  {
+    int_2dvec_t *item = new int_2dvec_t();
+    item->swap(sg);
+
+    // Wait for the UI to drain the queue
+    while (!stream_queue.push(item))
+    {
+      if (gs_sched.is_canceled(task))
+      {
+        delete item;
+        return false;
+      }
+      qsleep(10);
+    }
+
+    // Pause while the user is waiting for something
+    return gs_sched.yield(task);
+  }
+
+  /**
+  * @brief Timer callback: move the streamed groups into the live groupman
+  */
+  int on_stream_timer()
+  {
+    // Let the interactive work finish first
+    if (gs_sched.is_interactive_pending())
+      return STREAM_TIMER_INTERVAL;
+
+    // The graph is rebuilt with each merge: merge the queued groups together,
+    // at most once per STREAM_LAYOUT_INTERVAL. The producer waits meanwhile
+    bool done = stream_done;
+    uint64 now_ms = get_nsec_stamp() / 1000000;
+    if (!done && now_ms - stream_layout_ms < STREAM_LAYOUT_INTERVAL)
+      return STREAM_TIMER_INTERVAL;
+
+    qstrvec_t added_ids;
+    int_2dvec_t *item;
+    while (stream_queue.pop(item))
+    {
+      qstring sg_id;
+      sg_id.sprnt("CLONE_%d", stream_sg_count);
+      if (merge_2dvec_into_groupman(*item, gm, sg_id.c_str()) != NULL)
+      {
+        streamed_sg_ids.push_back(sg_id);
+        added_ids.push_back(sg_id);
+        ++stream_sg_count;
+      }
+      delete item;
+    }
+
+    if (!added_ids.empty())
+    {
+      stream_layout_ms = now_ms;
+      refresh(true);
+      if (gsgv != NULL)
+      {
+        // The highlighting of the previous ticks and of the user stays
+        gsgv->redo_layout_keep_highlighting();
+        highlight_sgs_by_id(added_ids);
+      }
+      msg(STR_GS_MSG "Analysis found %d new group(s)\n", int(added_ids.size()));
+    }
+
+    // Still running?
+    if (!stream_done || !stream_queue.empty())
+      return STREAM_TIMER_INTERVAL;
+
+    msg(STR_GS_MSG "Analysis finished with %d group(s)\n", stream_sg_count);
+
+    // The timer unregisters itself
+    stream_timer = NULL;
+    stop_streaming();
+    return -1;
+  }
+
+  /**
+  * @brief Add the super groups with the given ids to the highlighting
+  */
+  void highlight_sgs_by_id(const qstrvec_t &ids)
+  {
+    supergroup_listp_t sgl;
+    psupergroup_listp_t path_sgl = gm->get_path_sgl();
+    for (supergroup_listp_t::iterator it=path_sgl->begin();
+         it != path_sgl->end();
+         ++it)
+    {
+      psupergroup_t sg = *it;
+      if (std::find(ids.begin(), ids.end(), sg->id) != ids.end())
+        sgl.push_back(sg);
+    }
+
+    DECL_CG;
+    gsgv->highlight_nodes(&sgl, cg, options.manual_refresh_mode);
+  }
+
+  /**
+  * @brief Make this chooser the owner of the matcher state.
+  *        Fails while another chooser analyzes in the background
+  */
+  bool claim_matcher()
+  {
+    // The matcher is initialized on first use
+    if (py_matcher == NULL && !acquire_matcher())
+      return false;
+
+    if (   matcher_owner != NULL
+        && matcher_owner != this
+        && (   matcher_owner->stream_task != NULL
+            || matcher_owner->similar_task != NULL))
+    {
+      msg(STR_GS_MSG "The matcher is busy analyzing another function!\n");
+      return false;
+    }
+
+    matcher_owner = this;
+    return true;
+  }
+
+  /**
+  * @brief Start analyzing a function in the background
+  */
+  bool start_streaming(ea_t func_ea)
+  {
+    if (!claim_matcher() || !py_matcher->Prepare(func_ea))
+      return false;
+
+    stream_done = false;
+    stream_sg_count = 0;
+    streamed_sg_ids.clear();
+    stream_layout_ms = 0;
+
+    stream_task = gs_sched.post(gsp_background, s_stream_task, s_stream_task_done, this);
+    if (stream_task == NULL)
+      return false;
+    pump_sched_later();
+
+    stream_timer = register_timer(STREAM_TIMER_INTERVAL, s_stream_timer, this);
+    msg(STR_GS_MSG "Analyzing function at %a in the background...\n", func_ea);
+    return true;
+  }
+
+  /**
+  * @brief The function was analyzed again: find the nodes similar to the
+  *        selection that was pending
+  */
+  void on_similar_task_done()
+  {
+    similar_task = NULL;
+    if (similar_ok)
+    {
+      show_similar(similar_sel);
+    }
+    else
+    {
+      msg(STR_GS_MSG "Failed to analyze the function again\n");
+      matcher_owner = NULL;
+    }
+    similar_sel.qclear();
+  }
+
+  /**
+  * @brief Cancel the pending find similar: the matcher state is incomplete
+  */
+  void cancel_similar()
+  {
+    if (similar_task == NULL)
+      return;
+
+    gs_sched.cancel(similar_task);
+    similar_task = NULL;
+    similar_sel.qclear();
+    if (matcher_owner == this)
+      matcher_owner = NULL;
+  }
+
+  /**
+  * @brief Cancel (if needed) and clean up the background analysis
+  */
+  void stop_streaming()
+  {
+    if (stream_timer != NULL)
+    {
+      unregister_timer(stream_timer);
+      stream_timer = NULL;
+    }
+
+    if (stream_task != NULL)
+    {
+      gs_sched.cancel(stream_task);
+      stream_task = NULL;
+    }
+
+    // Discard what was not consumed
+    int_2dvec_t *item;
+    while (stream_queue.pop(item))
+      delete item;
+  }
+
+  /**
+  * @brief Task side of the asynchronous load/save. No IDA API calls here
+  */
+  void run_io_stage()
+  {
+    io_job_t *job = io_job;
+    if (!job->is_load)
+    {
+      job->ok = job->gm->emit_append(job->filename.c_str(), &job->compacted);
+    }
+    else if (job->stage == 0)
+    {
+      // Don't init cache yet because file may be optimized
+      job->ok = job->gm->parse(job->filename.c_str(), false);
+    }
+    else
+    {
+      // Written for this very flowchart? Then it is complete as is
+      // otherwise de-optimize the input file
+      if (   job->gm->matches_flowchart(get_fc_fingerprint(job->fc), job->fc->size())
+          || sanitize_groupman(BADADDR, job->gm, job->fc))
+      {
+        // Now initialize the cache
+        job->gm->initialize_lookups();
+      }
+      job->ok = true;
+    }
+  }
+
+  /**
+  * @brief Start the current I/O job stage as a scheduler task
+  */
+  bool start_io_stage()
+  {
+    gssched_prio_e prio = io_job->is_load && !io_job->is_reload ? gsp_interactive : gsp_background;
+    io_task = gs_sched.post(prio, s_io_task, s_io_task_done, this);
+    if (io_task == NULL)
+      return false;
+
+    pump_sched_later();
+    return true;
+  }
+
+  /**
+  * @brief Start an asynchronous load or save job (waits for the previous one)
+  */
+  bool start_io_job(io_job_t *job)
+  {
+    finish_io_job();
+
+    io_job = job;
+    job->stage = 0;
+    job->ok = false;
+    if (!start_io_stage())
+    {
+      msg(STR_GS_MSG "Error: failed to start the I/O task\n");
+      delete job->gm;
+      delete job;
+      io_job = NULL;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+  * @brief Main thread side of the load: locate the function and build its flowchart
+  */
+  bool prepare_loaded_file(io_job_t *job)
+  {
+    // Get an address from the parsed file
+    nodedef_t *nd = job->gm->get_first_nd();
+    if (nd == NULL)
+    {
+      msg(STR_GS_MSG "Invalid input file! No addresses defined\n");
+      return false;
+    }
+
+    // Get related function
+    func_t *f = get_func(nd->start);
+    if (f == NULL)
+    {
+      msg(STR_GS_MSG "Input file does not related to a defined function!\n");
+      return false;
+    }
+
+    job->fc = acquire_shared_fc(f->startEA);
+    if (job->fc == NULL)
+    {
+      msg(STR_GS_MSG "Could not build function flow chart at %a\n", f->startEA);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+  * @brief Watch the bbgroup file that was loaded or saved
+  */
+  void watch_file(const char *filename)
+  {
+    if (!options.hot_reload)
+      return;
+
+    if (qstrcmp(file_watch.get_path(), filename) == 0)
+    {
+      // Our own write
+      file_watch.rearm();
+      return;
+    }
+
+    if (!file_watch.start(filename))
+      return;
+
+    if (watch_timer == NULL)
+      watch_timer = register_timer(WATCH_TIMER_INTERVAL, s_watch_timer, this);
+  }
+
+  /**
+  * @brief Stop watching the bbgroup file
+  */
+  void unwatch_file()
+  {
+    if (watch_timer != NULL)
+    {
+      unregister_timer(watch_timer);
+      watch_timer = NULL;
+    }
+    file_watch.stop();
+  }
+
+  /**
+  * @brief Timer callback: reload the watched file if it changed
+  */
+  int on_watch_timer()
+  {
+    // Check again once the pending work is done
+    if (   io_job != NULL
+        || stream_task != NULL
+        || gs_sched.is_interactive_pending())
+    {
+      return WATCH_TIMER_INTERVAL;
+    }
+
+    if (file_watch.poll())
+    {
+      msg(STR_GS_MSG "'%s' changed, reloading...\n", file_watch.get_path());
+
+      io_job_t *job = new io_job_t();
+      job->is_load = true;
+      job->is_reload = true;
+      job->filename = file_watch.get_path();
+      job->gm = new groupman_t();
+      job->fc = NULL;
+      job->analyze_on_failure = false;
+      job->compacted = false;
+      start_io_job(job);
+    }
+    return WATCH_TIMER_INTERVAL;
+  }
+
+  /**
+  * @brief Patch the current groupman with the reloaded file. The unchanged
+  *        super groups are left as they are
+  */
+  void patch_reloaded_file(io_job_t *job)
+  {
+    qstrvec_t changed_ids;
+    int count = gm->patch_from(job->gm, &changed_ids);
+
+    // The file now holds what the groupman holds
+    gm->filestate = job->gm->filestate;
+
+    if (count == 0)
+    {
+      msg(STR_GS_MSG "No super group changed\n");
+      return;
+    }
+
+    msg(STR_GS_MSG "%d super group(s) changed\n", count);
+    refresh(true);
+    if (gsgv != NULL)
+    {
+      // The user's highlighting stays: the changed groups are added to it
+      gsgv->redo_layout_keep_highlighting();
+      highlight_sgs_by_id(changed_ids);
+    }
+  }
+
+  /**
+  * @brief Swap the loaded groupman and flowchart in and show them
+  */
+  void commit_loaded_file(io_job_t *job)
+  {
+    // Same function: patch the changed groups only
+    if (job->is_reload && gm != NULL && job->fc == func_fc)
+    {
+      patch_reloaded_file(job);
+      return;
+    }
+
+    // The streamed analysis feeds the groupman that goes away
+    stop_streaming();
+
+    // Delete the previous group manager and assign the new one
+    delete gm;
+    gm = job->gm;
+    job->gm = NULL;
+
+    release_shared_fc(func_fc);
+    func_fc = job->fc;
+    job->fc = NULL;
+
+    populate_chooser_lines();
+    show_graph();
+
+    // Remember last loaded file
+    last_loaded_file = job->filename;
+    watch_file(job->filename.c_str());
+  }
+
+  /**
+  * @brief Task completion (main thread): advance the I/O job to its next stage
+  */
+  void on_io_stage_done()
+  {
+    io_task = NULL;
+
+    io_job_t *job = io_job;
+    if (job->is_load && job->ok && job->stage == 0)
+    {
+      job->stage = 1;
+      if (prepare_loaded_file(job) && start_io_stage())
+        return;
+      job->ok = false;
+    }
+
+    end_io_job();
+  }
+
+  /**
+  * @brief Report and dispose the I/O job once its worker is done
+  */
+  void end_io_job()
+  {
+    io_job_t *job = io_job;
+    io_job = NULL;
+
+    if (!job->is_load)
+    {
+      if (job->ok)
+      {
+        // The file now holds what the copy held
+        if (gm != NULL)
+          gm->filestate = job->gm->filestate;
+
+        watch_file(job->filename.c_str());
+
+        msg(STR_GS_MSG "Saved '%s'%s\n", 
+          job->filename.c_str(),
+          job->compacted ? " (rewritten)" : "");
+      }
+      else
+        msg(STR_GS_MSG "Error: failed to save group file '%s'\n", job->filename.c_str());
+    }
+    else if (job->ok && job->stage == 1)
+    {
+      commit_loaded_file(job);
+    }
+    else
+    {
+      if (job->stage == 0)
+        msg(STR_GS_MSG "Error: failed to parse group file '%s'\n", job->filename.c_str());
+
+      if (job->analyze_on_failure)
+      {
+        const char *fn = job->filename.c_str();
+        onmenu_analyze(fn);
+        gm->src_filename = fn;
+        last_loaded_file = fn;
+      }
+    }
+
+    release_shared_fc(job->fc);
+    delete job->gm;
+    delete job;
+  }
+
+  /**
+  * @brief Wait for a pending save. A pending load is discarded
+  */
+  void finish_io_job()
+  {
+    if (io_job == NULL)
+      return;
+
+    io_job_t *job = io_job;
+    if (job->is_load)
+    {
+      // Discard the pending load
+      if (io_task != NULL)
+      {
+        gs_sched.cancel(io_task);
+        io_task = NULL;
+      }
+      msg(STR_GS_MSG "Loading of '%s' was canceled\n", job->filename.c_str());
+      io_job = NULL;
+      release_shared_fc(job->fc);
+      delete job->gm;
+      delete job;
+    }
+    else if (io_task != NULL)
+    {
+      // The completion ends the job
+      gs_sched.wait(io_task);
+    }
+    else
+    {
+      end_io_job();
+    }
+  }
+
+  /**
+  * @brief Handle the save bbgroup menu command
+  */
+  void onmenu_save_bbfile()
+  {
+    const char *filename = askfile_c(
+        1,
+        last_loaded_file.empty() ? "*." BBGROUP_EXT : last_loaded_file.c_str(),
+        "Please select BBGROUP file to save to");
+
+    if (filename == NULL || gm == NULL)
+      return;
+
+    queue_save_file(filename);
+  }
+
+  /**
+  * @brief TODO
+  */
+  void onmenu_analyze(const char *def_filename = NULL)
+  {
+      func_t *f = get_func(get_screen_ea());
+      if (f == NULL)
+      {
+          msg(STR_GS_MSG "No function at the cursor location!");
+          return;
+      }
+
+      // Cancel a previous background analysis
+      stop_streaming();
+
+#ifndef NO_PYTHON
+      // Stream the results: start with ungroupped nodes and add groups as they are found
+      if (options.stream_analyze && !options.no_initial_path_info)
+      {
+          if (!get_flowchart(f->startEA))
+              return;
+
+          build_groupman_from_fc(func_fc, gm, true);
+          if (def_filename != NULL)
+              gm->src_filename = def_filename;
+
+          refresh(true);
+          if (gsgv == NULL)
+              show_graph();
+          else
+              gsgv->redo_current_layout();
+
+          if (start_streaming(f->startEA))
+              return;
+
+          msg(STR_GS_MSG "Could not start the background analysis, analyzing synchronously...\n");
+      }
+#endif
+
+      // Call Analyzer
+      int_3dvec_t result;
+#ifndef NO_PYTHON
+      if (!claim_matcher())
+          return;
+
+      py_matcher->Analyze(f->startEA, result);
+#endif
+      if (!get_flowchart(f->startEA))
+          return;
+
+      // reset groupping
+      if (result.empty() || options.no_initial_path_info)
+      {
+          // Retrieve initial groupping information
+          build_groupman_from_fc(func_fc, gm, true);
+      }
+      else
+      {
+          if (result.empty())
+          {
+              msg(STR_GS_MSG "Failed to analyze function at %a\n", f->startEA);
+              return;
+          }
+
+          // Build the groupping information from the analyze() result
+          build_groupman_from_3dvec(func_fc, result, gm, true);
+      }
+
+      if (gm->src_filename.empty() && def_filename != NULL)
+          gm->src_filename = def_filename;
+
+      // Refresh the chooser
+      refresh(true);
+
+      if (gsgv == NULL)
+          show_graph();
+      else
+          gsgv->redo_current_layout();
+  }
+
+  /**
+  * @brief Remove the sub-block clones found previously from the similar SGL
+  */
+  void clear_subclone_sgs(const char *prefix = STR_SUBCLONE_ID_PREFIX)
+  {
+    size_t prefix_len = strlen(prefix);
+    psupergroup_listp_t sgl = gm->get_similar_sgl();
+    for (supergroup_listp_t::iterator it=sgl->begin(); it != sgl->end(); )
+    {
+      psupergroup_t sg = *it;
+      ++it;
+      if (strncmp(sg->id.c_str(), prefix, prefix_len) == 0)
+      {
+        gm->remove_supergroup(sgl, sg);
+        delete sg;
+      }
+    }
+  }
+
+  /**
+  * @brief Find the sub-block clones in the current function.
+  *        Each clone becomes a similar SG, each occurrence an ND (nid = containing block)
+  */
+  void onmenu_find_clones()
+  {
+    if (gm == NULL || func_fc == NULL)
+    {
+      msg(STR_GS_MSG "No function is loaded!\n");
+      return;
+    }
+
+    const func_features_t *ff = func_fc->get_features();
+    if (ff == NULL)
+      return;
+
+    clone_params_t params;
+    params.min_insns = options.clone_min_insns;
+    clone_groupvec_t clones;
+    find_subblock_clones(ff, 1, params, clones);
+
+    clear_subclone_sgs();
+
+    supergroup_listp_t clone_sgl;
+    for (size_t i=0; i < clones.size(); i++)
+    {
+      clone_group_t &cg = clones[i];
+
+      psupergroup_t sg = gm->add_supergroup(gm->get_similar_sgl());
+      sg->id.sprnt("%s%d", STR_SUBCLONE_ID_PREFIX, int(i));
+      sg->name.sprnt("Sub-block clone %d (%d instructions)", int(i), cg.ninsns);
+      for (clone_rangevec_t::iterator it=cg.ranges.begin(); it != cg.ranges.end(); ++it)
+      {
+        pnodedef_t nd = sg->add_nodegroup()->add_node();
+        nd->nid = it->block;
+        nd->start = it->start;
+        nd->end = it->end;
+
+        msg(STR_GS_MSG "%s: %a-%a (node %d)\n", sg->id.c_str(), nd->start, nd->end, nd->nid);
+      }
+      clone_sgl.push_back(sg);
+    }
+    msg(STR_GS_MSG "Found %d sub-block clone(s)\n", int(clones.size()));
+
+    if (clone_sgl.empty() || gsgv == NULL)
+      return;
+
+    // Clones are highlighted per block, that is only meaningful in the single view mode
+    if (gsgv->get_view_mode() != gvrfm_single_mode)
+      gsgv->redo_layout(gvrfm_single_mode);
+
+    DECL_CG;
+    gsgv->clear_highlighting(true);
+    gsgv->highlight_nodes(&clone_sgl, cg, options.manual_refresh_mode);
+  }
+
+  /**
+  * @brief Find the sub-block clones across all the functions and list them
+  */
+  void onmenu_find_db_clones()
+  {
+    show_wait_box("Extracting features...");
+    func_featvec_t funcs;
+    get_db_features(funcs);
+
+    replace_wait_box("Finding sub-block clones...");
+    clone_params_t params;
+    params.min_insns = options.clone_min_insns;
+    clone_groupvec_t clones;
+    find_subblock_clones(funcs.begin(), funcs.size(), params, clones);
+    hide_wait_box();
+
+    for (size_t i=0; i < clones.size(); i++)
+    {
+      clone_group_t &cg = clones[i];
+      msg(STR_GS_MSG "Clone %d: %d instructions, %d occurrences\n", 
+        int(i), 
+        cg.ninsns, 
+        int(cg.ranges.size()));
+
+      for (clone_rangevec_t::iterator it=cg.ranges.begin(); it != cg.ranges.end(); ++it)
+      {
+        msg(STR_GS_MSG "  %a-%a in %a\n", 
+          it->start, 
+          it->end, 
+          funcs[it->func].ea);
+      }
+    }
+    msg(STR_GS_MSG "Found %d sub-block clone(s) in %d function(s)\n", 
+      int(clones.size()), 
+      int(funcs.size()));
+  }
+
+  /**
+  * @brief Find the blocks of the current function that differ by a few instructions.
+  *        Each set of near-duplicates becomes a similar SG, each block an NG
+  */
+  void onmenu_find_near_duplicates()
+  {
+    if (gm == NULL || func_fc == NULL)
+    {
+      msg(STR_GS_MSG "No function is loaded!\n");
+      return;
+    }
+
+    const func_features_t *ff = func_fc->get_features();
+    if (ff == NULL)
+      return;
+
+    bbalign_params_t params;
+    params.max_dist = options.neardup_max_dist;
+    bbalign_groupvec_t groups;
+    bbalign_stats_t stats;
+    find_near_duplicate_blocks(ff, 1, params, groups, &stats);
+
+    clear_subclone_sgs(STR_NEARDUP_ID_PREFIX);
+
+    supergroup_listp_t neardup_sgl;
+    for (size_t i=0; i < groups.size(); i++)
+    {
+      bbalign_group_t &grp = groups[i];
+
+      psupergroup_t sg = gm->add_supergroup(gm->get_similar_sgl());
+      sg->id.sprnt("%s%d", STR_NEARDUP_ID_PREFIX, int(i));
+      sg->name.sprnt("Near-duplicate blocks %d (distance %d)", int(i), grp.max_dist);
+      for (size_t k=0; k < grp.blocks.size(); k++)
+      {
+        const bbfeat_block_t &bb = ff->blocks[grp.blocks[k].block];
+        pnodedef_t nd = sg->add_nodegroup()->add_node();
+        nd->nid = grp.blocks[k].block;
+        nd->start = bb.start;
+        nd->end = bb.end;
+      }
+      neardup_sgl.push_back(sg);
+    }
+    msg(STR_GS_MSG "Found %d near-duplicate block set(s) (candidates: %d, prefiltered: %d, aligned: %d, confirmed: %d)\n",
+        int(groups.size()), stats.candidates, stats.prefiltered, stats.aligned, stats.confirmed);
+
+    if (neardup_sgl.empty() || gsgv == NULL)
+      return;
+
+    if (gsgv->get_view_mode() != gvrfm_single_mode)
+      gsgv->redo_layout(gvrfm_single_mode);
+
+    DECL_CG;
+    gsgv->clear_highlighting(true);
+    gsgv->highlight_nodes(&neardup_sgl, cg, options.manual_refresh_mode);
+  }
+
+  /**
+  * @brief Run the native repeated paths engine on the current function's flowchart
+  */
+  bool analyze_native(
+    int_3dvec_t &result, 
+    repath_stats_t *stats = NULL)
+  {
+    const func_features_t *ff = func_fc->get_features();
+    if (ff == NULL)
+      return false;
+
+    repath_params_t params;
+    params.min_blocks = options.path_min_blocks;
+    find_repeated_paths(*ff, params, result, stats);
+    return true;
+  }
+
+  /**
+  * @brief Analyze the function with the native repeated paths engine
+  */
+  void onmenu_analyze_native()
+  {
+    func_t *f = get_func(get_screen_ea());
+    if (f == NULL)
+    {
+      msg(STR_GS_MSG "No function at the cursor location!\n");
+      return;
+    }
+
+    stop_streaming();
+    if (!get_flowchart(f->startEA))
+      return;
+
+    int_3dvec_t result;
+    if (!analyze_native(result))
+      return;
+
+    build_groupman_from_3dvec(func_fc, result, gm, true);
+    msg(STR_GS_MSG "Native engine found %d group(s)\n", int(result.size()));
+
+    refresh(true);
+    if (gsgv == NULL)
+      show_graph();
+    else
+      gsgv->redo_current_layout();
+  }
+
+  /**
+  * @brief Run the frequent subgraphs miner on the current function's flowchart
+  */
+  bool analyze_mined(
+    int_3dvec_t &result,
+    fsg_stats_t *stats = NULL)
+  {
+    const func_features_t *ff = func_fc->get_features();
+    if (ff == NULL)
+      return false;
+
+    fsg_params_t params;
+    params.min_support = options.mine_min_support;
+    params.min_blocks = options.path_min_blocks;
+    params.max_blocks = options.mine_max_blocks;
+    mine_frequent_subgraphs(*ff, params, result, stats);
+    return true;
+  }
+
+  /**
+  * @brief Analyze the function with the frequent subgraphs miner
+  */
+  void onmenu_analyze_mined()
+  {
+    func_t *f = get_func(get_screen_ea());
+    if (f == NULL)
+    {
+      msg(STR_GS_MSG "No function at the cursor location!\n");
+      return;
+    }
+
+    stop_streaming();
+    if (!get_flowchart(f->startEA))
+      return;
+
+    int_3dvec_t result;
+    fsg_stats_t stats;
+    if (!analyze_mined(result, &stats))
+      return;
+
+    build_groupman_from_3dvec(func_fc, result, gm, true);
+    msg(STR_GS_MSG "Subgraphs miner found %d group(s) (patterns: %d, non canonical: %d, truncated: %d)\n",
+        int(result.size()), stats.patterns, stats.non_canonical, stats.truncated);
+
+    refresh(true);
+    if (gsgv == NULL)
+      show_graph();
+    else
+      gsgv->redo_current_layout();
+  }
+
+  /**
+  * @brief Collect the nodes that belong to an SG with more than one NG
+  */
+  static void get_grouped_nodes(int_3dvec_t &result, intset_t &nodes)
+  {
+    for (int_3dvec_t::iterator it_sg=result.begin(); it_sg != result.end(); ++it_sg)
+    {
+      if (it_sg->size() < 2)
+        continue;
+
+      for (int_2dvec_t::iterator it_ng=it_sg->begin(); it_ng != it_sg->end(); ++it_ng)
+        nodes.insert(it_ng->begin(), it_ng->end());
+    }
+  }
+
+  /**
+  * @brief Run the Python matcher and the native engines on the function
+  *        and report the recall of the native engines and the timings
+  */
+  void onmenu_compare_engines()
+  {
+#ifndef NO_PYTHON
+    func_t *f = get_func(get_screen_ea());
+    if (f == NULL || !get_flowchart(f->startEA))
+      return;
+
+    stop_streaming();
+    if (!claim_matcher())
+      return;
+
+    int_3dvec_t py_result, native_result, mined_result;
+    uint64 t0 = get_nsec_stamp();
+    py_matcher->Analyze(f->startEA, py_result);
+    uint64 t1 = get_nsec_stamp();
+    repath_stats_t stats;
+    analyze_native(native_result, &stats);
+    uint64 t2 = get_nsec_stamp();
+    fsg_stats_t mined_stats;
+    analyze_mined(mined_result, &mined_stats);
+    uint64 t3 = get_nsec_stamp();
+
+    intset_t py_nodes, native_nodes, mined_nodes;
+    get_grouped_nodes(py_result, py_nodes);
+    get_grouped_nodes(native_result, native_nodes);
+    get_grouped_nodes(mined_result, mined_nodes);
+
+    int common = 0, mined_common = 0;
+    for (intset_t::iterator it=py_nodes.begin(); it != py_nodes.end(); ++it)
+    {
+      if (native_nodes.find(*it) != native_nodes.end())
+        ++common;
+      if (mined_nodes.find(*it) != mined_nodes.end())
+        ++mined_common;
+    }
+
+    msg(STR_GS_MSG "Engines comparison for %a (%d nodes):\n"
+        STR_GS_MSG "  Python: %d group(s), %d grouped node(s), %.3f ms\n"
+        STR_GS_MSG "  Native: %d group(s), %d grouped node(s), %.3f ms (sequence: %d, states: %d, candidates: %d, multi-entry: %d)\n"
+        STR_GS_MSG "  Miner: %d group(s), %d grouped node(s), %.3f ms (seeds: %d, patterns: %d, non canonical: %d, truncated: %d, multi-entry: %d)\n"
+        STR_GS_MSG "  Recall: native %d/%d (%.1f%%), miner %d/%d (%.1f%%)\n",
+        f->startEA, int(func_fc->size()),
+        int(py_result.size()), int(py_nodes.size()), (t1 - t0) / 1000000.0,
+        int(native_result.size()), int(native_nodes.size()), (t2 - t1) / 1000000.0,
+        stats.seq_len, stats.nstates, stats.candidates, stats.rejected_entry,
+        int(mined_result.size()), int(mined_nodes.size()), (t3 - t2) / 1000000.0,
+        mined_stats.seeds, mined_stats.patterns, mined_stats.non_canonical,
+        mined_stats.truncated, mined_stats.rejected_entry,
+        common, int(py_nodes.size()),
+        py_nodes.empty() ? 100.0 : 100.0 * common / py_nodes.size(),
+        mined_common, int(py_nodes.size()),
+        py_nodes.empty() ? 100.0 : 100.0 * mined_common / py_nodes.size());
+#endif
+  }
+
+  /**
+  * @brief Load matcher thresholds generated by bb_tune.py
+  */
+  void onmenu_load_profile()
+  {
+#ifndef NO_PYTHON
+    const char *filename = askfile_c(
+        0,
+        "*.profile",
+        "Please select the matcher profile to load");
+
+    if (filename == NULL || !claim_matcher())
+      return;
+
+    if (py_matcher->LoadProfile(filename))
+      msg(STR_GS_MSG "Loaded matcher profile '%s'\n", filename);
+    else
+      msg(STR_GS_MSG "Failed to load matcher profile '%s'\n", filename);
+#endif
+  }
+
+  /**
+  * @brief Ask for a rules file and compile it
+  */
+  bool ask_rules(rulevec_t &rules)
+  {
+    const char *filename = askfile_c(
+        0,
+        "*." RULES_EXT,
+        "Please select the grouping rules file");
+
+    if (filename == NULL)
+      return false;
+
+    qstring err;
+    if (!compile_rules_file(filename, rules, &err))
+    {
+      msg(STR_GS_MSG "Error: %s: %s\n", filename, err.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /**
+  * @brief Group the blocks of the current function with rules.
+  *        Each matching rule becomes a similar SG, each block an NG
+  */
+  void onmenu_apply_rules()
+  {
+    if (gm == NULL || func_fc == NULL)
+    {
+      msg(STR_GS_MSG "No function is loaded!\n");
+      return;
+    }
+
+    rulevec_t rules;
+    if (!ask_rules(rules))
+      return;
+
+    const func_features_t *ff = func_fc->get_features();
+    if (ff == NULL)
+      return;
+
+    rule_matchvec_t matches;
+    rules_evaluate(rules, ff, 1, matches, 1);
+
+    clear_subclone_sgs(STR_RULE_ID_PREFIX);
+
+    supergroup_listp_t rule_sgl;
+    for (size_t i=0; i < matches.size(); i++)
+    {
+      rule_match_t &m = matches[i];
+
+      psupergroup_t sg = gm->add_supergroup(gm->get_similar_sgl());
+      sg->id.sprnt("%s%s", STR_RULE_ID_PREFIX, rules[m.rule].name.c_str());
+      sg->name.sprnt("Rule %s (%d blocks)", rules[m.rule].name.c_str(), int(m.blocks.size()));
+      for (size_t k=0; k < m.blocks.size(); k++)
+      {
+        const bbfeat_block_t &bb = ff->blocks[m.blocks[k]];
+        pnodedef_t nd = sg->add_nodegroup()->add_node();
+        nd->nid = m.blocks[k];
+        nd->start = bb.start;
+        nd->end = bb.end;
+      }
+      msg(STR_GS_MSG "%s: %d block(s)\n", sg->id.c_str(), int(m.blocks.size()));
+      rule_sgl.push_back(sg);
+    }
+    msg(STR_GS_MSG "%d of %d rule(s) matched\n", int(matches.size()), int(rules.size()));
+
+    if (rule_sgl.empty() || gsgv == NULL)
+      return;
+
+    // Blocks are highlighted individually
+    if (gsgv->get_view_mode() != gvrfm_single_mode)
+      gsgv->redo_layout(gvrfm_single_mode);
+
+    DECL_CG;
+    gsgv->clear_highlighting(true);
+    gsgv->highlight_nodes(&rule_sgl, cg, options.manual_refresh_mode);
+  }
+
+  /**
+  * @brief Apply grouping rules to all the functions and list the matches
+  */
+  void onmenu_apply_db_rules()
+  {
+    rulevec_t rules;
+    if (!ask_rules(rules))
+      return;
+
+    show_wait_box("Extracting features...");
+    func_featvec_t funcs;
+    get_db_features(funcs);
+
+    replace_wait_box("Applying rules...");
+    uint64 t0 = get_nsec_stamp();
+    rule_matchvec_t matches;
+    rules_evaluate(rules, funcs.begin(), funcs.size(), matches);
+    uint64 t1 = get_nsec_stamp();
+    hide_wait_box();
+
+    intvec_t nfuncs, nblocks;
+    nfuncs.resize(rules.size(), 0);
+    nblocks.resize(rules.size(), 0);
+    for (size_t i=0; i < matches.size(); i++)
+    {
+      rule_match_t &m = matches[i];
+      func_features_t &ff = funcs[m.func];
+      ++nfuncs[m.rule];
+      nblocks[m.rule] += int(m.blocks.size());
+
+      for (size_t k=0; k < m.blocks.size(); k++)
+      {
+        const bbfeat_block_t &bb = ff.blocks[m.blocks[k]];
+        msg(STR_GS_MSG "%s: %a-%a in %a\n", 
+          rules[m.rule].name.c_str(), 
+          bb.start, 
+          bb.end, 
+          ff.ea);
+      }
+    }
+
+    for (size_t r=0; r < rules.size(); r++)
+    {
+      msg(STR_GS_MSG "Rule %s: %d block(s) in %d function(s)\n", 
+        rules[r].name.c_str(), 
+        nblocks[r], 
+        nfuncs[r]);
+    }
+    msg(STR_GS_MSG "Applied %d rule(s) to %d function(s) in %.3fs\n", 
+      int(rules.size()), 
+      int(funcs.size()), 
+      (t1 - t0) / 1000000000.0);
+  }
+
+  /**
+  * @brief Show the call graph with the functions grouped
+  */
+  void onmenu_show_call_graph()
+  {
+    int code = askbuttons_c(
+      "Modules",  // YES
+      "Clusters", // NO
+      "Cancel",   // CANCEL
+      ASKBTN_YES,
+      "Group the functions by name prefix (modules) or by call clusters?");
+
+    if (code == ASKBTN_CANCEL)
+      return;
+
+    cgview_t::show(&options, code == ASKBTN_YES);
+  }
+
+  /**
+  * @brief Aggregate a block-hit trace file per group and show it as a heatmap
+  */
+  void onmenu_load_trace()
+  {
+    if (gm == NULL || gsgv == NULL)
+    {
+      msg(STR_GS_MSG "No groups are shown!\n");
+      return;
+    }
+
+    const char *filename = askfile_c(
+        0,
+        "*.*",
+        "Please select the trace file");
+
+    if (filename == NULL)
+      return;
+
+    show_wait_box("Aggregating trace...");
+    uint64 t0 = get_nsec_stamp();
+    trace_aggregator_t aggregator;
+    aggregator.build(gm);
+    bool ok = aggregator.add_file(filename, s_trace_cancel);
+    trace_heat_t heat;
+    aggregator.get_heat(heat);
+    double secs = double(get_nsec_stamp() - t0) / 1e9;
+    hide_wait_box();
+
+    if (!ok)
+    {
+      msg(STR_GS_MSG "Trace '%s' could not be read or was canceled\n", filename);
+      return;
+    }
+
+    const trace_stats_t &stats = aggregator.get_stats();
+    msg(STR_GS_MSG "Trace: %" FMT_64 "u event(s), %" FMT_64 "u in the groups (%" FMT_64 "u hits), %" FMT_64 "u bad line(s) in %.2f s (%.0f events/s)\n",
+      stats.events,
+      stats.resolved,
+      stats.hits,
+      stats.bad_lines,
+      secs,
+      secs > 0 ? double(stats.events) / secs : 0.0);
+
+    // The hottest super groups
+    typedef std::multimap<uint64, psupergroup_t> hot_sgs_t;
+    hot_sgs_t hot_sgs;
+    for (std::map<psupergroup_t, uint64>::iterator it=heat.sgs.begin();
+         it != heat.sgs.end();
+         ++it)
+    {
+      hot_sgs.insert(std::make_pair(it->second, it->first));
+    }
+
+    int shown = 0;
+    for (hot_sgs_t::reverse_iterator it=hot_sgs.rbegin();
+         it != hot_sgs.rend() && shown < 10;
+         ++it, ++shown)
+    {
+      msg("  %-32s: %" FMT_64 "u\n", it->second->get_display_name("(unnamed)"), it->first);
+    }
+
+    gsgv->set_heat(heat);
   }
 
-  static uint32 idaapi s_onmenu_show_graph(void *obj, uint32 n)
+  /**
+  * @brief Remove the trace heatmap
+  */
+  void onmenu_clear_trace()
   {
-    ((gschooser_t *)obj)->onmenu_show_graph();
-    return n;
+    if (gsgv != NULL)
+      gsgv->clear_heat();
   }
 
-  static uint32 idaapi s_onmenu_analyze(void *obj, uint32 n)
+  /**
+  * @brief Print the memory used by each cache
+  */
+  void onmenu_show_memory_usage()
   {
-    ((gschooser_t *)obj)->onmenu_analyze();
-    return n;
+    uint64 used;
+    uint64 budget = gsmem_get_budget(&used);
+    msg(STR_GS_MSG "Memory usage: %" FMT_64 "u KB of %" FMT_64 "u KB\n",
+      used >> 10,
+      budget >> 10);
+
+    gsmem_usagevec_t usage;
+    gsmem_get_usage(usage);
+    for (size_t i=0; i < usage.size(); i++)
+    {
+      const gsmem_usage_t &u = usage[i];
+      msg("  %-16s: %" FMT_64 "u KB (%" FMT_64 "u KB in use) in %d entries, %d evicted\n",
+        u.name,
+        u.bytes >> 10,
+        u.pinned_bytes >> 10,
+        u.entries,
+        u.evictions);
+    }
   }
 
-  static uint32 idaapi s_onmenu_auto_find_path(void *obj, uint32 n)
+  /**
+  * @brief Order the groups in the chooser by one of their metrics
+  */
+  void onmenu_sort_groups()
   {
-    ((gschooser_t *)obj)->onmenu_analyze();
-    return n;
+    static const char form[] =
+      "Sort groups\n"
+      "\n"
+      "<#Keep the bbgroup file order#~F~ile order:R>\n"
+      "<~I~nstructions:R>\n"
+      "<~B~ytes:R>\n"
+      "<I~n~ degree:R>\n"
+      "<O~u~t degree:R>\n"
+      "<Cyclomatic ~c~omplexity:R>\n"
+      "<Occurrences c~o~unt:R>>\n"
+      "<~D~escending:C>>\n";
+
+    ushort key = ushort(sort_key + 1);
+    ushort flags = sort_descending ? 1 : 0;
+    if (AskUsingForm_c(form, &key, &flags) <= 0)
+      return;
+
+    sort_key = int(key) - 1;
+    sort_descending = (flags & 1) != 0;
+
+    refresh(true);
   }
 
   /**
-  * @brief Handle the save bbgroup menu command
+  * @brief Export the features of all the functions for the headless analyzer
   */
-  void onmenu_save_bbfile()
+  void onmenu_export_snapshot()
   {
     const char *filename = askfile_c(
         1,
-        last_loaded_file.empty() ? "*." BBGROUP_EXT : last_loaded_file.c_str(),
-        "Please select BBGROUP file to save to");
+        "*." SNAPSHOT_EXT,
+        "Please select the snapshot file to save to");
 
-    if (filename == NULL || gm == NULL)
+    if (filename == NULL)
       return;
 
-    gm->emit(filename);
+    show_wait_box("Extracting features...");
+    func_featvec_t funcs;
+    get_db_features(funcs);
+
+    qstring db_name;
+    get_idb_root_name(&db_name);
+
+    replace_wait_box("Saving snapshot...");
+    bool ok = snapshot_save(filename, db_name.c_str(), funcs);
+    hide_wait_box();
+
+    if (ok)
+      msg(STR_GS_MSG "Exported %d function(s) to '%s'\n", int(funcs.size()), filename);
+    else
+      msg(STR_GS_MSG "Failed to export snapshot to '%s'\n", filename);
   }
 
   /**
-  * @brief TODO
+  * @brief Record the functions bounds, flowcharts and disassembly for the
+  *        headless runs of the view logic (see gsdb.h)
   */
-  void onmenu_analyze(const char *def_filename = NULL)
+  void onmenu_record_db()
   {
-      func_t *f = get_func(get_screen_ea());
-      if (f == NULL)
-      {
-          msg(STR_GS_MSG "No function at the cursor location!");
-          return;
-      }
-
-      // Call Analyzer
-      int_3dvec_t result;
-#ifndef NO_PYTHON
-      py_matcher->Analyze(f->startEA, result);
-#endif
-      if (!get_flowchart(f->startEA))
-          return;
-
-      // reset groupping
-      if (result.empty() || options.no_initial_path_info)
-      {
-          // Retrieve initial groupping information
-          build_groupman_from_fc(&func_fc, gm, true);
-      }
-      else
-      {
-          if (result.empty())
-          {
-              msg(STR_GS_MSG "Failed to analyze function at %a\n", f->startEA);
-              return;
-          }
-
-          // Build the groupping information from the analyze() result
-          build_groupman_from_3dvec(&func_fc, result, gm, true);
-      }
+    const char *filename = askfile_c(
+        1,
+        "*." GSDB_REC_EXT,
+        "Please select the recording file to save to");
 
-      if (gm->src_filename.empty() && def_filename != NULL)
-          gm->src_filename = def_filename;
+    if (filename == NULL)
+      return;
 
-      // Refresh the chooser
-      refresh(true);
+    show_wait_box("Recording database...");
+    int nfuncs = gsdb_record(get_ida_gsdb(), filename);
+    hide_wait_box();
 
-      if (gsgv == NULL)
-          show_graph();
-      else
-          gsgv->redo_current_layout();
+    if (nfuncs >= 0)
+      msg(STR_GS_MSG "Recorded %d function(s) to '%s'\n", nfuncs, filename);
+    else
+      msg(STR_GS_MSG "Failed to record the database to '%s'\n", filename);
   }
 
   /**
@@ -2105,16 +5025,116 @@ private:
   }
 
   /**
-  * @brief Delete the singleton instance if applicable
+  * @brief Delete this instance if applicable
   */
-  void delete_singleton()
+  void delete_instance()
   {
-    //TODO: I don't like this singleton thing
     if ((chi.flags & CH_MODAL) != 0)
       return;
 
-    delete singleton;
-    singleton = NULL;
+    instances.del(this);
+    delete this;
+  }
+
+  /**
+  * @brief Return the chooser of a function or NULL
+  */
+  static gschooser_t *find_instance(ea_t func_ea)
+  {
+    for (size_t i=0; i < instances.size(); i++)
+    {
+      if (instances[i]->instance_ea == func_ea)
+        return instances[i];
+    }
+    return NULL;
+  }
+
+  /**
+  * @brief Make the chooser and graph titles unique to the function and
+  *        remember it (see find_instance())
+  */
+  void set_titles(ea_t func_ea)
+  {
+    instance_ea = func_ea;
+
+    char name[MAXSTR];
+    if (get_func_name(func_ea, name, sizeof(name)) == NULL)
+      qsnprintf(name, sizeof(name), "%a", func_ea);
+
+    qstring base = name;
+    for (int n=2; ; n++)
+    {
+      title.sprnt("%s - %s", TITLE_GS_PANEL, base.c_str());
+      bool used = false;
+      for (size_t i=0; i < instances.size() && !used; i++)
+        used = instances[i]->title == title;
+
+      if (!used)
+        break;
+
+      base.sprnt("%s (%d)", name, n);
+    }
+    view_title.sprnt("%s - %s", STR_GS_VIEW, base.c_str());
+    chi.title = title.c_str();
+  }
+
+  /**
+  * @brief Warm up the Python matcher. Runs once from the UI thread:
+  *        the Python runtime is not initialized from other threads
+  */
+  int on_warm_timer()
+  {
+    // Let the interactive work finish first
+    if (gs_sched.is_interactive_pending())
+      return PY_WARM_DELAY;
+
+    // The timer unregisters itself
+    warm_timer = NULL;
+    if (py_matcher == NULL)
+      acquire_matcher();
+
+    return -1;
+  }
+
+  /**
+  * @brief Take a reference to the shared Python matcher (created on first use)
+  */
+  bool acquire_matcher()
+  {
+#ifndef NO_PYTHON
+    if (py_matcher != NULL)
+      return true;
+
+    if (shared_matcher == NULL)
+    {
+      if (!init_python())
+        return false;
+
+      shared_matcher = py_matcher;
+    }
+    ++matcher_refs;
+    py_matcher = shared_matcher;
+#endif
+    return true;
+  }
+
+  /**
+  * @brief Drop the reference to the shared Python matcher
+  */
+  void release_matcher()
+  {
+    if (py_matcher == NULL)
+      return;
+
+    py_matcher = NULL;
+    if (matcher_owner == this)
+      matcher_owner = NULL;
+
+    if (--matcher_refs == 0)
+    {
+      delete shared_matcher;
+      shared_matcher = NULL;
+    }
   }
 
   /**
@@ -2134,6 +5154,18 @@ private:
     return ch_nodes.size();
   }
 
+  /**
+  * @brief Format a metric column
+  */
+  static void get_metric_desc(
+        const group_metrics_t *m,
+        int col,
+        qstring *out)
+  {
+    if (m != NULL)
+      out->sprnt("%d", m->get(col - CHCOL_METRICS));
+  }
+
   /**
   * @brief Return chooser line description
   */
@@ -2161,6 +5193,10 @@ private:
             node->sg->id.c_str(),
             node->sg->gcount());
         }
+        else if (col >= CHCOL_METRICS)
+        {
+          get_metric_desc(gm->metrics.get(node->sg), col, out);
+        }
         break;
       }
       // Handle a node definition list
@@ -2190,6 +5226,10 @@ private:
           if (nd != NULL)
             out->sprnt("%a", nd->start);
         }
+        else if (col >= CHCOL_METRICS)
+        {
+          get_metric_desc(gm->metrics.get(groups), col, out);
+        }
         break;
       }
     }
@@ -2224,7 +5264,8 @@ private:
     // Return the column name
     if (n == 0)
     {
-      qstrncpy(arrptr[0], "Node", MAXSTR);
+      for (int col=0; col < qnumber(chcol_names); col++)
+        qstrncpy(arrptr[col], chcol_names[col], MAXSTR);
       return;
     }
     // Return description about a node
@@ -2240,9 +5281,12 @@ private:
       get_node_desc(&cn, &desc, 1);
       qstrncpy(arrptr[0], desc.c_str(), MAXSTR);
 
-      desc.qclear();
-      get_node_desc(&cn, &desc, 2);
-      qstrncpy(arrptr[1], desc.c_str(), MAXSTR);
+      for (int col=2; col <= qnumber(chcol_names); col++)
+      {
+        desc.qclear();
+        get_node_desc(&cn, &desc, col);
+        qstrncpy(arrptr[col - 1], desc.c_str(), MAXSTR);
+      }
     }
   }
 
@@ -2392,6 +5436,18 @@ private:
     if (chi.popup_names != NULL)
       qfree((void *)chi.popup_names);
 
+    // Stop the background analysis and I/O before the groupman goes away
+    stop_streaming();
+    cancel_similar();
+    finish_io_job();
+
+    if (warm_timer != NULL)
+    {
+      unregister_timer(warm_timer);
+      warm_timer = NULL;
+    }
+    unwatch_file();
+
     // Close the associated graph
     close_graph();
 
@@ -2399,7 +5455,10 @@ private:
     delete gm;
     gm = NULL;
 
-    delete_singleton();
+    release_shared_fc(func_fc);
+    func_fc = NULL;
+
+    delete_instance();
   }
 
   /**
@@ -2410,7 +5469,7 @@ private:
     if (populate_lines)
       populate_chooser_lines();
 
-    refresh_chooser(TITLE_GS_PANEL);
+    refresh_chooser(title.c_str());
   }
 
   /**
@@ -2426,12 +5485,13 @@ private:
   */
   bool show_graph()
   {
-    if (gm->empty())
+    if (gm->empty() || func_fc == NULL)
       return true;
 
     // Show the graph
     gsgv = gsgraphview_t::show_graph(
-      &func_fc,
+      view_title.c_str(),
+      func_fc,
       gm,
       &options);
     if (gsgv == NULL)
@@ -2444,7 +5504,9 @@ private:
   /**
   * @brief Load and display a bbgroup file
   */
-  bool load_file_show_graph(const char *filename)
+  bool load_file_show_graph(
+      const char *filename,
+      bool analyze_on_failure = false)
   {
     // Retrieve the options
     options.load_options();
@@ -2453,16 +5515,8 @@ private:
     if (options.show_options_dialog_next_time)
       options.show_dialog();
 
-    // Load the input file
-    if (!load_file(filename))
-      return false;
-
-    show_graph();
-
-    // Remember last loaded file
-    last_loaded_file = filename;
-
-    return true;
+    // Load the input file. The graph is shown once it is loaded
+    return load_file(filename, analyze_on_failure);
   }
 
   /**
@@ -2485,13 +5539,51 @@ private:
   /**
   * @brief Find similar nodes to the selected one
   */
-  pnodegroup_list_t find_similar(intvec_t &sel_nodes)
+  void find_similar(intvec_t &sel_nodes)
+  {
+#ifndef NO_PYTHON
+    if (similar_task != NULL)
+    {
+      msg(STR_GS_MSG "The function is still being analyzed!\n");
+      return;
+    }
+
+    if (matcher_owner == this)
+    {
+      show_similar(sel_nodes);
+      return;
+    }
+
+    // Another chooser analyzed since: restore this function's state in the background
+    if (   func_fc == NULL
+        || !claim_matcher()
+        || !py_matcher->Prepare(func_fc->get_func_ea()))
+    {
+      return;
+    }
+
+    similar_sel = sel_nodes;
+    similar_task = gs_sched.post(gsp_interactive, s_similar_task, s_similar_task_done, this);
+    if (similar_task == NULL)
+    {
+      matcher_owner = NULL;
+      return;
+    }
+    pump_sched_later();
+    msg(STR_GS_MSG "Analyzing the function again to find the similar nodes...\n");
+#endif
+  }
+
+  /**
+  * @brief Find the nodes similar to the selection with the matcher state of
+  *        this function and highlight them
+  */
+  void show_similar(intvec_t &sel_nodes)
   {
 #ifndef NO_PYTHON
-    //TODO:
     int_2dvec_t ng_vec;
     if (!py_matcher->FindSimilar(sel_nodes, ng_vec) || ng_vec.empty())
-      return NULL;
+      return;
 
     // Build NG
     pnodegroup_list_t ngl = new nodegroup_list_t();
@@ -2517,9 +5609,16 @@ private:
           ng->add_node(loc->nd);
       }
     }
-    return ngl;
-#else
-      return NULL;
+
+    if (gsgv != NULL)
+    {
+      gsgv->highlight_similar_ngl(ngl);
+    }
+    else
+    {
+      ngl->free_nodegroup(false);
+      delete ngl;
+    }
 #endif
   }
 
@@ -2532,17 +5631,41 @@ private:
 	// TODO: add option to show similar_sgs
     ch_nodes.clear();
 
+    // The groups changed: recompute their metrics
+    const func_features_t *ff = func_fc == NULL ? NULL : func_fc->get_features();
+    if (ff != NULL)
+      gm_compute_metrics(gm, *ff);
+    else
+      gm->metrics.clear();
+
     // Add the first-level node = bbgroup file
     gschooser_line_t *line = &ch_nodes.push_back();
     line->type = chlt_gm;
     line->gm = gm;
 
+    // The lines order does not change the groups order in the file
     psupergroup_listp_t sgroups = gm->get_path_sgl();
+    qvector<psupergroup_t> sgs;
     for (supergroup_listp_t::iterator it=sgroups->begin();
          it != sgroups->end();
          ++it)
     {
-      supergroup_t &sg = **it;
+      sgs.push_back(*it);
+    }
+
+    bool sorted = sort_key != -1 && gm->metrics.valid;
+    if (sorted)
+    {
+      std::stable_sort(
+        sgs.begin(),
+        sgs.end(),
+        group_metric_less_t<psupergroup_t>(&gm->metrics, sort_key, sort_descending));
+    }
+
+    qvector<pnodegroup_t> ngs;
+    for (size_t isg=0; isg < sgs.size(); isg++)
+    {
+      supergroup_t &sg = *sgs[isg];
 
       // Add the second-level node = a set of group defs
       line = &ch_nodes.push_back();
@@ -2552,12 +5675,26 @@ private:
       line->sg   = &sg;
       line->ngl  = &ngl;
 
-      // Add each nodedef list within each node group
+      ngs.qclear();
       for (nodegroup_list_t::iterator it = ngl.begin();
            it != ngl.end();
            ++it)
       {
-        pnodegroup_t ng = *it;
+        ngs.push_back(*it);
+      }
+
+      if (sorted)
+      {
+        std::stable_sort(
+          ngs.begin(),
+          ngs.end(),
+          group_metric_less_t<pnodegroup_t>(&gm->metrics, sort_key, sort_descending));
+      }
+
+      // Add each nodedef list within each node group
+      for (size_t ing=0; ing < ngs.size(); ing++)
+      {
+        pnodegroup_t ng = ngs[ing];
         // Add the third-level node = nodedef
         line = &ch_nodes.push_back();
         line->type = chlt_ng;
@@ -2574,12 +5711,16 @@ private:
   */
   bool get_flowchart(ea_t startEA)
   {
-    // Build the flowchart once
-    if (!get_func_flowchart(startEA, func_fc))
+    // Shared with the other choosers and graphs looking at the function
+    shared_fc_t *fc = acquire_shared_fc(startEA);
+    if (fc == NULL)
     {
       msg(STR_GS_MSG "Could not build function flow chart at %a\n", startEA);
       return false;
     }
+
+    release_shared_fc(func_fc);
+    func_fc = fc;
     return true;
   }
 
@@ -2601,7 +5742,7 @@ private:
 #endif
     const char *fn = get_screen_function_fn(BBGROUP_EXT);
 
-    if (!load_file_show_graph(fn))
+    if (!load_file_show_graph(fn, true))
     {
         onmenu_analyze(fn);
         gm->src_filename = fn;
@@ -2619,14 +5760,30 @@ private:
         "********************************************************************************\n",
         STR_PLGNAME);
 
-    set_dock_pos(TITLE_GS_PANEL, STR_OUTWIN_TITLE, DP_RIGHT);
-    set_dock_pos(STR_GS_VIEW, STR_IDAVIEWA_TITLE, DP_INSIDE);
+    set_dock_pos(title.c_str(), STR_OUTWIN_TITLE, DP_RIGHT);
+    set_dock_pos(view_title.c_str(), STR_IDAVIEWA_TITLE, DP_INSIDE);
 
     // Chooser was shown, now create a menu item
     add_menu("Save bbgroup file", s_onmenu_save_bbfile, "Ctrl-S");
     add_menu("Show graph", s_onmenu_show_graph);
     add_menu("Analyze", s_onmenu_analyze);
     add_menu("Automatically find path", s_onmenu_auto_find_path);
+    add_menu("Find sub-block clones", s_onmenu_find_clones);
+    add_menu("Find sub-block clones in database", s_onmenu_find_db_clones);
+    add_menu("Find near-duplicate blocks", s_onmenu_find_near_duplicates);
+    add_menu("Analyze (native paths engine)", s_onmenu_analyze_native);
+    add_menu("Analyze (frequent subgraphs miner)", s_onmenu_analyze_mined);
+    add_menu("Compare the analysis engines", s_onmenu_compare_engines);
+    add_menu("Load matcher profile", s_onmenu_load_profile);
+    add_menu("Export database snapshot", s_onmenu_export_snapshot);
+    add_menu("Record database for headless runs", s_onmenu_record_db);
+    add_menu("Apply grouping rules", s_onmenu_apply_rules);
+    add_menu("Apply grouping rules to database", s_onmenu_apply_db_rules);
+    add_menu("Show call graph groups", s_onmenu_show_call_graph);
+    add_menu("Show memory usage", s_onmenu_show_memory_usage);
+    add_menu("Sort groups", s_onmenu_sort_groups);
+    add_menu("Load trace heatmap", s_onmenu_load_trace);
+    add_menu("Clear trace heatmap", s_onmenu_clear_trace);
   }
 
   /**
@@ -2634,14 +5791,14 @@ private:
   */
   void init_chi()
   {
-    static const int widths[] = {60, 16};
+    static const int widths[] = {60, 16, 6, 6, 4, 4, 4, 4};
 
     memset(&chi, 0, sizeof(chi));
     chi.cb = sizeof(chi);
     chi.flags = 0;
     chi.width = -1;
     chi.height = -1;
-    chi.title = TITLE_GS_PANEL;
+    chi.title = title.c_str();
     chi.obj = this;
     chi.columns = qnumber(widths);
     chi.widths = widths;
@@ -2673,6 +5830,20 @@ private:
   }
 
 public:
+  /**
+  * @brief Stop the streamed analyses and finish the I/O jobs of all the
+  *        choosers. Called before the scheduler stops
+  */
+  static void finish_all_tasks()
+  {
+    for (size_t i=0; i < instances.size(); i++)
+    {
+      instances[i]->stop_streaming();
+      instances[i]->cancel_similar();
+      instances[i]->finish_io_job();
+    }
+  }
+
   /**
   * @brief Constructor
   */
@@ -2683,7 +5854,29 @@ public:
     gsgv = NULL;
     gm = NULL;
     py_matcher = NULL;
+    func_fc = NULL;
+    instance_ea = BADADDR;
     gm = new groupman_t();
+
+    sort_key = -1;
+    sort_descending = true;
+
+    gsmem_set_budget(uint64(options.mem_budget_mb) << 20);
+
+    stream_task = NULL;
+    stream_timer = NULL;
+    stream_done = false;
+    stream_sg_count = 0;
+    stream_layout_ms = 0;
+
+    similar_task = NULL;
+    similar_ok = false;
+
+    io_job = NULL;
+    io_task = NULL;
+
+    warm_timer = NULL;
+    watch_timer = NULL;
   }
 
   /**
@@ -2692,7 +5885,7 @@ public:
   ~gschooser_t()
   {
     //NOTE: IDA will close the chooser for us and thus the destroy callback will be called
-    delete py_matcher;
+    release_matcher();
   }
 
   /**
@@ -2704,7 +5897,7 @@ public:
       const char *hotkey = NULL)
   {
     return add_chooser_command(
-              TITLE_GS_PANEL,
+              title.c_str(),
               name,
               cb,
               hotkey,
@@ -2726,69 +5919,52 @@ public:
   }
 
   /**
-  * @brief Load the file bbgroup file into the chooser
+  * @brief Load the file bbgroup file into the chooser in the background
+  *        The chooser keeps the previous groups until the new ones are ready
+  * @return True if the load was queued. The completion handles a file that
+  *         fails to load (and analyzes the function if asked to)
   */
-  bool load_file(const char *filename)
+  bool load_file(
+      const char *filename,
+      bool analyze_on_failure = false)
   {
-      groupman_t *ngm = new groupman_t();
-
-      do
-      {
-          // Load a file and parse it
-          // (don't init cache yet because file may be optimized)
-          if (!ngm->parse(filename, false))
-          {
-              msg(STR_GS_MSG "Error: failed to parse group file '%s'\n", filename);
-              break;
-          }
-
-          // Get an address from the parsed file
-          nodedef_t *nd = ngm->get_first_nd();
-          if (nd == NULL)
-          {
-              msg(STR_GS_MSG "Invalid input file! No addresses defined\n");
-              break;
-          }
-
-          // Get related function
-          func_t *f = get_func(nd->start);
-          if (f == NULL)
-          {
-              msg(STR_GS_MSG "Input file does not related to a defined function!\n");
-              break;
-          }
-
-          if (!get_flowchart(f->startEA))
-              break;
-
-          // De-optimize the input file
-          if (sanitize_groupman(BADADDR, ngm, &func_fc))
-          {
-              // Now initialize the cache
-              ngm->initialize_lookups();
-          }
-
-          // Delete the previous group manager
-          delete gm;
-
-          // Assign new group manager
-          gm = ngm;
-
-          populate_chooser_lines();
-
-          return true;
-      } while (false);
-
-      delete ngm;
+    if (!qfileexist(filename))
       return false;
+
+    io_job_t *job = new io_job_t();
+    job->is_load = true;
+    job->filename = filename;
+    job->gm = new groupman_t();
+    job->fc = NULL;
+    job->analyze_on_failure = analyze_on_failure;
+    job->is_reload = false;
+    job->compacted = false;
+    return start_io_job(job);
   }
 
   /**
-  * @brief Save BB group file
+  * @brief Save the BB group file in the background
+  * @return True if the save was queued. The completion reports whether the
+  *         file was written (finish_io_job() waits for it)
   */
-  bool save_file(const char *filename)
+  bool queue_save_file(const char *filename)
   {
-    return gm->emit(filename);
+    // Let a pending save update the file state first
+    finish_io_job();
+
+    if (func_fc != NULL)
+      gm->fingerprint = get_fc_fingerprint(func_fc);
+
+    // Write a copy so the groups can be edited while saving
+    io_job_t *job = new io_job_t();
+    job->is_load = false;
+    job->filename = filename;
+    job->gm = gm->clone();
+    job->fc = NULL;
+    job->analyze_on_failure = false;
+    job->is_reload = false;
+    job->compacted = false;
+    return start_io_job(job);
   }
 
   /**
@@ -2815,29 +5991,38 @@ public:
   }
 
   /**
-  * @brief Show the chooser
+  * @brief Show the chooser of the screen function. Each function gets its own chooser
   */
   static bool show()
   {
-    if (singleton == NULL)
+    func_t *f = get_func(get_screen_ea());
+    ea_t func_ea = f == NULL ? BADADDR : f->startEA;
+
+    gschooser_t *ch = find_instance(func_ea);
+    if (ch == NULL)
     {
-      singleton = new gschooser_t();
-      if (!singleton->init_python())
-      {
-        delete singleton;
-        singleton = NULL;
-        return false;
-      }
+      // The Python matcher is not needed to show the groups
+      ch = new gschooser_t();
+      ch->set_titles(func_ea);
+      instances.push_back(ch);
+
+#ifndef NO_PYTHON
+      if (ch->options.warm_python && shared_matcher == NULL)
+        ch->warm_timer = register_timer(PY_WARM_DELAY, s_warm_timer, ch);
+#endif
     }
 
-    choose3(&singleton->chi);
-    singleton->on_show();
+    choose3(&ch->chi);
+    ch->on_show();
 
     return true;
   }
 
 };
-gschooser_t *gschooser_t::singleton = NULL;
+qvector<gschooser_t *> gschooser_t::instances;
+PyBBMatcher *gschooser_t::shared_matcher = NULL;
+int gschooser_t::matcher_refs = 0;
+gschooser_t *gschooser_t::matcher_owner = NULL;
 
 //--------------------------------------------------------------------------
 //
@@ -2861,6 +6046,13 @@ int idaapi init(void)
 //--------------------------------------------------------------------------
 void idaapi term(void)
 {
+  if (gs_sched_timer != NULL)
+  {
+    unregister_timer(gs_sched_timer);
+    gs_sched_timer = NULL;
+  }
+  gschooser_t::finish_all_tasks();
+  gs_sched.stop();
 }
 
 //--------------------------------------------------------------------------
@@ -4,6 +4,11 @@ History
 
 11/07/2013 - eliasb             - Initial version
 04/15/2014 - eliasb             - Check the result of PyAnalyze() before converting the result to C structs
+10/18/2026 - eliasb             - Added Prepare() and AnalyzeStream()
+                                - Register the 'gsnative' module before running the init script
+                                - Added LoadProfile()
+                                - Release the GIL while the stream callback runs
+                                - AnalyzeStream() takes a cancel callback polled by the matcher loops
 --------------------------------------------------------------------------*/
 
 #include "pybbmatcher.h"
@@ -46,6 +51,10 @@ const char *PyBBMatcher::call_init_file()
 const char *PyBBMatcher::init()
 {
     PYW_GIL_GET;
+    // Native helpers must be importable by the matcher scripts
+    if (Py_IsInitialized())
+        init_gsnative_module();
+
     const char *err = call_init_file();
     if (err != NULL)
         return err;
@@ -64,11 +73,17 @@ const char *PyBBMatcher::init()
     py_meth_save_state = PyW_TryGetAttrString(py_instref, "SaveState");
     py_meth_load_state = PyW_TryGetAttrString(py_instref, "LoadState");
     py_meth_analyze = PyW_TryGetAttrString(py_instref, "Analyze");
+    py_meth_prepare = PyW_TryGetAttrString(py_instref, "Prepare");
+    py_meth_analyze_stream = PyW_TryGetAttrString(py_instref, "AnalyzeStream");
+    py_meth_load_profile = PyW_TryGetAttrString(py_instref, "LoadProfile");
 
     if (   py_meth_find_similar == NULL
         || py_meth_save_state == NULL
         || py_meth_load_state == NULL
-        || py_meth_analyze == NULL)
+        || py_meth_analyze == NULL
+        || py_meth_prepare == NULL
+        || py_meth_analyze_stream == NULL
+        || py_meth_load_profile == NULL)
     {
         return "Failed to find one or more needed methods";
     }
@@ -114,6 +129,24 @@ void PyBBMatcher::deinit()
         Py_DECREF(py_meth_analyze);
         py_meth_analyze = NULL;
     }
+
+    if (py_meth_prepare != NULL)
+    {
+        Py_DECREF(py_meth_prepare);
+        py_meth_prepare = NULL;
+    }
+
+    if (py_meth_analyze_stream != NULL)
+    {
+        Py_DECREF(py_meth_analyze_stream);
+        py_meth_analyze_stream = NULL;
+    }
+
+    if (py_meth_load_profile != NULL)
+    {
+        Py_DECREF(py_meth_load_profile);
+        py_meth_load_profile = NULL;
+    }
 }
 
 //--------------------------------------------------------------------------
@@ -130,6 +163,107 @@ void PyBBMatcher::Analyze(ea_t func_addr, int_3dvec_t &result)
     Py_XDECREF(py_ret);
 }
 
+//--------------------------------------------------------------------------
+bool PyBBMatcher::Prepare(ea_t func_addr)
+{
+    PYW_GIL_GET;
+    PyObject *py_func_addr = Py_BuildValue(PY_FMT64, func_addr);
+    PyObject *py_ret = PyObject_CallFunctionObjArgs(py_meth_prepare, py_func_addr, NULL);
+    Py_DECREF(py_func_addr);
+
+    bool bOk = py_ret == Py_True;
+    if (py_ret == NULL)
+        PyErr_Clear();
+
+    Py_XDECREF(py_ret);
+
+    return bOk;
+}
+
+//--------------------------------------------------------------------------
+// Context passed to the Python callable used by AnalyzeStream()
+struct py_stream_ctx_t
+{
+    PyBBMatcher::stream_cb_t cb;
+    PyBBMatcher::stream_canceled_cb_t canceled;
+    void *ud;
+};
+
+//--------------------------------------------------------------------------
+static PyObject *py_stream_cb(PyObject *self, PyObject *args)
+{
+    py_stream_ctx_t *ctx = (py_stream_ctx_t *)PyCObject_AsVoidPtr(self);
+
+    PyObject *py_sg;
+    if (!PyArg_ParseTuple(args, "O", &py_sg))
+        return NULL;
+
+    int_2dvec_t sg;
+    if (!PyW_PyListListToIntVecVec(py_sg, sg))
+        Py_RETURN_NONE;
+
+    // The callback may block (queue full, paused for interactive work):
+    // let the main thread use the interpreter meanwhile
+    bool ok;
+    Py_BEGIN_ALLOW_THREADS;
+    ok = ctx->cb(sg, ctx->ud);
+    Py_END_ALLOW_THREADS;
+
+    if (!ok)
+    {
+        // Raising an exception unwinds the matcher
+        PyErr_SetString(PyExc_KeyboardInterrupt, "Analysis cancelled");
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef py_stream_cb_def = { "stream_cb", py_stream_cb, METH_VARARGS, NULL };
+
+//--------------------------------------------------------------------------
+static PyObject *py_stream_canceled(PyObject *self, PyObject * /*args*/)
+{
+    py_stream_ctx_t *ctx = (py_stream_ctx_t *)PyCObject_AsVoidPtr(self);
+    if (ctx->canceled(ctx->ud))
+        Py_RETURN_TRUE;
+
+    Py_RETURN_FALSE;
+}
+
+static PyMethodDef py_stream_canceled_def = { "stream_canceled", py_stream_canceled, METH_NOARGS, NULL };
+
+//--------------------------------------------------------------------------
+bool PyBBMatcher::AnalyzeStream(stream_cb_t cb, void *ud, stream_canceled_cb_t canceled)
+{
+    PYW_GIL_GET;
+    py_stream_ctx_t ctx;
+    ctx.cb = cb;
+    ctx.canceled = canceled;
+    ctx.ud = ud;
+
+    PyObject *py_ctx = PyCObject_FromVoidPtr(&ctx, NULL);
+    PyObject *py_cb = PyCFunction_New(&py_stream_cb_def, py_ctx);
+    PyObject *py_canceled = Py_None;
+    if (canceled != NULL)
+        py_canceled = PyCFunction_New(&py_stream_canceled_def, py_ctx);
+    else
+        Py_INCREF(py_canceled);
+    Py_DECREF(py_ctx);
+
+    PyObject *py_ret = PyObject_CallFunctionObjArgs(py_meth_analyze_stream, py_cb, py_canceled, NULL);
+    Py_DECREF(py_cb);
+    Py_DECREF(py_canceled);
+
+    bool bOk = py_ret == Py_True;
+    if (py_ret == NULL)
+        PyErr_Clear();
+
+    Py_XDECREF(py_ret);
+
+    return bOk;
+}
+
 //--------------------------------------------------------------------------
 bool PyBBMatcher::FindSimilar(intvec_t &node_list, int_2dvec_t &similar)
 {
@@ -178,4 +312,23 @@ bool PyBBMatcher::LoadState(const char *filename)
     bool bOk = py_ret == Py_True;
 
     return bOk;
-}
\ No newline at end of file
+}
+
+//--------------------------------------------------------------------------
+bool PyBBMatcher::LoadProfile(const char *filename)
+{
+    PYW_GIL_GET;
+    PyObject *py_filename = PyString_FromString(filename);
+    PyObject *py_ret = PyObject_CallFunctionObjArgs(py_meth_load_profile, py_filename, NULL);
+    Py_DECREF(py_filename);
+    if (py_ret == NULL)
+    {
+        PyErr_Clear();
+        return false;
+    }
+
+    bool bOk = py_ret == Py_True;
+    Py_DECREF(py_ret);
+
+    return bOk;
+}
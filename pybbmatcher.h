@@ -17,12 +17,33 @@ BBMatcher Python to C wrapper class
 #include <Python.h>
 #include "types.hpp"
 
+//--------------------------------------------------------------------------
+/**
+* @brief Register the 'gsnative' helper module with the Python runtime
+*/
+bool init_gsnative_module();
+
 //--------------------------------------------------------------------------
 class PyBBMatcher
 {
+public:
+  /**
+  * @brief Callback receiving each accepted group while streaming.
+  *        Return false to cancel the analysis
+  */
+  typedef bool (idaapi *stream_cb_t)(int_2dvec_t &sg, void *ud);
+
+  /**
+  * @brief Polled by the matcher loops while streaming. Return true to cancel
+  *        the analysis
+  */
+  typedef bool (idaapi *stream_canceled_cb_t)(void *ud);
+
+private:
   PyObject *py_matcher_module;
   PyObject *py_instref;
   PyObject *py_meth_save_state, *py_meth_load_state, *py_meth_analyze, *py_meth_find_similar;
+  PyObject *py_meth_prepare, *py_meth_analyze_stream, *py_meth_load_profile;
 
   const char *init_script;
 
@@ -37,7 +58,9 @@ public:
   */
   PyBBMatcher(const char *init_script): py_matcher_module(NULL), py_instref(NULL),
                  py_meth_find_similar (NULL), py_meth_save_state(NULL),
-                 py_meth_load_state (NULL), py_meth_analyze (NULL), init_script(init_script)
+                 py_meth_load_state (NULL), py_meth_analyze (NULL), py_meth_prepare(NULL),
+                 py_meth_analyze_stream(NULL), py_meth_load_profile(NULL),
+                 init_script(init_script)
   {
   }
 
@@ -61,11 +84,29 @@ public:
   */
   void Analyze(ea_t func_addr, int_3dvec_t &result);
 
+  /**
+  * @brief Build the matcher graph of a function. Must be called from the main thread
+  */
+  bool Prepare(ea_t func_addr);
+
+  /**
+  * @brief Analyze the prepared function and report every accepted group to the callback.
+  *        It does not use the IDA API and can be called from a worker thread
+  * @param canceled - optional: polled between the matching steps, so a cancel
+  *                   does not wait for the next accepted group
+  */
+  bool AnalyzeStream(stream_cb_t cb, void *ud, stream_canceled_cb_t canceled = NULL);
+
   /**
   * @brief Load state
   */
   bool LoadState(const char *filename);
 
+  /**
+  * @brief Load the matcher thresholds from a profile file (see bb_tune.py)
+  */
+  bool LoadProfile(const char *filename);
+
   /**
   * @brief Save state and return it as a string
   */
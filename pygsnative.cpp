@@ -0,0 +1,110 @@
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Native helpers exposed to the Python matcher as the 'gsnative' module
+
+History
+--------
+
+10/18/2026 - eliasb             - Initial version: block_hashes()
+                                - Added block_distance()
+                                - Added primes()
+--------------------------------------------------------------------------*/
+
+#include "pybbmatcher.h"
+#include "algo.hpp"
+#include "bbalign.h"
+#include "gsprimes.h"
+
+//--------------------------------------------------------------------------
+// Consts
+const char STR_PY_NATIVE_MODULE[] = "gsnative";
+
+//--------------------------------------------------------------------------
+// block_hashes(start, end) -> (itype, optype, regren, regimm, exact)
+static PyObject *py_block_hashes(PyObject * /*self*/, PyObject *args)
+{
+    unsigned PY_LONG_LONG start, end;
+    if (!PyArg_ParseTuple(args, "KK", &start, &end))
+        return NULL;
+
+    // Decode once, hash at all the levels
+    insn_featvec_t insns;
+    get_range_features(ea_t(start), ea_t(end), insns);
+
+    bbhash_t bh;
+    bbfeat_hash_insns(insns.begin(), insns.size(), bh);
+
+    PyObject *py_ret = PyTuple_New(bbh_count);
+    for (int i=0; i < bbh_count; i++)
+        PyTuple_SetItem(py_ret, i, PyLong_FromUnsignedLongLong(bh.h[i]));
+
+    return py_ret;
+}
+
+//--------------------------------------------------------------------------
+// block_distance(start1, end1, start2, end2, max_dist=2) -> distance
+// The distance is capped to max_dist + 1
+static PyObject *py_block_distance(PyObject * /*self*/, PyObject *args)
+{
+    unsigned PY_LONG_LONG start1, end1, start2, end2;
+    int max_dist = 2;
+    if (!PyArg_ParseTuple(args, "KKKK|i", &start1, &end1, &start2, &end2, &max_dist))
+        return NULL;
+
+    insn_featvec_t insns1, insns2;
+    get_range_features(ea_t(start1), ea_t(end1), insns1);
+    get_range_features(ea_t(start2), ea_t(end2), insns2);
+
+    bbalign_seqs_t seqs;
+    int s1 = seqs.add(insns1.begin(), insns1.size());
+    int s2 = seqs.add(insns2.begin(), insns2.size());
+
+    int dist = seqs.lower_bound(s1, s2);
+    if (dist <= max_dist)
+        dist = seqs.distance(s1, s2, max_dist);
+    else
+        dist = max_dist + 1;
+
+    return PyInt_FromLong(dist);
+}
+
+//--------------------------------------------------------------------------
+// primes(count) -> list of the first 'count' primes or None if the table is too short
+static PyObject *py_primes(PyObject * /*self*/, PyObject *args)
+{
+    int count;
+    if (!PyArg_ParseTuple(args, "i", &count))
+        return NULL;
+
+    if (count < 0 || count > GS_PRIMES_COUNT)
+        Py_RETURN_NONE;
+
+    PyObject *py_ret = PyList_New(count);
+    for (int i=0; i < count; i++)
+        PyList_SetItem(py_ret, i, PyInt_FromLong(long(gs_primes[i])));
+
+    return py_ret;
+}
+
+//--------------------------------------------------------------------------
+static PyMethodDef py_gsnative_methods[] =
+{
+    { "block_hashes", py_block_hashes, METH_VARARGS, "Normalized hashes of a block" },
+    { "block_distance", py_block_distance, METH_VARARGS, "Bounded edit distance of the instructions of two blocks" },
+    { "primes", py_primes, METH_VARARGS, "The first primes from the native table" },
+    { NULL, NULL, 0, NULL }
+};
+
+//--------------------------------------------------------------------------
+bool init_gsnative_module()
+{
+    static bool initialized = false;
+    if (initialized)
+        return true;
+
+    // The module reference is borrowed
+    initialized = Py_InitModule(STR_PY_NATIVE_MODULE, py_gsnative_methods) != NULL;
+    return initialized;
+}
@@ -0,0 +1,446 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version: suffix automaton over the DFS linearized CFG
+                                - fix: the end positions are laid out once over the suffix link tree instead of
+                                  walked per candidate; the candidates that cannot fit the free blocks are skipped
+--------------------------------------------------------------------------*/
+
+#include "repaths.h"
+#include <map>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+/**
+* @brief Suffix automaton state
+*/
+struct sam_state_t
+{
+  int len;
+  int link;
+
+  // End position of the first occurrence
+  int firstpos;
+
+  // Count of occurrences (end positions)
+  int occ;
+
+  bool is_clone;
+
+  std::map<int, int> next;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Suffix automaton over an integer alphabet
+*/
+class suffix_automaton_t
+{
+  int last;
+
+public:
+  qvector<sam_state_t> st;
+
+  void build(const intvec_t &seq)
+  {
+    st.qclear();
+    st.reserve(2 * seq.size() + 1);
+
+    sam_state_t &root = st.push_back();
+    root.len = 0;
+    root.link = -1;
+    root.firstpos = -1;
+    root.occ = 0;
+    root.is_clone = false;
+    last = 0;
+
+    for (size_t i=0; i < seq.size(); i++)
+      extend(seq[i], int(i));
+
+    count_occurrences();
+  }
+
+  void extend(int c, int pos)
+  {
+    int cur = int(st.size());
+    {
+      sam_state_t &s = st.push_back();
+      s.len = st[last].len + 1;
+      s.link = -1;
+      s.firstpos = pos;
+      s.occ = 1;
+      s.is_clone = false;
+    }
+
+    int p = last;
+    while (p != -1 && st[p].next.find(c) == st[p].next.end())
+    {
+      st[p].next[c] = cur;
+      p = st[p].link;
+    }
+
+    if (p == -1)
+    {
+      st[cur].link = 0;
+    }
+    else
+    {
+      int q = st[p].next[c];
+      if (st[p].len + 1 == st[q].len)
+      {
+        st[cur].link = q;
+      }
+      else
+      {
+        int clone = int(st.size());
+        sam_state_t s = st[q];
+        s.len = st[p].len + 1;
+        s.occ = 0;
+        s.is_clone = true;
+        st.push_back(s);
+
+        while (p != -1 && st[p].next[c] == q)
+        {
+          st[p].next[c] = clone;
+          p = st[p].link;
+        }
+        st[q].link = clone;
+        st[cur].link = clone;
+      }
+    }
+    last = cur;
+  }
+
+  /**
+  * @brief Propagate the occurrence counts up the suffix links (longest states first)
+  */
+  void count_occurrences()
+  {
+    intvec_t order;
+    order.resize(st.size());
+    for (size_t i=0; i < st.size(); i++)
+      order[i] = int(i);
+
+    std::sort(order.begin(), order.end(), by_len_desc_t(st));
+    for (size_t i=0; i < order.size(); i++)
+    {
+      sam_state_t &s = st[order[i]];
+      if (s.link != -1)
+        st[s.link].occ += s.occ;
+    }
+  }
+
+  struct by_len_desc_t
+  {
+    const qvector<sam_state_t> &st;
+    by_len_desc_t(const qvector<sam_state_t> &st): st(st) { }
+    bool operator()(int a, int b) const
+    {
+      return st[a].len > st[b].len;
+    }
+  };
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Helper class to find the repeated paths
+*/
+class repath_finder_t
+{
+  const func_features_t &ff;
+  const repath_params_t &params;
+  repath_stats_t &stats;
+
+  // The linearized CFG: block hash symbols (>=0) and separators (<0)
+  intvec_t seq;
+
+  // Block id of each sequence position (-1 for separators)
+  intvec_t seq2blk;
+
+  suffix_automaton_t sam;
+
+  // End positions (first positions of the non clone states) in the DFS
+  // order of the suffix link tree: a state's occurrences are the range of
+  // its subtree, [tour_begin, tour_end)
+  intvec_t tour_pos;
+  intvec_t tour_begin;
+  intvec_t tour_end;
+
+  // Blocks already used by a selected SG
+  qvector<bool> used;
+
+  /**
+  * @brief Orders the successors canonically: by hash then by block id
+  */
+  struct succ_order_t
+  {
+    const func_features_t &ff;
+    int level;
+    succ_order_t(const func_features_t &ff, int level): ff(ff), level(level) { }
+    bool operator()(int a, int b) const
+    {
+      uint64 ha = ff.blocks[a].hash.h[level];
+      uint64 hb = ff.blocks[b].hash.h[level];
+      return ha < hb || (ha == hb && a < b);
+    }
+  };
+
+  void linearize()
+  {
+    std::map<uint64, int> alphabet;
+    int nsep = 0;
+    int nblocks = int(ff.blocks.size());
+    qvector<bool> visited;
+    visited.resize(nblocks, false);
+
+    int prev = -1;
+    intvec_t stack;
+    for (int root=0; root < nblocks; root++)
+    {
+      if (visited[root])
+        continue;
+
+      stack.push_back(root);
+      while (!stack.empty())
+      {
+        int b = stack.back();
+        stack.pop_back();
+        if (visited[b])
+          continue;
+        visited[b] = true;
+
+        // Not connected to the previous block? Cut the sequence
+        const bbfeat_block_t &bb = ff.blocks[b];
+        if (prev != -1 && !ff.blocks[prev].succ.has(b))
+        {
+          seq.push_back(-(++nsep));
+          seq2blk.push_back(-1);
+        }
+
+        uint64 h = bb.hash.h[params.level];
+        std::map<uint64, int>::iterator it = alphabet.find(h);
+        if (it == alphabet.end())
+          it = alphabet.insert(std::make_pair(h, int(alphabet.size()))).first;
+
+        seq.push_back(it->second);
+        seq2blk.push_back(b);
+        prev = b;
+
+        // Push the successors in reverse canonical order so the first is visited first
+        intvec_t succ = bb.succ;
+        std::sort(succ.begin(), succ.end(), succ_order_t(ff, params.level));
+        for (int i=int(succ.size()) - 1; i >= 0; i--)
+        {
+          if (!visited[succ[i]])
+            stack.push_back(succ[i]);
+        }
+      }
+    }
+
+    // Terminate with a unique separator so every repeat is right-delimited
+    seq.push_back(-(++nsep));
+    seq2blk.push_back(-1);
+  }
+
+  /**
+  * @brief Lay out the end positions over the suffix link tree, once
+  */
+  void build_endpos_tour()
+  {
+    size_t nstates = sam.st.size();
+    qvector<intvec_t> children;
+    children.resize(nstates);
+    for (size_t i=1; i < nstates; i++)
+      children[sam.st[i].link].push_back(int(i));
+
+    tour_pos.qclear();
+    tour_pos.reserve(seq.size());
+    tour_begin.resize(nstates, 0);
+    tour_end.resize(nstates, 0);
+
+    // A state is pushed again (complemented) to close its range
+    intvec_t stack;
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+      int s = stack.back();
+      stack.pop_back();
+      if (s < 0)
+      {
+        tour_end[~s] = int(tour_pos.size());
+        continue;
+      }
+
+      tour_begin[s] = int(tour_pos.size());
+      if (s != 0 && !sam.st[s].is_clone)
+        tour_pos.push_back(sam.st[s].firstpos);
+
+      stack.push_back(~s);
+      const intvec_t &ch = children[s];
+      for (size_t i=0; i < ch.size(); i++)
+        stack.push_back(ch[i]);
+    }
+  }
+
+  /**
+  * @brief Collect the sorted end positions of a state's occurrences.
+  *        O(occ log occ)
+  */
+  void collect_endpos(int state, intvec_t &endpos)
+  {
+    endpos.reserve(tour_end[state] - tour_begin[state]);
+    for (int i=tour_begin[state]; i < tour_end[state]; i++)
+      endpos.push_back(tour_pos[i]);
+
+    std::sort(endpos.begin(), endpos.end());
+  }
+
+  /**
+  * @brief Is the segment a single-entry subgraph? Only its first block may
+  *        have predecessors outside of the segment
+  */
+  bool is_single_entry(int start, int len, qvector<bool> &in_seg)
+  {
+    for (int i=0; i < len; i++)
+      in_seg[seq2blk[start + i]] = true;
+
+    bool ok = true;
+    for (int i=1; i < len && ok; i++)
+    {
+      const intvec_t &pred = ff.blocks[seq2blk[start + i]].pred;
+      for (size_t k=0; k < pred.size() && ok; k++)
+        ok = in_seg[pred[k]];
+    }
+
+    for (int i=0; i < len; i++)
+      in_seg[seq2blk[start + i]] = false;
+
+    return ok;
+  }
+
+  struct candidate_t
+  {
+    int state;
+    int len;
+    int occ;
+
+    // Prefer the candidates covering the most blocks
+    bool operator<(const candidate_t &o) const
+    {
+      int s1 = len * occ, s2 = o.len * o.occ;
+      return s1 > s2 || (s1 == s2 && (len > o.len || (len == o.len && state < o.state)));
+    }
+  };
+
+public:
+  repath_finder_t(
+    const func_features_t &ff,
+    const repath_params_t &params,
+    repath_stats_t &stats): ff(ff), params(params), stats(stats)
+  {
+  }
+
+  size_t find(int_3dvec_t &result)
+  {
+    result.qclear();
+    if (ff.blocks.empty())
+      return 0;
+
+    linearize();
+    sam.build(seq);
+    stats.seq_len = int(seq.size());
+    stats.nstates = int(sam.st.size());
+
+    build_endpos_tour();
+
+    // Maximal repeats: repeated, long enough and right-maximal.
+    // The state's longest string is always left-maximal
+    qvector<candidate_t> cands;
+    for (size_t i=1; i < sam.st.size(); i++)
+    {
+      sam_state_t &s = sam.st[i];
+      if (s.occ < 2 || s.len < params.min_blocks || s.next.size() < 2)
+        continue;
+
+      candidate_t &c = cands.push_back();
+      c.state = int(i);
+      c.len = s.len;
+      c.occ = s.occ;
+    }
+    stats.candidates = int(cands.size());
+    std::sort(cands.begin(), cands.end());
+
+    used.resize(ff.blocks.size(), false);
+    qvector<bool> in_seg;
+    in_seg.resize(ff.blocks.size(), false);
+
+    // Each candidate costs O(occ log occ) to collect its occurrences. The sum
+    // over the candidates is quadratic on long runs of identical blocks
+    // (every prefix of the run is a candidate), but the first candidate
+    // then takes most of the run and the others are skipped unseen
+    int nfree = int(ff.blocks.size());
+    intvec_t endpos;
+    for (size_t ic=0; ic < cands.size(); ic++)
+    {
+      const candidate_t &c = cands[ic];
+      if (2 * c.len > nfree)
+        continue;
+
+      endpos.qclear();
+      collect_endpos(c.state, endpos);
+
+      // Pick the non overlapping, unused and single-entry occurrences
+      intvec_t starts;
+      for (size_t i=0; i < endpos.size(); i++)
+      {
+        int start = endpos[i] - c.len + 1;
+        if (!starts.empty() && start < starts.back() + c.len)
+          continue;
+
+        bool free_seg = true;
+        for (int k=0; k < c.len && free_seg; k++)
+          free_seg = !used[seq2blk[start + k]];
+
+        if (!free_seg)
+          continue;
+
+        if (!is_single_entry(start, c.len, in_seg))
+        {
+          ++stats.rejected_entry;
+          continue;
+        }
+        starts.push_back(start);
+      }
+
+      if (starts.size() < 2)
+        continue;
+
+      int_2dvec_t &sg = result.push_back();
+      for (size_t i=0; i < starts.size(); i++)
+      {
+        intvec_t &ng = sg.push_back();
+        for (int k=0; k < c.len; k++)
+        {
+          int b = seq2blk[starts[i] + k];
+          used[b] = true;
+          ng.push_back(b);
+          --nfree;
+        }
+      }
+    }
+    return result.size();
+  }
+};
+
+//--------------------------------------------------------------------------
+size_t find_repeated_paths(
+    const func_features_t &ff,
+    const repath_params_t &params,
+    int_3dvec_t &result,
+    repath_stats_t *stats)
+{
+  repath_stats_t _stats;
+  repath_finder_t finder(ff, params, stats == NULL ? _stats : *stats);
+  return finder.find(result);
+}
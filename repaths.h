@@ -0,0 +1,89 @@
+#ifndef __REPATHS__
+#define __REPATHS__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Repeated paths module
+
+A native alternative to the Python findSubGraphs() engine.
+
+The CFG is linearized along a canonical DFS order into a sequence of block
+hashes. A separator (unique symbol) is inserted wherever two consecutive
+blocks of the sequence are not connected by an edge, so a repeated segment
+is always a path in the CFG. A suffix automaton of the sequence is built
+and its right-maximal states with more than one occurrence give the
+maximal repeated path segments in linear time.
+
+The segments are then validated as single-entry subgraphs and selected
+greedily (longest coverage first) so that no block is used twice. Their
+occurrences are read from one DFS layout of the suffix link tree, and the
+segments too long for the blocks left free are skipped.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include "bbfeat.h"
+#include "types.hpp"
+
+//--------------------------------------------------------------------------
+/**
+* @brief Repeated paths parameters
+*/
+struct repath_params_t
+{
+  /**
+  * @brief Minimum length of a repeated path, in blocks
+  */
+  int min_blocks;
+
+  /**
+  * @brief Block hash level used as the sequence alphabet
+  */
+  bbhash_level_e level;
+
+  repath_params_t(): min_blocks(2), level(bbh_regren)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Statistics of a repeated paths run
+*/
+struct repath_stats_t
+{
+  // Length of the linearized sequence (blocks and separators)
+  int seq_len;
+
+  // Count of suffix automaton states
+  int nstates;
+
+  // Maximal repeats that passed the length/occurrence filters
+  int candidates;
+
+  // Occurrences rejected because the segment has more than one entry
+  int rejected_entry;
+
+  repath_stats_t(): seq_len(0), nstates(0), candidates(0), rejected_entry(0)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Find the repeated single-entry paths of a function.
+*        The result has the same layout as PyBBMatcher::Analyze():
+*        one entry per SG, one entry per NG in the SG, the node ids of the NG
+* @return The count of super groups found
+*/
+size_t find_repeated_paths(
+    const func_features_t &ff,
+    const repath_params_t &params,
+    int_3dvec_t &result,
+    repath_stats_t *stats = NULL);
+
+#endif
@@ -0,0 +1,845 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version: compiler and parallel evaluator
+                                - fix: insn() and last() are false on empty blocks
+--------------------------------------------------------------------------*/
+
+#include "rules.h"
+#include <ua.hpp>
+#include <ctype.h>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+/**
+* @brief Bytecode opcodes. The stack holds int64 values
+*/
+enum rule_op_e
+{
+  // Predicates: push 1 or 0. Operand: set or table index
+  rop_insn,
+  rop_last,
+  rop_target,
+  rop_ref,
+  rop_const,
+  rop_dom,
+
+  // Push a block metric. Operand: rule_metric_e
+  rop_metric,
+
+  // Push a value. Operand: the value
+  rop_push,
+
+  // Pop b then a, push (a op b). Operand: rule_cmp_e
+  rop_cmp,
+
+  rop_not,
+
+  // Short circuit: jump if the top is false/true, keeping it. Operand: target
+  rop_jz,
+  rop_jnz,
+
+  rop_pop,
+};
+
+enum rule_metric_e
+{
+  rmet_ninsns,
+  rmet_nsucc,
+  rmet_npred,
+  rmet_size,
+};
+
+enum rule_cmp_e
+{
+  rcmp_eq,
+  rcmp_ne,
+  rcmp_lt,
+  rcmp_le,
+  rcmp_gt,
+  rcmp_ge,
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Recursive descent compiler of one rule expression
+*/
+class rule_compiler_t
+{
+  const char *p;
+  rule_resolver_t &resolver;
+  rule_t &rule;
+  qstring &err;
+
+  // Current token
+  enum
+  {
+    tk_end,
+    tk_ident,
+    tk_number,
+    tk_punct,
+  } tk;
+  qstring tok;
+  uint64 tok_val;
+
+  void next()
+  {
+    while (*p == ' ' || *p == '\t')
+      p++;
+
+    tok.qclear();
+    if (*p == '\0')
+    {
+      tk = tk_end;
+      return;
+    }
+
+    if (isdigit(uchar(*p)))
+    {
+      char *end;
+      tok_val = strtoull(p, &end, 0);
+      tok = qstring(p, end - p);
+      p = end;
+      tk = tk_number;
+      return;
+    }
+
+    if (isalpha(uchar(*p)) || *p == '_' || *p == '?' || *p == '@' || *p == '$')
+    {
+      const char *s = p;
+      while (isalnum(uchar(*p)) || *p == '_' || *p == '?' || *p == '@' || *p == '$' || *p == '.')
+        p++;
+      tok = qstring(s, p - s);
+      tk = tk_ident;
+      return;
+    }
+
+    // Two characters operators first
+    static const char *const ops2[] = { "==", "!=", "<=", ">=", "&&", "||" };
+    for (size_t i=0; i < qnumber(ops2); i++)
+    {
+      if (p[0] == ops2[i][0] && p[1] == ops2[i][1])
+      {
+        tok = ops2[i];
+        p += 2;
+        tk = tk_punct;
+        return;
+      }
+    }
+    tok = qstring(p, 1);
+    p++;
+    tk = tk_punct;
+  }
+
+  inline bool is_punct(const char *s)
+  {
+    return tk == tk_punct && tok == s;
+  }
+
+  inline bool is_keyword(const char *s)
+  {
+    return tk == tk_ident && stricmp(tok.c_str(), s) == 0;
+  }
+
+  bool expect(const char *s)
+  {
+    if (is_punct(s))
+    {
+      next();
+      return true;
+    }
+    err.sprnt("expected '%s' near '%s'", s, tok.c_str());
+    return false;
+  }
+
+  inline void emit(int op)
+  {
+    rule.code.push_back(op);
+  }
+
+  inline void emit(int op, int64 arg)
+  {
+    rule.code.push_back(op);
+    rule.code.push_back(arg);
+  }
+
+  /**
+  * @brief Emit a short circuit jump and return the operand position to patch
+  */
+  inline size_t emit_jump(int op)
+  {
+    emit(op, 0);
+    return rule.code.size() - 1;
+  }
+
+  inline void patch_jump(size_t at)
+  {
+    rule.code[at] = int64(rule.code.size());
+  }
+
+  /**
+  * @brief Parse an address: a number or a name
+  */
+  bool parse_address(ea_t *ea)
+  {
+    if (tk == tk_number)
+    {
+      *ea = ea_t(tok_val);
+    }
+    else if (tk == tk_ident)
+    {
+      if (!resolver.get_name_ea(tok.c_str(), ea))
+      {
+        err.sprnt("unknown name '%s'", tok.c_str());
+        return false;
+      }
+    }
+    else
+    {
+      err.sprnt("expected an address near '%s'", tok.c_str());
+      return false;
+    }
+    next();
+    return true;
+  }
+
+  /**
+  * @brief Parse the mnemonics list of insn() and last()
+  */
+  bool parse_itypes(int op)
+  {
+    intvec_t &set = rule.itype_sets.push_back();
+    for (;;)
+    {
+      if (tk != tk_ident)
+      {
+        err.sprnt("expected a mnemonic near '%s'", tok.c_str());
+        return false;
+      }
+      intvec_t itypes;
+      if (!resolver.get_itypes(tok.c_str(), itypes))
+      {
+        err.sprnt("unknown mnemonic '%s'", tok.c_str());
+        return false;
+      }
+      for (size_t i=0; i < itypes.size(); i++)
+        set.push_back(itypes[i]);
+      next();
+
+      if (!is_punct(","))
+        break;
+      next();
+    }
+
+    std::sort(set.begin(), set.end());
+    emit(op, int64(rule.itype_sets.size() - 1));
+    return expect(")");
+  }
+
+  /**
+  * @brief Parse the values list of target(), ref() and const()
+  */
+  bool parse_values(int op)
+  {
+    uint64vec_t &set = rule.value_sets.push_back();
+    for (;;)
+    {
+      ea_t ea;
+      if (op == rop_const)
+      {
+        if (tk != tk_number)
+        {
+          err.sprnt("expected a number near '%s'", tok.c_str());
+          return false;
+        }
+        set.push_back(tok_val);
+        next();
+      }
+      else if (parse_address(&ea))
+      {
+        set.push_back(ea);
+      }
+      else
+      {
+        return false;
+      }
+
+      if (!is_punct(","))
+        break;
+      next();
+    }
+
+    std::sort(set.begin(), set.end());
+    emit(op, int64(rule.value_sets.size() - 1));
+    return expect(")");
+  }
+
+  bool parse_term()
+  {
+    if (is_punct("("))
+    {
+      next();
+      return parse_or() && expect(")");
+    }
+
+    if (tk != tk_ident)
+    {
+      err.sprnt("unexpected '%s'", tok.c_str());
+      return false;
+    }
+
+    // Metrics comparisons
+    static const char *const metrics[] = { "ninsns", "nsucc", "npred", "size" };
+    for (size_t i=0; i < qnumber(metrics); i++)
+    {
+      if (!is_keyword(metrics[i]))
+        continue;
+
+      next();
+      static const char *const cmps[] = { "==", "!=", "<", "<=", ">", ">=" };
+      size_t icmp = 0;
+      while (icmp < qnumber(cmps) && !is_punct(cmps[icmp]))
+        icmp++;
+
+      if (icmp == qnumber(cmps))
+      {
+        err.sprnt("expected a comparison after '%s'", metrics[i]);
+        return false;
+      }
+      next();
+
+      if (tk != tk_number)
+      {
+        err.sprnt("expected a number near '%s'", tok.c_str());
+        return false;
+      }
+      emit(rop_metric, int64(i));
+      emit(rop_push, int64(tok_val));
+      emit(rop_cmp, int64(icmp));
+      next();
+      return true;
+    }
+
+    // Predicates
+    qstring fn = tok;
+    next();
+    if (!expect("("))
+      return false;
+
+    if (stricmp(fn.c_str(), "insn") == 0)
+      return parse_itypes(rop_insn);
+    if (stricmp(fn.c_str(), "last") == 0)
+      return parse_itypes(rop_last);
+    if (stricmp(fn.c_str(), "target") == 0)
+      return parse_values(rop_target);
+    if (stricmp(fn.c_str(), "ref") == 0)
+      return parse_values(rop_ref);
+    if (stricmp(fn.c_str(), "const") == 0)
+      return parse_values(rop_const);
+    if (stricmp(fn.c_str(), "dominated") == 0)
+    {
+      ea_t ea;
+      if (!parse_address(&ea))
+        return false;
+      rule.dom_eas.push_back(ea);
+      emit(rop_dom, int64(rule.dom_eas.size() - 1));
+      return expect(")");
+    }
+
+    err.sprnt("unknown predicate '%s'", fn.c_str());
+    return false;
+  }
+
+  bool parse_not()
+  {
+    if (is_keyword("not") || is_punct("!"))
+    {
+      next();
+      if (!parse_not())
+        return false;
+      emit(rop_not);
+      return true;
+    }
+    return parse_term();
+  }
+
+  bool parse_and()
+  {
+    if (!parse_not())
+      return false;
+
+    while (is_keyword("and") || is_punct("&&"))
+    {
+      next();
+      size_t j = emit_jump(rop_jz);
+      emit(rop_pop);
+      if (!parse_not())
+        return false;
+      patch_jump(j);
+    }
+    return true;
+  }
+
+  bool parse_or()
+  {
+    if (!parse_and())
+      return false;
+
+    while (is_keyword("or") || is_punct("||"))
+    {
+      next();
+      size_t j = emit_jump(rop_jnz);
+      emit(rop_pop);
+      if (!parse_and())
+        return false;
+      patch_jump(j);
+    }
+    return true;
+  }
+
+public:
+  rule_compiler_t(
+    const char *expr,
+    rule_resolver_t &resolver,
+    rule_t &rule,
+    qstring &err): p(expr), resolver(resolver), rule(rule), err(err)
+  {
+  }
+
+  bool compile()
+  {
+    next();
+    if (!parse_or())
+      return false;
+
+    if (tk != tk_end)
+    {
+      err.sprnt("unexpected '%s'", tok.c_str());
+      return false;
+    }
+    return true;
+  }
+};
+
+//--------------------------------------------------------------------------
+bool rules_compile(
+    const char *text,
+    rule_resolver_t &resolver,
+    rulevec_t &rules,
+    qstring *errbuf)
+{
+  rules.qclear();
+
+  qstring err;
+  int lineno = 0;
+  for (const char *line=text; line != NULL && *line != '\0'; )
+  {
+    ++lineno;
+    const char *eol = strchr(line, '\n');
+    qstring s(line, eol == NULL ? strlen(line) : size_t(eol - line));
+    line = eol == NULL ? NULL : eol + 1;
+
+    // Trim
+    const char *b = s.c_str();
+    while (*b == ' ' || *b == '\t')
+      b++;
+    qstring t = b;
+    while (!t.empty() && strchr(" \t\r", t[t.length() - 1]) != NULL)
+      t.remove_last();
+
+    if (t.empty() || t[0] == '#')
+      continue;
+
+    const char *colon = strchr(t.c_str(), ':');
+    if (colon == NULL)
+    {
+      err.sprnt("expected 'name: expression'");
+    }
+    else
+    {
+      rule_t &rule = rules.push_back();
+      rule.name = qstring(t.c_str(), colon - t.c_str());
+      while (!rule.name.empty() && strchr(" \t", rule.name[rule.name.length() - 1]) != NULL)
+        rule.name.remove_last();
+
+      rule_compiler_t compiler(colon + 1, resolver, rule, err);
+      if (compiler.compile())
+        continue;
+    }
+
+    if (errbuf != NULL)
+      errbuf->sprnt("line %d: %s", lineno, err.c_str());
+    rules.qclear();
+    return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Immediate dominators of the blocks of a function (block 0 is the
+*        entry). Unreachable blocks have no dominator (-1)
+*/
+static void compute_idoms(
+    const func_features_t &ff,
+    intvec_t &idom)
+{
+  int nblocks = int(ff.blocks.size());
+  idom.qclear();
+  idom.resize(nblocks, -1);
+  if (nblocks == 0)
+    return;
+
+  // Reverse post order
+  intvec_t rpo_num, order, stack, it_pos;
+  rpo_num.resize(nblocks, -1);
+  it_pos.resize(nblocks, 0);
+  qvector<bool> visited;
+  visited.resize(nblocks, false);
+
+  stack.push_back(0);
+  visited[0] = true;
+  while (!stack.empty())
+  {
+    int b = stack.back();
+    const intvec_t &succ = ff.blocks[b].succ;
+    if (it_pos[b] < int(succ.size()))
+    {
+      int s = succ[it_pos[b]++];
+      if (!visited[s])
+      {
+        visited[s] = true;
+        stack.push_back(s);
+      }
+      continue;
+    }
+    order.push_back(b);
+    stack.pop_back();
+  }
+  std::reverse(order.begin(), order.end());
+  for (size_t i=0; i < order.size(); i++)
+    rpo_num[order[i]] = int(i);
+
+  // Cooper, Harvey and Kennedy iterative algorithm
+  idom[0] = 0;
+  for (bool changed=true; changed; )
+  {
+    changed = false;
+    for (size_t i=1; i < order.size(); i++)
+    {
+      int b = order[i];
+      int new_idom = -1;
+      const intvec_t &pred = ff.blocks[b].pred;
+      for (size_t k=0; k < pred.size(); k++)
+      {
+        int p = pred[k];
+        if (idom[p] == -1)
+          continue;
+
+        if (new_idom == -1)
+        {
+          new_idom = p;
+          continue;
+        }
+
+        // Intersect
+        int f1 = p, f2 = new_idom;
+        while (f1 != f2)
+        {
+          while (rpo_num[f1] > rpo_num[f2])
+            f1 = idom[f1];
+          while (rpo_num[f2] > rpo_num[f1])
+            f2 = idom[f2];
+        }
+        new_idom = f1;
+      }
+
+      if (new_idom != idom[b])
+      {
+        idom[b] = new_idom;
+        changed = true;
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Evaluates the rules on the blocks of one function at a time
+*/
+class rule_evaluator_t
+{
+  const rulevec_t &rules;
+
+  const func_features_t *ff;
+
+  // Per function: dominators and the blocks of each rule's dominated() addresses
+  intvec_t idom;
+  bool idom_ready;
+  qvector<intvec_t> dom_blocks;
+
+  qvector<int64> stack;
+
+  bool dominates(int d, int b)
+  {
+    if (d < 0)
+      return false;
+
+    if (!idom_ready)
+    {
+      compute_idoms(*ff, idom);
+      idom_ready = true;
+    }
+
+    // Walk up the dominators tree
+    while (b != d)
+    {
+      if (b == 0 || idom[b] == -1)
+        return false;
+      b = idom[b];
+    }
+    return true;
+  }
+
+  bool eval(int irule, int iblock)
+  {
+    const rule_t &rule = rules[irule];
+    const bbfeat_block_t &bb = ff->blocks[iblock];
+    const insn_feat_t *insns = ff->insns.begin() + bb.first_insn;
+
+    stack.qclear();
+    const int64 *code = rule.code.begin();
+    for (size_t pc=0, n=rule.code.size(); pc < n; )
+    {
+      int op = int(code[pc++]);
+      switch (op)
+      {
+        case rop_insn:
+        case rop_last:
+        {
+          const intvec_t &set = rule.itype_sets[size_t(code[pc++])];
+
+          // An empty block has no (last) instruction
+          if (bb.ninsns == 0)
+          {
+            stack.push_back(0);
+            break;
+          }
+
+          int64 r = 0;
+          for (int i = op == rop_last ? bb.ninsns - 1 : 0; i < bb.ninsns && r == 0; i++)
+            r = std::binary_search(set.begin(), set.end(), int(insns[i].itype));
+          stack.push_back(r);
+          break;
+        }
+        case rop_target:
+        case rop_ref:
+        case rop_const:
+        {
+          const uint64vec_t &set = rule.value_sets[size_t(code[pc++])];
+          int64 r = 0;
+          for (int i=0; i < bb.ninsns && r == 0; i++)
+          {
+            const insn_feat_t &insn = insns[i];
+            for (int k=0; k < insn.nops && r == 0; k++)
+            {
+              const op_feat_t &o = insn.ops[k];
+              bool kind_ok = op == rop_target ? (o.type == o_near || o.type == o_far)
+                           : op == rop_ref    ? (o.type == o_mem)
+                           :                    (o.type == o_imm);
+              r = kind_ok && std::binary_search(set.begin(), set.end(), o.value);
+            }
+          }
+          stack.push_back(r);
+          break;
+        }
+        case rop_dom:
+          stack.push_back(dominates(dom_blocks[irule][size_t(code[pc++])], iblock));
+          break;
+        case rop_metric:
+        {
+          int64 v;
+          switch (code[pc++])
+          {
+            case rmet_ninsns: v = bb.ninsns; break;
+            case rmet_nsucc:  v = bb.succ.size(); break;
+            case rmet_npred:  v = bb.pred.size(); break;
+            default:          v = int64(bb.end - bb.start); break;
+          }
+          stack.push_back(v);
+          break;
+        }
+        case rop_push:
+          stack.push_back(code[pc++]);
+          break;
+        case rop_cmp:
+        {
+          int64 b = stack.back();
+          stack.pop_back();
+          int64 &a = stack.back();
+          switch (code[pc++])
+          {
+            case rcmp_eq: a = a == b; break;
+            case rcmp_ne: a = a != b; break;
+            case rcmp_lt: a = a <  b; break;
+            case rcmp_le: a = a <= b; break;
+            case rcmp_gt: a = a >  b; break;
+            default:      a = a >= b; break;
+          }
+          break;
+        }
+        case rop_not:
+          stack.back() = stack.back() == 0;
+          break;
+        case rop_jz:
+        case rop_jnz:
+        {
+          size_t target = size_t(code[pc++]);
+          if ((stack.back() != 0) == (op == rop_jnz))
+            pc = target;
+          break;
+        }
+        case rop_pop:
+          stack.pop_back();
+          break;
+      }
+    }
+    return !stack.empty() && stack.back() != 0;
+  }
+
+public:
+  rule_evaluator_t(const rulevec_t &rules): rules(rules), ff(NULL)
+  {
+  }
+
+  void run(
+    const func_features_t &func,
+    int ifunc,
+    rule_matchvec_t &matches)
+  {
+    ff = &func;
+    idom_ready = false;
+
+    // Resolve the dominated() addresses to blocks of this function
+    dom_blocks.resize(rules.size());
+    for (size_t r=0; r < rules.size(); r++)
+    {
+      const eavec_t &eas = rules[r].dom_eas;
+      dom_blocks[r].resize(eas.size());
+      for (size_t i=0; i < eas.size(); i++)
+        dom_blocks[r][i] = func.find_block(eas[i]);
+    }
+
+    for (size_t r=0; r < rules.size(); r++)
+    {
+      rule_match_t *m = NULL;
+      for (int b=0, nblocks=int(func.blocks.size()); b < nblocks; b++)
+      {
+        if (!eval(int(r), b))
+          continue;
+
+        if (m == NULL)
+        {
+          m = &matches.push_back();
+          m->rule = int(r);
+          m->func = ifunc;
+        }
+        m->blocks.push_back(b);
+      }
+    }
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief State shared by the evaluation threads
+*/
+struct rules_job_t
+{
+  const rulevec_t *rules;
+  const func_features_t *funcs;
+  int nfuncs;
+  std::atomic<int> next_func;
+  qvector<rule_matchvec_t> results;
+  std::atomic<int> next_result;
+};
+
+static int idaapi rules_thread(void *ud)
+{
+  rules_job_t &job = *(rules_job_t *)ud;
+  rule_matchvec_t &out = job.results[job.next_result++];
+
+  rule_evaluator_t evaluator(*job.rules);
+  for (int f; (f = job.next_func++) < job.nfuncs; )
+    evaluator.run(job.funcs[f], f, out);
+
+  return 0;
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Orders the matches by function then by rule
+*/
+static bool match_less(const rule_match_t &a, const rule_match_t &b)
+{
+  return a.func < b.func || (a.func == b.func && a.rule < b.rule);
+}
+
+//--------------------------------------------------------------------------
+size_t rules_evaluate(
+    const rulevec_t &rules,
+    const func_features_t *funcs,
+    size_t nfuncs,
+    rule_matchvec_t &matches,
+    int nthreads)
+{
+  matches.qclear();
+  if (rules.empty() || nfuncs == 0)
+    return 0;
+
+  if (nthreads <= 0)
+    nthreads = qmax(int(std::thread::hardware_concurrency()), 1);
+  if (size_t(nthreads) > nfuncs)
+    nthreads = int(nfuncs);
+
+  rules_job_t job;
+  job.rules = &rules;
+  job.funcs = funcs;
+  job.nfuncs = int(nfuncs);
+  job.next_func = 0;
+  job.next_result = 0;
+  job.results.resize(nthreads);
+
+  // The calling thread is one of the workers
+  qvector<qthread_t> threads;
+  for (int i=1; i < nthreads; i++)
+  {
+    qthread_t t = qthread_create(rules_thread, &job);
+    if (t != NULL)
+      threads.push_back(t);
+  }
+  rules_thread(&job);
+
+  for (size_t i=0; i < threads.size(); i++)
+  {
+    qthread_join(threads[i]);
+    qthread_free(threads[i]);
+  }
+
+  for (size_t i=0; i < job.results.size(); i++)
+  {
+    rule_matchvec_t &r = job.results[i];
+    for (size_t k=0; k < r.size(); k++)
+    {
+      rule_match_t &m = matches.push_back();
+      m.rule = r[k].rule;
+      m.func = r[k].func;
+      m.blocks.swap(r[k].blocks);
+    }
+  }
+  std::sort(matches.begin(), matches.end(), match_less);
+  return matches.size();
+}
@@ -0,0 +1,137 @@
+#ifndef __RULES__
+#define __RULES__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Grouping rules module
+
+A small rule language to group blocks by what they contain. A rules text
+has one rule per line:
+
+  name: expression
+
+Lines starting with '#' are comments. The expression operators are
+'and', 'or', 'not' (also '&&', '||', '!') and parenthesis. The terms are:
+
+  insn(m1, m2, ...)     The block has an instruction with one of these mnemonics
+  last(m1, m2, ...)     The block's last instruction has one of these mnemonics
+  target(x1, x2, ...)   An instruction jumps to or calls one of these addresses
+  ref(x1, x2, ...)      An instruction references one of these data addresses
+  const(v1, v2, ...)    An instruction uses one of these immediate values
+  dominated(x)          The block is dominated by the block containing x
+                        (including that block)
+  ninsns, nsucc, npred, size
+                        Compared to a number with == != < <= > >=
+
+A block without instructions (empty or zero-size blocks do occur) matches
+neither insn() nor last(): "empty: not last(ret) and ninsns == 0" is true
+for it.
+
+Addresses are numbers or names. For example:
+
+  calls_malloc: last(call) and target(malloc)
+  md5_init:     const(0x67452301, 0xEFCDAB89)
+  after_check:  dominated(0x401020) and not insn(ret)
+  fat_forks:    ninsns >= 20 and nsucc == 2
+
+The rules are compiled to a small stack bytecode. The names are resolved
+at compile time (see rule_resolver_t) so the evaluation does not call the
+IDA kernel; it runs over the function features in parallel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include "bbfeat.h"
+
+//--------------------------------------------------------------------------
+#define RULES_EXT "gsrules"
+
+//--------------------------------------------------------------------------
+/**
+* @brief Resolves the names used in the rules text
+*/
+class rule_resolver_t
+{
+public:
+  virtual ~rule_resolver_t() { }
+
+  /**
+  * @brief Return all the instruction types with that mnemonic
+  */
+  virtual bool get_itypes(const char *mnem, intvec_t &itypes) = 0;
+
+  /**
+  * @brief Return the address of a name
+  */
+  virtual bool get_name_ea(const char *name, ea_t *ea) = 0;
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief A compiled rule
+*/
+struct rule_t
+{
+  qstring name;
+
+  /**
+  * @brief Opcodes followed by their operand (if any)
+  */
+  qvector<int64> code;
+
+  /**
+  * @brief Sorted instruction types sets referenced by insn() and last()
+  */
+  qvector<intvec_t> itype_sets;
+
+  /**
+  * @brief Sorted values sets referenced by target(), ref() and const()
+  */
+  qvector<uint64vec_t> value_sets;
+
+  /**
+  * @brief Addresses referenced by dominated()
+  */
+  eavec_t dom_eas;
+};
+typedef qvector<rule_t> rulevec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief The blocks of a function matching a rule
+*/
+struct rule_match_t
+{
+  int rule;
+  int func;
+  intvec_t blocks;
+};
+typedef qvector<rule_match_t> rule_matchvec_t;
+
+//--------------------------------------------------------------------------
+/**
+* @brief Compile a rules text
+* @param errbuf - the error message (with the line number) if it fails
+*/
+bool rules_compile(
+    const char *text,
+    rule_resolver_t &resolver,
+    rulevec_t &rules,
+    qstring *errbuf);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Evaluate the rules over all the blocks of the functions
+* @param nthreads - count of worker threads; zero to use one per core
+* @return The count of matches (sorted by function then by rule)
+*/
+size_t rules_evaluate(
+    const rulevec_t &rules,
+    const func_features_t *funcs,
+    size_t nfuncs,
+    rule_matchvec_t &matches,
+    int nthreads = 0);
+
+#endif
@@ -0,0 +1,659 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - Added memory_size()
+--------------------------------------------------------------------------*/
+
+#include "sgquery.h"
+#include <ctype.h>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+static void to_lower(const qstring &in, qstring *out)
+{
+  *out = in;
+  for (size_t i=0; i < out->length(); i++)
+    (*out)[i] = char(tolower(uchar((*out)[i])));
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Orders SG indices by a numeric attribute
+*/
+struct num_less_t
+{
+  const sgquery_index_t &idx;
+  sgquery_index_t::num_attr_e attr;
+
+  num_less_t(
+    const sgquery_index_t &idx,
+    sgquery_index_t::num_attr_e attr): idx(idx), attr(attr)
+  {
+  }
+
+  bool operator()(int a, int b) const
+  {
+    int64 va = idx.get_num(a, attr), vb = idx.get_num(b, attr);
+    return va < vb || (va == vb && a < b);
+  }
+
+  // For the searches by value
+  bool operator()(int a, int64 v) const { return idx.get_num(a, attr) < v; }
+  bool operator()(int64 v, int a) const { return v < idx.get_num(a, attr); }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Orders SG indices by lower case id or name
+*/
+struct str_less_t
+{
+  const sgquery_index_t &idx;
+  bool by_name;
+
+  str_less_t(const sgquery_index_t &idx, bool by_name): idx(idx), by_name(by_name)
+  {
+  }
+
+  inline const char *get(int i) const
+  {
+    const sgquery_index_t::sg_attr_t &a = idx.get_attr(i);
+    return by_name ? a.lower_name.c_str() : a.lower_id.c_str();
+  }
+
+  bool operator()(int a, int b) const
+  {
+    int r = strcmp(get(a), get(b));
+    return r < 0 || (r == 0 && a < b);
+  }
+
+  bool operator()(int a, const char *v) const { return strcmp(get(a), v) < 0; }
+  bool operator()(const char *v, int a) const { return strcmp(v, get(a)) < 0; }
+};
+
+//--------------------------------------------------------------------------
+size_t sgquery_index_t::memory_size() const
+{
+  size_t bytes = sizeof(*this)
+               + sgs.size() * sizeof(sg_attr_t)
+               + (by_id.size() + by_name.size()) * sizeof(int)
+               + ivals.size() * sizeof(ival_t)
+               + max_end.size() * sizeof(ea_t);
+
+  for (int i=0; i < sqa_count; i++)
+    bytes += by_num[i].size() * sizeof(int);
+
+  for (size_t i=0; i < sgs.size(); i++)
+    bytes += sgs[i].lower_id.size() + sgs[i].lower_name.size();
+
+  return bytes;
+}
+
+//--------------------------------------------------------------------------
+int64 sgquery_index_t::get_num(int i, num_attr_e attr) const
+{
+  const sg_attr_t &a = sgs[i];
+  switch (attr)
+  {
+    case sqa_ngcount: return a.ngcount;
+    case sqa_ndcount: return a.ndcount;
+    case sqa_ninsns:  return a.ninsns;
+    case sqa_start:   return int64(a.start);
+    default:          return int64(a.end);
+  }
+}
+
+//--------------------------------------------------------------------------
+void sgquery_index_t::build(
+    groupman_t *gm,
+    const func_features_t *ff)
+{
+  sgs.qclear();
+  ivals.qclear();
+
+  psupergroup_listp_t sgl = gm->get_path_sgl();
+  for (supergroup_listp_t::iterator it_sg=sgl->begin();
+       it_sg != sgl->end();
+       ++it_sg)
+  {
+    psupergroup_t sg = *it_sg;
+    int isg = int(sgs.size());
+
+    sg_attr_t &a = sgs.push_back();
+    a.sg = sg;
+    a.ngcount = int(sg->groups.size());
+    a.ndcount = 0;
+    a.ninsns = 0;
+    a.start = BADADDR;
+    a.end = 0;
+    to_lower(sg->id, &a.lower_id);
+    to_lower(sg->name, &a.lower_name);
+
+    for (nodegroup_list_t::iterator it_ng=sg->groups.begin();
+         it_ng != sg->groups.end();
+         ++it_ng)
+    {
+      for (nodegroup_t::iterator it_nd=(*it_ng)->begin();
+           it_nd != (*it_ng)->end();
+           ++it_nd)
+      {
+        pnodedef_t nd = *it_nd;
+        ++a.ndcount;
+        a.start = qmin(a.start, nd->start);
+        a.end = qmax(a.end, nd->end);
+
+        if (   ff != NULL
+            && nd->nid >= 0
+            && nd->nid < int(ff->blocks.size())
+            && ff->blocks[nd->nid].start == nd->start)
+        {
+          a.ninsns += ff->blocks[nd->nid].ninsns;
+        }
+
+        ival_t &iv = ivals.push_back();
+        iv.start = nd->start;
+        iv.end = nd->end;
+        iv.sg = isg;
+      }
+    }
+    if (a.ndcount == 0)
+      a.start = 0;
+  }
+
+  // Sorted attributes
+  int n = int(sgs.size());
+  for (int attr=0; attr < sqa_count; attr++)
+  {
+    intvec_t &v = by_num[attr];
+    v.resize(n);
+    for (int i=0; i < n; i++)
+      v[i] = i;
+    std::sort(v.begin(), v.end(), num_less_t(*this, num_attr_e(attr)));
+  }
+
+  by_id = by_num[0];
+  std::sort(by_id.begin(), by_id.end(), str_less_t(*this, false));
+  by_name = by_num[0];
+  std::sort(by_name.begin(), by_name.end(), str_less_t(*this, true));
+
+  // Interval tree
+  std::sort(ivals.begin(), ivals.end(), ival_less);
+  max_end.resize(ivals.size());
+  build_max_end(0, int(ivals.size()));
+}
+
+//--------------------------------------------------------------------------
+bool sgquery_index_t::ival_less(const ival_t &a, const ival_t &b)
+{
+  return a.start < b.start;
+}
+
+//--------------------------------------------------------------------------
+ea_t sgquery_index_t::build_max_end(int lo, int hi)
+{
+  if (lo >= hi)
+    return 0;
+
+  int mid = (lo + hi) / 2;
+  ea_t m = ivals[mid].end;
+  m = qmax(m, build_max_end(lo, mid));
+  m = qmax(m, build_max_end(mid + 1, hi));
+  max_end[mid] = m;
+  return m;
+}
+
+//--------------------------------------------------------------------------
+void sgquery_index_t::find_overlaps(
+    int lo,
+    int hi,
+    ea_t a,
+    ea_t b,
+    intvec_t &out) const
+{
+  while (lo < hi)
+  {
+    int mid = (lo + hi) / 2;
+
+    // Nothing in this subtree ends after 'a'
+    if (max_end[mid] <= a)
+      return;
+
+    find_overlaps(lo, mid, a, b, out);
+
+    // This one and the right subtree start at or after 'b'
+    if (ivals[mid].start >= b)
+      return;
+
+    if (ivals[mid].end > a)
+      out.push_back(ivals[mid].sg);
+
+    lo = mid + 1;
+  }
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Sort and remove the duplicates
+*/
+static void make_set(intvec_t &v)
+{
+  std::sort(v.begin(), v.end());
+  v.resize(std::unique(v.begin(), v.end()) - v.begin());
+}
+
+//--------------------------------------------------------------------------
+static void append_range(intvec_t &out, const int *first, const int *last)
+{
+  for (; first != last; ++first)
+    out.push_back(*first);
+}
+
+//--------------------------------------------------------------------------
+void sgquery_index_t::select_num(
+    num_attr_e attr,
+    const char *cmp,
+    int64 value,
+    intvec_t &out) const
+{
+  const intvec_t &v = by_num[attr];
+  num_less_t less(*this, attr);
+  const int *lb = std::lower_bound(v.begin(), v.end(), value, less);
+  const int *ub = std::upper_bound(v.begin(), v.end(), value, less);
+
+  out.qclear();
+  if (strcmp(cmp, "==") == 0)
+  {
+    append_range(out, lb, ub);
+  }
+  else if (strcmp(cmp, "!=") == 0)
+  {
+    append_range(out, v.begin(), lb);
+    append_range(out, ub, v.end());
+  }
+  else if (strcmp(cmp, "<") == 0)
+  {
+    append_range(out, v.begin(), lb);
+  }
+  else if (strcmp(cmp, "<=") == 0)
+  {
+    append_range(out, v.begin(), ub);
+  }
+  else if (strcmp(cmp, ">") == 0)
+  {
+    append_range(out, ub, v.end());
+  }
+  else
+  {
+    append_range(out, lb, v.end());
+  }
+  std::sort(out.begin(), out.end());
+}
+
+//--------------------------------------------------------------------------
+void sgquery_index_t::select_str(
+    bool by_name,
+    const char *cmp,
+    const char *value,
+    intvec_t &out) const
+{
+  qstring lower;
+  to_lower(qstring(value), &lower);
+  const char *s = lower.c_str();
+
+  out.qclear();
+  if (strcmp(cmp, "~") == 0)
+  {
+    // Substring: scan
+    for (size_t i=0; i < sgs.size(); i++)
+    {
+      const qstring &str = by_name ? sgs[i].lower_name : sgs[i].lower_id;
+      if (strstr(str.c_str(), s) != NULL)
+        out.push_back(int(i));
+    }
+    return;
+  }
+
+  const intvec_t &v = by_name ? this->by_name : by_id;
+  str_less_t less(*this, by_name);
+  const int *it = std::lower_bound(v.begin(), v.end(), s, less);
+  if (strcmp(cmp, "==") == 0)
+  {
+    const int *ub = std::upper_bound(v.begin(), v.end(), s, less);
+    append_range(out, it, ub);
+  }
+  else
+  {
+    // Prefix
+    size_t len = strlen(s);
+    for (; it != v.end() && strncmp(less.get(*it), s, len) == 0; ++it)
+      out.push_back(*it);
+  }
+  std::sort(out.begin(), out.end());
+}
+
+//--------------------------------------------------------------------------
+void sgquery_index_t::select_overlaps(
+    ea_t a,
+    ea_t b,
+    intvec_t &out) const
+{
+  out.qclear();
+  find_overlaps(0, int(ivals.size()), a, b, out);
+  make_set(out);
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Parses and evaluates a query in one pass. Each term is a sorted SG set
+*/
+class sgquery_parser_t
+{
+  const sgquery_index_t &idx;
+  const char *p;
+  qstring &err;
+
+  enum
+  {
+    tk_end,
+    tk_ident,
+    tk_number,
+    tk_string,
+    tk_punct,
+  } tk;
+  qstring tok;
+  uint64 tok_val;
+
+  void next()
+  {
+    while (*p == ' ' || *p == '\t')
+      p++;
+
+    if (*p == '\0')
+    {
+      tk = tk_end;
+      tok.qclear();
+      return;
+    }
+
+    if (*p == '"' || *p == '\'')
+    {
+      char q = *p++;
+      const char *s = p;
+      while (*p != '\0' && *p != q)
+        p++;
+      tok = qstring(s, p - s);
+      if (*p == q)
+        p++;
+      tk = tk_string;
+      return;
+    }
+
+    if (isdigit(uchar(*p)))
+    {
+      char *end;
+      tok_val = strtoull(p, &end, 0);
+      tok = qstring(p, end - p);
+      p = end;
+      tk = tk_number;
+      return;
+    }
+
+    if (isalnum(uchar(*p)) || *p == '_' || *p == '$' || *p == '@' || *p == '?' || *p == '.')
+    {
+      const char *s = p;
+      while (isalnum(uchar(*p)) || *p == '_' || *p == '$' || *p == '@' || *p == '?' || *p == '.')
+        p++;
+      tok = qstring(s, p - s);
+      tk = tk_ident;
+      return;
+    }
+
+    static const char *const ops2[] = { "==", "!=", "<=", ">=", "^=", "&&", "||" };
+    for (size_t i=0; i < qnumber(ops2); i++)
+    {
+      if (p[0] == ops2[i][0] && p[1] == ops2[i][1])
+      {
+        tok = ops2[i];
+        p += 2;
+        tk = tk_punct;
+        return;
+      }
+    }
+    tok = qstring(p, 1);
+    p++;
+    tk = tk_punct;
+  }
+
+  inline bool is_punct(const char *s)
+  {
+    return tk == tk_punct && tok == s;
+  }
+
+  inline bool is_keyword(const char *s)
+  {
+    return tk == tk_ident && stricmp(tok.c_str(), s) == 0;
+  }
+
+  bool expect(const char *s)
+  {
+    if (is_punct(s))
+    {
+      next();
+      return true;
+    }
+    err.sprnt("expected '%s' near '%s'", s, tok.c_str());
+    return false;
+  }
+
+  bool parse_number(uint64 *v)
+  {
+    if (tk != tk_number)
+    {
+      err.sprnt("expected a number near '%s'", tok.c_str());
+      return false;
+    }
+    *v = tok_val;
+    next();
+    return true;
+  }
+
+  bool parse_term(intvec_t &out)
+  {
+    if (is_punct("("))
+    {
+      next();
+      return parse_or(out) && expect(")");
+    }
+
+    if (tk != tk_ident)
+    {
+      err.sprnt("unexpected '%s'", tok.c_str());
+      return false;
+    }
+
+    if (is_keyword("synthetic"))
+    {
+      next();
+      out.qclear();
+      for (size_t i=0; i < idx.size(); i++)
+      {
+        if (idx.get_sg(int(i))->is_synthetic)
+          out.push_back(int(i));
+      }
+      return true;
+    }
+
+    if (is_keyword("addr") || is_keyword("overlaps"))
+    {
+      bool is_addr = is_keyword("addr");
+      next();
+
+      uint64 a, b;
+      if (!expect("(") || !parse_number(&a))
+        return false;
+
+      if (is_addr)
+        b = a + 1;
+      else if (!expect(",") || !parse_number(&b))
+        return false;
+
+      idx.select_overlaps(ea_t(a), ea_t(b), out);
+      return expect(")");
+    }
+
+    if (is_keyword("id") || is_keyword("name"))
+    {
+      bool by_name = is_keyword("name");
+      next();
+      if (!is_punct("==") && !is_punct("^=") && !is_punct("~"))
+      {
+        err.sprnt("expected '==', '^=' or '~' near '%s'", tok.c_str());
+        return false;
+      }
+      qstring cmp = tok;
+      next();
+
+      if (tk == tk_end || tk == tk_punct)
+      {
+        err.sprnt("expected a string near '%s'", tok.c_str());
+        return false;
+      }
+      idx.select_str(by_name, cmp.c_str(), tok.c_str(), out);
+      next();
+      return true;
+    }
+
+    static const char *const attrs[] = { "ngcount", "ndcount", "ninsns", "start", "end" };
+    for (size_t i=0; i < qnumber(attrs); i++)
+    {
+      if (!is_keyword(attrs[i]))
+        continue;
+
+      next();
+      static const char *const cmps[] = { "==", "!=", "<", "<=", ">", ">=" };
+      size_t icmp = 0;
+      while (icmp < qnumber(cmps) && !is_punct(cmps[icmp]))
+        icmp++;
+
+      if (icmp == qnumber(cmps))
+      {
+        err.sprnt("expected a comparison after '%s'", attrs[i]);
+        return false;
+      }
+      next();
+
+      uint64 v;
+      if (!parse_number(&v))
+        return false;
+
+      idx.select_num(sgquery_index_t::num_attr_e(i), cmps[icmp], int64(v), out);
+      return true;
+    }
+
+    err.sprnt("unknown attribute '%s'", tok.c_str());
+    return false;
+  }
+
+  bool parse_not(intvec_t &out)
+  {
+    if (is_keyword("not") || is_punct("!"))
+    {
+      next();
+      intvec_t v;
+      if (!parse_not(v))
+        return false;
+
+      // Complement
+      out.qclear();
+      size_t k = 0;
+      for (int i=0, n=int(idx.size()); i < n; i++)
+      {
+        if (k < v.size() && v[k] == i)
+          k++;
+        else
+          out.push_back(i);
+      }
+      return true;
+    }
+    return parse_term(out);
+  }
+
+  bool parse_and(intvec_t &out)
+  {
+    if (!parse_not(out))
+      return false;
+
+    while (is_keyword("and") || is_punct("&&"))
+    {
+      next();
+      intvec_t rhs, r;
+      if (!parse_not(rhs))
+        return false;
+
+      r.resize(qmin(out.size(), rhs.size()));
+      r.resize(std::set_intersection(out.begin(), out.end(), rhs.begin(), rhs.end(), r.begin()) - r.begin());
+      out.swap(r);
+    }
+    return true;
+  }
+
+  bool parse_or(intvec_t &out)
+  {
+    if (!parse_and(out))
+      return false;
+
+    while (is_keyword("or") || is_punct("||"))
+    {
+      next();
+      intvec_t rhs, r;
+      if (!parse_and(rhs))
+        return false;
+
+      r.resize(out.size() + rhs.size());
+      r.resize(std::set_union(out.begin(), out.end(), rhs.begin(), rhs.end(), r.begin()) - r.begin());
+      out.swap(r);
+    }
+    return true;
+  }
+
+public:
+  sgquery_parser_t(
+    const sgquery_index_t &idx,
+    const char *expr,
+    qstring &err): idx(idx), p(expr), err(err)
+  {
+  }
+
+  bool parse(intvec_t &result)
+  {
+    next();
+    if (!parse_or(result))
+      return false;
+
+    if (tk != tk_end)
+    {
+      err.sprnt("unexpected '%s'", tok.c_str());
+      return false;
+    }
+    return true;
+  }
+};
+
+//--------------------------------------------------------------------------
+bool sgquery_index_t::query(
+    const char *expr,
+    intvec_t &result,
+    qstring *errbuf) const
+{
+  qstring err;
+  sgquery_parser_t parser(*this, expr, err);
+  if (parser.parse(result))
+    return true;
+
+  result.qclear();
+  if (errbuf != NULL)
+    *errbuf = err;
+  return false;
+}
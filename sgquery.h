@@ -0,0 +1,163 @@
+#ifndef __SGQUERY__
+#define __SGQUERY__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Super groups query module
+
+Queries the path super groups of a groupman by their attributes:
+
+  id, name              == (exact), ^= (prefix), ~ (substring). Case insensitive
+  ngcount, ndcount,
+  ninsns, start, end    == != < <= > >=
+  addr(x)               an ND contains the address
+  overlaps(a, b)        an ND overlaps [a, b)
+  synthetic             synthetic SG
+
+combined with 'and', 'or', 'not' (also '&&', '||', '!') and parenthesis.
+String values are quoted or bare words. For example:
+
+  ngcount >= 3 and name ~ loop
+  overlaps(0x401000, 0x401100) and not synthetic
+
+The index keeps the SGs sorted by each attribute and an interval tree of
+the ND ranges, so every term is resolved with binary searches (except the
+substring match which is a scan). The terms results are combined as
+sorted sets of SG indices.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include "groupman.h"
+#include "bbfeat.h"
+
+//--------------------------------------------------------------------------
+/**
+* @brief Query index over the path super groups of a groupman
+*/
+class sgquery_index_t
+{
+public:
+  /**
+  * @brief Attributes of one super group
+  */
+  struct sg_attr_t
+  {
+    psupergroup_t sg;
+    int ngcount;
+    int ndcount;
+    int ninsns;
+    ea_t start;
+    ea_t end;
+    qstring lower_id;
+    qstring lower_name;
+  };
+
+  /**
+  * @brief Sortable numeric attributes
+  */
+  enum num_attr_e
+  {
+    sqa_ngcount,
+    sqa_ndcount,
+    sqa_ninsns,
+    sqa_start,
+    sqa_end,
+    sqa_count
+  };
+
+private:
+  qvector<sg_attr_t> sgs;
+
+  // SG indices sorted by each numeric attribute
+  intvec_t by_num[sqa_count];
+
+  // SG indices sorted by lower case id and name
+  intvec_t by_id, by_name;
+
+  // ND intervals sorted by start and the max end of each implicit subtree
+  struct ival_t
+  {
+    ea_t start;
+    ea_t end;
+    int sg;
+  };
+  qvector<ival_t> ivals;
+  qvector<ea_t> max_end;
+
+  static bool ival_less(const ival_t &a, const ival_t &b);
+
+  ea_t build_max_end(int lo, int hi);
+
+  void find_overlaps(
+      int lo,
+      int hi,
+      ea_t a,
+      ea_t b,
+      intvec_t &out) const;
+
+public:
+  /**
+  * @brief Index the path SGL of a groupman
+  * @param ff - optional: the function features to count the instructions
+  */
+  void build(
+      groupman_t *gm,
+      const func_features_t *ff = NULL);
+
+  inline size_t size() const { return sgs.size(); }
+
+  /**
+  * @brief Rough memory footprint of the index, in bytes
+  */
+  size_t memory_size() const;
+
+  inline psupergroup_t get_sg(int i) const { return sgs[i].sg; }
+
+  inline const sg_attr_t &get_attr(int i) const { return sgs[i]; }
+
+  int64 get_num(int i, num_attr_e attr) const;
+
+  /**
+  * @brief SGs with a numeric attribute compared to a value
+  * @param cmp - "==", "!=", "<", "<=", ">" or ">="
+  */
+  void select_num(
+      num_attr_e attr,
+      const char *cmp,
+      int64 value,
+      intvec_t &out) const;
+
+  /**
+  * @brief SGs with an id (or name) equal to, prefixed by or containing a string
+  * @param cmp - "==", "^=" or "~"
+  */
+  void select_str(
+      bool by_name,
+      const char *cmp,
+      const char *value,
+      intvec_t &out) const;
+
+  /**
+  * @brief SGs with an ND overlapping [a, b)
+  */
+  void select_overlaps(
+      ea_t a,
+      ea_t b,
+      intvec_t &out) const;
+
+  /**
+  * @brief Run a query
+  * @param result - the sorted SG indices
+  */
+  bool query(
+      const char *expr,
+      intvec_t &result,
+      qstring *errbuf) const;
+};
+
+#endif
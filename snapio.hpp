@@ -0,0 +1,181 @@
+#ifndef __SNAPIO__
+#define __SNAPIO__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Buffer serialization helpers of the binary files written for the headless
+runs (see snapshot.h and gsdb.h): bytes, LEB128 varints, zigzag signed
+varints and length prefixed strings.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <pro.h>
+#include <fpro.h>
+
+//--------------------------------------------------------------------------
+/**
+* @brief Serializes to a memory buffer
+*/
+class snap_writer_t
+{
+public:
+  qvector<uchar> buf;
+
+  inline void put_u8(uchar v)
+  {
+    buf.push_back(v);
+  }
+
+  void put_uleb(uint64 v)
+  {
+    do
+    {
+      uchar b = uchar(v & 0x7F);
+      v >>= 7;
+      if (v != 0)
+        b |= 0x80;
+      buf.push_back(b);
+    } while (v != 0);
+  }
+
+  inline void put_sleb(int64 v)
+  {
+    put_uleb((uint64(v) << 1) ^ uint64(v >> 63));
+  }
+
+  void put_bytes(const void *p, size_t sz)
+  {
+    const uchar *b = (const uchar *)p;
+    for (size_t i=0; i < sz; i++)
+      buf.push_back(b[i]);
+  }
+
+  /**
+  * @brief Write the buffer to a file
+  */
+  bool save_file(const char *filename)
+  {
+    FILE *fp = qfopen(filename, "wb");
+    if (fp == NULL)
+      return false;
+
+    bool ok = qfwrite(fp, buf.begin(), buf.size()) == ssize_t(buf.size());
+    qfclose(fp);
+    return ok;
+  }
+
+  void put_str(const char *s, size_t len)
+  {
+    put_uleb(len);
+    put_bytes(s, len);
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Deserializes from a memory buffer. Reading past the end sets 'ok' to false
+*/
+class snap_reader_t
+{
+  const uchar *p, *end;
+
+public:
+  bool ok;
+
+  snap_reader_t(const uchar *p, size_t sz): p(p), end(p + sz), ok(true)
+  {
+  }
+
+  inline uchar get_u8()
+  {
+    if (p >= end)
+    {
+      ok = false;
+      return 0;
+    }
+    return *p++;
+  }
+
+  uint64 get_uleb()
+  {
+    uint64 v = 0;
+    for (int shift=0; shift < 64; shift += 7)
+    {
+      uchar b = get_u8();
+      v |= uint64(b & 0x7F) << shift;
+      if ((b & 0x80) == 0)
+        return v;
+    }
+    ok = false;
+    return 0;
+  }
+
+  /**
+  * @brief Read an element count. Each element takes at least one byte:
+  *        a count larger than the bytes left sets 'ok' to false
+  */
+  size_t get_count()
+  {
+    uint64 v = get_uleb();
+    if (!ok || v > uint64(end - p))
+    {
+      ok = false;
+      return 0;
+    }
+    return size_t(v);
+  }
+
+  inline int64 get_sleb()
+  {
+    uint64 v = get_uleb();
+    return int64(v >> 1) ^ -int64(v & 1);
+  }
+
+  bool get_bytes(void *out, size_t sz)
+  {
+    if (size_t(end - p) < sz)
+    {
+      ok = false;
+      return false;
+    }
+    memcpy(out, p, sz);
+    p += sz;
+    return true;
+  }
+
+  bool get_str(qstring *out)
+  {
+    size_t len = get_count();
+    if (!ok)
+      return false;
+
+    out->qclear();
+    out->append((const char *)p, len);
+    p += len;
+    return true;
+  }
+
+  /**
+  * @brief Load a whole file into a buffer
+  */
+  static bool load_file(const char *filename, qvector<uchar> &buf)
+  {
+    FILE *fp = qfopen(filename, "rb");
+    if (fp == NULL)
+      return false;
+
+    qfseek(fp, 0, SEEK_END);
+    buf.resize(size_t(qftell(fp)));
+    qfseek(fp, 0, SEEK_SET);
+    bool ok = qfread(fp, buf.begin(), buf.size()) == ssize_t(buf.size());
+    qfclose(fp);
+    return ok;
+  }
+};
+
+#endif
@@ -0,0 +1,167 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+                                - Moved the buffer reader and writer to snapio.hpp
+                                - fix: reject the counts larger than the file and the bad successors while loading
+                                - fix: use the file helpers of snapio.hpp
+--------------------------------------------------------------------------*/
+
+#include "snapshot.h"
+#include "snapio.hpp"
+
+//--------------------------------------------------------------------------
+static const char SNAP_MAGIC[] = "GSSNAP";
+static const uchar SNAP_VERSION = 1;
+
+//--------------------------------------------------------------------------
+bool snapshot_save(
+    const char *filename,
+    const char *db_name,
+    const func_featvec_t &funcs)
+{
+  snap_writer_t w;
+  w.put_bytes(SNAP_MAGIC, sizeof(SNAP_MAGIC) - 1);
+  w.put_u8(SNAP_VERSION);
+
+  size_t name_len = db_name == NULL ? 0 : strlen(db_name);
+  w.put_uleb(name_len);
+  w.put_bytes(db_name, name_len);
+
+  w.put_uleb(funcs.size());
+  for (size_t ifunc=0; ifunc < funcs.size(); ifunc++)
+  {
+    const func_features_t &ff = funcs[ifunc];
+    w.put_uleb(ff.ea);
+    w.put_uleb(ff.blocks.size());
+    for (size_t iblock=0; iblock < ff.blocks.size(); iblock++)
+    {
+      const bbfeat_block_t &bb = ff.blocks[iblock];
+      w.put_sleb(int64(bb.start - ff.ea));
+      w.put_uleb(bb.end - bb.start);
+      w.put_uleb(bb.ninsns);
+
+      w.put_uleb(bb.succ.size());
+      for (size_t i=0; i < bb.succ.size(); i++)
+        w.put_uleb(bb.succ[i]);
+
+      for (int i=0; i < bb.ninsns; i++)
+      {
+        const insn_feat_t &insn = ff.insns[bb.first_insn + i];
+        w.put_u8(insn.size);
+        w.put_uleb(insn.itype);
+        w.put_u8(insn.nops);
+        for (int iop=0; iop < insn.nops; iop++)
+        {
+          const op_feat_t &op = insn.ops[iop];
+          w.put_u8(op.type);
+          w.put_u8(op.dtyp);
+          w.put_uleb(op.reg);
+          w.put_uleb(op.value);
+        }
+      }
+    }
+  }
+
+  return w.save_file(filename);
+}
+
+//--------------------------------------------------------------------------
+bool snapshot_load(
+    const char *filename,
+    qstring *db_name,
+    func_featvec_t &funcs)
+{
+  funcs.qclear();
+
+  qvector<uchar> buf;
+  if (!snap_reader_t::load_file(filename, buf))
+    return false;
+
+  snap_reader_t r(buf.begin(), buf.size());
+
+  char magic[sizeof(SNAP_MAGIC) - 1];
+  if (   !r.get_bytes(magic, sizeof(magic))
+      || memcmp(magic, SNAP_MAGIC, sizeof(magic)) != 0
+      || r.get_u8() != SNAP_VERSION)
+  {
+    return false;
+  }
+
+  size_t name_len = r.get_count();
+  if (!r.ok)
+    return false;
+
+  qvector<char> name;
+  name.resize(name_len + 1, '\0');
+  if (!r.get_bytes(name.begin(), name_len))
+    return false;
+  if (db_name != NULL)
+    *db_name = name.begin();
+
+  size_t nfuncs = r.get_count();
+  for (size_t ifunc=0; ifunc < nfuncs && r.ok; ifunc++)
+  {
+    func_features_t &ff = funcs.push_back();
+    ff.ea = ea_t(r.get_uleb());
+
+    int nblocks = int(r.get_count());
+    for (int iblock=0; iblock < nblocks && r.ok; iblock++)
+    {
+      bbfeat_block_t &bb = ff.blocks.push_back();
+      bb.start = ea_t(ff.ea + r.get_sleb());
+      bb.end = ea_t(bb.start + r.get_uleb());
+      bb.ninsns = int(r.get_count());
+      bb.first_insn = int(ff.insns.size());
+
+      int nsucc = int(r.get_count());
+      for (int i=0; i < nsucc && r.ok; i++)
+      {
+        uint64 succ = r.get_uleb();
+        if (succ >= uint64(nblocks))
+          return false;
+        bb.succ.push_back(int(succ));
+      }
+
+      ea_t ea = bb.start;
+      for (int i=0; i < bb.ninsns && r.ok; i++)
+      {
+        insn_feat_t &insn = ff.insns.push_back();
+        insn.ea = ea;
+        insn.size = r.get_u8();
+        insn.itype = uint16(r.get_uleb());
+        insn.nops = r.get_u8();
+        if (insn.nops > BBF_MAXOP)
+          return false;
+
+        for (int iop=0; iop < insn.nops; iop++)
+        {
+          op_feat_t &op = insn.ops[iop];
+          op.type = r.get_u8();
+          op.dtyp = r.get_u8();
+          op.reg = uint16(r.get_uleb());
+          op.value = r.get_uleb();
+        }
+        ea += insn.size;
+      }
+
+      // Truncated: the instructions are missing
+      if (!r.ok)
+        return false;
+
+      bbfeat_hash_insns(ff.insns.begin() + bb.first_insn, bb.ninsns, bb.hash);
+    }
+
+    // Rebuild the predecessors
+    for (int iblock=0; iblock < nblocks && r.ok; iblock++)
+    {
+      const intvec_t &succ = ff.blocks[iblock].succ;
+      for (size_t i=0; i < succ.size(); i++)
+      {
+        ff.blocks[succ[i]].pred.push_back(iblock);
+      }
+    }
+  }
+  return r.ok;
+}
@@ -0,0 +1,61 @@
+#ifndef __SNAPSHOT__
+#define __SNAPSHOT__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Database snapshot module
+
+A compact binary snapshot of the features of all the functions of a
+database (see func_features_t): blocks, edges, ranges and the per
+instruction itype/operand features.
+
+The snapshot lets the analysis run without IDA (see headless.cpp).
+The block hashes are not stored, they are recomputed when loading.
+
+Layout (all integers are LEB128 varints unless noted):
+
+  "GSSNAP" version(u8) db_name(len, chars) nfuncs
+  per function:
+    ea nblocks
+    per block:
+      zigzag(start - ea) (end - start) ninsns nsucc succ...
+      per instruction:
+        size(u8) itype nops(u8)
+        per operand: type(u8) dtyp(u8) reg value
+
+The instructions of a block are contiguous, so their addresses are not
+stored. The predecessors are rebuilt from the successors.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include "bbfeat.h"
+
+//--------------------------------------------------------------------------
+#define SNAPSHOT_EXT "gssnap"
+
+//--------------------------------------------------------------------------
+/**
+* @brief Save a snapshot
+* @param db_name The database path without extension. The headless analyzer
+*                uses it to name the bbgroup files like the plugin does
+*/
+bool snapshot_save(
+    const char *filename,
+    const char *db_name,
+    const func_featvec_t &funcs);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Load a snapshot and recompute the block hashes
+*/
+bool snapshot_load(
+    const char *filename,
+    qstring *db_name,
+    func_featvec_t &funcs);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef __SPSCQ__
+#define __SPSCQ__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Single producer / single consumer queue
+
+A bounded lock-free ring buffer. Exactly one thread may push and exactly
+one (other) thread may pop.
+
+History
+--------
+
+10/18/2026 - eliasb     - First version
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <atomic>
+#include <stddef.h>
+
+//--------------------------------------------------------------------------
+/**
+* @brief Bounded SPSC queue. 'N' must be a power of two
+*/
+template <class T, size_t N>
+class spsc_queue_t
+{
+  T items[N];
+
+  // Written by the consumer only
+  std::atomic<size_t> head;
+
+  // Written by the producer only
+  std::atomic<size_t> tail;
+
+  // No copies
+  spsc_queue_t(const spsc_queue_t &);
+  spsc_queue_t &operator=(const spsc_queue_t &);
+
+public:
+  spsc_queue_t(): head(0), tail(0)
+  {
+  }
+
+  /**
+  * @brief Push an item (producer side)
+  * @return False if the queue is full
+  */
+  bool push(const T &item)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == N)
+      return false;
+
+    items[t & (N - 1)] = item;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+  * @brief Pop an item (consumer side)
+  * @return False if the queue is empty
+  */
+  bool pop(T &item)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+
+    item = items[h & (N - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+  * @brief Checks whether the queue is empty (only exact from the consumer side)
+  */
+  inline bool empty()
+  {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+};
+
+#endif
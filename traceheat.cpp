@@ -0,0 +1,350 @@
+/*--------------------------------------------------------------------------
+History
+--------
+
+10/18/2026 - eliasb             - First version
+--------------------------------------------------------------------------*/
+
+#include "traceheat.h"
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+// Trace file read buffer size
+#define TRACE_READ_SIZE (1 << 20)
+
+// Radix sort digit size
+#define TRACE_RADIX_BITS 11
+
+//--------------------------------------------------------------------------
+void trace_heat_t::clear()
+{
+  nds.clear();
+  ngs.clear();
+  sgs.clear();
+  max_nd = max_ng = max_sg = 0;
+}
+
+//--------------------------------------------------------------------------
+trace_aggregator_t::trace_aggregator_t()
+{
+  batch.reserve(TRACE_BATCH_SIZE);
+}
+
+//--------------------------------------------------------------------------
+bool trace_aggregator_t::ival_less(const ival_t &a, const ival_t &b)
+{
+  return a.start < b.start;
+}
+
+//--------------------------------------------------------------------------
+void trace_aggregator_t::build(groupman_t *gm)
+{
+  ivals.qclear();
+  nds.qclear();
+  nd_ngs.qclear();
+  nd_sgs.qclear();
+  batch.qclear();
+  stats = trace_stats_t();
+
+  psupergroup_listp_t sgl = gm->get_path_sgl();
+  for (supergroup_listp_t::iterator it_sg=sgl->begin();
+       it_sg != sgl->end();
+       ++it_sg)
+  {
+    psupergroup_t sg = *it_sg;
+    for (nodegroup_list_t::iterator it_ng=sg->groups.begin();
+         it_ng != sg->groups.end();
+         ++it_ng)
+    {
+      pnodegroup_t ng = *it_ng;
+      for (nodegroup_t::iterator it_nd=ng->begin();
+           it_nd != ng->end();
+           ++it_nd)
+      {
+        pnodedef_t nd = *it_nd;
+        if (nd->end <= nd->start)
+          continue;
+
+        ival_t &iv = ivals.push_back();
+        iv.start = nd->start;
+        iv.end = nd->end;
+        iv.nd = int(nds.size());
+
+        nds.push_back(nd);
+        nd_ngs.push_back(ng);
+        nd_sgs.push_back(sg);
+      }
+    }
+  }
+
+  // The NDs of the path SGs do not overlap
+  std::sort(ivals.begin(), ivals.end(), ival_less);
+  nd_hits.resize(nds.size());
+  std::fill(nd_hits.begin(), nd_hits.end(), 0);
+}
+
+//--------------------------------------------------------------------------
+void trace_aggregator_t::sort_batch()
+{
+  size_t n = batch.size();
+
+  // Only sort on the bits that vary: traces are mostly within one module
+  ea_t lo = batch[0].ea, hi = lo;
+  for (size_t i=1; i < n; i++)
+  {
+    ea_t ea = batch[i].ea;
+    if (ea < lo)
+      lo = ea;
+    else if (ea > hi)
+      hi = ea;
+  }
+  uint64 range = uint64(hi - lo);
+
+  scratch.resize(n);
+  event_t *src = batch.begin();
+  event_t *dst = scratch.begin();
+  const size_t ndigits = size_t(1) << TRACE_RADIX_BITS;
+  const uint64 mask = ndigits - 1;
+  size_t pos[ndigits];
+  for (int shift=0; shift < 64 && (range >> shift) != 0; shift += TRACE_RADIX_BITS)
+  {
+    memset(pos, 0, sizeof(pos));
+    for (size_t i=0; i < n; i++)
+      ++pos[(uint64(src[i].ea - lo) >> shift) & mask];
+
+    size_t sum = 0;
+    for (size_t d=0; d < ndigits; d++)
+    {
+      size_t c = pos[d];
+      pos[d] = sum;
+      sum += c;
+    }
+
+    for (size_t i=0; i < n; i++)
+      dst[pos[(uint64(src[i].ea - lo) >> shift) & mask]++] = src[i];
+
+    std::swap(src, dst);
+  }
+
+  if (src != batch.begin())
+    batch.swap(scratch);
+}
+
+//--------------------------------------------------------------------------
+void trace_aggregator_t::flush()
+{
+  size_t nevents = batch.size();
+  if (nevents == 0)
+    return;
+
+  stats.events += nevents;
+  sort_batch();
+
+  // Merge the sorted events against the sorted intervals
+  size_t nivals = ivals.size();
+  size_t j = 0;
+  for (size_t i=0; i < nevents && j < nivals; )
+  {
+    ea_t ea = batch[i].ea;
+
+    // Skip the intervals before the event: a linear step first as the
+    // next interval is the likely one, then a binary search
+    if (ea >= ivals[j].end)
+    {
+      ++j;
+      if (j < nivals && ea >= ivals[j].end)
+      {
+        size_t lo = j + 1, hi = nivals;
+        while (lo < hi)
+        {
+          size_t mid = (lo + hi) / 2;
+          if (ivals[mid].end <= ea)
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+        j = lo;
+      }
+      continue;
+    }
+
+    // Sum the events with this address
+    uint64 count = 0;
+    size_t n = 0;
+    do
+    {
+      count += batch[i].count;
+      ++n;
+      ++i;
+    } while (i < nevents && batch[i].ea == ea);
+
+    if (ea >= ivals[j].start)
+    {
+      nd_hits[ivals[j].nd] += count;
+      stats.resolved += n;
+      stats.hits += count;
+    }
+  }
+  batch.qclear();
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief Parse one trace line. Returns false for a malformed line
+*/
+static bool parse_trace_line(
+    const char *p,
+    const char *end,
+    ea_t *ea,
+    uint64 *count,
+    bool *skip)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    ++p;
+
+  *skip = p == end || *p == '#';
+  if (*skip)
+    return true;
+
+  if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+    p += 2;
+
+  uint64 v = 0;
+  const char *start = p;
+  for ( ; p < end; ++p)
+  {
+    char c = *p;
+    int d;
+    if (c >= '0' && c <= '9')
+      d = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      d = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      d = c - 'A' + 10;
+    else
+      break;
+    v = (v << 4) | d;
+  }
+  if (p == start)
+    return false;
+  *ea = ea_t(v);
+
+  // Optional count
+  while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == ':'))
+    ++p;
+
+  if (p == end || *p == '\r')
+  {
+    *count = 1;
+    return true;
+  }
+
+  v = 0;
+  start = p;
+  for ( ; p < end && *p >= '0' && *p <= '9'; ++p)
+    v = v * 10 + (*p - '0');
+
+  if (p == start)
+    return false;
+
+  *count = v;
+  return true;
+}
+
+//--------------------------------------------------------------------------
+bool trace_aggregator_t::add_file(
+    const char *filename,
+    trace_cancel_cb_t *cancel_cb,
+    void *ud)
+{
+  FILE *fp = qfopen(filename, "rb");
+  if (fp == NULL)
+    return false;
+
+  // The buffer keeps the partial last line of the previous read
+  qvector<char> buf;
+  buf.resize(TRACE_READ_SIZE);
+  size_t kept = 0;
+  bool ok = true;
+  for ( ;; )
+  {
+    if (cancel_cb != NULL && cancel_cb(ud))
+    {
+      ok = false;
+      break;
+    }
+
+    if (kept == buf.size())
+    {
+      // A line longer than the buffer: drop it
+      ++stats.bad_lines;
+      kept = 0;
+    }
+
+    ssize_t n = qfread(fp, buf.begin() + kept, buf.size() - kept);
+    bool eof = n <= 0;
+    size_t avail = kept + (eof ? 0 : size_t(n));
+    if (avail == 0)
+      break;
+
+    const char *p = buf.begin();
+    const char *end = p + avail;
+    for ( ;; )
+    {
+      const char *eol = (const char *)memchr(p, '\n', end - p);
+      if (eol == NULL)
+      {
+        // Last line without a new line
+        if (eof)
+          eol = end;
+        else
+          break;
+      }
+
+      ea_t ea;
+      uint64 count;
+      bool skip;
+      if (!parse_trace_line(p, eol, &ea, &count, &skip))
+        ++stats.bad_lines;
+      else if (!skip)
+        add(ea, count);
+
+      p = eol + 1;
+      if (eol == end)
+        break;
+    }
+
+    if (eof)
+      break;
+
+    kept = end - p;
+    memmove(buf.begin(), p, kept);
+  }
+  qfclose(fp);
+  return ok;
+}
+
+//--------------------------------------------------------------------------
+void trace_aggregator_t::get_heat(trace_heat_t &out)
+{
+  flush();
+  out.clear();
+  for (size_t i=0; i < nds.size(); i++)
+  {
+    uint64 hits = nd_hits[i];
+    if (hits == 0)
+      continue;
+
+    uint64 &nd_total = out.nds[nds[i]];
+    nd_total += hits;
+    out.max_nd = qmax(out.max_nd, nd_total);
+
+    uint64 &ng_total = out.ngs[nd_ngs[i]];
+    ng_total += hits;
+    out.max_ng = qmax(out.max_ng, ng_total);
+
+    uint64 &sg_total = out.sgs[nd_sgs[i]];
+    sg_total += hits;
+    out.max_sg = qmax(out.max_sg, sg_total);
+  }
+}
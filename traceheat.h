@@ -0,0 +1,164 @@
+#ifndef __TRACEHEAT__
+#define __TRACEHEAT__
+
+/*--------------------------------------------------------------------------
+GraphSlick (c) Elias Bachaalany
+-------------------------------------
+
+Execution trace heatmap module
+
+Projects block-hit traces (from fuzzers, emulators, ...) onto the groups:
+the hit counts are accumulated per node definition and rolled up to the
+node groups and super groups.
+
+The trace is streamed: the events are buffered in batches, each batch is
+radix sorted by address and merged against the sorted ND intervals of the
+path super groups, so each event costs a few radix passes and a short
+forward search instead of a lookup per address.
+
+Trace file format (text): one event per line, a hexadecimal address
+(with or without '0x') optionally followed by a decimal hit count
+(default 1). Empty lines and lines starting with '#' are ignored.
+
+It does not call the IDA kernel.
+
+--------------------------------------------------------------------------*/
+
+//--------------------------------------------------------------------------
+#include <map>
+#include "groupman.h"
+
+//--------------------------------------------------------------------------
+// Events per sorted batch
+#define TRACE_BATCH_SIZE (1 << 16)
+
+//--------------------------------------------------------------------------
+/**
+* @brief Hit counts per group
+*/
+struct trace_heat_t
+{
+  std::map<pnodedef_t, uint64> nds;
+  std::map<pnodegroup_t, uint64> ngs;
+  std::map<psupergroup_t, uint64> sgs;
+
+  // Largest counts, to scale the colors
+  uint64 max_nd;
+  uint64 max_ng;
+  uint64 max_sg;
+
+  trace_heat_t(): max_nd(0), max_ng(0), max_sg(0)
+  {
+  }
+
+  void clear();
+
+  inline bool empty() const { return nds.empty(); }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Statistics of an aggregation
+*/
+struct trace_stats_t
+{
+  // Events read and those that fell in a node definition
+  uint64 events;
+  uint64 resolved;
+
+  // Hits (sum of the counts) that fell in a node definition
+  uint64 hits;
+
+  // Lines that could not be parsed
+  uint64 bad_lines;
+
+  trace_stats_t(): events(0), resolved(0), hits(0), bad_lines(0)
+  {
+  }
+};
+
+//--------------------------------------------------------------------------
+/**
+* @brief Return true to cancel the aggregation (checked once per batch)
+*/
+typedef bool trace_cancel_cb_t(void *ud);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Streaming trace aggregator over the path SGs of a groupman
+*/
+class trace_aggregator_t
+{
+  struct ival_t
+  {
+    ea_t start;
+    ea_t end;
+    int nd;
+  };
+
+  struct event_t
+  {
+    ea_t ea;
+    uint64 count;
+
+  };
+
+  qvector<ival_t> ivals;
+  qvector<pnodedef_t> nds;
+  qvector<pnodegroup_t> nd_ngs;
+  qvector<psupergroup_t> nd_sgs;
+  qvector<uint64> nd_hits;
+
+  qvector<event_t> batch, scratch;
+  trace_stats_t stats;
+
+  static bool ival_less(const ival_t &a, const ival_t &b);
+
+  /**
+  * @brief LSD radix sort of the batch by address
+  */
+  void sort_batch();
+
+  /**
+  * @brief Resolve and accumulate the buffered events
+  */
+  void flush();
+
+public:
+  trace_aggregator_t();
+
+  /**
+  * @brief Index the ND intervals of the path SGs and reset the counts
+  */
+  void build(groupman_t *gm);
+
+  /**
+  * @brief Add one event
+  */
+  inline void add(ea_t ea, uint64 count = 1)
+  {
+    event_t &ev = batch.push_back();
+    ev.ea = ea;
+    ev.count = count;
+    if (batch.size() >= TRACE_BATCH_SIZE)
+      flush();
+  }
+
+  /**
+  * @brief Stream a trace file
+  * @return False if the file could not be read or the aggregation was canceled
+  */
+  bool add_file(
+      const char *filename,
+      trace_cancel_cb_t *cancel_cb = NULL,
+      void *ud = NULL);
+
+  /**
+  * @brief Flush the pending events and return the counts per group
+  */
+  void get_heat(trace_heat_t &out);
+
+  inline const trace_stats_t &get_stats() const { return stats; }
+};
+
+#endif
@@ -12,6 +12,8 @@ History
 10/25/2013 - eliasb   - Added jump_to_node()
 10/30/2013 - eliasb   - moved str2asizet() and skip_spaces() from other modules
 10/31/2013 - eliasb   - added 'is_ida_gui()'
+10/18/2026 - eliasb   - added get_idb_root_name()
+                      - added fc_to_gsdb_fc() and get_ida_gsdb()
 --------------------------------------------------------------------------*/
 
 //--------------------------------------------------------------------------
@@ -29,13 +31,9 @@ asize_t str2asizet(const char *str)
 }
 
 //--------------------------------------------------------------------------
-const char *get_screen_function_fn(const char *ext)
+void get_idb_root_name(qstring *out)
 {
-    func_t *fnc = get_func(get_screen_ea());
-    if (fnc == NULL)
-        return NULL;
-    
-    static char buf[QMAXPATH] = { 0 };
+    char buf[QMAXPATH];
 
     // Copy database path global var
     set_file_ext(buf, qnumber(buf), database_idb, "");
@@ -43,10 +41,20 @@ const char *get_screen_function_fn(const char *ext)
     if (t > 0 && buf[t - 1] == '.')
         buf[t - 1] = '\0';
 
+    *out = buf;
+}
+
+//--------------------------------------------------------------------------
+const char *get_screen_function_fn(const char *ext)
+{
+    func_t *fnc = get_func(get_screen_ea());
+    if (fnc == NULL)
+        return NULL;
+    
     // format as: dir/file/func->startEA . ext
     static qstring s;
     
-    s = buf;
+    get_idb_root_name(&s);
     s.cat_sprnt("-%08a.%s", fnc->startEA, ext);
 
      return s.c_str();
@@ -101,6 +109,84 @@ bool get_func_flowchart(
   return true;
 }
 
+//--------------------------------------------------------------------------
+void fc_to_gsdb_fc(
+    qflow_chart_t *qf,
+    gsdb_fc_t &fc)
+{
+  int nodes_count = qf->size();
+  fc.clear();
+  fc.func_ea = qf->pfn != NULL ? qf->pfn->startEA : qf->bounds.startEA;
+  fc.blocks.resize(nodes_count);
+  for (int n=0; n < nodes_count; n++)
+  {
+    qbasic_block_t &block = qf->blocks[n];
+    gsdb_block_t &bb = fc.blocks[n];
+    bb.start = block.startEA;
+    bb.end = block.endEA;
+    for (int i=0, nsucc=qf->nsucc(n); i < nsucc; i++)
+      bb.succ.push_back(qf->succ(n, i));
+  }
+  fc.build_preds();
+}
+
+//--------------------------------------------------------------------------
+/**
+* @brief The database queries backed by the IDA database
+*/
+class ida_gsdb_t: public gsdb_t
+{
+public:
+  virtual void get_db_name(qstring *out)
+  {
+    get_idb_root_name(out);
+  }
+
+  virtual size_t get_func_qty()
+  {
+    return ::get_func_qty();
+  }
+
+  virtual ea_t getn_func(size_t n)
+  {
+    func_t *f = ::getn_func(n);
+    return f == NULL ? BADADDR : f->startEA;
+  }
+
+  virtual bool get_func_bounds(ea_t ea, ea_t *start, ea_t *end)
+  {
+    func_t *f = get_func(ea);
+    if (f == NULL)
+      return false;
+
+    *start = f->startEA;
+    *end = f->endEA;
+    return true;
+  }
+
+  virtual bool get_flowchart(ea_t ea, gsdb_fc_t &fc)
+  {
+    qflow_chart_t qf;
+    if (!get_func_flowchart(ea, qf))
+      return false;
+
+    fc_to_gsdb_fc(&qf, fc);
+    return true;
+  }
+
+  virtual void get_disasm_text(ea_t start, ea_t end, qstring *out)
+  {
+    ::get_disasm_text(start, end, out);
+  }
+};
+
+//--------------------------------------------------------------------------
+gsdb_t *get_ida_gsdb()
+{
+  static ida_gsdb_t db;
+  return &db;
+}
+
 //--------------------------------------------------------------------------
 void jump_to_node(graph_viewer_t *gv, int nid)
 {
@@ -17,6 +17,7 @@ This module implements various utility functions
 #include <gdl.hpp>
 #include <graph.hpp>
 #include "types.hpp"
+#include "gsdb.h"
 
 //--------------------------------------------------------------------------
 /**
@@ -57,6 +58,20 @@ bool get_func_flowchart(
     ea_t ea, 
     qflow_chart_t &qf);
 
+//--------------------------------------------------------------------------
+/**
+* @brief Copy an IDA flowchart into the IDA independent flowchart (see gsdb.h)
+*/
+void fc_to_gsdb_fc(
+    qflow_chart_t *qf,
+    gsdb_fc_t &fc);
+
+//--------------------------------------------------------------------------
+/**
+* @brief Return the database queries backed by the IDA database
+*/
+gsdb_t *get_ida_gsdb();
+
 //--------------------------------------------------------------------------
 /**
 * @brief Focuses and jumps to the given node id in the graph viewer
@@ -83,6 +98,12 @@ char *skip_spaces(char *p);
 bool is_ida_gui();
 
 
+//--------------------------------------------------------------------------
+/**
+* @brief Returns the database path without its extension
+*/
+void get_idb_root_name(qstring *out);
+
 //--------------------------------------------------------------------------
 /**
 * @brief Returns a file name containing the idbpath and function start EA